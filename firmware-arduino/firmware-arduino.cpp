@@ -14,6 +14,7 @@
 #include "src/SafePacketSender.h"
 #include "src/MemoryFree.h"
 #include "src/FileIO.h"
+#include "src/TaskScheduler.h"
 
 #define OLED_MOSI PIN_SPI0_MOSI
 #define OLED_MISO PIN_SPI0_MISO
@@ -49,6 +50,84 @@ UIController uiController(&status, &settings, &u8g2, MINUS_BUTTON, PLUS_BUTTON);
 
 volatile SystemMode systemMode = SYSTEM_MODE_UNDETERMINED;
 
+float rp2040Temperature() {
+    adc_select_input(4);
+
+    auto raw = (float)adc_read();
+    const float conversion_factor = 3.3f / (1<<12);
+    float result = raw * conversion_factor;
+    return 27.f - (result -0.706)/0.001721;
+}
+
+void runSafetyTask() {
+    /* @todo This should not be in a timer */
+    if (systemMode != SYSTEM_MODE_NORMAL) {
+        safePacketSender.loop();
+    } else {
+        automationController.loop();
+    }
+}
+
+void runStatusTask() {
+    SystemControllerStatusMessage message;
+
+    /* @todo Check if pico_queue is interrupt safe */
+    while (!queue1->isEmpty()) {
+        queue1->removeBlocking(&message);
+        status.updateStatusMessage(message);
+        networkController.handleStatusMessage(message);
+        status.hasReceivedControlBoardPacket = true;
+        status.hasSentLccPacket = true;
+    }
+
+#ifdef CONTROL_LOOP_PROFILING
+    LoopProfileReport profile;
+
+    if (systemController.takeProfileReport(profile)) {
+        networkController.setLoopProfile(profile);
+    }
+#endif
+}
+
+void runNetworkTask() {
+    networkController.loop();
+
+    status.mode = networkController.getMode();
+    status.wifiConnected = networkController.isConnectedToWifi();
+    status.mqttConnected = networkController.isConnectedToMqtt();
+    status.ipAddress = networkController.getIPAddress();
+}
+
+void runButtonsTask() {
+    uiController.handleButtons();
+}
+
+void runDisplayTask() {
+    uiController.render();
+}
+
+void runDieTemperatureTask() {
+    status.rp2040Temperature = rp2040Temperature();
+}
+
+void runSettingsTask() {
+    // Settings changed by the other tasks only touch RAM, they're written to LittleFS here once they've settled
+    settings.loop();
+}
+
+// In the order they run in. Tasks without a period run on every pass.
+ScheduledTask core1Tasks[] = {
+    ScheduledTask("safety", runSafetyTask),
+    ScheduledTask("status", runStatusTask),
+    ScheduledTask("network", runNetworkTask),
+    ScheduledTask("buttons", runButtonsTask, 10, 20),
+    ScheduledTask("display", runDisplayTask, UI_FRAME_INTERVAL_MS, UI_FRAME_INTERVAL_MS),
+    ScheduledTask("die_temp", runDieTemperatureTask, 1000, 1000),
+    ScheduledTask("settings", runSettingsTask, 100, 1000),
+};
+
+TaskScheduler core1Scheduler(core1Tasks, sizeof(core1Tasks) / sizeof(core1Tasks[0]));
+
 void setup() {
     u8g2.begin();
 
@@ -114,7 +193,9 @@ void setup1()
     u8g2.drawStr(64, 64, "CC");
     u8g2.sendBuffer();
 
-    networkController.init(systemMode);
+    networkController.setTaskScheduler(&core1Scheduler);
+    networkController.setUIController(&uiController);
+    networkController.init(systemMode, core1Relaunches > 0);
 
     u8g2.clearBuffer();
     u8g2.setFont(u8g2_font_9x15_tf);
@@ -137,54 +218,14 @@ void setup1()
         SystemControllerCommand beginCmd = SystemControllerCommand{.type = COMMAND_BEGIN};
         queue0->addBlocking(&beginCmd);
     }
-}
-
-float rp2040Temperature() {
-    adc_select_input(4);
 
-    auto raw = (float)adc_read();
-    const float conversion_factor = 3.3f / (1<<12);
-    float result = raw * conversion_factor;
-    return 27.f - (result -0.706)/0.001721;
+    // When core 0 relaunches core 1, the boot screens above have replaced the frame the UI controller last sent
+    uiController.invalidate();
 }
 
 void loop1()
 {
-    /* @todo This should not be in a timer */
-    if (systemMode != SYSTEM_MODE_NORMAL) {
-        safePacketSender.loop();
-    } else {
-        automationController.loop();
-    }
-
-    /* @todo We can either use hardware_timer or pico_time/repeating_timer. Regardless, we'll have to create a core1 alarm pool */
-
-    SystemControllerStatusMessage message;
-
-    /* @todo Check if pico_queue is interrupt safe */
-    while (!queue1->isEmpty()) {
-        queue1->removeBlocking(&message);
-        status.updateStatusMessage(message);
-        status.hasReceivedControlBoardPacket = true;
-        status.hasSentLccPacket = true;
-    }
-
-    networkController.loop();
-
-    status.mode = networkController.getMode();
-    status.wifiConnected = networkController.isConnectedToWifi();
-    status.mqttConnected = networkController.isConnectedToMqtt();
-    status.ipAddress = networkController.getIPAddress();
-
-    /* @todo This should also not be run in an interrupt */
-    status.rp2040Temperature = rp2040Temperature();
-
-    /*
-     * @todo
-     * This is *not* interrupt safe, because it can trigger LittleFS-writes. That'll have to be handled by writing
-     * to some kind of shadow config and updating LittleFS from within loop1.
-     */
-    uiController.loop();
+    core1Scheduler.loop();
 }
 
 void loop() {
@@ -159,6 +159,7 @@ PubSubClient::PubSubClient(const char* domain, uint16_t port, MQTT_CALLBACK_SIGN
 
 PubSubClient::~PubSubClient() {
   free(this->buffer);
+  free(this->batchBuffer);
 }
 
 boolean PubSubClient::connect(const char *id) {
@@ -178,6 +179,27 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
 }
 
 boolean PubSubClient::connect(const char *id, const char *user, const char *pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession) {
+    if (!beginConnect(id, user, pass, willTopic, willQos, willRetain, willMessage, cleanSession)) {
+        return false;
+    }
+
+    while (pollConnect() == MQTT_CONNECTING) {
+
+// Start Tasmota patch
+        delay(0);  // Prevent watchdog crashes
+// End Tasmota patch
+
+    }
+
+    if (_state != MQTT_CONNECTED && this->connectionVersion != this->protocolVersion) {
+        // The broker turned MQTT 5 down, try again with the fallback
+        return connect(id, user, pass, willTopic, willQos, willRetain, willMessage, cleanSession);
+    }
+
+    return _state == MQTT_CONNECTED;
+}
+
+boolean PubSubClient::beginConnect(const char *id, const char *user, const char *pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession) {
     if (!connected()) {
         int result = 0;
 
@@ -206,19 +228,35 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
 
         if (result == 1) {
             nextMsgId = 1;
+            lastPubackId = 0;
+            pingOutstanding = false;
+            batching = false;
+            batchLength = 0;
+            connectionVersion = protocolVersion;
+            topicAliasMaximum = 0;
+            topicAliasCount = 0;
+            topicAliasArenaUsed = 0;
+            pendingTopicAliasLength = 0;
             // Leave room in the buffer for header and variable length field
             uint16_t length = MQTT_MAX_HEADER_SIZE;
             unsigned int j;
 
+            if (connectionVersion == MQTT_VERSION_5) {
+                uint8_t d[7] = {0x00,0x04,'M','Q','T','T',MQTT_VERSION_5};
+                for (j = 0;j<7;j++) {
+                    this->buffer[length++] = d[j];
+                }
+            } else {
 #if MQTT_VERSION == MQTT_VERSION_3_1
-            uint8_t d[9] = {0x00,0x06,'M','Q','I','s','d','p', MQTT_VERSION};
+                uint8_t d[9] = {0x00,0x06,'M','Q','I','s','d','p', MQTT_VERSION};
 #define MQTT_HEADER_VERSION_LENGTH 9
 #elif MQTT_VERSION == MQTT_VERSION_3_1_1
-            uint8_t d[7] = {0x00,0x04,'M','Q','T','T',MQTT_VERSION};
+                uint8_t d[7] = {0x00,0x04,'M','Q','T','T',MQTT_VERSION};
 #define MQTT_HEADER_VERSION_LENGTH 7
 #endif
-            for (j = 0;j<MQTT_HEADER_VERSION_LENGTH;j++) {
-                this->buffer[length++] = d[j];
+                for (j = 0;j<MQTT_HEADER_VERSION_LENGTH;j++) {
+                    this->buffer[length++] = d[j];
+                }
             }
 
             uint8_t v;
@@ -240,12 +278,22 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
             }
             this->buffer[length++] = v;
 
-            this->buffer[length++] = ((this->keepAlive) >> 8);
-            this->buffer[length++] = ((this->keepAlive) & 0xFF);
+            negotiatedKeepAlive = getKeepAlive();
+            this->buffer[length++] = ((negotiatedKeepAlive) >> 8);
+            this->buffer[length++] = ((negotiatedKeepAlive) & 0xFF);
+
+            if (connectionVersion == MQTT_VERSION_5) {
+                // No CONNECT properties, so the broker won't send us topic aliases
+                this->buffer[length++] = 0;
+            }
 
             CHECK_STRING_LENGTH(length,id)
             length = writeString(id,this->buffer,length);
             if (willTopic) {
+                if (connectionVersion == MQTT_VERSION_5) {
+                    // No will properties
+                    this->buffer[length++] = 0;
+                }
                 CHECK_STRING_LENGTH(length,willTopic)
                 length = writeString(willTopic,this->buffer,length);
                 CHECK_STRING_LENGTH(length,willMessage)
@@ -264,40 +312,80 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
             write(MQTTCONNECT,this->buffer,length-MQTT_MAX_HEADER_SIZE);
 
             lastInActivity = lastOutActivity = millis();
+            _state = MQTT_CONNECTING;
+            return true;
+        } else {
+            _state = MQTT_CONNECT_FAILED;
+        }
+        return false;
+    }
+    return true;
+}
 
-            while (!_client->available()) {
-
-// Start Tasmota patch
-                delay(0);  // Prevent watchdog crashes
-// End Tasmota patch
-
-                unsigned long t = millis();
-                if (t-lastInActivity >= ((int32_t) this->socketTimeout*1000UL)) {
-                    _state = MQTT_CONNECTION_TIMEOUT;
-                    _client->stop();
-                    return false;
-                }
-            }
-            uint8_t llen;
-            uint32_t len = readPacket(&llen);
+int PubSubClient::pollConnect() {
+    if (_state != MQTT_CONNECTING) {
+        return _state;
+    }
 
-            if (len == 4) {
-                if (buffer[3] == 0) {
-                    lastInActivity = millis();
-                    pingOutstanding = false;
-                    _state = MQTT_CONNECTED;
-                    return true;
-                } else {
-                    _state = buffer[3];
-                }
+    if (!_client->available()) {
+        unsigned long t = millis();
+        if (t-lastInActivity >= getSocketTimeoutMs()) {
+            _state = MQTT_CONNECTION_TIMEOUT;
+            _client->stop();
+        } else if (!_client->connected()) {
+            // Brokers that don't know MQTT 5 may just close the connection
+            if (connectionVersion == MQTT_VERSION_5) {
+                protocolVersion = MQTT_VERSION;
             }
+            _state = MQTT_CONNECT_FAILED;
             _client->stop();
-        } else {
+        }
+        return _state;
+    }
+
+    uint8_t llen;
+    uint32_t len = readPacket(&llen);
+
+    if (connectionVersion == MQTT_VERSION_5) {
+        if (len < (uint32_t)llen+3 || (buffer[0]&0xF0) != MQTTCONNACK) {
             _state = MQTT_CONNECT_FAILED;
+            _client->stop();
+            return _state;
         }
-        return false;
+
+        uint8_t reasonCode = buffer[llen+2];
+        if (reasonCode == 0 && readConnackProperties(llen+3, len)) {
+            lastInActivity = millis();
+            pingOutstanding = false;
+            _state = MQTT_CONNECTED;
+            return _state;
+        }
+
+        switch (reasonCode) {
+            case 0x00: _state = MQTT_CONNECT_FAILED; break; // Malformed properties
+            case 0x01: // MQTT 3.1.1 brokers answer with their own CONNACK
+            case 0x84: _state = MQTT_CONNECT_BAD_PROTOCOL; protocolVersion = MQTT_VERSION; break;
+            case 0x85: _state = MQTT_CONNECT_BAD_CLIENT_ID; break;
+            case 0x86: _state = MQTT_CONNECT_BAD_CREDENTIALS; break;
+            case 0x87: _state = MQTT_CONNECT_UNAUTHORIZED; break;
+            case 0x88:
+            case 0x89: _state = MQTT_CONNECT_UNAVAILABLE; break;
+            default: _state = reasonCode; break;
+        }
+        _client->stop();
+        return _state;
     }
-    return true;
+
+    if (len == 4 && buffer[3] == 0) {
+        lastInActivity = millis();
+        pingOutstanding = false;
+        _state = MQTT_CONNECTED;
+        return _state;
+    }
+
+    _state = (len == 4) ? buffer[3] : MQTT_CONNECT_FAILED;
+    _client->stop();
+    return _state;
 }
 
 // reads a byte into result
@@ -310,6 +398,7 @@ boolean PubSubClient::readByte(uint8_t * result) {
 // End Tasmota patch
 
    uint32_t previousMillis = millis();
+   uint32_t timeoutMs = getSocketTimeoutMs();
    while(!_client->available()) {
 
 // Start Tasmota patch
@@ -319,7 +408,7 @@ boolean PubSubClient::readByte(uint8_t * result) {
 // End Tasmota patch
 
      uint32_t currentMillis = millis();
-     if(currentMillis - previousMillis >= ((int32_t) this->socketTimeout * 1000)){
+     if(currentMillis - previousMillis >= timeoutMs){
        return false;
      }
    }
@@ -404,8 +493,13 @@ uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
 
 boolean PubSubClient::loop() {
     if (connected()) {
+        // Anything left in a batch has to go out before pings and acknowledgements
+        if (!flushBatch()) {
+            return false;
+        }
+
         unsigned long t = millis();
-        if ((t - lastInActivity > this->keepAlive*1000UL) || (t - lastOutActivity > this->keepAlive*1000UL)) {
+        if ((t - lastInActivity > this->negotiatedKeepAlive*1000UL) || (t - lastOutActivity > this->negotiatedKeepAlive*1000UL)) {
             if (pingOutstanding) {
                 this->_state = MQTT_CONNECTION_TIMEOUT;
                 _client->stop();
@@ -437,7 +531,7 @@ boolean PubSubClient::loop() {
                 lastInActivity = t;
                 uint8_t type = this->buffer[0]&0xF0;
                 if (type == MQTTPUBLISH) {
-                    if (callback) {
+                    if (callback || messageCallback) {
                         uint16_t tl = (this->buffer[llen+1]<<8)+this->buffer[llen+2]; /* topic length in bytes */
 
 // Start Tasmota patch
@@ -450,15 +544,49 @@ boolean PubSubClient::loop() {
                         }
 // End Tasmota patch
 
-                        memmove(this->buffer+llen+2,this->buffer+llen+3,tl); /* move topic inside buffer 1 byte to front */
-                        this->buffer[llen+2+tl] = 0; /* end the topic as a 'C' string with \x00 */
-                        char *topic = (char*) this->buffer+llen+2;
+                        uint16_t payloadOffset = llen+3+tl;
                         // msgId only present for QOS>0
-                        if ((this->buffer[0]&0x06) == MQTTQOS1) {
-                            msgId = (this->buffer[llen+3+tl]<<8)+this->buffer[llen+3+tl+1];
-                            payload = this->buffer+llen+3+tl+2;
-                            callback(topic,payload,len-llen-3-tl-2);
+                        boolean isQos1 = (this->buffer[0]&0x06) == MQTTQOS1;
+                        if (isQos1) {
+                            msgId = (this->buffer[payloadOffset]<<8)+this->buffer[payloadOffset+1];
+                            payloadOffset += 2;
+                        }
+                        if (this->connectionVersion == MQTT_VERSION_5) {
+                            // The broker never sends a topic alias, as none were allowed in CONNECT
+                            uint32_t propertiesLength = 0;
+                            uint32_t multiplier = 1;
+                            uint8_t digit;
+                            do {
+                                if (payloadOffset >= len || multiplier > 128*128*128) {
+                                    return true;
+                                }
+                                digit = this->buffer[payloadOffset++];
+                                propertiesLength += (digit & 127) * multiplier;
+                                multiplier <<= 7;
+                            } while ((digit & 128) != 0);
+                            if (propertiesLength > len) {
+                                return true;
+                            }
+                            payloadOffset += propertiesLength;
+                        }
+                        if (payloadOffset > len) {
+                            // Malformed packet, the topic and msgId don't fit in it
+                            return true;
+                        }
+                        payload = this->buffer+payloadOffset;
+
+                        if (messageCallback) {
+                            MqttMessage message = { (const char*) this->buffer+llen+3, tl, payload, (unsigned int)(len-payloadOffset) };
+                            messageCallback(message);
+                        } else {
+                            memmove(this->buffer+llen+2,this->buffer+llen+3,tl); /* move topic inside buffer 1 byte to front */
+                            receiveBytesMoved += tl;
+                            this->buffer[llen+2+tl] = 0; /* end the topic as a 'C' string with \x00 */
+                            char *topic = (char*) this->buffer+llen+2;
+                            callback(topic,payload,len-payloadOffset);
+                        }
 
+                        if (isQos1) {
                             this->buffer[0] = MQTTPUBACK;
                             this->buffer[1] = 2;
                             this->buffer[2] = (msgId >> 8);
@@ -473,9 +601,6 @@ boolean PubSubClient::loop() {
                             }
 // End Tasmota patch
 
-                        } else {
-                            payload = this->buffer+llen+3+tl;
-                            callback(topic,payload,len-llen-3-tl);
                         }
                     }
                 } else if (type == MQTTPINGREQ) {
@@ -484,6 +609,11 @@ boolean PubSubClient::loop() {
                     _client->write(this->buffer,2);
                 } else if (type == MQTTPINGRESP) {
                     pingOutstanding = false;
+                } else if (type == MQTTPUBACK && len >= 4) {
+                    // On MQTT 5 a reason code may follow the msgId, leaving it out means success
+                    if (this->connectionVersion != MQTT_VERSION_5 || len < 5 || this->buffer[4] < 0x80) {
+                        lastPubackId = (this->buffer[2]<<8)+this->buffer[3];
+                    }
                 }
             } else if (!connected()) {
                 // readPacket has closed the connection
@@ -509,13 +639,13 @@ boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigne
 
 boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained) {
     if (connected()) {
-        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + plength) {
+        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + publishOverhead() + plength) {
             // Too long
             return false;
         }
         // Leave room in the buffer for header and variable length field
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        length = writeString(topic,this->buffer,length);
+        length = writePublishVariableHeader(topic,0,length);
 
         // Add payload
         uint16_t i;
@@ -533,6 +663,43 @@ boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigne
     return false;
 }
 
+uint16_t PubSubClient::publishQos1(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained) {
+    if (connected()) {
+        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + 2 + publishOverhead() + plength) {
+            // Too long
+            return 0;
+        }
+        nextMsgId++;
+        if (nextMsgId == 0) {
+            nextMsgId = 1;
+        }
+        uint16_t msgId = nextMsgId;
+
+        // Leave room in the buffer for header and variable length field
+        uint16_t length = MQTT_MAX_HEADER_SIZE;
+        length = writePublishVariableHeader(topic,msgId,length);
+
+        // Add payload
+        memcpy(this->buffer+length, payload, plength);
+        length += plength;
+
+        // Write the header
+        uint8_t header = MQTTPUBLISH | MQTTQOS1;
+        if (retained) {
+            header |= 1;
+        }
+        if (!write(header,this->buffer,length-MQTT_MAX_HEADER_SIZE)) {
+            return 0;
+        }
+        return msgId;
+    }
+    return 0;
+}
+
+boolean PubSubClient::isAcknowledged(uint16_t msgId) {
+    return msgId != 0 && lastPubackId == msgId;
+}
+
 boolean PubSubClient::publish_P(const char* topic, const char* payload, boolean retained) {
     return publish_P(topic, (const uint8_t*)payload, payload ? strnlen(payload, this->bufferSize) : 0, retained);
 }
@@ -558,8 +725,26 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
     if (retained) {
         header |= 1;
     }
+
+    if (MQTT_MAX_HEADER_SIZE + 2 + tlen + publishOverhead() + plength <= this->bufferSize) {
+        // Copy the payload out of program memory, so the packet goes out in a single write
+        uint16_t length = writePublishVariableHeader(topic,0,MQTT_MAX_HEADER_SIZE);
+        for (i=0;i<plength;i++) {
+            this->buffer[length++] = pgm_read_byte_near(payload + i);
+        }
+        return write(header,this->buffer,length-MQTT_MAX_HEADER_SIZE);
+    }
+
+    // Doesn't fit in the buffer, so the payload is written byte by byte, after anything batched
+    if (!flushBatch()) {
+        return false;
+    }
+
+    // On MQTT 5 this is sent without properties, so no alias or expiry
+    uint8_t propertiesLength = (this->connectionVersion == MQTT_VERSION_5) ? 1 : 0;
+
     this->buffer[pos++] = header;
-    len = plength + 2 + tlen;
+    len = plength + 2 + tlen + propertiesLength;
     do {
         digit = len  & 127; //digit = len %128
         len >>= 7; //len = len / 128
@@ -571,6 +756,9 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
     } while(len>0);
 
     pos = writeString(topic,this->buffer,pos);
+    if (propertiesLength) {
+        this->buffer[pos++] = 0;
+    }
 
     rc += _client->write(this->buffer,pos);
 
@@ -586,16 +774,21 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
     }
 // End Tasmota patch
 
-    expectedLength = 1 + llen + 2 + tlen + plength;
+    expectedLength = 1 + llen + 2 + tlen + propertiesLength + plength;
 
     return (rc == expectedLength);
 }
 
 boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, boolean retained) {
     if (connected()) {
+        // The payload is written straight to the client, so anything batched has to go first
+        if (!flushBatch()) {
+            return false;
+        }
+
         // Send the header and variable length field
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        length = writeString(topic,this->buffer,length);
+        length = writePublishVariableHeader(topic,0,length);
         uint8_t header = MQTTPUBLISH;
         if (retained) {
             header |= 1;
@@ -611,7 +804,11 @@ boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, bool
         }
 // End Tasmota patch
 
-        return (rc == (length-(MQTT_MAX_HEADER_SIZE-hlen)));
+        if (rc != (length-(MQTT_MAX_HEADER_SIZE-hlen))) {
+            return false;
+        }
+        commitTopicAlias();
+        return true;
     }
     return false;
 }
@@ -620,6 +817,38 @@ int PubSubClient::endPublish() {
  return 1;
 }
 
+uint8_t* PubSubClient::beginPublishInPlace(const char* topic, size_t* capacity) {
+    *capacity = 0;
+    this->inPlaceOffset = 0;
+    if (connected()) {
+        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2 + strnlen(topic, this->bufferSize) + publishOverhead()) {
+            // Too long
+            return NULL;
+        }
+        // Leave room in the buffer for header and variable length field
+        this->inPlaceOffset = writePublishVariableHeader(topic,0,MQTT_MAX_HEADER_SIZE);
+        *capacity = this->bufferSize - this->inPlaceOffset;
+        return this->buffer + this->inPlaceOffset;
+    }
+    return NULL;
+}
+
+boolean PubSubClient::endPublishInPlace(unsigned int plength, boolean retained) {
+    uint16_t offset = this->inPlaceOffset;
+    this->inPlaceOffset = 0;
+    if (offset == 0 || plength > (unsigned int)(this->bufferSize - offset)) {
+        return false;
+    }
+    if (connected()) {
+        uint8_t header = MQTTPUBLISH;
+        if (retained) {
+            header |= 1;
+        }
+        return write(header,this->buffer,offset+plength-MQTT_MAX_HEADER_SIZE);
+    }
+    return false;
+}
+
 size_t PubSubClient::write(uint8_t data) {
 
 // Start Tasmota patch
@@ -683,12 +912,34 @@ size_t PubSubClient::buildHeader(uint8_t header, uint8_t* buf, uint16_t length)
 }
 
 boolean PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
-    uint16_t rc;
     uint8_t hlen = buildHeader(header, buf, length);
+    uint8_t* packet = buf+(MQTT_MAX_HEADER_SIZE-hlen);
+    uint16_t packetLength = length+hlen;
+    boolean result;
+
+    if (this->batching && this->batchLength + packetLength > this->batchBufferSize && !flushBatch()) {
+        return false;
+    }
+    if (this->batching && packetLength <= this->batchBufferSize) {
+        memcpy(this->batchBuffer+this->batchLength, packet, packetLength);
+        this->batchLength += packetLength;
+        result = true;
+    } else {
+        result = writeToClient(packet, packetLength);
+    }
+
+    if (result && (header & 0xF0) == MQTTPUBLISH) {
+        commitTopicAlias();
+    }
+    return result;
+}
+
+boolean PubSubClient::writeToClient(const uint8_t* buf, uint16_t length) {
+    uint16_t rc;
 
 #ifdef MQTT_MAX_TRANSFER_SIZE
-    uint8_t* writeBuf = buf+(MQTT_MAX_HEADER_SIZE-hlen);
-    uint16_t bytesRemaining = length+hlen;  //Match the length type
+    const uint8_t* writeBuf = buf;
+    uint16_t bytesRemaining = length;  //Match the length type
     uint8_t bytesToWrite;
     boolean result = true;
     while((bytesRemaining > 0) && result) {
@@ -700,7 +951,7 @@ boolean PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
     }
     return result;
 #else
-    rc = _client->write(buf+(MQTT_MAX_HEADER_SIZE-hlen),length+hlen);
+    rc = _client->write(buf,length);
 
 // Start Tasmota patch
 //    lastOutActivity = millis();
@@ -710,10 +961,36 @@ boolean PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
     }
 // End Tasmota patch
 
-    return (rc == hlen+length);
+    return (rc == length);
 #endif
 }
 
+void PubSubClient::beginBatch() {
+    this->batching = (this->batchBufferSize > 0);
+}
+
+boolean PubSubClient::endBatch() {
+    this->batching = false;
+    return flushBatch();
+}
+
+boolean PubSubClient::flushBatch() {
+    if (this->batchLength == 0) {
+        return true;
+    }
+    uint16_t length = this->batchLength;
+    this->batchLength = 0;
+    if (!connected() || !writeToClient(this->batchBuffer, length)) {
+        // Aliases were taken when their PUBLISH was batched, so the broker may never have seen them.
+        // Forgetting them makes the next publishes send the full topic and establish them again.
+        this->topicAliasCount = 0;
+        this->topicAliasArenaUsed = 0;
+        this->pendingTopicAliasLength = 0;
+        return false;
+    }
+    return true;
+}
+
 boolean PubSubClient::subscribe(const char* topic) {
     return subscribe(topic, 0);
 }
@@ -726,7 +1003,7 @@ boolean PubSubClient::subscribe(const char* topic, uint8_t qos) {
     if (qos > 1) {
         return false;
     }
-    if (this->bufferSize < 9 + topicLength) {
+    if (this->bufferSize < 9 + topicLength + (this->connectionVersion == MQTT_VERSION_5 ? 1 : 0)) {
         // Too long
         return false;
     }
@@ -739,6 +1016,10 @@ boolean PubSubClient::subscribe(const char* topic, uint8_t qos) {
         }
         this->buffer[length++] = (nextMsgId >> 8);
         this->buffer[length++] = (nextMsgId & 0xFF);
+        if (this->connectionVersion == MQTT_VERSION_5) {
+            // No properties
+            this->buffer[length++] = 0;
+        }
         length = writeString((char*)topic, this->buffer,length);
         this->buffer[length++] = qos;
         return write(MQTTSUBSCRIBE|MQTTQOS1,this->buffer,length-MQTT_MAX_HEADER_SIZE);
@@ -751,7 +1032,7 @@ boolean PubSubClient::unsubscribe(const char* topic) {
     if (topic == 0) {
         return false;
     }
-    if (this->bufferSize < 9 + topicLength) {
+    if (this->bufferSize < 9 + topicLength + (this->connectionVersion == MQTT_VERSION_5 ? 1 : 0)) {
         // Too long
         return false;
     }
@@ -763,6 +1044,10 @@ boolean PubSubClient::unsubscribe(const char* topic) {
         }
         this->buffer[length++] = (nextMsgId >> 8);
         this->buffer[length++] = (nextMsgId & 0xFF);
+        if (this->connectionVersion == MQTT_VERSION_5) {
+            // No properties
+            this->buffer[length++] = 0;
+        }
         length = writeString(topic, this->buffer,length);
         return write(MQTTUNSUBSCRIBE|MQTTQOS1,this->buffer,length-MQTT_MAX_HEADER_SIZE);
     }
@@ -789,9 +1074,153 @@ void PubSubClient::disconnect(bool disconnect_package) {
     _state = MQTT_DISCONNECTED;
 // End Tasmota patch
 
+    batching = false;
+    batchLength = 0;
     lastInActivity = lastOutActivity = millis();
 }
 
+uint16_t PubSubClient::writePublishVariableHeader(const char* topic, uint16_t msgId, uint16_t pos) {
+    if (this->connectionVersion != MQTT_VERSION_5) {
+        pos = writeString(topic,this->buffer,pos);
+        if (msgId != 0) {
+            this->buffer[pos++] = (msgId >> 8);
+            this->buffer[pos++] = (msgId & 0xFF);
+        }
+        return pos;
+    }
+
+    boolean established = false;
+    this->pendingTopicAliasLength = 0;
+    uint16_t alias = topicAlias(topic, &established);
+    if (established) {
+        // An empty topic, the broker maps the alias back to it
+        this->buffer[pos++] = 0;
+        this->buffer[pos++] = 0;
+    } else {
+        pos = writeString(topic,this->buffer,pos);
+    }
+    if (msgId != 0) {
+        this->buffer[pos++] = (msgId >> 8);
+        this->buffer[pos++] = (msgId & 0xFF);
+    }
+
+    this->buffer[pos++] = (this->messageExpiry ? 5 : 0) + (alias ? 3 : 0);
+    if (this->messageExpiry) {
+        this->buffer[pos++] = MQTT5_PROPERTY_MESSAGE_EXPIRY;
+        this->buffer[pos++] = (this->messageExpiry >> 24);
+        this->buffer[pos++] = (this->messageExpiry >> 16) & 0xFF;
+        this->buffer[pos++] = (this->messageExpiry >> 8) & 0xFF;
+        this->buffer[pos++] = (this->messageExpiry & 0xFF);
+    }
+    if (alias) {
+        this->buffer[pos++] = MQTT5_PROPERTY_TOPIC_ALIAS;
+        this->buffer[pos++] = (alias >> 8);
+        this->buffer[pos++] = (alias & 0xFF);
+    }
+    return pos;
+}
+
+uint16_t PubSubClient::topicAlias(const char* topic, boolean* established) {
+    *established = false;
+    for (uint8_t i = 0; i < this->topicAliasCount; i++) {
+        if (strcmp(this->topicAliasArena + this->topicAliasOffsets[i], topic) == 0) {
+            *established = true;
+            return i + 1;
+        }
+    }
+
+    size_t topicLength = strlen(topic);
+    if (!this->topicAliasing || this->topicAliasCount >= this->topicAliasMaximum || this->topicAliasCount >= MQTT_MAX_TOPIC_ALIASES ||
+            this->topicAliasArenaUsed + topicLength + 1 > MQTT_TOPIC_ALIAS_ARENA_SIZE) {
+        return 0;
+    }
+
+    // The alias is established by this publish, which still carries the full topic
+    this->topicAliasOffsets[this->topicAliasCount] = this->topicAliasArenaUsed;
+    memcpy(this->topicAliasArena + this->topicAliasArenaUsed, topic, topicLength + 1);
+    this->pendingTopicAliasLength = topicLength + 1;
+    return this->topicAliasCount + 1;
+}
+
+void PubSubClient::commitTopicAlias() {
+    if (this->pendingTopicAliasLength > 0) {
+        this->topicAliasArenaUsed += this->pendingTopicAliasLength;
+        this->topicAliasCount++;
+        this->pendingTopicAliasLength = 0;
+    }
+}
+
+uint16_t PubSubClient::publishOverhead() {
+    return (this->connectionVersion == MQTT_VERSION_5) ? MQTT5_MAX_PUBLISH_PROPERTIES_SIZE : 0;
+}
+
+boolean PubSubClient::readConnackProperties(uint16_t pos, uint16_t end) {
+    uint32_t propertiesLength = 0;
+    uint32_t multiplier = 1;
+    uint8_t digit;
+    do {
+        if (pos >= end || multiplier > 128*128*128) {
+            return false;
+        }
+        digit = this->buffer[pos++];
+        propertiesLength += (digit & 127) * multiplier;
+        multiplier <<= 7;
+    } while ((digit & 128) != 0);
+
+    if (pos + propertiesLength > end) {
+        return false;
+    }
+    end = pos + propertiesLength;
+
+    while (pos < end) {
+        uint8_t id = this->buffer[pos++];
+        uint16_t size;
+        switch (id) {
+            case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A:
+                size = 1;
+                break;
+            case 0x13: case 0x21: case 0x22: case 0x23:
+                size = 2;
+                break;
+            case 0x02: case 0x11: case 0x18: case 0x27:
+                size = 4;
+                break;
+            case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1A: case 0x1C: case 0x1F:
+                // UTF-8 string or binary data
+                if (pos + 2 > end) {
+                    return false;
+                }
+                size = 2 + ((this->buffer[pos]<<8)+this->buffer[pos+1]);
+                break;
+            case 0x26:
+                // User property, a pair of strings
+                if (pos + 2 > end) {
+                    return false;
+                }
+                size = 2 + ((this->buffer[pos]<<8)+this->buffer[pos+1]);
+                if (pos + size + 2 > end) {
+                    return false;
+                }
+                size += 2 + ((this->buffer[pos+size]<<8)+this->buffer[pos+size+1]);
+                break;
+            default:
+                return false;
+        }
+        if (pos + size > end) {
+            return false;
+        }
+
+        if (id == MQTT5_PROPERTY_TOPIC_ALIAS_MAXIMUM) {
+            this->topicAliasMaximum = (this->buffer[pos]<<8)+this->buffer[pos+1];
+        } else if (id == MQTT5_PROPERTY_SERVER_KEEP_ALIVE) {
+            // The broker may override our keepAlive
+            this->negotiatedKeepAlive = (this->buffer[pos]<<8)+this->buffer[pos+1];
+        }
+        pos += size;
+    }
+    return true;
+}
+
 uint16_t PubSubClient::writeString(const char* string, uint8_t* buf, uint16_t pos) {
     const char* idp = string;
     uint16_t i = 0;
@@ -859,6 +1288,11 @@ PubSubClient& PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
     return *this;
 }
 
+PubSubClient& PubSubClient::setMessageCallback(MQTT_MESSAGE_CALLBACK_SIGNATURE) {
+    this->messageCallback = messageCallback;
+    return *this;
+}
+
 PubSubClient& PubSubClient::setClient(Client& client){
     this->_client = &client;
     return *this;
@@ -892,14 +1326,87 @@ boolean PubSubClient::setBufferSize(uint16_t size) {
     return (this->buffer != NULL);
 }
 
+boolean PubSubClient::setBatchBufferSize(uint16_t size) {
+    if (size == 0) {
+        // Cannot set it back to 0
+        return false;
+    }
+    if (this->batchLength > 0) {
+        // Would lose what's already batched
+        return false;
+    }
+    uint8_t* newBuffer = (uint8_t*)realloc(this->batchBuffer, size);
+    if (newBuffer == NULL) {
+        return false;
+    }
+    this->batchBuffer = newBuffer;
+    this->batchBufferSize = size;
+    return true;
+}
+
 uint16_t PubSubClient::getBufferSize() {
     return this->bufferSize;
 }
+
+uint32_t PubSubClient::getReceiveBytesMoved() {
+    return this->receiveBytesMoved;
+}
+
 PubSubClient& PubSubClient::setKeepAlive(uint16_t keepAlive) {
     this->keepAlive = keepAlive;
     return *this;
 }
 PubSubClient& PubSubClient::setSocketTimeout(uint16_t timeout) {
-    this->socketTimeout = timeout;
+    this->socketTimeoutMs = timeout*1000UL;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setSocketTimeoutMs(uint32_t timeoutMs) {
+    this->socketTimeoutMs = timeoutMs;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setProtocolVersion(uint8_t version) {
+    this->protocolVersion = version;
+    return *this;
+}
+
+uint8_t PubSubClient::getProtocolVersion() {
+    return this->protocolVersion;
+}
+
+PubSubClient& PubSubClient::setMessageExpiry(uint32_t seconds) {
+    this->messageExpiry = seconds;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setTopicAliasing(boolean enabled) {
+    this->topicAliasing = enabled;
     return *this;
 }
+
+PubSubClient& PubSubClient::setAdaptiveTimeouts(boolean enabled) {
+    this->adaptiveTimeouts = enabled;
+    return *this;
+}
+
+void PubSubClient::reportRssi(int8_t rssi) {
+    this->linkRssi = rssi;
+}
+
+uint16_t PubSubClient::getKeepAlive() {
+    if (this->adaptiveTimeouts && this->linkRssi != 0 && this->linkRssi < MQTT_ADAPTIVE_WEAK_RSSI) {
+        uint32_t keepAlive = (uint32_t)this->keepAlive * MQTT_ADAPTIVE_KEEPALIVE_FACTOR;
+        return keepAlive > 0xFFFF ? 0xFFFF : keepAlive;
+    }
+    return this->keepAlive;
+}
+
+uint32_t PubSubClient::getSocketTimeoutMs() {
+    // An outstanding ping means the link may be stalling, so the full timeout applies
+    if (this->adaptiveTimeouts && this->linkRssi != 0 && this->linkRssi >= MQTT_ADAPTIVE_GOOD_RSSI && !this->pingOutstanding
+            && MQTT_ADAPTIVE_SOCKET_TIMEOUT_MS < this->socketTimeoutMs) {
+        return MQTT_ADAPTIVE_SOCKET_TIMEOUT_MS;
+    }
+    return this->socketTimeoutMs;
+}
@@ -14,8 +14,9 @@
 
 #define MQTT_VERSION_3_1      3
 #define MQTT_VERSION_3_1_1    4
+#define MQTT_VERSION_5        5
 
-// MQTT_VERSION : Pick the version
+// MQTT_VERSION : Pick the default version. MQTT 5 can be selected per connection with setProtocolVersion()
 //#define MQTT_VERSION MQTT_VERSION_3_1
 #ifndef MQTT_VERSION
 #define MQTT_VERSION MQTT_VERSION_3_1_1
@@ -37,12 +38,46 @@
 #define MQTT_SOCKET_TIMEOUT 15
 #endif
 
+// MQTT_ADAPTIVE_SOCKET_TIMEOUT_MS : socket timeout used in adaptive mode while the link is healthy.
+//  Enable adaptive mode with setAdaptiveTimeouts()
+#ifndef MQTT_ADAPTIVE_SOCKET_TIMEOUT_MS
+#define MQTT_ADAPTIVE_SOCKET_TIMEOUT_MS 2000
+#endif
+
+// MQTT_ADAPTIVE_GOOD_RSSI : in adaptive mode, the link is healthy at or above this RSSI (in dBm)
+#ifndef MQTT_ADAPTIVE_GOOD_RSSI
+#define MQTT_ADAPTIVE_GOOD_RSSI -67
+#endif
+
+// MQTT_ADAPTIVE_WEAK_RSSI : in adaptive mode, keepAlive is multiplied by MQTT_ADAPTIVE_KEEPALIVE_FACTOR
+//  when connecting below this RSSI (in dBm)
+#ifndef MQTT_ADAPTIVE_WEAK_RSSI
+#define MQTT_ADAPTIVE_WEAK_RSSI -80
+#endif
+
+#ifndef MQTT_ADAPTIVE_KEEPALIVE_FACTOR
+#define MQTT_ADAPTIVE_KEEPALIVE_FACTOR 4
+#endif
+
+// MQTT_MAX_TOPIC_ALIASES : how many topics are given an alias on an MQTT 5 connection, at most.
+//  The broker may allow fewer. Only publishes made with setTopicAliasing(true) take a new alias.
+#ifndef MQTT_MAX_TOPIC_ALIASES
+#define MQTT_MAX_TOPIC_ALIASES 8
+#endif
+
+// MQTT_TOPIC_ALIAS_ARENA_SIZE : room for the aliased topics, which are copied. Topics that no
+//  longer fit are published in full.
+#ifndef MQTT_TOPIC_ALIAS_ARENA_SIZE
+#define MQTT_TOPIC_ALIAS_ARENA_SIZE 256
+#endif
+
 // MQTT_MAX_TRANSFER_SIZE : limit how much data is passed to the network client
 //  in each write call. Needed for the Arduino Wifi Shield. Leave undefined to
 //  pass the entire MQTT packet in each write call.
 //#define MQTT_MAX_TRANSFER_SIZE 80
 
 // Possible values for client.state()
+#define MQTT_CONNECTING             -5
 #define MQTT_CONNECTION_TIMEOUT     -4
 #define MQTT_CONNECTION_LOST        -3
 #define MQTT_CONNECT_FAILED         -2
@@ -53,6 +88,7 @@
 #define MQTT_CONNECT_UNAVAILABLE     3
 #define MQTT_CONNECT_BAD_CREDENTIALS 4
 #define MQTT_CONNECT_UNAUTHORIZED    5
+// Other MQTT 5 CONNACK reason codes (0x80 and up) are reported as is
 
 #define MQTTCONNECT     1 << 4  // Client request to connect to Server
 #define MQTTCONNACK     2 << 4  // Connect Acknowledgment
@@ -77,6 +113,15 @@
 // Maximum size of fixed header and variable length size header
 #define MQTT_MAX_HEADER_SIZE 5
 
+// MQTT 5 properties used by the client
+#define MQTT5_PROPERTY_MESSAGE_EXPIRY      0x02
+#define MQTT5_PROPERTY_SERVER_KEEP_ALIVE   0x13
+#define MQTT5_PROPERTY_TOPIC_ALIAS_MAXIMUM 0x22
+#define MQTT5_PROPERTY_TOPIC_ALIAS         0x23
+
+// Properties length, message expiry and topic alias
+#define MQTT5_MAX_PUBLISH_PROPERTIES_SIZE 9
+
 #if defined(ESP8266) || defined(ESP32) || defined(PUBSUB_USE_FUNCTIONAL)
 #include <functional>
 #define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
@@ -84,6 +129,22 @@
 #define MQTT_CALLBACK_SIGNATURE void (*callback)(char*, uint8_t*, unsigned int)
 #endif
 
+// A received PUBLISH, pointing straight into the receive buffer. The topic is not NUL-terminated.
+// Both are only valid until the callback returns, and the payload may be modified in place,
+// e.g. by an in-situ JSON parser.
+struct MqttMessage {
+   const char* topic;
+   uint16_t topicLength;
+   uint8_t* payload;
+   unsigned int length;
+};
+
+#if defined(ESP8266) || defined(ESP32) || defined(PUBSUB_USE_FUNCTIONAL)
+#define MQTT_MESSAGE_CALLBACK_SIGNATURE std::function<void(const MqttMessage&)> messageCallback
+#else
+#define MQTT_MESSAGE_CALLBACK_SIGNATURE void (*messageCallback)(const MqttMessage&)
+#endif
+
 #define CHECK_STRING_LENGTH(l,s) if (l+2+strnlen(s, this->bufferSize) > this->bufferSize) {_client->stop();return false;}
 
 class PubSubClient : public Print {
@@ -92,16 +153,56 @@ private:
    uint8_t* buffer;
    uint16_t bufferSize;
    uint16_t keepAlive;
-   uint16_t socketTimeout;
+   // The keepAlive sent in CONNECT, which the broker holds us to for the rest of the connection
+   uint16_t negotiatedKeepAlive = 0;
+   uint32_t socketTimeoutMs;
+   boolean adaptiveTimeouts = false;
+   uint8_t protocolVersion = MQTT_VERSION;
+   // The version in use on the current connection
+   uint8_t connectionVersion = MQTT_VERSION;
+   uint32_t messageExpiry = 0;
+   boolean topicAliasing = false;
+   // How many aliases the broker accepts on the current connection
+   uint16_t topicAliasMaximum = 0;
+   uint8_t topicAliasCount = 0;
+   uint16_t topicAliasOffsets[MQTT_MAX_TOPIC_ALIASES];
+   uint16_t topicAliasArenaUsed = 0;
+   // A new alias only counts once the PUBLISH establishing it has been written
+   uint16_t pendingTopicAliasLength = 0;
+   char topicAliasArena[MQTT_TOPIC_ALIAS_ARENA_SIZE];
+   // 0 until an RSSI has been reported
+   int8_t linkRssi = 0;
    uint16_t nextMsgId;
+   uint16_t lastPubackId = 0;
+   uint16_t inPlaceOffset = 0;
+   uint32_t receiveBytesMoved = 0;
+   uint8_t* batchBuffer = NULL;
+   uint16_t batchBufferSize = 0;
+   uint16_t batchLength = 0;
+   bool batching = false;
    unsigned long lastOutActivity;
    unsigned long lastInActivity;
-   bool pingOutstanding;
+   bool pingOutstanding = false;
    MQTT_CALLBACK_SIGNATURE;
+   MQTT_MESSAGE_CALLBACK_SIGNATURE = NULL;
    uint32_t readPacket(uint8_t*);
    boolean readByte(uint8_t * result);
    boolean readByte(uint8_t * result, uint16_t * index);
    boolean write(uint8_t header, uint8_t* buf, uint16_t length);
+   // Hands a complete packet to the client, in MQTT_MAX_TRANSFER_SIZE chunks if set
+   boolean writeToClient(const uint8_t* buf, uint16_t length);
+   // Writes out whatever has been batched so far, without ending the batch
+   boolean flushBatch();
+   // Writes the topic (or its alias), the msgId if not 0 and, on MQTT 5, the properties of a PUBLISH
+   uint16_t writePublishVariableHeader(const char* topic, uint16_t msgId, uint16_t pos);
+   // Returns the alias to publish topic with, or 0. Sets established if the broker already knows it.
+   // A new alias is only taken while topic aliasing is on.
+   uint16_t topicAlias(const char* topic, boolean* established);
+   void commitTopicAlias();
+   // Returns how much a PUBLISH needs on top of the topic, msgId and payload
+   uint16_t publishOverhead();
+   // Reads the CONNACK properties, returns false if they are malformed
+   boolean readConnackProperties(uint16_t pos, uint16_t end);
    uint16_t writeString(const char* string, uint8_t* buf, uint16_t pos);
    // Build up the header ready to send
    // Returns the size of the header
@@ -141,19 +242,63 @@ public:
    PubSubClient& setServer(uint8_t * ip, uint16_t port);
    PubSubClient& setServer(const char * domain, uint16_t port);
    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+   // Receive messages without the topic being copied to NUL-terminate it. Takes precedence
+   // over setCallback().
+   PubSubClient& setMessageCallback(MQTT_MESSAGE_CALLBACK_SIGNATURE);
    PubSubClient& setClient(Client& client);
    PubSubClient& setStream(Stream& stream);
    PubSubClient& setKeepAlive(uint16_t keepAlive);
    PubSubClient& setSocketTimeout(uint16_t timeout);
+   PubSubClient& setSocketTimeoutMs(uint32_t timeoutMs);
+   // In adaptive mode the socket timeout is shortened to MQTT_ADAPTIVE_SOCKET_TIMEOUT_MS while the link
+   // is healthy, which bounds how long loop() can block, and keepAlive is lengthened when connecting
+   // on a weak link, so fewer PINGREQs are needed. Both depend on the RSSI passed to reportRssi().
+   PubSubClient& setAdaptiveTimeouts(boolean enabled);
+   void reportRssi(int8_t rssi);
+   // Speak MQTT 5 (MQTT_VERSION_5) or MQTT_VERSION on the next connection. If the broker turns MQTT 5
+   // down, the client falls back to MQTT_VERSION for later connections; connect() retries right away.
+   // On MQTT 5 repeated topics are published with topic aliases, once the broker allows them.
+   // Streaming received messages with setStream() isn't supported on MQTT 5.
+   PubSubClient& setProtocolVersion(uint8_t version);
+   // The version requested for the next connection, after any fallback
+   uint8_t getProtocolVersion();
+   // Message expiry interval in seconds sent with every following publish on MQTT 5, so the broker
+   // discards them rather than delivering stale messages late. 0 (the default) means they don't expire.
+   PubSubClient& setMessageExpiry(uint32_t seconds);
+   // Whether the following publishes on MQTT 5 may take one of the broker's few topic aliases.
+   // Off by default, so that one-off and retained topics don't use them up before the frequently
+   // published ones get one. A topic that already has an alias always uses it.
+   PubSubClient& setTopicAliasing(boolean enabled);
+   // The keepAlive that will be sent in the next CONNECT. Changes don't affect an open connection.
+   uint16_t getKeepAlive();
+   // The socket timeout currently in effect
+   uint32_t getSocketTimeoutMs();
 
    boolean setBufferSize(uint16_t size);
    uint16_t getBufferSize();
+   // Bytes of received messages moved around in the buffer before reaching a callback, since the
+   // client was created. The callback set with setCallback() needs the topic moved to NUL-terminate it.
+   uint32_t getReceiveBytesMoved();
+   // Size of the buffer packets are coalesced in between beginBatch() and endBatch().
+   // Batching is disabled until this is set.
+   boolean setBatchBufferSize(uint16_t size);
 
    boolean connect(const char* id);
    boolean connect(const char* id, const char* user, const char* pass);
    boolean connect(const char* id, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage);
    boolean connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage);
    boolean connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession);
+   // Start a non-blocking connect.
+   // This API:
+   //   beginConnect(...)
+   //   pollConnect() until it returns something other than MQTT_CONNECTING
+   // Opens the network connection and sends CONNECT, without waiting for the CONNACK. The
+   // strings passed in must stay valid until the connect has completed.
+   // Returns 1 if CONNECT was sent (or the client is already connected), 0 if there was an error
+   boolean beginConnect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession);
+   // Check for the CONNACK of a connect started with beginConnect, without blocking
+   // Returns MQTT_CONNECTING while waiting, otherwise the resulting state()
+   int pollConnect();
 
 // Start Tasmota patch
 //   void disconnect();
@@ -167,6 +312,15 @@ public:
    boolean publish(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
    boolean publish_P(const char* topic, const char* payload, boolean retained);
    boolean publish_P(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
+   // Publish a message with QoS 1. The broker acknowledges it with a PUBACK, which is
+   // picked up by loop(). Use isAcknowledged() to check for it.
+   // Returns the message id, or 0 if the message couldn't be sent
+   uint16_t publishQos1(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
+   // Returns true once the PUBACK for msgId has been received. Only the most recent PUBACK
+   // is tracked, so only one QoS 1 publish should be outstanding at a time. Acknowledgements
+   // don't carry over to a new connection. An MQTT 5 PUBACK with a failure reason code doesn't
+   // count as an acknowledgement.
+   boolean isAcknowledged(uint16_t msgId);
    // Start to publish a message.
    // This API:
    //   beginPublish(...)
@@ -179,6 +333,34 @@ public:
    // Finish off this publish message (started with beginPublish)
    // Returns 1 if the packet was sent successfully, 0 if there was an error
    int endPublish();
+   // Start an in-place publish.
+   // This API:
+   //   beginPublishInPlace(...)
+   //   write up to *capacity bytes of payload to the returned pointer
+   //   endPublishInPlace(...)
+   // Lets the payload be serialized straight into the packet buffer, so it never has to be held
+   // in a separate buffer, and the packet is still handed to the client in a single write.
+   // Nothing else may use the client (including loop()) between the two calls.
+   // Returns NULL if the message couldn't be started
+   uint8_t* beginPublishInPlace(const char* topic, size_t* capacity);
+   // Finish off an in-place publish, with plength bytes of payload written
+   // Returns 1 if the packet was sent successfully, 0 if there was an error
+   boolean endPublishInPlace(unsigned int plength, boolean retained);
+   // Start a batch of packets.
+   // This API:
+   //   beginBatch()
+   //   any number of publish/subscribe/unsubscribe calls
+   //   endBatch()
+   // Complete packets are collected in the batch buffer and handed to the client in a single
+   // write, which saves a network transaction per packet on clients where every write is
+   // expensive. A packet that doesn't fit in what's left of the batch buffer flushes it first,
+   // and a packet larger than the batch buffer is written on its own. Calls made inside the
+   // batch report success once the packet is queued; write errors are reported by endBatch().
+   // After a failed write, topic aliases are established again by the next publishes.
+   void beginBatch();
+   // Write out everything batched since beginBatch()
+   // Returns 1 if everything was written successfully, 0 if there was an error
+   boolean endBatch();
    // Write a single byte of payload (only to be used with beginPublish/endPublish)
    virtual size_t write(uint8_t);
    // Write size bytes from buffer into the payload (only to be used with beginPublish/endPublish)
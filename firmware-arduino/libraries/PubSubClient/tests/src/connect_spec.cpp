@@ -260,7 +260,7 @@ int test_connect_disconnect_connect() {
     byte disconnect[] = {0xE0,0x00};
     shimClient.expect(disconnect,2);
 
-    client.disconnect();
+    client.disconnect(true);
 
     IS_FALSE(client.connected());
     IS_FALSE(shimClient.connected());
@@ -312,6 +312,159 @@ int test_connect_custom_keepalive() {
 }
 
 
+int test_begin_connect_polls_until_connack() {
+    IT("connects without blocking using beginConnect and pollConnect");
+    ShimClient shimClient;
+
+    shimClient.setAllowConnect(true);
+    byte connect[] = {0x10,0x18,0x0,0x4,0x4d,0x51,0x54,0x54,0x4,0x2,0x0,0xf,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+
+    shimClient.expect(connect,26);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+
+    int rc = client.beginConnect((char*)"client_test1", NULL, NULL, 0, 0, 0, 0, 1);
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    int state = client.pollConnect();
+    IS_TRUE(state == MQTT_CONNECTING);
+    IS_FALSE(client.connected());
+
+    shimClient.respond(connack,4);
+
+    state = client.pollConnect();
+    IS_TRUE(state == MQTT_CONNECTED);
+    IS_TRUE(client.connected());
+
+    END_IT
+}
+
+int test_begin_connect_fails_on_bad_rc() {
+    IT("reports a bad return code from pollConnect");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+    byte connack[] = { 0x20, 0x02, 0x00, 0x05 };
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.beginConnect((char*)"client_test1", NULL, NULL, 0, 0, 0, 0, 1);
+    IS_TRUE(rc);
+
+    shimClient.respond(connack,4);
+
+    int state = client.pollConnect();
+    IS_TRUE(state == MQTT_CONNECT_UNAUTHORIZED);
+    IS_FALSE(shimClient.connected());
+
+    END_IT
+}
+
+int test_begin_connect_fails_no_network() {
+    IT("fails beginConnect if underlying client doesn't connect");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(false);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.beginConnect((char*)"client_test1", NULL, NULL, 0, 0, 0, 0, 1);
+    IS_FALSE(rc);
+
+    int state = client.pollConnect();
+    IS_TRUE(state == MQTT_CONNECT_FAILED);
+
+    END_IT
+}
+
+int test_begin_connect_fails_on_connection_drop() {
+    IT("fails pollConnect if the connection drops before the CONNACK");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.beginConnect((char*)"client_test1", NULL, NULL, 0, 0, 0, 0, 1);
+    IS_TRUE(rc);
+    IS_TRUE(client.pollConnect() == MQTT_CONNECTING);
+
+    shimClient.setConnected(false);
+
+    int state = client.pollConnect();
+    IS_TRUE(state == MQTT_CONNECT_FAILED);
+
+    END_IT
+}
+
+int test_connect_adaptive_weak_link_keepalive() {
+    IT("lengthens keepalive when connecting on a weak link in adaptive mode");
+    ShimClient shimClient;
+
+    shimClient.setAllowConnect(true);
+
+    // 4 x 15secs == 60secs == 0x00 0x3c
+    byte connect[] = {0x10,0x18,0x0,0x4,0x4d,0x51,0x54,0x54,0x4,0x2,0x00,0x3c,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+
+    shimClient.expect(connect,26);
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setKeepAlive(15);
+    client.reportRssi(-85);
+    IS_TRUE(client.getKeepAlive() == 15);
+
+    client.setAdaptiveTimeouts(true);
+    IS_TRUE(client.getKeepAlive() == 60);
+
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_connect_adaptive_socket_timeout() {
+    IT("shortens the socket timeout on a healthy link in adaptive mode");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setSocketTimeout(15);
+    client.setAdaptiveTimeouts(true);
+    IS_TRUE(client.getSocketTimeoutMs() == 15000);
+
+    // Weak and unknown links keep the configured timeout
+    client.reportRssi(-75);
+    IS_TRUE(client.getSocketTimeoutMs() == 15000);
+
+    client.reportRssi(-50);
+    IS_TRUE(client.getSocketTimeoutMs() == MQTT_ADAPTIVE_SOCKET_TIMEOUT_MS);
+
+    time_t start = time(0);
+    int rc = client.connect((char*)"client_test1");
+    IS_FALSE(rc);
+    IS_TRUE(client.state() == MQTT_CONNECTION_TIMEOUT);
+    IS_TRUE(time(0) - start <= MQTT_ADAPTIVE_SOCKET_TIMEOUT_MS / 1000 + 1);
+
+    END_IT
+}
+
+int test_connect_runtime_socket_timeout() {
+    IT("uses a socket timeout set at runtime");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setSocketTimeoutMs(1000);
+    IS_TRUE(client.getSocketTimeoutMs() == 1000);
+
+    time_t start = time(0);
+    int rc = client.connect((char*)"client_test1");
+    IS_FALSE(rc);
+    IS_TRUE(client.state() == MQTT_CONNECTION_TIMEOUT);
+    IS_TRUE(time(0) - start <= 2);
+
+    END_IT
+}
+
 int main()
 {
     SUITE("Connect");
@@ -332,5 +485,14 @@ int main()
     test_connect_disconnect_connect();
 
     test_connect_custom_keepalive();
+
+    test_begin_connect_polls_until_connack();
+    test_begin_connect_fails_on_bad_rc();
+    test_begin_connect_fails_no_network();
+    test_begin_connect_fails_on_connection_drop();
+
+    test_connect_adaptive_weak_link_keepalive();
+    test_connect_adaptive_socket_timeout();
+    test_connect_runtime_socket_timeout();
     FINISH
 }
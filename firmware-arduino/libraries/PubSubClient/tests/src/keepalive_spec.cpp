@@ -172,6 +172,38 @@ int test_keepalive_disconnects_hung() {
     END_IT
 }
 
+int test_keepalive_uses_negotiated_value() {
+    IT("keeps pinging at the negotiated keepalive when it's changed while connected");
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setKeepAlive(2);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    // Only applies to the next connection, the broker still expects a ping every 2 seconds
+    client.setKeepAlive(60);
+    IS_TRUE(client.getKeepAlive() == 60);
+
+    byte pingreq[] = { 0xC0,0x0 };
+    shimClient.expect(pingreq,2);
+    uint16_t received = shimClient.received();
+
+    sleep(4);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(shimClient.received() == received + 2);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
 int main()
 {
     SUITE("Keep-alive");
@@ -180,6 +212,7 @@ int main()
     test_keepalive_pings_with_inbound_qos0();
     test_keepalive_no_pings_inbound_qos1();
     test_keepalive_disconnects_hung();
+    test_keepalive_uses_negotiated_value();
 
     FINISH
 }
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <string>
 #include "Print.h"
 
 
@@ -16,6 +17,7 @@ extern "C"{
     extern void setup( void ) ;
     extern void loop( void ) ;
     uint32_t millis( void );
+    void delay( unsigned long );
 }
 
 #define PROGMEM
@@ -23,4 +25,11 @@ extern "C"{
 
 #define yield(x) {}
 
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s ? s : "") {}
+    unsigned int length() const { return size(); }
+};
+
 #endif // Arduino_h
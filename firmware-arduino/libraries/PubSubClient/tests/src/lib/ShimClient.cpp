@@ -8,6 +8,9 @@ extern "C" {
     uint32_t millis(void) {
        return time(0)*1000;
     }
+
+    void delay(unsigned long ms) {
+    }
 }
 
 ShimClient::ShimClient() {
@@ -16,8 +19,10 @@ ShimClient::ShimClient() {
     this->_allowConnect = true;
     this->_connected = false;
     this->_error = false;
+    this->_failWrites = false;
     this->expectAnything = true;
     this->_received = 0;
+    this->_writeCalls = 0;
     this->_expectedPort = 0;
 }
 
@@ -55,7 +60,11 @@ int ShimClient::connect(const char *host, uint16_t port)  {
     return this->_connected;
 }
 size_t ShimClient::write(uint8_t b)  {
+    if (this->_failWrites) {
+        return 0;
+    }
     this->_received += 1;
+    this->_writeCalls += 1;
     TRACE(std::hex << (unsigned int)b);
     if (!this->expectAnything) {
         if (this->expectBuffer->available()) {
@@ -72,7 +81,11 @@ size_t ShimClient::write(uint8_t b)  {
     return 1;
 }
 size_t ShimClient::write(const uint8_t *buf, size_t size)  {
+    if (this->_failWrites) {
+        return 0;
+    }
     this->_received += size;
+    this->_writeCalls += 1;
     TRACE( "[" << std::dec << (unsigned int)(size) << "] ");
     uint16_t i=0;
     for (;i<size;i++) {
@@ -130,6 +143,9 @@ ShimClient* ShimClient::expect(uint8_t *buf, size_t size) {
 void ShimClient::setConnected(bool b) {
     this->_connected = b;
 }
+void ShimClient::setFailWrites(bool b) {
+    this->_failWrites = b;
+}
 void ShimClient::setAllowConnect(bool b) {
     this->_allowConnect = b;
 }
@@ -142,6 +158,10 @@ uint16_t ShimClient::received() {
     return this->_received;
 }
 
+uint16_t ShimClient::writeCalls() {
+    return this->_writeCalls;
+}
+
 void ShimClient::expectConnect(IPAddress ip, uint16_t port) {
     this->_expectedIP = ip;
     this->_expectedPort = port;
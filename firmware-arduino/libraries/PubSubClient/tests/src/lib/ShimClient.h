@@ -15,7 +15,9 @@ private:
     bool _connected;
     bool expectAnything;
     bool _error;
+    bool _failWrites;
     uint16_t _received;
+    uint16_t _writeCalls;
     IPAddress _expectedIP;
     uint16_t _expectedPort;
     const char* _expectedHost;
@@ -42,10 +44,14 @@ public:
   virtual void expectConnect(const char *host, uint16_t port);
   
   virtual uint16_t received();
+  // Number of write calls, each of which would be a separate network transaction
+  virtual uint16_t writeCalls();
   virtual bool error();
   
   virtual void setAllowConnect(bool b);
   virtual void setConnected(bool b);
+  // Writes report nothing written while set, like a socket that stalled without dropping the connection
+  virtual void setFailWrites(bool b);
 };
 
 #endif
@@ -0,0 +1,580 @@
+#include "PubSubClient.h"
+#include "ShimClient.h"
+#include "Buffer.h"
+#include "BDDTest.h"
+#include "trace.h"
+
+
+byte server[] = { 172, 16, 0, 2 };
+
+bool callback_called = false;
+char lastTopic[1024];
+char lastPayload[1024];
+unsigned int lastLength;
+
+void reset_callback() {
+    callback_called = false;
+    lastTopic[0] = '\0';
+    lastPayload[0] = '\0';
+    lastLength = 0;
+}
+
+void callback(char* topic, byte* payload, unsigned int length) {
+    callback_called = true;
+    strcpy(lastTopic,topic);
+    memcpy(lastPayload,payload,length);
+    lastLength = length;
+}
+
+int test_mqtt5_connect() {
+    IT("sends a properly formatted mqtt 5 connect packet and succeeds");
+    ShimClient shimClient;
+
+    shimClient.setAllowConnect(true);
+    byte connect[] = {0x10,0x19,0x0,0x4,0x4d,0x51,0x54,0x54,0x5,0x2,0x0,0xf,0x0,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+
+    shimClient.expect(connect,27);
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+    IS_TRUE(client.state() == MQTT_CONNECTED);
+    IS_TRUE(client.getProtocolVersion() == MQTT_VERSION_5);
+
+    END_IT
+}
+
+int test_mqtt5_connect_will() {
+    IT("sends empty will properties in an mqtt 5 connect packet");
+    ShimClient shimClient;
+
+    shimClient.setAllowConnect(true);
+    byte connect[] = {0x10,0x32,0x0,0x4,0x4d,0x51,0x54,0x54,0x5,0xe,0x0,0xf,0x0,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31,0x0,0x0,0x9,0x77,0x69,0x6c,0x6c,0x54,0x6f,0x70,0x69,0x63,0x0,0xb,0x77,0x69,0x6c,0x6c,0x4d,0x65,0x73,0x73,0x61,0x67,0x65};
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+
+    shimClient.expect(connect,52);
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+
+    int rc = client.connect((char*)"client_test1",(char*)"willTopic",1,0,(char*)"willMessage");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_fallback() {
+    IT("falls back to mqtt 3.1.1 when the broker doesn't support mqtt 5");
+    ShimClient shimClient;
+
+    shimClient.setAllowConnect(true);
+    byte connackBadProtocol[] = { 0x20, 0x02, 0x00, 0x01 };
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+
+    shimClient.respond(connackBadProtocol,4);
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.state() == MQTT_CONNECTED);
+    IS_TRUE(client.getProtocolVersion() == MQTT_VERSION_3_1_1);
+
+    // A 3.1.1 publish, without properties
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,16);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_fallback_non_blocking() {
+    IT("falls back on the next connect when using pollConnect");
+    ShimClient shimClient;
+
+    shimClient.setAllowConnect(true);
+    byte connackUnsupported[] = { 0x20, 0x03, 0x00, 0x84, 0x00 };
+    shimClient.respond(connackUnsupported,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+
+    int rc = client.beginConnect((char*)"client_test1", NULL, NULL, 0, 0, 0, 0, 1);
+    IS_TRUE(rc);
+
+    int state = client.pollConnect();
+    IS_TRUE(state == MQTT_CONNECT_BAD_PROTOCOL);
+    IS_TRUE(client.getProtocolVersion() == MQTT_VERSION_3_1_1);
+
+    END_IT
+}
+
+int test_mqtt5_bad_credentials() {
+    IT("reports mqtt 5 reason codes without falling back");
+    ShimClient shimClient;
+
+    shimClient.setAllowConnect(true);
+    byte connack[] = { 0x20, 0x03, 0x00, 0x86, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+
+    int rc = client.connect((char*)"client_test1");
+    IS_FALSE(rc);
+    IS_TRUE(client.state() == MQTT_CONNECT_BAD_CREDENTIALS);
+    IS_TRUE(client.getProtocolVersion() == MQTT_VERSION_5);
+
+    END_IT
+}
+
+int test_mqtt5_publish_without_aliases() {
+    IT("publishes with empty properties when the broker allows no topic aliases");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0xf,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,17);
+    shimClient.expect(publish,17);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_publish_topic_alias() {
+    IT("replaces a repeated topic with its alias");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    // Topic alias maximum of 2
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x02 };
+    shimClient.respond(connack,8);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setTopicAliasing(true);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    // Establishes alias 1
+    byte first[] = {0x30,0x12,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(first,20);
+    uint16_t received = shimClient.received();
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_TRUE(shimClient.received() - received == 20);
+
+    // Uses it, with an empty topic
+    byte second[] = {0x30,0xd,0x0,0x0,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(second,15);
+    received = shimClient.received();
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_TRUE(shimClient.received() - received == 15);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_publish_alias_maximum() {
+    IT("publishes the full topic once the broker's alias maximum is used up");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    // Topic alias maximum of 1
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x01 };
+    shimClient.respond(connack,8);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setTopicAliasing(true);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte first[] = {0x30,0x8,0x0,0x1,0x61,0x3,0x23,0x0,0x1,0x31};
+    byte second[] = {0x30,0x5,0x0,0x1,0x62,0x0,0x32};
+    byte third[] = {0x30,0x7,0x0,0x0,0x3,0x23,0x0,0x1,0x33};
+    shimClient.expect(first,10);
+    shimClient.expect(second,7);
+    shimClient.expect(third,9);
+
+    IS_TRUE(client.publish((char*)"a",(char*)"1"));
+    IS_TRUE(client.publish((char*)"b",(char*)"2"));
+    IS_TRUE(client.publish((char*)"a",(char*)"3"));
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_aliases_reset_on_reconnect() {
+    IT("establishes topic aliases again on a new connection");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x02 };
+    shimClient.respond(connack,8);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setTopicAliasing(true);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    IS_TRUE(client.publish((char*)"topic",(char*)"payload"));
+
+    client.disconnect();
+    shimClient.respond(connack,8);
+    rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte first[] = {0x30,0x12,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(first,20);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_message_expiry() {
+    IT("publishes with a message expiry interval");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0x14,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x5,0x2,0x0,0x0,0x0,0x3c,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,22);
+
+    client.setMessageExpiry(60);
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_message_expiry_ignored_on_3_1_1() {
+    IT("ignores the message expiry interval on mqtt 3.1.1");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,16);
+
+    client.setMessageExpiry(60);
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_qos1_publish() {
+    IT("publishes with qos 1 on mqtt 5");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x32,0x11,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0,0x2,0x0,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,19);
+
+    uint16_t msgId = client.publishQos1((char*)"topic",(byte*)"payload",7,false);
+    IS_TRUE(msgId == 2);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_topic_aliasing_opt_in() {
+    IT("only takes a new topic alias while topic aliasing is on");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x02 };
+    shimClient.respond(connack,8);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte full[] = {0x30,0xf,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    byte establishing[] = {0x30,0x12,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    byte aliased[] = {0x30,0xd,0x0,0x0,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(full,17);
+    shimClient.expect(establishing,20);
+    shimClient.expect(aliased,15);
+
+    IS_TRUE(client.publish((char*)"topic",(char*)"payload"));
+    client.setTopicAliasing(true);
+    IS_TRUE(client.publish((char*)"topic",(char*)"payload"));
+    client.setTopicAliasing(false);
+    // Already has an alias, which is used regardless
+    IS_TRUE(client.publish((char*)"topic",(char*)"payload"));
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_puback_failure() {
+    IT("doesn't count a puback with a failure reason code as an acknowledgement");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    uint16_t msgId = client.publishQos1((char*)"topic",(byte*)"payload",7,false);
+    IS_TRUE(msgId == 2);
+
+    // Unspecified error
+    byte failed[] = { 0x40, 0x03, 0x00, 0x02, 0x80 };
+    shimClient.respond(failed,5);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_FALSE(client.isAcknowledged(msgId));
+
+    // No matching subscribers, which is still a success
+    byte succeeded[] = { 0x40, 0x03, 0x00, 0x02, 0x10 };
+    shimClient.respond(succeeded,5);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.isAcknowledged(msgId));
+
+    END_IT
+}
+
+int test_mqtt5_subscribe() {
+    IT("subscribes with empty properties on mqtt 5");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte subscribe[] = {0x82,0xb,0x0,0x2,0x0,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0};
+    shimClient.expect(subscribe,13);
+
+    rc = client.subscribe((char*)"topic");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_receive() {
+    IT("skips the properties of a received mqtt 5 message");
+    reset_callback();
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    // With a payload format indicator property
+    byte publish[] = {0x30,0x11,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x2,0x1,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.respond(publish,19);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    IS_TRUE(callback_called);
+    IS_TRUE(strcmp(lastTopic,"topic")==0);
+    IS_TRUE(memcmp(lastPayload,"payload",7)==0);
+    IS_TRUE(lastLength == 7);
+
+    END_IT
+}
+
+int test_mqtt5_connack_properties() {
+    IT("skips connack properties it doesn't use");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    // Receive maximum, assigned client identifier, user property and topic alias maximum
+    byte connack[] = { 0x20, 0x15, 0x00, 0x00, 0x12,
+        0x21, 0x00, 0x0a,
+        0x12, 0x00, 0x02, 0x69, 0x64,
+        0x26, 0x00, 0x01, 0x6b, 0x00, 0x01, 0x76,
+        0x22, 0x00, 0x01 };
+    shimClient.respond(connack,23);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setTopicAliasing(true);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0x12,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,20);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_abandoned_in_place_publish() {
+    IT("doesn't use an alias established by an abandoned in-place publish");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x02 };
+    shimClient.respond(connack,8);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setTopicAliasing(true);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    size_t capacity = 0;
+    uint8_t* payload = client.beginPublishInPlace((char*)"topic", &capacity);
+    IS_TRUE(payload != NULL);
+
+    // Never finished, so the next publish has to carry the full topic again
+    byte first[] = {0x30,0x12,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(first,20);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_failed_batch_forgets_aliases() {
+    IT("establishes aliases again after a batch fails to go out");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x02 };
+    shimClient.respond(connack,8);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setTopicAliasing(true);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.setBatchBufferSize(128));
+
+    client.beginBatch();
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+
+    shimClient.setFailWrites(true);
+    rc = client.endBatch();
+    IS_FALSE(rc);
+    shimClient.setFailWrites(false);
+
+    // The PUBLISH establishing alias 1 never went out, so the topic is sent again
+    byte first[] = {0x30,0x12,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(first,20);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+
+    byte second[] = {0x30,0xd,0x0,0x0,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(second,15);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("MQTT 5");
+    test_mqtt5_connect();
+    test_mqtt5_connect_will();
+    test_mqtt5_fallback();
+    test_mqtt5_fallback_non_blocking();
+    test_mqtt5_bad_credentials();
+    test_mqtt5_publish_without_aliases();
+    test_mqtt5_publish_topic_alias();
+    test_mqtt5_publish_alias_maximum();
+    test_mqtt5_aliases_reset_on_reconnect();
+    test_mqtt5_abandoned_in_place_publish();
+    test_mqtt5_failed_batch_forgets_aliases();
+    test_mqtt5_message_expiry();
+    test_mqtt5_message_expiry_ignored_on_3_1_1();
+    test_mqtt5_qos1_publish();
+    test_mqtt5_puback_failure();
+    test_mqtt5_topic_aliasing_opt_in();
+    test_mqtt5_subscribe();
+    test_mqtt5_receive();
+    test_mqtt5_connack_properties();
+
+    FINISH
+}
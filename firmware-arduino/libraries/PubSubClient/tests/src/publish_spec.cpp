@@ -173,8 +173,402 @@ int test_publish_P() {
     END_IT
 }
 
+int test_publish_in_place() {
+    IT("publishes a payload written in place");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x31,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,16);
+
+    size_t capacity;
+    uint8_t* payload = client.beginPublishInPlace((char*)"topic",&capacity);
+    IS_TRUE(payload != NULL);
+    IS_TRUE(capacity == MQTT_MAX_PACKET_SIZE - MQTT_MAX_HEADER_SIZE - 7);
+
+    memcpy(payload,"payload",7);
+    rc = client.endPublishInPlace(7,true);
+    IS_TRUE(rc);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_in_place_too_long() {
+    IT("in place publish fails when the payload exceeds the capacity");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setBufferSize(128);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    uint16_t received = shimClient.received();
+
+    size_t capacity;
+    uint8_t* payload = client.beginPublishInPlace((char*)"topic",&capacity);
+    IS_TRUE(payload != NULL);
+    IS_TRUE(capacity == 128 - MQTT_MAX_HEADER_SIZE - 7);
+
+    rc = client.endPublishInPlace(capacity+1,false);
+    IS_FALSE(rc);
 
+    // Ending without a matching begin fails too
+    rc = client.endPublishInPlace(0,false);
+    IS_FALSE(rc);
+
+    IS_TRUE(shimClient.received() == received);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_in_place_not_connected() {
+    IT("in place publish fails when not connected");
+    ShimClient shimClient;
+
+    PubSubClient client(server, 1883, callback, shimClient);
+
+    size_t capacity = 1;
+    uint8_t* payload = client.beginPublishInPlace((char*)"topic",&capacity);
+    IS_TRUE(payload == NULL);
+    IS_TRUE(capacity == 0);
+
+    IS_FALSE(client.endPublishInPlace(0,false));
+
+    END_IT
+}
+
+
+int test_publish_qos1() {
+    IT("publishes with qos 1 and a message id");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x32,0x10,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0,0x2,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,18);
+
+    uint16_t msgId = client.publishQos1((char*)"topic",(byte*)"payload",7,false);
+    IS_TRUE(msgId == 2);
+    IS_FALSE(client.isAcknowledged(msgId));
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
 
+int test_publish_qos1_acknowledged() {
+    IT("tracks the puback of a qos 1 publish");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    uint16_t msgId = client.publishQos1((char*)"topic",(byte*)"payload",7,true);
+    IS_TRUE(msgId == 2);
+
+    byte otherPuback[] = { 0x40, 0x02, 0x00, 0x03 };
+    shimClient.respond(otherPuback,4);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_FALSE(client.isAcknowledged(msgId));
+
+    byte puback[] = { 0x40, 0x02, 0x00, 0x02 };
+    shimClient.respond(puback,4);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.isAcknowledged(msgId));
+
+    END_IT
+}
+
+int test_publish_qos1_ack_reset_on_reconnect() {
+    IT("forgets acknowledgements when reconnecting");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    uint16_t msgId = client.publishQos1((char*)"topic",(byte*)"payload",7,false);
+    byte puback[] = { 0x40, 0x02, 0x00, 0x02 };
+    shimClient.respond(puback,4);
+    client.loop();
+    IS_TRUE(client.isAcknowledged(msgId));
+
+    client.disconnect(true);
+    shimClient.respond(connack,4);
+    rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    IS_FALSE(client.isAcknowledged(msgId));
+
+    END_IT
+}
+
+int test_publish_qos1_not_connected() {
+    IT("publish with qos 1 fails when not connected");
+    ShimClient shimClient;
+
+    PubSubClient client(server, 1883, callback, shimClient);
+
+    uint16_t msgId = client.publishQos1((char*)"topic",(byte*)"payload",7,false);
+    IS_TRUE(msgId == 0);
+
+    END_IT
+}
+
+int test_publish_single_write() {
+    IT("hands each publish to the client in a single write");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte payload[] = { 0x01,0x02,0x03,0x0,0x05 };
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    uint16_t writeCalls = shimClient.writeCalls();
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 1);
+
+    rc = client.publish_P((char*)"topic",payload,5,true);
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 2);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_batch() {
+    IT("coalesces a batch of packets into a single write");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.setBatchBufferSize(128));
+
+    byte packets[] = {
+        0x31,0xb,0x0,0x3,0x6c,0x77,0x74,0x6f,0x6e,0x6c,0x69,0x6e,0x65,
+        0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64
+    };
+    shimClient.expect(packets,29);
+
+    uint16_t writeCalls = shimClient.writeCalls();
+
+    client.beginBatch();
+    rc = client.publish((char*)"lwt",(char*)"online",true);
+    IS_TRUE(rc);
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls);
+
+    rc = client.endBatch();
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 1);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_batch_throughput() {
+    IT("needs one write per batch instead of one per publish");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.setBatchBufferSize(512));
+
+    uint16_t writeCalls = shimClient.writeCalls();
+    for (int i = 0; i < 10; i++) {
+        rc = client.publish((char*)"topic",(char*)"payload");
+        IS_TRUE(rc);
+    }
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 10);
+
+    writeCalls = shimClient.writeCalls();
+    uint16_t received = shimClient.received();
+    client.beginBatch();
+    for (int i = 0; i < 10; i++) {
+        rc = client.publish((char*)"topic",(char*)"payload");
+        IS_TRUE(rc);
+    }
+    rc = client.endBatch();
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 1);
+    IS_EQUAL(shimClient.received(), received + 10 * 16);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_batch_overflow() {
+    IT("flushes a batch when the next packet doesn't fit");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.setBatchBufferSize(20));
+
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,16);
+    shimClient.expect(publish,16);
+
+    uint16_t writeCalls = shimClient.writeCalls();
+
+    client.beginBatch();
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 1);
+
+    rc = client.endBatch();
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 2);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_batch_too_large() {
+    IT("writes a packet larger than the batch buffer on its own");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.setBatchBufferSize(8));
+
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,16);
+
+    uint16_t writeCalls = shimClient.writeCalls();
+
+    client.beginBatch();
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 1);
+
+    rc = client.endBatch();
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 1);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_batch_disabled() {
+    IT("writes immediately when no batch buffer is set");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    uint16_t writeCalls = shimClient.writeCalls();
+
+    client.beginBatch();
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 1);
+
+    rc = client.endBatch();
+    IS_TRUE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls + 1);
+
+    END_IT
+}
+
+int test_publish_batch_disconnected() {
+    IT("drops a batch when the client disconnects");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.setBatchBufferSize(128));
+
+    client.beginBatch();
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+
+    shimClient.setConnected(false);
+    uint16_t writeCalls = shimClient.writeCalls();
+
+    rc = client.endBatch();
+    IS_FALSE(rc);
+    IS_EQUAL(shimClient.writeCalls(), writeCalls);
+
+    END_IT
+}
 
 int main()
 {
@@ -186,6 +580,20 @@ int main()
     test_publish_not_connected();
     test_publish_too_long();
     test_publish_P();
+    test_publish_in_place();
+    test_publish_in_place_too_long();
+    test_publish_in_place_not_connected();
+    test_publish_qos1();
+    test_publish_qos1_acknowledged();
+    test_publish_qos1_ack_reset_on_reconnect();
+    test_publish_qos1_not_connected();
+    test_publish_single_write();
+    test_publish_batch();
+    test_publish_batch_throughput();
+    test_publish_batch_overflow();
+    test_publish_batch_too_large();
+    test_publish_batch_disabled();
+    test_publish_batch_disconnected();
 
     FINISH
 }
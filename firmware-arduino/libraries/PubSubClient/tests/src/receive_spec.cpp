@@ -27,6 +27,15 @@ void callback(char* topic, byte* payload, unsigned int length) {
     lastLength = length;
 }
 
+void message_callback(const MqttMessage& message) {
+    TRACE("Message callback received topic length=" << message.topicLength << " length=" << message.length << "\n")
+    callback_called = true;
+    memcpy(lastTopic,message.topic,message.topicLength);
+    lastTopic[message.topicLength] = '\0';
+    memcpy(lastPayload,message.payload,message.length);
+    lastLength = message.length;
+}
+
 int test_receive_callback() {
     IT("receives a callback message");
     reset_callback();
@@ -324,6 +333,133 @@ int test_receive_qos1() {
     END_IT
 }
 
+int test_receive_message_callback() {
+    IT("receives a message view");
+    reset_callback();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setMessageCallback(message_callback);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.respond(publish,16);
+
+    rc = client.loop();
+
+    IS_TRUE(rc);
+
+    IS_TRUE(callback_called);
+    IS_TRUE(strcmp(lastTopic,"topic")==0);
+    IS_TRUE(memcmp(lastPayload,"payload",7)==0);
+    IS_TRUE(lastLength == 7);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_receive_message_callback_qos1() {
+    IT("receives a qos1 message view");
+    reset_callback();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setMessageCallback(message_callback);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x32,0x10,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x12,0x34,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.respond(publish,18);
+
+    byte puback[] = {0x40,0x2,0x12,0x34};
+    shimClient.expect(puback,4);
+
+    rc = client.loop();
+
+    IS_TRUE(rc);
+
+    IS_TRUE(callback_called);
+    IS_TRUE(strcmp(lastTopic,"topic")==0);
+    IS_TRUE(memcmp(lastPayload,"payload",7)==0);
+    IS_TRUE(lastLength == 7);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_receive_message_callback_malformed() {
+    IT("drops a qos1 message too short for its msgId");
+    reset_callback();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setMessageCallback(message_callback);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x32,0x7,0x0,0x5,0x74,0x6f,0x70,0x69,0x63};
+    shimClient.respond(publish,9);
+
+    rc = client.loop();
+
+    IS_TRUE(rc);
+    IS_FALSE(callback_called);
+
+    END_IT
+}
+
+int test_receive_bytes_moved() {
+    IT("doesn't move the topic for a message view");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+
+    // The classic callback gets a NUL-terminated topic, which is moved a byte to the front
+    reset_callback();
+    shimClient.respond(publish,16);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(callback_called);
+    IS_TRUE(client.getReceiveBytesMoved() == 5);
+
+    // The view points at the topic where it was received
+    reset_callback();
+    client.setMessageCallback(message_callback);
+    shimClient.respond(publish,16);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(callback_called);
+    IS_TRUE(client.getReceiveBytesMoved() == 5);
+
+    END_IT
+}
+
 int main()
 {
     SUITE("Receive");
@@ -335,6 +471,10 @@ int main()
     test_resize_buffer();
     test_receive_oversized_stream_message();
     test_receive_qos1();
+    test_receive_message_callback();
+    test_receive_message_callback_qos1();
+    test_receive_message_callback_malformed();
+    test_receive_bytes_moved();
 
     FINISH
 }
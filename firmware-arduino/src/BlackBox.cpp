@@ -0,0 +1,81 @@
+#include "BlackBox.h"
+#include <CRC32.h>
+#include <pico.h>
+#include <cstring>
+
+#define BLACK_BOX_MAGIC 0x4c434242
+
+// The header sits right before the entries, so that a recovered black box can be written out in one go
+struct BlackBoxRing {
+    uint32_t magic;
+    uint32_t nextSequence;
+    BlackBoxHeader header;
+    BlackBoxEntry entries[BLACK_BOX_ENTRIES];
+};
+
+static_assert(offsetof(BlackBoxRing, entries) == offsetof(BlackBoxRing, header) + sizeof(BlackBoxHeader), "Black box entries must follow the header");
+
+// Survives a watchdog reset, but is garbage after power on, hence the magic
+static BlackBoxRing __uninitialized_ram(blackBoxRing);
+
+// Plain RAM, so it's cleared on every chip boot, but not when core 0 relaunches core 1. Once core 0 is recording, the
+// ring no longer holds what came before the reset, and recovering would sort it under core 0's feet.
+static volatile bool recording = false;
+
+static uint32_t entryChecksum(const BlackBoxEntry &entry) {
+    return CRC32::calculate((const uint8_t*)&entry, offsetof(BlackBoxEntry, checksum));
+}
+
+void black_box_begin() {
+    memset(&blackBoxRing, 0, sizeof(blackBoxRing));
+    blackBoxRing.nextSequence = 1;
+    blackBoxRing.magic = BLACK_BOX_MAGIC;
+    recording = true;
+}
+
+void black_box_record(BlackBoxEntry &entry) {
+    entry.sequence = blackBoxRing.nextSequence++;
+    entry.checksum = entryChecksum(entry);
+
+    blackBoxRing.entries[entry.sequence % BLACK_BOX_ENTRIES] = entry;
+}
+
+size_t black_box_recover(const uint8_t **data) {
+    if (recording || blackBoxRing.magic != BLACK_BOX_MAGIC) {
+        return 0;
+    }
+
+    uint16_t count = 0;
+
+    // Valid entries are moved to the front and sorted as they go, which is cheap enough for a one off at boot
+    for (uint16_t i = 0; i < BLACK_BOX_ENTRIES; i++) {
+        BlackBoxEntry entry = blackBoxRing.entries[i];
+
+        if (entry.sequence == 0 || entry.sequence >= blackBoxRing.nextSequence || entry.checksum != entryChecksum(entry)) {
+            continue;
+        }
+
+        uint16_t position = count++;
+
+        for (; position > 0 && blackBoxRing.entries[position - 1].sequence > entry.sequence; position--) {
+            blackBoxRing.entries[position] = blackBoxRing.entries[position - 1];
+        }
+
+        blackBoxRing.entries[position] = entry;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    blackBoxRing.header.schemaId = BLACK_BOX_SCHEMA_ID;
+    blackBoxRing.header.schemaVersion = BLACK_BOX_SCHEMA_VERSION;
+    blackBoxRing.header.entrySize = sizeof(BlackBoxEntry);
+    blackBoxRing.header.entryCount = count;
+
+    // What's left is no longer a ring, and mustn't be recovered again
+    blackBoxRing.magic = 0;
+
+    *data = (const uint8_t*)&blackBoxRing.header;
+    return sizeof(BlackBoxHeader) + count * sizeof(BlackBoxEntry);
+}
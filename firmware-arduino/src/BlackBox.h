@@ -0,0 +1,71 @@
+#ifndef FIRMWARE_ARDUINO_BLACKBOX_H
+#define FIRMWARE_ARDUINO_BLACKBOX_H
+
+#include <cstdint>
+#include <cstddef>
+#include "SystemController/control_board_protocol.h"
+#include "SystemController/lcc_protocol.h"
+
+// Control cycles kept, i.e. the last 5 s
+#define BLACK_BOX_ENTRIES 50
+
+#define BLACK_BOX_FILENAME ("/fs/blackbox.dat")
+
+// Recovered black boxes start with a header carrying the schema ID and version, like telemetry frames do. See
+// telemetry_decode.py for the consumer side.
+#define BLACK_BOX_SCHEMA_ID ((uint16_t)0x4C42)
+#define BLACK_BOX_SCHEMA_VERSION ((uint8_t)1)
+
+typedef enum : uint8_t {
+    BLACK_BOX_FLAG_CONTROL_BOARD_RESPONDED = 1 << 0,
+    BLACK_BOX_FLAG_BREW_SSR_ON = 1 << 1,
+    BLACK_BOX_FLAG_SERVICE_SSR_ON = 1 << 2,
+    BLACK_BOX_FLAG_SAFE_PACKET_SENT = 1 << 3,
+    BLACK_BOX_FLAG_STATUS_QUEUE_FULL = 1 << 4,
+} BlackBoxFlag;
+
+struct __attribute__((packed)) BlackBoxHeader {
+    uint16_t schemaId;
+    uint8_t schemaVersion;
+    uint8_t entrySize;
+    uint16_t entryCount;
+    uint16_t reserved;
+};
+
+// Little endian, no padding. Temperatures are in tenths of a degree, times are time_us_32().
+struct __attribute__((packed)) BlackBoxEntry {
+    uint32_t sequence;
+    uint32_t cycleStartUs;
+    uint32_t cycleEndUs;
+    // The packets as they went over the wire
+    uint8_t controlBoardPacket[sizeof(ControlBoardRawPacket)];
+    uint8_t lccPacket[sizeof(LccRawPacket)];
+    int16_t brewTemperature;
+    int16_t serviceTemperature;
+    uint8_t internalState;
+    uint8_t bailReason;
+    uint8_t flags;
+    // CRC32 over the rest of the entry, so that an entry torn by the reset is left out
+    uint32_t checksum;
+};
+
+static_assert(sizeof(BlackBoxEntry) == 46, "Black box entry layout changed, bump BLACK_BOX_SCHEMA_VERSION");
+
+/*
+ * The last few seconds of control cycles, kept by core 0 in RAM that isn't cleared on a watchdog reset. Recording
+ * costs a copy and a CRC per cycle, and never touches flash. After a watchdog reset, core 1 recovers the cycles
+ * leading up to the hang and writes them to flash once.
+ */
+
+// Starts a new recording. Called by core 0 once it's told to begin, which is after core 1 has recovered the old one.
+void black_box_begin();
+// Called by core 0 at the end of every control cycle. The sequence and checksum are filled in.
+void black_box_record(BlackBoxEntry &entry);
+
+// Validates what was recorded before the reset, and lays it out as a header followed by the entries, oldest first.
+// Returns the length, or 0 if there's nothing to recover, which includes once black_box_begin() has been called since
+// the chip booted. The data is only valid until then.
+size_t black_box_recover(const uint8_t **data);
+
+
+#endif //FIRMWARE_ARDUINO_BLACKBOX_H
@@ -0,0 +1,48 @@
+#include "ControlLoopStats.h"
+
+void ControlLoopStats::addStatusMessage(const SystemControllerStatusMessage &message) {
+    cycles++;
+
+    if (message.brewSSRActive) {
+        brewSsrOnCycles++;
+    }
+
+    if (message.serviceSSRActive) {
+        serviceSsrOnCycles++;
+    }
+
+    brewDutyCycle = smooth(brewDutyCycle, message.brewSSRActive ? 1.f : 0.f);
+    serviceDutyCycle = smooth(serviceDutyCycle, message.serviceSSRActive ? 1.f : 0.f);
+
+    bool isBailed = message.state == SYSTEM_CONTROLLER_STATE_BAILED;
+
+    if (isBailed && !bailed) {
+        bails++;
+    }
+
+    bailed = isBailed;
+
+    if (!is_nil_time(lastTimestamp)) {
+        int64_t period = absolute_time_diff_us(lastTimestamp, message.timestamp);
+        int64_t deviation = period - CONTROL_LOOP_PERIOD_US;
+
+        if (deviation < 0) {
+            deviation = -deviation;
+        }
+
+        if (period - CONTROL_LOOP_PERIOD_US > CONTROL_LOOP_LATE_US) {
+            lateCycles++;
+        }
+
+        // A late cycle is counted above, and shouldn't swamp the average
+        uint32_t clamped = deviation > UINT32_MAX ? UINT32_MAX : (uint32_t)deviation;
+
+        if (clamped > maxJitterUs) {
+            maxJitterUs = clamped;
+        }
+
+        jitterUs = smooth(jitterUs, clamped > CONTROL_LOOP_PERIOD_US ? (float)CONTROL_LOOP_PERIOD_US : (float)clamped);
+    }
+
+    lastTimestamp = message.timestamp;
+}
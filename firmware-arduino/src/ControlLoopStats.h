@@ -0,0 +1,58 @@
+#ifndef FIRMWARE_ARDUINO_CONTROLLOOPSTATS_H
+#define FIRMWARE_ARDUINO_CONTROLLOOPSTATS_H
+
+#include <cstdint>
+#include <pico/time.h>
+#include "types.h"
+
+// Core 0 sends one status message per control cycle
+#define CONTROL_LOOP_PERIOD_US 100000
+
+// A cycle that arrives this much later than expected is counted as late, which includes messages dropped on a full queue
+#define CONTROL_LOOP_LATE_US 50000
+
+// Smoothing of the duty cycle and jitter averages, in cycles. 100 cycles is roughly 10 s.
+#define CONTROL_LOOP_SMOOTHING_CYCLES 100
+
+/*
+ * Accumulates statistics about the control loop from the status messages core 0 sends. Counters only ever grow, so
+ * that a scraper can compute rates, while the averages are smoothed over the last ten seconds or so.
+ */
+class ControlLoopStats {
+public:
+    void addStatusMessage(const SystemControllerStatusMessage &message);
+
+    inline uint32_t getCycles() const { return cycles; }
+    inline uint32_t getLateCycles() const { return lateCycles; }
+    inline uint32_t getBrewSsrOnCycles() const { return brewSsrOnCycles; }
+    inline uint32_t getServiceSsrOnCycles() const { return serviceSsrOnCycles; }
+    inline uint32_t getBails() const { return bails; }
+
+    inline float getBrewDutyCycle() const { return brewDutyCycle; }
+    inline float getServiceDutyCycle() const { return serviceDutyCycle; }
+
+    // Mean and max absolute deviation of the cycle period from CONTROL_LOOP_PERIOD_US
+    inline float getJitterUs() const { return jitterUs; }
+    inline uint32_t getMaxJitterUs() const { return maxJitterUs; }
+private:
+    absolute_time_t lastTimestamp = nil_time;
+    bool bailed = false;
+
+    uint32_t cycles = 0;
+    uint32_t lateCycles = 0;
+    uint32_t brewSsrOnCycles = 0;
+    uint32_t serviceSsrOnCycles = 0;
+    uint32_t bails = 0;
+
+    float brewDutyCycle = 0.f;
+    float serviceDutyCycle = 0.f;
+    float jitterUs = 0.f;
+    uint32_t maxJitterUs = 0;
+
+    static inline float smooth(float average, float sample) {
+        return average + (sample - average) / CONTROL_LOOP_SMOOTHING_CYCLES;
+    }
+};
+
+
+#endif //FIRMWARE_ARDUINO_CONTROLLOOPSTATS_H
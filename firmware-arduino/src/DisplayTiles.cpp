@@ -0,0 +1,43 @@
+#include "DisplayTiles.h"
+#include <cstring>
+
+size_t DisplayTiles::send(const uint8_t *frame, const DisplayAreaSender &sendArea) {
+    if (!hasSentFrame) {
+        sendArea(0, 0, UI_DISPLAY_TILES_PER_PAGE, UI_DISPLAY_PAGES);
+        memcpy(sentFrame, frame, sizeof(sentFrame));
+        hasSentFrame = true;
+        return sizeof(sentFrame);
+    }
+
+    size_t bytesSent = 0;
+
+    for (uint8_t page = 0; page < UI_DISPLAY_PAGES; page++) {
+        const uint8_t* drawn = frame + page * UI_DISPLAY_TILES_PER_PAGE * 8;
+        uint8_t* sent = sentFrame + page * UI_DISPLAY_TILES_PER_PAGE * 8;
+
+        int8_t firstTile = -1;
+        int8_t lastTile = -1;
+
+        for (uint8_t tile = 0; tile < UI_DISPLAY_TILES_PER_PAGE; tile++) {
+            if (memcmp(drawn + tile * 8, sent + tile * 8, 8) != 0) {
+                if (firstTile < 0) {
+                    firstTile = tile;
+                }
+
+                lastTile = tile;
+            }
+        }
+
+        if (firstTile < 0) {
+            continue;
+        }
+
+        uint8_t tiles = lastTile - firstTile + 1;
+
+        sendArea(firstTile, page, tiles, 1);
+        memcpy(sent + firstTile * 8, drawn + firstTile * 8, tiles * 8);
+        bytesSent += tiles * 8;
+    }
+
+    return bytesSent;
+}
@@ -0,0 +1,34 @@
+#ifndef FIRMWARE_ARDUINO_DISPLAYTILES_H
+#define FIRMWARE_ARDUINO_DISPLAYTILES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+// The SSD1306's 128x64 frame, in 8 pixel high pages of 16 tiles
+#define UI_DISPLAY_PAGES 8
+#define UI_DISPLAY_TILES_PER_PAGE 16
+#define UI_FRAME_BUFFER_SIZE (UI_DISPLAY_PAGES * UI_DISPLAY_TILES_PER_PAGE * 8)
+
+// Sends an area of the frame to the panel, in tiles, like U8G2::updateDisplayArea()
+typedef std::function<void(uint8_t tileX, uint8_t tileY, uint8_t tilesWide, uint8_t tilesHigh)> DisplayAreaSender;
+
+/*
+ * Keeps a copy of what the panel shows. Most frames only change a number or an icon, so each page of a new frame is
+ * compared with it, and only the span of tiles that differs is sent. A full frame is 1 KiB over SPI.
+ */
+class DisplayTiles {
+public:
+    // Sends whatever differs from what the panel shows, and returns the pixel bytes sent
+    size_t send(const uint8_t* frame, const DisplayAreaSender &sendArea);
+    // Forgets what the panel shows, so the next frame is sent whole
+    inline void invalidate() { hasSentFrame = false; }
+    inline bool knowsPanel() const { return hasSentFrame; }
+private:
+    uint8_t sentFrame[UI_FRAME_BUFFER_SIZE]{};
+    // The boot screens are drawn straight through U8g2, so the first frame after them is sent whole
+    bool hasSentFrame = false;
+};
+
+
+#endif //FIRMWARE_ARDUINO_DISPLAYTILES_H
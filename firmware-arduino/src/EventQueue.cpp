@@ -0,0 +1,150 @@
+#include "EventQueue.h"
+#include <cstring>
+
+EventQueue::EventQueue(FileStore *fileStore): fileStore(fileStore) {
+}
+
+void EventQueue::init() {
+    spillCount = fileStore->size(EVENT_SPILL_FILENAME) / sizeof(QueuedEvent);
+    spillReadIndex = 0;
+    spillDoneCount = 0;
+
+    if (spillCount > 0) {
+        DEBUGV("Recovered %u spilled events\n", spillCount);
+    }
+}
+
+bool EventQueue::enqueue(const char *payload) {
+    QueuedEvent event;
+    size_t length = strlen(payload);
+
+    if (length > EVENT_PAYLOAD_SIZE) {
+        droppedEvents++;
+        return false;
+    }
+
+    event.length = length;
+    memcpy(event.payload, payload, length);
+
+    if (spillCount == 0 && count < EVENT_QUEUE_CAPACITY) {
+        push(event);
+        return true;
+    }
+
+    return spill(event);
+}
+
+void EventQueue::onConnected() {
+    // Any event in flight on the previous connection is resent
+    inflightMsgId = 0;
+    nextDrainAt = make_timeout_time_ms(EVENT_DRAIN_INTERVAL_MS);
+}
+
+void EventQueue::loop(PubSubClient &mqtt, const char *topic) {
+    if (!mqtt.connected()) {
+        return;
+    }
+
+    if (inflightMsgId != 0) {
+        if (mqtt.isAcknowledged(inflightMsgId)) {
+            pop();
+            inflightMsgId = 0;
+            nextDrainAt = make_timeout_time_ms(EVENT_DRAIN_INTERVAL_MS);
+        } else if (absolute_time_diff_us(inflightSentAt, get_absolute_time()) > EVENT_PUBACK_TIMEOUT_MS * 1000) {
+            DEBUGV("No PUBACK for event %u, resending\n", inflightMsgId);
+            inflightMsgId = 0;
+        } else {
+            return;
+        }
+    }
+
+    if (count == 0) {
+        refillFromSpill();
+
+        if (count == 0) {
+            return;
+        }
+    }
+
+    if (absolute_time_diff_us(nextDrainAt, get_absolute_time()) < 0) {
+        return;
+    }
+
+    const QueuedEvent &event = ring[head];
+    inflightMsgId = mqtt.publishQos1(topic, (const uint8_t *)event.payload, event.length, false);
+    inflightSentAt = get_absolute_time();
+
+    if (inflightMsgId == 0) {
+        nextDrainAt = make_timeout_time_ms(EVENT_DRAIN_INTERVAL_MS);
+    }
+}
+
+void EventQueue::push(const QueuedEvent &event) {
+    ring[(head + count) % EVENT_QUEUE_CAPACITY] = event;
+    count++;
+}
+
+void EventQueue::pop() {
+    head = (head + 1) % EVENT_QUEUE_CAPACITY;
+    count--;
+
+    // The ring is only refilled once it's empty, so after the first refill everything in it came from the spill file
+    if (spillReadIndex > 0) {
+        spillDoneCount++;
+        removeSpillIfDone();
+    }
+}
+
+bool EventQueue::spill(const QueuedEvent &event) {
+    if (spillCount >= EVENT_SPILL_MAX_EVENTS) {
+        droppedEvents++;
+        return false;
+    }
+
+    flashWrites++;
+
+    if (!fileStore->append(EVENT_SPILL_FILENAME, (const uint8_t *)&event, sizeof(event))) {
+        DEBUGV("Unable to spill event\n");
+        droppedEvents++;
+        return false;
+    }
+
+    spillCount++;
+    return true;
+}
+
+void EventQueue::refillFromSpill() {
+    while (spillReadIndex < spillCount && count < EVENT_QUEUE_CAPACITY) {
+        QueuedEvent event;
+
+        if (fileStore->read(EVENT_SPILL_FILENAME, spillReadIndex * sizeof(QueuedEvent), (uint8_t *)&event, sizeof(event)) != sizeof(event)) {
+            // Truncated file, nothing more to recover
+            spillDoneCount += spillCount - spillReadIndex;
+            spillReadIndex = spillCount;
+            break;
+        }
+
+        spillReadIndex++;
+
+        if (event.length <= EVENT_PAYLOAD_SIZE) {
+            push(event);
+        } else {
+            spillDoneCount++;
+        }
+    }
+
+    removeSpillIfDone();
+}
+
+// Reading an event back isn't enough, as it would be lost if the power went before the broker acknowledged it
+void EventQueue::removeSpillIfDone() {
+    if (spillCount == 0 || spillDoneCount < spillCount) {
+        return;
+    }
+
+    fileStore->remove(EVENT_SPILL_FILENAME);
+    flashWrites++;
+    spillCount = 0;
+    spillReadIndex = 0;
+    spillDoneCount = 0;
+}
@@ -0,0 +1,74 @@
+#ifndef FIRMWARE_ARDUINO_EVENTQUEUE_H
+#define FIRMWARE_ARDUINO_EVENTQUEUE_H
+
+#include <pico/time.h>
+#include <PubSubClient.h>
+#include "FileStore.h"
+
+#define EVENT_PAYLOAD_SIZE 63
+#define EVENT_QUEUE_CAPACITY 8
+// Bounds the spill file to 64 records of 64 bytes
+#define EVENT_SPILL_MAX_EVENTS 64
+#define EVENT_SPILL_FILENAME ("/fs/events.dat")
+
+// At most one event is in flight, and events are sent no faster than this after a reconnect
+#define EVENT_DRAIN_INTERVAL_MS 250
+#define EVENT_PUBACK_TIMEOUT_MS 5000
+
+struct QueuedEvent {
+    uint8_t length = 0;
+    char payload[EVENT_PAYLOAD_SIZE]{};
+};
+
+/*
+ * Store-and-forward queue for events that shouldn't be lost when the connection drops, like finished shots and
+ * bails. Events are published with QoS 1, one at a time, and only removed once the broker has acknowledged them.
+ *
+ * Events are kept in RAM, and spill to flash once the RAM queue is full. While anything is spilled, new events are
+ * appended to the spill file as well, so that ordering is kept. The spill file is only removed once every event in it
+ * has been acknowledged, so spilled events survive a reboot, at the cost of possibly being delivered twice.
+ */
+class EventQueue {
+public:
+    explicit EventQueue(FileStore* fileStore);
+
+    // Picks up events spilled before a reboot
+    void init();
+
+    // Returns false if the event had to be dropped
+    bool enqueue(const char *payload);
+
+    void onConnected();
+    void loop(PubSubClient &mqtt, const char *topic);
+
+    inline uint16_t size() const { return count + (spillCount - spillReadIndex); }
+    inline uint32_t getDroppedEvents() const { return droppedEvents; }
+    inline uint32_t getFlashWrites() const { return flashWrites; }
+private:
+    FileStore* fileStore;
+
+    QueuedEvent ring[EVENT_QUEUE_CAPACITY];
+    uint8_t head = 0;
+    uint8_t count = 0;
+
+    uint16_t spillCount = 0;
+    uint16_t spillReadIndex = 0;
+    // Spilled events that were acknowledged, or were unreadable and skipped
+    uint16_t spillDoneCount = 0;
+
+    uint16_t inflightMsgId = 0;
+    absolute_time_t inflightSentAt = nil_time;
+    absolute_time_t nextDrainAt = nil_time;
+
+    uint32_t droppedEvents = 0;
+    uint32_t flashWrites = 0;
+
+    void push(const QueuedEvent &event);
+    void pop();
+    bool spill(const QueuedEvent &event);
+    void refillFromSpill();
+    void removeSpillIfDone();
+};
+
+
+#endif //FIRMWARE_ARDUINO_EVENTQUEUE_H
@@ -0,0 +1,232 @@
+#include "FaultLog.h"
+#include "MemoryFree.h"
+#include <Arduino.h>
+#include <CRC32.h>
+#include <pico.h>
+#include <cstdio>
+#include <cstring>
+
+#define FAULT_SNAPSHOT_RING_MAGIC 0x4c434346
+
+struct FaultSnapshotRing {
+    uint32_t magic;
+    uint32_t head;
+    uint32_t count;
+    FaultCycleSnapshot snapshots[FAULT_LOG_SNAPSHOTS];
+};
+
+// Survives a watchdog reset, but is garbage after power on, hence the magic
+static FaultSnapshotRing __uninitialized_ram(snapshotRing);
+
+static int16_t tenths(float temperature) {
+    float scaled = temperature * 10.f;
+
+    if (!(scaled > INT16_MIN)) {
+        return INT16_MIN;
+    }
+
+    return scaled < INT16_MAX ? (int16_t)scaled : INT16_MAX;
+}
+
+static bool isSnapshotRingValid() {
+    return snapshotRing.magic == FAULT_SNAPSHOT_RING_MAGIC &&
+           snapshotRing.head < FAULT_LOG_SNAPSHOTS &&
+           snapshotRing.count <= FAULT_LOG_SNAPSHOTS;
+}
+
+static void resetSnapshotRing() {
+    snapshotRing.head = 0;
+    snapshotRing.count = 0;
+    snapshotRing.magic = FAULT_SNAPSHOT_RING_MAGIC;
+}
+
+static uint32_t recordChecksum(const FaultRecord &record) {
+    return CRC32::calculate((const uint8_t*)&record, offsetof(FaultRecord, checksum));
+}
+
+FaultLog::FaultLog(FileStore *fileStore): fileStore(fileStore) {
+}
+
+void FaultLog::init(bool resetByWatchdog, bool core1Relaunched) {
+    FaultRecord existing;
+
+    for (uint8_t slot = 0; slot < FAULT_LOG_SLOTS; slot++) {
+        if (readRecord(slot, existing) && existing.sequence >= nextSequence) {
+            nextSequence = existing.sequence + 1;
+        }
+    }
+
+    if (core1Relaunched) {
+        // The chip didn't reboot, so this isn't a boot, and the ring holds the cycles leading up to the hang. It's
+        // carried on rather than reset, as the cycles after it belong to the same run of core 0.
+        if (!isSnapshotRingValid()) {
+            resetSnapshotRing();
+        }
+
+        record(FAULT_EVENT_CORE1_RESET);
+        return;
+    }
+
+    if (!resetByWatchdog || !isSnapshotRingValid()) {
+        resetSnapshotRing();
+    }
+
+    record(resetByWatchdog ? FAULT_EVENT_WATCHDOG_RESET : FAULT_EVENT_POWER_ON);
+
+    // What came before the reset has been recorded, and shouldn't show up again with the next fault
+    resetSnapshotRing();
+}
+
+void FaultLog::addStatusMessage(const SystemControllerStatusMessage &message) {
+    FaultCycleSnapshot &snapshot = snapshotRing.snapshots[(snapshotRing.head + snapshotRing.count) % FAULT_LOG_SNAPSHOTS];
+
+    snapshot.uptimeMs = to_ms_since_boot(message.timestamp);
+    snapshot.brewTemperature = tenths(message.brewTemperature);
+    snapshot.serviceTemperature = tenths(message.serviceTemperature);
+    snapshot.brewSetPoint = tenths(message.brewSetPoint);
+    snapshot.state = (uint8_t)message.state;
+    snapshot.flags = (message.brewSSRActive ? FAULT_SNAPSHOT_BREW_SSR : 0) |
+                     (message.serviceSSRActive ? FAULT_SNAPSHOT_SERVICE_SSR : 0) |
+                     (message.currentlyBrewing ? FAULT_SNAPSHOT_BREWING : 0) |
+                     (message.currentlyFillingServiceBoiler ? FAULT_SNAPSHOT_FILLING : 0) |
+                     (message.waterTankLow ? FAULT_SNAPSHOT_WATER_TANK_LOW : 0);
+
+    if (snapshotRing.count < FAULT_LOG_SNAPSHOTS) {
+        snapshotRing.count++;
+    } else {
+        snapshotRing.head = (snapshotRing.head + 1) % FAULT_LOG_SNAPSHOTS;
+    }
+
+    if (message.bailReason != bailReason && message.bailReason != BAIL_REASON_NONE) {
+        record(FAULT_EVENT_BAIL, message.bailReason);
+    }
+
+    bailReason = message.bailReason;
+}
+
+void FaultLog::record(FaultEventType type, SystemControllerBailReason reason) {
+    if (pendingCount == FAULT_LOG_PENDING) {
+        droppedFaults++;
+        return;
+    }
+
+    FaultRecord &entry = pending[(pendingHead + pendingCount) % FAULT_LOG_PENDING];
+    memset(&entry, 0, sizeof(entry));
+
+    entry.sequence = nextSequence++;
+    entry.uptimeMs = to_ms_since_boot(get_absolute_time());
+    entry.freeMemory = freeMemory();
+    entry.type = type;
+    entry.bailReason = reason;
+    entry.snapshotCount = snapshotRing.count;
+
+    for (uint8_t i = 0; i < snapshotRing.count; i++) {
+        entry.snapshots[i] = snapshotRing.snapshots[(snapshotRing.head + i) % FAULT_LOG_SNAPSHOTS];
+    }
+
+    entry.checksum = recordChecksum(entry);
+    pendingCount++;
+}
+
+void FaultLog::loop() {
+    if (pendingCount == 0) {
+        return;
+    }
+
+    const FaultRecord &record = pending[pendingHead];
+    size_t offset = (record.sequence % FAULT_LOG_SLOTS) * sizeof(FaultRecord);
+
+    // Not retried, so a broken file system can't turn into a write on every loop
+    if (!fileStore->writeAt(FAULT_LOG_FILENAME, offset, (const uint8_t*)&record, sizeof(record))) {
+        DEBUGV("Unable to write fault %u\n", record.sequence);
+        droppedFaults++;
+    }
+
+    pendingHead = (pendingHead + 1) % FAULT_LOG_PENDING;
+    pendingCount--;
+}
+
+/*
+ * {"f":[{"n":sequence,"e":type,"r":bail reason,"u":uptime ms,"m":free memory,
+ *        "c":[[uptime ms,brew temp,service temp,brew set point,state,flags],...]},...],"d":dropped}
+ */
+size_t FaultLog::render(char *buffer, size_t size) {
+    uint8_t slots[FAULT_LOG_SLOTS];
+    uint32_t sequences[FAULT_LOG_SLOTS];
+    uint8_t slotCount = 0;
+    FaultRecord record;
+
+    // Sorted newest first as they're read
+    for (uint8_t slot = 0; slot < FAULT_LOG_SLOTS; slot++) {
+        if (!readRecord(slot, record)) {
+            continue;
+        }
+
+        uint8_t i = slotCount++;
+
+        for (; i > 0 && sequences[i - 1] < record.sequence; i--) {
+            slots[i] = slots[i - 1];
+            sequences[i] = sequences[i - 1];
+        }
+
+        slots[i] = slot;
+        sequences[i] = record.sequence;
+    }
+
+    // Room is kept for the closing of the document
+    char closing[24];
+    int closingLength = snprintf(closing, sizeof(closing), "],\"d\":%lu}", (unsigned long)droppedFaults);
+
+    if (closingLength <= 0 || size < sizeof("{\"f\":[") + closingLength) {
+        return 0;
+    }
+
+    size_t limit = size - closingLength;
+    size_t position = snprintf(buffer, size, "{\"f\":[");
+
+    for (uint8_t i = 0; i < slotCount; i++) {
+        if (!readRecord(slots[i], record)) {
+            continue;
+        }
+
+        size_t start = position;
+        int written = snprintf(buffer + position, limit - position, "%s{\"n\":%lu,\"e\":%u,\"r\":%u,\"u\":%lu,\"m\":%ld,\"c\":[",
+                               buffer[position - 1] == '[' ? "" : ",", (unsigned long)record.sequence, record.type, record.bailReason,
+                               (unsigned long)record.uptimeMs, (long)record.freeMemory);
+
+        for (uint8_t s = 0; s < record.snapshotCount && written > 0 && position + written < limit; s++) {
+            position += written;
+
+            const FaultCycleSnapshot &snapshot = record.snapshots[s];
+            written = snprintf(buffer + position, limit - position, "%s[%lu,%d,%d,%d,%u,%u]", s > 0 ? "," : "",
+                               (unsigned long)snapshot.uptimeMs, snapshot.brewTemperature, snapshot.serviceTemperature,
+                               snapshot.brewSetPoint, snapshot.state, snapshot.flags);
+        }
+
+        if (written > 0 && position + written < limit) {
+            position += written;
+            written = snprintf(buffer + position, limit - position, "]}");
+        }
+
+        // Records that don't fit are left out whole
+        if (written <= 0 || position + written >= limit) {
+            position = start;
+            break;
+        }
+
+        position += written;
+    }
+
+    memcpy(buffer + position, closing, closingLength + 1);
+    return position + closingLength;
+}
+
+bool FaultLog::readRecord(uint8_t slot, FaultRecord &record) {
+    if (fileStore->read(FAULT_LOG_FILENAME, slot * sizeof(FaultRecord), (uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+        return false;
+    }
+
+    return record.sequence != 0 &&
+           record.snapshotCount <= FAULT_LOG_SNAPSHOTS &&
+           record.checksum == recordChecksum(record);
+}
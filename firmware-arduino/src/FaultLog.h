@@ -0,0 +1,102 @@
+#ifndef FIRMWARE_ARDUINO_FAULTLOG_H
+#define FIRMWARE_ARDUINO_FAULTLOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <pico/time.h>
+#include "types.h"
+#include "FileStore.h"
+
+#define FAULT_LOG_FILENAME ("/fs/faults.log")
+
+// The log is a ring of this many fixed size records, so it never takes up more than about 2 KB of flash
+#define FAULT_LOG_SLOTS 16
+
+// Control cycles leading up to a fault that are kept with it, i.e. the last 0.8 s
+#define FAULT_LOG_SNAPSHOTS 8
+
+// Faults waiting to be written. One is written per loop, and faults beyond these are dropped.
+#define FAULT_LOG_PENDING 4
+
+typedef enum : uint8_t {
+    FAULT_EVENT_NONE = 0,
+    FAULT_EVENT_POWER_ON = 1,
+    FAULT_EVENT_WATCHDOG_RESET = 2,
+    FAULT_EVENT_BAIL = 3,
+    FAULT_EVENT_WIFI_MODULE_RESET = 4,
+    // Core 0 reset core 1 after it stopped responding, while the machine kept running
+    FAULT_EVENT_CORE1_RESET = 5,
+} FaultEventType;
+
+#define FAULT_SNAPSHOT_BREW_SSR 0x01
+#define FAULT_SNAPSHOT_SERVICE_SSR 0x02
+#define FAULT_SNAPSHOT_BREWING 0x04
+#define FAULT_SNAPSHOT_FILLING 0x08
+#define FAULT_SNAPSHOT_WATER_TANK_LOW 0x10
+
+// Temperatures are in tenths of a degree
+struct FaultCycleSnapshot {
+    uint32_t uptimeMs;
+    int16_t brewTemperature;
+    int16_t serviceTemperature;
+    int16_t brewSetPoint;
+    uint8_t state;
+    uint8_t flags;
+};
+
+struct FaultRecord {
+    uint32_t sequence;
+    uint32_t uptimeMs;
+    int32_t freeMemory;
+    uint8_t type;
+    uint8_t bailReason;
+    uint8_t snapshotCount;
+    uint8_t reserved;
+    // Oldest first
+    FaultCycleSnapshot snapshots[FAULT_LOG_SNAPSHOTS];
+    uint32_t checksum;
+};
+
+/*
+ * A post-mortem log of bails, resets and other faults, kept on flash across reboots. Every record carries the control
+ * cycles leading up to it. Those are kept in RAM that isn't cleared on a watchdog reset, so the record written at boot
+ * after a watchdog reset shows what the machine was doing when it hung. The same goes for the record written when core 0
+ * relaunches core 1.
+ *
+ * Faults are recorded into a small fixed queue and written out one per loop, so recording never blocks or allocates.
+ * Each write overwrites one slot in place.
+ */
+class FaultLog {
+public:
+    explicit FaultLog(FileStore* fileStore);
+
+    // Finds where the log left off, and records the boot, or the reset if core 0 relaunched core 1
+    void init(bool resetByWatchdog, bool core1Relaunched);
+
+    // Called for every status message from core 0
+    void addStatusMessage(const SystemControllerStatusMessage &message);
+    void record(FaultEventType type, SystemControllerBailReason reason = BAIL_REASON_NONE);
+
+    void loop();
+
+    // Renders the log as JSON, newest first, with as many records as fit. Returns the length.
+    size_t render(char* buffer, size_t size);
+
+    inline uint32_t getRecordedFaults() const { return nextSequence - 1; }
+    inline uint32_t getDroppedFaults() const { return droppedFaults; }
+private:
+    FileStore* fileStore;
+
+    uint32_t nextSequence = 1;
+    SystemControllerBailReason bailReason = BAIL_REASON_NONE;
+
+    FaultRecord pending[FAULT_LOG_PENDING]{};
+    uint8_t pendingHead = 0;
+    uint8_t pendingCount = 0;
+    uint32_t droppedFaults = 0;
+
+    bool readRecord(uint8_t slot, FaultRecord &record);
+};
+
+
+#endif //FIRMWARE_ARDUINO_FAULTLOG_H
@@ -10,26 +10,6 @@ FileIO::FileIO(FS *fileSystem, PicoQueue<SystemControllerCommand> *queue) : _fil
 
 }
 
-bool FileIO::saveSystemSettings(SettingStruct systemSettings, const char *filename, uint8_t version) {
-    File file = _fileSystem->open(filename, "w");
-
-    if (file)
-    {
-        uint32_t calculatedChecksum = CRC32::calculate((uint8_t *) &systemSettings, sizeof(systemSettings));
-
-        file.seek(0, SeekSet);
-        file.write(version);
-        file.write((uint8_t *) &systemSettings, sizeof(systemSettings));
-        file.write((uint8_t *) &calculatedChecksum, sizeof(calculatedChecksum));
-        file.close();
-
-        return true;
-    }
-    else {
-        return false;
-    }
-}
-
 bool FileIO::saveWifiConfig(WiFiNINA_Configuration wifiConfig, const char *filename, uint8_t version) {
     File file = _fileSystem->open(filename, "w");
 
@@ -56,11 +36,15 @@ bool FileIO::saveWifiConfig(WiFiNINA_Configuration wifiConfig, const char *filen
     }
 }
 
-nonstd::optional<SettingStruct> FileIO::readSystemSettings(const char *filename, uint8_t version) {
+nonstd::optional<WiFiNINA_Configuration> FileIO::readWifiConfig(const char *filename, uint8_t version) {
+    DEBUGV("Reading network config\n");
+    WiFiNINA_Configuration readConfig;
     File file = _fileSystem->open(filename, "r");
+
     if (!file)
     {
-        return nonstd::optional<SettingStruct>();
+        DEBUGV("No config file\n");
+        return nonstd::optional<WiFiNINA_Configuration>();
     }
 
     file.seek(0, SeekSet);
@@ -70,64 +54,107 @@ nonstd::optional<SettingStruct> FileIO::readSystemSettings(const char *filename,
 
     if (readVersion != version) {
         file.close();
-        return nonstd::optional<SettingStruct>();
+        DEBUGV("Wrong config version\n");
+        return nonstd::optional<WiFiNINA_Configuration>();
     }
 
-    SettingStruct readSettings{};
-
-    file.read((uint8_t *) &readSettings, sizeof(readSettings));
+    file.read((uint8_t *) &readConfig, sizeof(readConfig));
 
     uint32_t readChecksum;
     file.read((uint8_t *) &readChecksum, sizeof(readChecksum));
 
     file.close();
 
-    uint32_t calculatedChecksum = CRC32::calculate((uint8_t *) &readSettings, sizeof(readSettings));
+    uint32_t calculatedChecksum = CRC32::calculate((uint8_t *) &readConfig, sizeof(readConfig));
 
     if (calculatedChecksum != readChecksum) {
-        return nonstd::optional<SettingStruct>();
+        DEBUGV("Config checksum mismatch\n");
+        DEBUGV("Calculated config checksum %d, read %d\n", calculatedChecksum, readChecksum);
+        return nonstd::optional<WiFiNINA_Configuration>();
+    }
+
+    return nonstd::optional<WiFiNINA_Configuration>(readConfig);
+}
+
+bool FileIO::append(const char *filename, const uint8_t *data, size_t length) {
+    File file = _fileSystem->open(filename, "a");
+
+    if (!file) {
+        return false;
     }
 
+    size_t written = file.write(data, length);
+    file.close();
 
-    return nonstd::optional<SettingStruct>(readSettings);
+    return written == length;
 }
 
-nonstd::optional<WiFiNINA_Configuration> FileIO::readWifiConfig(const char *filename, uint8_t version) {
-    DEBUGV("Reading network config\n");
-    WiFiNINA_Configuration readConfig;
-    File file = _fileSystem->open(filename, "r");
+bool FileIO::write(const char *filename, const uint8_t *data, size_t length) {
+    File file = _fileSystem->open(filename, "w");
 
-    if (!file)
-    {
-        DEBUGV("No config file\n");
-        return nonstd::optional<WiFiNINA_Configuration>();
+    if (!file) {
+        return false;
     }
 
-    file.seek(0, SeekSet);
+    size_t written = file.write(data, length);
+    file.close();
 
-    uint8_t readVersion;
-    file.read((uint8_t *) &readVersion, sizeof(readVersion));
+    return written == length;
+}
 
-    if (readVersion != version) {
+bool FileIO::writeAt(const char *filename, size_t offset, const uint8_t *data, size_t length) {
+    File file = _fileSystem->open(filename, _fileSystem->exists(filename) ? "r+" : "w");
+
+    if (!file) {
+        return false;
+    }
+
+    if (!file.seek(offset, SeekSet)) {
         file.close();
-        DEBUGV("Wrong config version\n");
-        return nonstd::optional<WiFiNINA_Configuration>();
+        return false;
     }
 
-    file.read((uint8_t *) &readConfig, sizeof(readConfig));
+    size_t written = file.write(data, length);
+    file.close();
 
-    uint32_t readChecksum;
-    file.read((uint8_t *) &readChecksum, sizeof(readChecksum));
+    return written == length;
+}
+
+size_t FileIO::read(const char *filename, size_t offset, uint8_t *buffer, size_t length) {
+    File file = _fileSystem->open(filename, "r");
 
+    if (!file) {
+        return 0;
+    }
+
+    file.seek(offset, SeekSet);
+    int readBytes = file.read(buffer, length);
     file.close();
 
-    uint32_t calculatedChecksum = CRC32::calculate((uint8_t *) &readConfig, sizeof(readConfig));
+    return readBytes > 0 ? readBytes : 0;
+}
 
-    if (calculatedChecksum != readChecksum) {
-        DEBUGV("Config checksum mismatch\n");
-        DEBUGV("Calculated config checksum %d, read %d\n", calculatedChecksum, readChecksum);
-        return nonstd::optional<WiFiNINA_Configuration>();
+size_t FileIO::size(const char *filename) {
+    if (!_fileSystem->exists(filename)) {
+        return 0;
     }
 
-    return nonstd::optional<WiFiNINA_Configuration>(readConfig);
+    File file = _fileSystem->open(filename, "r");
+
+    if (!file) {
+        return 0;
+    }
+
+    size_t fileSize = file.size();
+    file.close();
+
+    return fileSize;
+}
+
+bool FileIO::remove(const char *filename) {
+    return _fileSystem->remove(filename);
+}
+
+bool FileIO::rename(const char *from, const char *to) {
+    return _fileSystem->rename(from, to);
 }
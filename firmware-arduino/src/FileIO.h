@@ -10,16 +10,23 @@
 #include "types.h"
 #include "optional.hpp"
 #include "utils/PicoQueue.h"
+#include "FileStore.h"
 
-class FileIO {
+class FileIO : public FileStore {
 public:
     explicit FileIO(FS *fileSystem, PicoQueue<SystemControllerCommand>* queue);
 
-    bool saveSystemSettings(SettingStruct systemSettings, const char * filename, uint8_t version);
     bool saveWifiConfig(WiFiNINA_Configuration wifiConfig, const char * filename, uint8_t version);
 
-    nonstd::optional<SettingStruct> readSystemSettings(const char * filename, uint8_t version);
     nonstd::optional<WiFiNINA_Configuration> readWifiConfig(const char * filename, uint8_t version);
+
+    bool append(const char * filename, const uint8_t * data, size_t length) override;
+    bool write(const char * filename, const uint8_t * data, size_t length) override;
+    bool writeAt(const char * filename, size_t offset, const uint8_t * data, size_t length) override;
+    size_t read(const char * filename, size_t offset, uint8_t * buffer, size_t length) override;
+    size_t size(const char * filename) override;
+    bool remove(const char * filename) override;
+    bool rename(const char * from, const char * to) override;
 private:
     FS* _fileSystem;
     PicoQueue<SystemControllerCommand>* _queue;
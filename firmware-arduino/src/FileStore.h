@@ -0,0 +1,28 @@
+#ifndef FIRMWARE_ARDUINO_FILESTORE_H
+#define FIRMWARE_ARDUINO_FILESTORE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Plain byte access to files made up of fixed size records. FileIO implements it on LittleFS, and the host tests
+ * implement it in memory.
+ */
+class FileStore {
+public:
+    virtual bool append(const char * filename, const uint8_t * data, size_t length) = 0;
+    // Replaces the contents of the file
+    virtual bool write(const char * filename, const uint8_t * data, size_t length) = 0;
+    // Overwrites part of the file in place, creating it if needed. Writing past the end extends it.
+    virtual bool writeAt(const char * filename, size_t offset, const uint8_t * data, size_t length) = 0;
+    virtual size_t read(const char * filename, size_t offset, uint8_t * buffer, size_t length) = 0;
+    virtual size_t size(const char * filename) = 0;
+    virtual bool remove(const char * filename) = 0;
+    // Atomic on LittleFS, an existing file at the destination is replaced
+    virtual bool rename(const char * from, const char * to) = 0;
+protected:
+    ~FileStore() = default;
+};
+
+
+#endif //FIRMWARE_ARDUINO_FILESTORE_H
@@ -0,0 +1,198 @@
+#include "HomeAssistantDiscovery.h"
+#include "types.h"
+#include <cstdio>
+
+#define NO_RANGE false, 0, 0, 0
+
+constexpr DiscoveryEntity discoveryEntities[DISCOVERY_ENTITY_COUNT] = {
+    {
+        "sensor", "state", "state", "State",
+        DISCOVERY_TOPIC_STATE, DISCOVERY_TOPIC_STATE, false,
+        "mdi:eye", nullptr, nullptr, nullptr,
+        "{{ value_json.s }}",
+        R"({"bail_reason": "{{value_json.i.br}}", "watchdog_reset": "{{value_json.i.wr}}"})",
+        nullptr, nullptr, nullptr,
+        NO_RANGE
+    },
+    {
+        "sensor", "brew_temp", "brew_temp", "Brew Boiler Temperature",
+        DISCOVERY_TOPIC_STATE, DISCOVERY_TOPIC_STATE, false,
+        "mdi:thermometer", "°C", "temperature", nullptr,
+        "{{ value_json.bt | round(1) }}",
+        R"({"p": "{{value_json.bp.p}}", "i": "{{value_json.bp.i}}", "d": "{{value_json.bp.d}}", "integral": "{{value_json.bp.in}}",  "hysteresis_mode": "{{value_json.bp.hm}}"})",
+        nullptr, nullptr, nullptr,
+        NO_RANGE
+    },
+    {
+        "sensor", "serv_temp", "serv_temp", "Service Boiler Temperature",
+        DISCOVERY_TOPIC_STATE, DISCOVERY_TOPIC_STATE, false,
+        "mdi:thermometer", "°C", "temperature", nullptr,
+        "{{ value_json.st | round(1) }}",
+        R"({"p": "{{value_json.sp.p}}", "i": "{{value_json.sp.i}}", "d": "{{value_json.sp.d}}", "integral": "{{value_json.sp.in}}",  "hysteresis_mode": "{{value_json.sp.hm}}"})",
+        nullptr, nullptr, nullptr,
+        NO_RANGE
+    },
+    {
+        "sensor", "wifi", "wifi", "WiFi",
+        DISCOVERY_TOPIC_STATE, DISCOVERY_TOPIC_INFO, false,
+        "mdi:wifi", "dBm", nullptr, "diagnostic",
+        "{{value_json.r}}",
+        R"({"ssid": "{{value_json.w.s}}", "ip": "{{value_json.w.i}}"})",
+        nullptr, nullptr, nullptr,
+        NO_RANGE
+    },
+    {
+        "sensor", "rp2040_temp", "rp2040_temp", "RP2040 Temperature",
+        DISCOVERY_TOPIC_STATE, DISCOVERY_TOPIC_STATE, false,
+        "mdi:thermometer", "°C", "temperature", "diagnostic",
+        "{{ value_json.rt | round(1) }}",
+        nullptr,
+        nullptr, nullptr, nullptr,
+        NO_RANGE
+    },
+    {
+        "switch", "eco_mode", "eco_mode", "Eco Mode",
+        DISCOVERY_TOPIC_CONFIG, DISCOVERY_TOPIC_CONFIG, true,
+        "hass:leaf", nullptr, nullptr, "config",
+        R"({{ 'ON' if value_json.em else 'OFF' }})",
+        nullptr,
+        nullptr,
+        R"({"cmd": "set_eco_mode", "bool_value": true})",
+        R"({"cmd": "set_eco_mode", "bool_value": false})",
+        NO_RANGE
+    },
+    {
+        "switch", "sleep_mode", "sleep_mode", "Sleep Mode",
+        DISCOVERY_TOPIC_CONFIG, DISCOVERY_TOPIC_CONFIG, true,
+        "hass:sleep", nullptr, nullptr, "config",
+        R"({{ 'ON' if value_json.sm else 'OFF' }})",
+        nullptr,
+        nullptr,
+        R"({"cmd": "set_sleep_mode", "bool_value": true})",
+        R"({"cmd": "set_sleep_mode", "bool_value": false})",
+        NO_RANGE
+    },
+    {
+        "number", "brew_temp_target", "brew_temp_target", "Brew Boiler Temperature Target",
+        DISCOVERY_TOPIC_CONFIG, DISCOVERY_TOPIC_NONE, true,
+        "mdi:thermometer", "°C", nullptr, "config",
+        R"({{ value_json.b.tt | round(1) }})",
+        nullptr,
+        R"({"cmd": "set_brew_temp_target", "float_value": {{value}} })",
+        nullptr, nullptr,
+        true, 0.1, 0, 100
+    },
+    {
+        "number", "serv_temp_target", "service_temp_target", "Service Boiler Temperature Target",
+        DISCOVERY_TOPIC_CONFIG, DISCOVERY_TOPIC_NONE, true,
+        "mdi:thermometer", "°C", nullptr, "config",
+        R"({{ value_json.s.tt | round(1) }})",
+        nullptr,
+        R"({"cmd": "set_service_temp_target", "float_value": {{value}} })",
+        nullptr, nullptr,
+        true, 0.1, 0, 150
+    },
+    {
+        "number", "auto_sleep_min", "auto_sleep_min", "Auto-sleep after",
+        DISCOVERY_TOPIC_CONFIG, DISCOVERY_TOPIC_NONE, true,
+        "hass:sleep", "minutes", nullptr, "config",
+        R"({{ value_json.asm }})",
+        nullptr,
+        R"({"cmd": "set_auto_sleep_min", "int_value": {{value}} })",
+        nullptr, nullptr,
+        true, 1, 0, AUTO_SLEEP_MAX_MIN
+    },
+    {
+        "binary_sensor", "water_tank_low", "water_tank_low", "Water Tank Low",
+        DISCOVERY_TOPIC_STATE, DISCOVERY_TOPIC_NONE, true,
+        "mdi:water-alert", nullptr, "problem", nullptr,
+        R"({{ 'ON' if value_json.wt else 'OFF' }})",
+        nullptr,
+        nullptr, nullptr, nullptr,
+        NO_RANGE
+    },
+    {
+        "sensor", "planned_auto_sleep_min", "planned_auto_sleep", "Planned Auto Sleep in",
+        DISCOVERY_TOPIC_STATE, DISCOVERY_TOPIC_STATE, false,
+        "hass:sleep", "minutes", nullptr, "diagnostic",
+        "{{value_json.asi | round(0) }}",
+        nullptr,
+        nullptr, nullptr, nullptr,
+        NO_RANGE
+    },
+};
+
+void format_discovery_topic(char* buffer, size_t bufferSize, const DiscoveryEntity &entity, const DiscoveryContext &context) {
+    snprintf(buffer, bufferSize, "homeassistant/%s/%s/%s_%s/config", entity.component, context.prefix, context.identifier, entity.objectId);
+}
+
+void create_discovery_payload(JsonDocument &document, const DiscoveryEntity &entity, const DiscoveryContext &context) {
+    char name[64];
+    char uniqueId[48];
+
+    snprintf(name, sizeof(name), "%s %s", context.identifier, entity.name);
+    snprintf(uniqueId, sizeof(uniqueId), "%s_%s", context.identifier, entity.uniqueIdSuffix);
+
+    document.clear();
+
+    // Non-const char pointers make ArduinoJson copy the strings, everything else points into flash
+    JsonObject device = document.createNestedObject("dev");
+    device["ids"][0] = context.identifier;
+    device["cns"][0][0] = "mac";
+    device["cns"][0][1] = context.macString;
+    device["mf"] = "magnusnordlander";
+    device["mdl"] = "smart-lcc";
+    device["name"] = context.identifier;
+    device["sw"] = context.firmwareVersion;
+
+    document["avty_t"] = context.topics[DISCOVERY_TOPIC_LWT];
+    document["stat_t"] = context.topics[entity.stateTopic];
+
+    if (entity.attributesTopic != DISCOVERY_TOPIC_NONE) {
+        document["json_attr_t"] = context.topics[entity.attributesTopic];
+    }
+
+    if (entity.hasCommandTopic) {
+        document["cmd_t"] = context.topics[DISCOVERY_TOPIC_COMMAND];
+    }
+
+    document["name"] = (char*)name;
+    document["uniq_id"] = (char*)uniqueId;
+
+    if (entity.unit) {
+        document["unit_of_meas"] = entity.unit;
+    }
+
+    document["ic"] = entity.icon;
+
+    if (entity.deviceClass) {
+        document["dev_cla"] = entity.deviceClass;
+    }
+
+    if (entity.hasRange) {
+        document["step"] = entity.step;
+        document["min"] = entity.min;
+        document["max"] = entity.max;
+    }
+
+    document["val_tpl"] = entity.valueTemplate;
+
+    if (entity.attributesTemplate) {
+        document["json_attr_tpl"] = entity.attributesTemplate;
+    }
+
+    if (entity.commandTemplate) {
+        document["cmd_tpl"] = entity.commandTemplate;
+    }
+
+    if (entity.payloadOn) {
+        document["pl_on"] = entity.payloadOn;
+        document["pl_off"] = entity.payloadOff;
+        document["stat_on"] = "ON";
+        document["stat_off"] = "OFF";
+    }
+
+    if (entity.entityCategory) {
+        document["entity_category"] = entity.entityCategory;
+    }
+}
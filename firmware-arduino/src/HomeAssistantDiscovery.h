@@ -0,0 +1,63 @@
+#ifndef FIRMWARE_ARDUINO_HOMEASSISTANTDISCOVERY_H
+#define FIRMWARE_ARDUINO_HOMEASSISTANTDISCOVERY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ArduinoJson.h>
+
+#define DISCOVERY_ENTITY_COUNT 12
+#define DISCOVERY_TOPIC_LENGTH 128
+
+typedef enum : uint8_t {
+    DISCOVERY_TOPIC_NONE,
+    DISCOVERY_TOPIC_LWT,
+    DISCOVERY_TOPIC_STATE,
+    DISCOVERY_TOPIC_CONFIG,
+    DISCOVERY_TOPIC_INFO,
+    DISCOVERY_TOPIC_COMMAND,
+    DISCOVERY_TOPIC_COUNT,
+} DiscoveryTopic;
+
+// Describes one Home Assistant entity. Optional strings are nullptr when unused.
+struct DiscoveryEntity {
+    const char* component;
+    // Used in the discovery topic, <identifier>_<objectId>
+    const char* objectId;
+    // Used for uniq_id, <identifier>_<uniqueIdSuffix>. Differs from objectId for a few entities for historical reasons.
+    const char* uniqueIdSuffix;
+    // Appended to the identifier, e.g. "<identifier> State"
+    const char* name;
+    DiscoveryTopic stateTopic;
+    DiscoveryTopic attributesTopic;
+    bool hasCommandTopic;
+    const char* icon;
+    const char* unit;
+    const char* deviceClass;
+    const char* entityCategory;
+    const char* valueTemplate;
+    const char* attributesTemplate;
+    const char* commandTemplate;
+    const char* payloadOn;
+    const char* payloadOff;
+    bool hasRange;
+    double step;
+    double min;
+    double max;
+};
+
+// Everything that's specific to this device rather than the entity
+struct DiscoveryContext {
+    const char* prefix;
+    const char* identifier;
+    const char* macString;
+    const char* firmwareVersion;
+    const char* topics[DISCOVERY_TOPIC_COUNT];
+};
+
+extern const DiscoveryEntity discoveryEntities[DISCOVERY_ENTITY_COUNT];
+
+// Formats homeassistant/<component>/<prefix>/<identifier>_<objectId>/config
+void format_discovery_topic(char* buffer, size_t bufferSize, const DiscoveryEntity &entity, const DiscoveryContext &context);
+void create_discovery_payload(JsonDocument &document, const DiscoveryEntity &entity, const DiscoveryContext &context);
+
+#endif //FIRMWARE_ARDUINO_HOMEASSISTANTDISCOVERY_H
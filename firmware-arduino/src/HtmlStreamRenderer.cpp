@@ -0,0 +1,111 @@
+#include "HtmlStreamRenderer.h"
+#include <cstring>
+
+// Fragments may contain placeholders of their own, but not endlessly
+#define HTML_MAX_FRAGMENT_DEPTH 2
+
+void HtmlStreamRenderer::render(const char *fragment) {
+    render(fragment, 0);
+}
+
+void HtmlStreamRenderer::flush() {
+    if (chunkLength > 0) {
+        sink(chunk, chunkLength);
+        chunkLength = 0;
+    }
+}
+
+void HtmlStreamRenderer::render(const char *fragment, uint8_t depth) {
+    const char* position = fragment;
+
+    while (*position != '\0') {
+        const char* start = strstr(position, "[[");
+
+        if (start == nullptr) {
+            write(position, strlen(position));
+            return;
+        }
+
+        const char* end = strstr(start + 2, "]]");
+
+        if (end == nullptr) {
+            write(position, strlen(position));
+            return;
+        }
+
+        write(position, start - position);
+
+        const HtmlField* field = findField(start + 2, end - start - 2);
+
+        if (field == nullptr) {
+            write(start, end + 2 - start);
+        } else if (field->isFragment && depth < HTML_MAX_FRAGMENT_DEPTH) {
+            render(field->value, depth + 1);
+        } else {
+            writeEscaped(field->value);
+        }
+
+        position = end + 2;
+    }
+}
+
+const HtmlField *HtmlStreamRenderer::findField(const char *name, size_t nameLength) const {
+    for (size_t i = 0; i < fieldCount; i++) {
+        if (strncmp(fields[i].name, name, nameLength) == 0 && fields[i].name[nameLength] == '\0') {
+            return &fields[i];
+        }
+    }
+
+    return nullptr;
+}
+
+void HtmlStreamRenderer::write(const char *data, size_t length) {
+    while (length > 0) {
+        size_t free = sizeof(chunk) - chunkLength;
+        size_t copied = length < free ? length : free;
+
+        memcpy(chunk + chunkLength, data, copied);
+        chunkLength += copied;
+        data += copied;
+        length -= copied;
+
+        if (chunkLength == sizeof(chunk)) {
+            flush();
+        }
+    }
+}
+
+// Values end up in attributes, e.g. value='[[pw]]', so quotes have to be escaped along with the usual suspects
+void HtmlStreamRenderer::writeEscaped(const char *value) {
+    const char* run = value;
+
+    for (const char* c = value; *c != '\0'; c++) {
+        const char* entity;
+
+        switch (*c) {
+            case '&':
+                entity = "&amp;";
+                break;
+            case '<':
+                entity = "&lt;";
+                break;
+            case '>':
+                entity = "&gt;";
+                break;
+            case '\'':
+                entity = "&#39;";
+                break;
+            case '"':
+                entity = "&quot;";
+                break;
+            default:
+                continue;
+        }
+
+        write(run, c - run);
+        write(entity, strlen(entity));
+        run = c + 1;
+    }
+
+    write(run, strlen(run));
+}
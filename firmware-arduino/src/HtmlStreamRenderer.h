@@ -0,0 +1,46 @@
+#ifndef FIRMWARE_ARDUINO_HTMLSTREAMRENDERER_H
+#define FIRMWARE_ARDUINO_HTMLSTREAMRENDERER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+// Output is handed to the sink in chunks of at most this size
+#define HTML_CHUNK_SIZE 256
+
+typedef std::function<void(const char* data, size_t length)> HtmlSink;
+
+// Substitutes a [[name]] placeholder. Values are HTML escaped, unless the field is itself a template fragment.
+struct HtmlField {
+    const char* name;
+    const char* value;
+    bool isFragment;
+};
+
+/*
+ * Renders template fragments straight to a sink, substituting [[name]] placeholders on the way, so that a page never
+ * has to exist in memory as a whole. Placeholders without a matching field are written as is.
+ */
+class HtmlStreamRenderer {
+public:
+    HtmlStreamRenderer(HtmlSink sink, const HtmlField* fields, size_t fieldCount): sink(sink), fields(fields), fieldCount(fieldCount) {}
+
+    void render(const char* fragment);
+    // Hands whatever is buffered to the sink. Must be called once the page is done.
+    void flush();
+private:
+    HtmlSink sink;
+    const HtmlField* fields;
+    size_t fieldCount;
+
+    char chunk[HTML_CHUNK_SIZE];
+    size_t chunkLength = 0;
+
+    void render(const char* fragment, uint8_t depth);
+    const HtmlField* findField(const char* name, size_t nameLength) const;
+    void write(const char* data, size_t length);
+    void writeEscaped(const char* value);
+};
+
+
+#endif //FIRMWARE_ARDUINO_HTMLSTREAMRENDERER_H
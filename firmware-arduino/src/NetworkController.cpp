@@ -3,15 +3,24 @@
 //
 
 #include "NetworkController.h"
+#include "telemetry_protocol.h"
+#include "HomeAssistantDiscovery.h"
+#include "utils/fnv_hash.h"
+#include "MemoryFree.h"
+#include "HtmlStreamRenderer.h"
+#include "PrometheusWriter.h"
 #include <CRC32.h>
 #include <WiFiWebServer.h>
 #include <ArduinoJson.h>
 #include <hardware/watchdog.h>
 #include <functional>
+#include <cmath>
 
 #define CONFIG_FILENAME ("/fs/network-config.dat")
 #define CONFIG_VERSION ((uint8_t)1)
 
+static_assert(sizeof(BlackBoxHeader) + BLACK_BOX_ENTRIES * sizeof(BlackBoxEntry) <= STATUS_HTTP_BUFFER_SIZE, "A recovered black box must fit the HTTP buffer");
+
 // -- HTML page fragments
 
 const char WIFININA_HTML_HEAD_START[] /*PROGMEM*/ = "<!DOCTYPE html><html><head><title>RP2040_WM_NINA_Lite</title>";
@@ -45,14 +54,6 @@ request.send(null);";
 const char WIFININA_HTML_SCRIPT_END[]   /*PROGMEM*/ = "alert('Updated');}</script>";
 const char WIFININA_HTML_END[]          /*PROGMEM*/ = "</html>";
 
-const char WIFININA_SELECT_START[]      /*PROGMEM*/ = "<select id=";
-const char WIFININA_SELECT_END[]        /*PROGMEM*/ = "</select>";
-const char WIFININA_DATALIST_START[]    /*PROGMEM*/ = "<datalist id=";
-const char WIFININA_DATALIST_END[]      /*PROGMEM*/ = "</datalist>";
-const char WIFININA_OPTION_START[]      /*PROGMEM*/ = "<option>";
-const char WIFININA_OPTION_END[]        /*PROGMEM*/ = "";			// "</option>"; is not required
-const char WIFININA_NO_NETWORKS_FOUND[] /*PROGMEM*/ = "No suitable WiFi networks available!";
-
 const char WM_HTTP_CACHE_CONTROL[]   PROGMEM = "Cache-Control";
 const char WM_HTTP_NO_STORE[]        PROGMEM = "no-cache, no-store, must-revalidate";
 const char WM_HTTP_PRAGMA[]          PROGMEM = "Pragma";
@@ -60,10 +61,10 @@ const char WM_HTTP_NO_CACHE[]        PROGMEM = "no-cache";
 const char WM_HTTP_EXPIRES[]         PROGMEM = "Expires";
 
 NetworkController::NetworkController(FileIO* _fileIO, SystemStatus* _status, SystemSettings* _settings):
-    fileIO(_fileIO), status(_status), settings(_settings) {
+    fileIO(_fileIO), status(_status), settings(_settings), faultLog(_fileIO), eventQueue(_fileIO) {
 }
 
-void NetworkController::init(SystemMode _mode) {
+void NetworkController::init(SystemMode _mode, bool core1Relaunched) {
     resetModule();
 
     mode = _mode;
@@ -75,12 +76,26 @@ void NetworkController::init(SystemMode _mode) {
     WiFi.lowPowerMode();
 
     snprintf(identifier, sizeof(identifier), "LCC-%02X%02X%02X", mac[2], mac[1], mac[0]);
-    stdIdentifier = std::string(identifier);
+    snprintf(macString, sizeof(macString), "%02x:%02x:%02x:%02x:%02x:%02x", mac[5], mac[4], mac[3], mac[2], mac[1], mac[0]);
 
     WiFi.setHostname(identifier);
 
     switch (mode) {
         case SYSTEM_MODE_NORMAL:
+            faultLog.init(watchdog_enable_caused_reboot(), core1Relaunched);
+            eventQueue.init();
+
+            // Core 0 is recording again after a relaunch, and the black box from the chip boot was persisted then
+            if (watchdog_enable_caused_reboot() && !core1Relaunched) {
+                persistBlackBox();
+            }
+
+            statusHttpServer.setRenderer([this] (StatusHttpResource resource, char* buffer, size_t size) {
+                return renderHttpResource(resource, buffer, size);
+            });
+            // Falls back to 3.1.1 for the rest of the session if the broker doesn't support it
+            mqtt.setProtocolVersion(MQTT_VERSION_5);
+            break;
         case SYSTEM_MODE_OTA:
             break;
         case SYSTEM_MODE_CONFIG:
@@ -90,10 +105,12 @@ void NetworkController::init(SystemMode _mode) {
 }
 
 void NetworkController::loop() {
-    int wifiStatus = WiFi.status();
-    if (wifiStatus != previousWifiStatus) {
-        DEBUGV("Wifi status transition. From %d to %d\n", previousWifiStatus, wifiStatus);
-        previousWifiStatus = wifiStatus;
+    if (!wifiSupervisor.isResetting()) {
+        int wifiStatus = WiFi.status();
+        if (wifiStatus != previousWifiStatus) {
+            DEBUGV("Wifi status transition. From %d to %d\n", previousWifiStatus, wifiStatus);
+            previousWifiStatus = wifiStatus;
+        }
     }
 
     switch (mode) {
@@ -123,31 +140,39 @@ void NetworkController::resetModule() {
     WiFiDrv::wifiDriverInit();
 }
 
+/*
+ * Only done after a watchdog reset, so the black box doesn't cost any flash writes in normal operation. The previous
+ * recording is replaced, as the most recent hang is the interesting one.
+ */
+void NetworkController::persistBlackBox() {
+    const uint8_t* data;
+    size_t length = black_box_recover(&data);
+
+    if (length == 0) {
+        DEBUGV("No black box to recover\n");
+        return;
+    }
+
+    if (!fileIO->write(BLACK_BOX_FILENAME, data, length)) {
+        DEBUGV("Unable to persist black box\n");
+        return;
+    }
+
+    char payload[EVENT_PAYLOAD_SIZE + 1];
+    snprintf(payload, sizeof(payload), R"({"e":"blackbox","n":%u})", ((const BlackBoxHeader*)data)->entryCount);
+    eventQueue.enqueue(payload);
+}
+
 void NetworkController::loopNormal() {
+    // Written whether or not there's a network, as that's when it's needed the most
+    faultLog.loop();
+
     if (hasConfiguration()) {
-        switch (WiFi.status()) {
-            case WL_CONNECTED:
-                _isConnectedToWifi = true;
-                break;
-            case WL_IDLE_STATUS:
-            case WL_NO_SSID_AVAIL:
-            case WL_SCAN_COMPLETED:
-            case WL_CONNECT_FAILED:
-            case WL_CONNECTION_LOST:
-            case WL_DISCONNECTED:
-                _isConnectedToWifi = false;
-                return attemptWifiConnection();
-            case WL_NO_MODULE:
-                DEBUGV("No module. \n");
-                resetModule();
-                return;
-            case WL_AP_LISTENING:
-            case WL_AP_CONNECTED:
-            case WL_AP_FAILED:
-                _isConnectedToWifi = false;
-                DEBUGV("Unexpected Wifi mode %u\n", WiFi.status());
-                return;
-        }
+        superviseWifi();
+
+        // Served whether or not there's a broker, so local dashboards keep working without one
+        statusHttpServer.loop(_isConnectedToWifi);
+        telemetryWebSocket.loop(_isConnectedToWifi);
 
         if (_isConnectedToWifi) {
             bool hasClient = ensureConnectedMqttClient();
@@ -158,7 +183,12 @@ void NetworkController::loopNormal() {
                 if (!success && !mqttConnectTimeoutTime.has_value()) {
                     mqttConnectTimeoutTime = make_timeout_time_ms(5000);
                 } else if (mqtt.connected()) {
+                    mqtt.beginBatch();
                     publishMqtt();
+
+                    if (!mqtt.endBatch()) {
+                        DEBUGV("Couldn't write MQTT batch\n");
+                    }
                 }
             }
         }
@@ -168,50 +198,99 @@ void NetworkController::loopNormal() {
 bool NetworkController::ensureConnectedMqttClient() {
     if (mqtt.connected()) {
         return true;
-    } else {
-        if (!mqttConnectTimeoutTime.has_value()) {
-            ensureTopicsFormatted();
-            DEBUGV("Attempting to connect to MQTT\n");
+    }
 
-            mqtt.setServer(config.value().mqttConfig.server, atoi(config.value().mqttConfig.port));
+    // The CONNACK is polled for once per loop, so the UI keeps running while the broker is slow or unreachable
+    if (mqtt.state() == MQTT_CONNECTING) {
+        int result = mqtt.pollConnect();
+
+        if (result == MQTT_CONNECTING) {
+            return false;
+        } else if (result != MQTT_CONNECTED) {
+            DEBUGV("Couldn't connect to MQTT server (state %d). Reconnecting in 5 s.\n", result);
+            mqtt.disconnect();
+            mqttConnectTimeoutTime = make_timeout_time_ms(5000);
+            return false;
+        }
 
-            std::function<void(char*, uint8_t*, unsigned int)> func = [&] (char* topic, byte* payload, unsigned int length) {
-                callback(topic, payload, length);
-            };
-            mqtt.setCallback(func);
+        onMqttConnected();
+        return true;
+    }
 
-            bool success = false;
+    if (mqttConnectTimeoutTime.has_value()) {
+        if (absolute_time_diff_us(mqttConnectTimeoutTime.value(), get_absolute_time()) > 0) {
+            mqttConnectTimeoutTime.reset();
+        }
 
-            if (strlen(config.value().mqttConfig.username) > 0) {
-                DEBUGV("Connecting using username and password\n");
-                success = mqtt.connect(identifier, config.value().mqttConfig.username, config.value().mqttConfig.password, &TOPIC_LWT[0], 0, true, "offline");
-            } else {
-                DEBUGV("Connecting unauthenticated\n");
-                success = mqtt.connect(identifier, &TOPIC_LWT[0], 0, true, "offline");
-            }
+        return false;
+    }
 
-            if (!success) {
-                DEBUGV("Couldn't connect to MQTT server. Reconnecting in 5 s.\n");
-                mqtt.disconnect();
-                mqttConnectTimeoutTime = make_timeout_time_ms(5000);
-                return false;
-            }
-            DEBUGV("MQTT connection successful, changing buffer size.\n");
-            mqtt.setBufferSize(4096);
-            DEBUGV("Buffer size changed\n");
+    beginMqttConnect();
+    return false;
+}
 
-            mqtt.subscribe(&TOPIC_COMMAND[0]);
+void NetworkController::beginMqttConnect() {
+    ensureTopicsFormatted();
 
-            publishAutoconfigure();
+    if (!topics.isBuilt()) {
+        mqttConnectTimeoutTime = make_timeout_time_ms(5000);
+        return;
+    }
 
-            return true;
-        } else {
-            if (absolute_time_diff_us(mqttConnectTimeoutTime.value(), get_absolute_time()) > 0) {
-                mqttConnectTimeoutTime.reset();
-            }
-        }
+    DEBUGV("Attempting to connect to MQTT\n");
 
-        return false;
+    mqtt.setServer(config.value().mqttConfig.server, atoi(config.value().mqttConfig.port));
+
+    // A short socket timeout on a good link keeps loop() from stalling core 1, and a longer keepalive on a poor one
+    // saves pings. The RSSI is refreshed with every state publish.
+    mqtt.setAdaptiveTimeouts(true);
+    mqtt.reportRssi((int8_t)WiFi.RSSI());
+
+    // Messages are handled straight from the receive buffer, without copying the topic or payload
+    std::function<void(const MqttMessage&)> func = [&] (const MqttMessage &message) {
+        callback(message);
+    };
+    mqtt.setMessageCallback(func);
+
+    bool success;
+
+    if (strlen(config.value().mqttConfig.username) > 0) {
+        DEBUGV("Connecting using username and password\n");
+        success = mqtt.beginConnect(identifier, config.value().mqttConfig.username, config.value().mqttConfig.password, topics.get(TOPIC_ID_LWT), 0, true, "offline", true);
+    } else {
+        DEBUGV("Connecting unauthenticated\n");
+        success = mqtt.beginConnect(identifier, nullptr, nullptr, topics.get(TOPIC_ID_LWT), 0, true, "offline", true);
+    }
+
+    if (!success) {
+        DEBUGV("Couldn't open connection to MQTT server. Reconnecting in 5 s.\n");
+        mqtt.disconnect();
+        mqttConnectTimeoutTime = make_timeout_time_ms(5000);
+    }
+}
+
+void NetworkController::onMqttConnected() {
+    DEBUGV("MQTT connection successful, changing buffer size.\n");
+    mqtt.setBufferSize(4096);
+    mqtt.setBatchBufferSize(MQTT_BATCH_BUFFER_SIZE);
+    DEBUGV("Buffer size changed\n");
+
+    mqtt.beginBatch();
+    mqtt.subscribe(topics.get(TOPIC_ID_COMMAND));
+
+    // The LWT is retained, so announcing ourselves once per connection is enough
+    mqtt.publish(topics.get(TOPIC_ID_LWT), "online", true);
+    publishScheduler.reset();
+    eventQueue.onConnected();
+
+    // Read back what the broker has retained, so that discovery only republishes what has changed
+    memset(retainedDiscoveryHashes, 0, sizeof(retainedDiscoveryHashes));
+    mqtt.subscribe(topics.get(TOPIC_ID_DISCOVERY_WILDCARD));
+    discoveryIndex = 0;
+    discoveryStartTime = make_timeout_time_ms(DISCOVERY_RETAINED_WAIT_MS);
+
+    if (!mqtt.endBatch()) {
+        DEBUGV("Couldn't write MQTT batch\n");
     }
 }
 
@@ -224,28 +303,10 @@ void NetworkController::loopConfig() {
 
 void NetworkController::loopOta() {
     if (hasConfiguration()) {
-        switch (WiFi.status()) {
-            case WL_CONNECTED:
-                _isConnectedToWifi = true;
-                break;
-            case WL_IDLE_STATUS:
-            case WL_NO_SSID_AVAIL:
-            case WL_SCAN_COMPLETED:
-            case WL_CONNECT_FAILED:
-            case WL_CONNECTION_LOST:
-            case WL_DISCONNECTED:
-                _isConnectedToWifi = false;
-                return attemptWifiConnection();
-            case WL_NO_MODULE:
-                DEBUGV("No module. \n");
-                resetModule();
-                return;
-            case WL_AP_LISTENING:
-            case WL_AP_CONNECTED:
-            case WL_AP_FAILED:
-                _isConnectedToWifi = false;
-                DEBUGV("Unexpected Wifi mode\n");
-                return;
+        superviseWifi();
+
+        if (!_isConnectedToWifi) {
+            return;
         }
 
         initOTA();
@@ -253,19 +314,46 @@ void NetworkController::loopOta() {
     }
 }
 
-void NetworkController::attemptWifiConnection() {
-    if (hasConfiguration()) {
-        if (!wifiConnectTimeoutTime.has_value()) {
+/*
+ * Carries out whatever the supervisor decides. De-initing and re-initing the module happen in separate loops, so
+ * core 1 keeps running the UI while the module is held in reset.
+ */
+void NetworkController::superviseWifi() {
+    // The module can't be queried while it's held in reset
+    uint8_t wifiStatus = wifiSupervisor.isResetting() ? (uint8_t)WL_NO_MODULE : WiFi.status();
+
+    switch (wifiSupervisor.update(wifiStatus)) {
+        case WIFI_ACTION_NONE:
+            break;
+        case WIFI_ACTION_CONNECT:
             DEBUGV("Attempting to connect to Wifi\n");
             WiFiDrv::wifiSetPassphrase(config.value().wiFiCredentials.wifi_ssid, strlen(config.value().wiFiCredentials.wifi_ssid), config.value().wiFiCredentials.wifi_pw, strlen(config.value().wiFiCredentials.wifi_pw));
-            wifiConnectTimeoutTime = make_timeout_time_ms(5000);
-        } else {
-            if (absolute_time_diff_us(wifiConnectTimeoutTime.value(), get_absolute_time()) > 0) {
-                DEBUGV("Wifi connection timed out\n");
-                wifiConnectTimeoutTime.reset();
-            }
-        }
+            break;
+        case WIFI_ACTION_DISCONNECT:
+            WiFi.disconnect();
+            break;
+        case WIFI_ACTION_DEINIT_MODULE:
+            faultLog.record(FAULT_EVENT_WIFI_MODULE_RESET);
+            WiFiDrv::wifiDriverDeinit();
+            break;
+        case WIFI_ACTION_INIT_MODULE:
+            WiFiDrv::wifiDriverInit();
+            break;
     }
+
+    _isConnectedToWifi = wifiSupervisor.isConnected();
+}
+
+void NetworkController::setTaskScheduler(const TaskScheduler* scheduler) {
+    taskScheduler = scheduler;
+}
+
+void NetworkController::setUIController(const UIController* controller) {
+    uiController = controller;
+}
+
+void NetworkController::setLoopProfile(const LoopProfileReport &report) {
+    loopProfile = report;
 }
 
 bool NetworkController::hasConfiguration() {
@@ -323,29 +411,7 @@ void NetworkController::handleConfigHTTPRequest() {
         if (data == "")
         {
             sendHTTPHeaders();
-
-            String result;
-            createHTML(result);
-
-            if (hasConfiguration()) {
-                result.replace("[[id]]", config.value().wiFiCredentials.wifi_ssid);
-                result.replace("[[pw]]", config.value().wiFiCredentials.wifi_pw);
-                result.replace("[[ms]]", config.value().mqttConfig.server);
-                result.replace("[[mo]]", config.value().mqttConfig.port);
-                result.replace("[[mu]]", config.value().mqttConfig.username);
-                result.replace("[[mp]]", config.value().mqttConfig.password);
-                result.replace("[[mr]]", config.value().mqttConfig.prefix);
-            } else {
-                result.replace("[[id]]",  "");
-                result.replace("[[pw]]",  "");
-                result.replace("[[ms]]", "");
-                result.replace("[[mo]]", "1883");
-                result.replace("[[mu]]", "");
-                result.replace("[[mp]]", "");
-                result.replace("[[mr]]", "lcc");
-            }
-
-            server->send(200, "text/html", result);
+            streamConfigHTML();
 
             return;
         } else {
@@ -392,132 +458,157 @@ void NetworkController::sendHTTPHeaders() {
     server->sendHeader(WM_HTTP_EXPIRES, "-1");
 }
 
-void NetworkController::createHTML(String &root_html_template) {
-    String pitem;
-
-    root_html_template  = WIFININA_HTML_HEAD_START;
-    root_html_template  += WIFININA_HTML_HEAD_STYLE;
-
-#if SCAN_WIFI_NETWORKS
-    WN_LOGDEBUG1(WiFiNetworksFound, F(" SSIDs found, generating HTML now"));
-      // Replace HTML <input...> with <select...>, based on WiFi network scan in startConfigurationMode()
-
-      ListOfSSIDs = "";
-
-      for (int i = 0, list_items = 0; (i < WiFiNetworksFound) && (list_items < MAX_SSID_IN_LIST); i++)
-      {
-        if (indices[i] == -1)
-          continue; 		// skip duplicates and those that are below the required quality
-
-        ListOfSSIDs += WIFININA_OPTION_START + String(WiFi.SSID(indices[i])) + WIFININA_OPTION_END;
-        list_items++;		// Count number of suitable, distinct SSIDs to be included in list
-      }
-
-      WN_LOGDEBUG(ListOfSSIDs);
-
-      if (ListOfSSIDs == "")		// No SSID found or none was good enough
-        ListOfSSIDs = WIFININA_OPTION_START + String(WIFININA_NO_NETWORKS_FOUND) + WIFININA_OPTION_END;
-
-      pitem = String(WIFININA_HTML_HEAD_END);
-
-#if MANUAL_SSID_INPUT_ALLOWED
-      pitem.replace("[[input_id]]",  "<input id='id' list='SSIDs'>"  + String(WIFININA_DATALIST_START) + "'SSIDs'>" + ListOfSSIDs + WIFININA_DATALIST_END);
-      pitem.replace("[[input_id1]]", "<input id='id1' list='SSIDs'>" + String(WIFININA_DATALIST_START) + "'SSIDs'>" + ListOfSSIDs + WIFININA_DATALIST_END);
-
-#else
-      pitem.replace("[[input_id]]",  "<select id='id'>"  + ListOfSSIDs + WIFININA_SELECT_END);
-      pitem.replace("[[input_id1]]", "<select id='id1'>" + ListOfSSIDs + WIFININA_SELECT_END);
-#endif
-
-      root_html_template += pitem + WIFININA_FLDSET_START;
-#else
-
-    pitem = String(WIFININA_HTML_HEAD_END);
-    pitem.replace("[[input_id]]",  WIFININA_HTML_INPUT_ID);
-    root_html_template += pitem + WIFININA_FLDSET_START;
-#endif    // SCAN_WIFI_NETWORKS
-
-    root_html_template += String(WIFININA_FLDSET_END) + WIFININA_HTML_BUTTON + WIFININA_HTML_SCRIPT;
-
-    root_html_template += String(WIFININA_HTML_SCRIPT_END) + WIFININA_HTML_END;
+/*
+ * The page is rendered straight to the client in chunks, rather than built up and searched and replaced in a String.
+ */
+void NetworkController::streamConfigHTML() {
+    bool configured = hasConfiguration();
+
+    const HtmlField fields[] = {
+        {"input_id", WIFININA_HTML_INPUT_ID, true},
+        {"id", configured ? config.value().wiFiCredentials.wifi_ssid : "", false},
+        {"pw", configured ? config.value().wiFiCredentials.wifi_pw : "", false},
+        {"ms", configured ? config.value().mqttConfig.server : "", false},
+        {"mo", configured ? config.value().mqttConfig.port : "1883", false},
+        {"mu", configured ? config.value().mqttConfig.username : "", false},
+        {"mp", configured ? config.value().mqttConfig.password : "", false},
+        {"mr", configured ? config.value().mqttConfig.prefix : "lcc", false},
+    };
+
+    // The length isn't known up front, so the page goes out with chunked transfer encoding
+    server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server->send(200, "text/html", "");
+
+    HtmlStreamRenderer renderer([this] (const char* data, size_t length) {
+        server->sendContent(data, length);
+    }, fields, sizeof(fields) / sizeof(fields[0]));
+
+    renderer.render(WIFININA_HTML_HEAD_START);
+    renderer.render(WIFININA_HTML_HEAD_STYLE);
+    renderer.render(WIFININA_HTML_HEAD_END);
+    renderer.render(WIFININA_FLDSET_START);
+    renderer.render(WIFININA_FLDSET_END);
+    renderer.render(WIFININA_HTML_BUTTON);
+    renderer.render(WIFININA_HTML_SCRIPT);
+    renderer.render(WIFININA_HTML_SCRIPT_END);
+    renderer.render(WIFININA_HTML_END);
+    renderer.flush();
+
+    // An empty chunk ends the response
+    server->sendContent("");
 }
 
 void NetworkController::ensureTopicsFormatted() {
-    if (!topicsFormatted && config.has_value()) {
-        snprintf(TOPIC_LWT, TOPIC_LENGTH - 1, "%s/%s/lwt", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_STATE, TOPIC_LENGTH - 1, "%s/%s/state", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_CONFIG, TOPIC_LENGTH - 1, "%s/%s/conf", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_INFO, TOPIC_LENGTH - 1, "%s/%s/info", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_COMMAND, TOPIC_LENGTH - 1, "%s/%s/cmd", config->mqttConfig.prefix, identifier);
-
-        snprintf(TOPIC_AUTOCONF_STATE_SENSOR, 127, "homeassistant/sensor/%s/%s_state/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_BREW_BOILER_SENSOR, 127, "homeassistant/sensor/%s/%s_brew_temp/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_SERVICE_BOILER_SENSOR, 127, "homeassistant/sensor/%s/%s_serv_temp/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_ECO_MODE_SWITCH, 127, "homeassistant/switch/%s/%s_eco_mode/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_SLEEP_MODE_SWITCH, 127, "homeassistant/switch/%s/%s_sleep_mode/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_BREW_TEMPERATURE_TARGET_NUMBER, 127, "homeassistant/number/%s/%s_brew_temp_target/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_SERVICE_TEMPERATURE_TARGET_NUMBER, 127, "homeassistant/number/%s/%s_serv_temp_target/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_WATER_TANK_LOW_BINARY_SENSOR, 127, "homeassistant/binary_sensor/%s/%s_water_tank_low/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_WIFI_SENSOR, 127, "homeassistant/sensor/%s/%s_wifi/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_RP2040_TEMP_SENSOR, 127, "homeassistant/sensor/%s/%s_rp2040_temp/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_AUTO_SLEEP_MIN, 127, "homeassistant/number/%s/%s_auto_sleep_min/config", config->mqttConfig.prefix, identifier);
-        snprintf(TOPIC_AUTOCONF_PLANNED_AUTO_SLEEP_MIN, 127, "homeassistant/sensor/%s/%s_planned_auto_sleep_min/config", config->mqttConfig.prefix, identifier);
-
-        topicsFormatted = true;
+    if (!topics.isBuilt() && config.has_value()) {
+        if (!topics.build(config->mqttConfig.prefix, identifier)) {
+            DEBUGV("MQTT topics don't fit in the topic arena\n");
+            return;
+        }
+
+        discoveryContext.prefix = config->mqttConfig.prefix;
+        discoveryContext.identifier = identifier;
+        discoveryContext.macString = macString;
+        discoveryContext.firmwareVersion = "0.2.0";
+        discoveryContext.topics[DISCOVERY_TOPIC_NONE] = nullptr;
+        discoveryContext.topics[DISCOVERY_TOPIC_LWT] = topics.get(TOPIC_ID_LWT);
+        discoveryContext.topics[DISCOVERY_TOPIC_STATE] = topics.get(TOPIC_ID_STATE);
+        discoveryContext.topics[DISCOVERY_TOPIC_CONFIG] = topics.get(TOPIC_ID_CONFIG);
+        discoveryContext.topics[DISCOVERY_TOPIC_INFO] = topics.get(TOPIC_ID_INFO);
+        discoveryContext.topics[DISCOVERY_TOPIC_COMMAND] = topics.get(TOPIC_ID_COMMAND);
+
+        // Discovery topics are formatted on demand, but hashed up front so retained payloads can be matched quickly
+        char discoveryTopic[DISCOVERY_TOPIC_LENGTH];
+        for (uint8_t i = 0; i < DISCOVERY_ENTITY_COUNT; i++) {
+            format_discovery_topic(discoveryTopic, sizeof(discoveryTopic), discoveryEntities[i], discoveryContext);
+            discoveryTopicHashes[i] = fnv1a_hash(discoveryTopic);
+        }
     }
 }
 
 void NetworkController::publishMqtt() {
-    if (configChanged || !mqttNextConfigPublishTime.has_value() || absolute_time_diff_us(mqttNextConfigPublishTime.value(), get_absolute_time()) > 0) {
-        mqtt.publish(TOPIC_LWT, "online");
+    // Discovery goes out one entity per loop, once the retained payloads have had a chance to arrive
+    if (discoveryIndex < DISCOVERY_ENTITY_COUNT && absolute_time_diff_us(discoveryStartTime, get_absolute_time()) > 0) {
+        if (publishNextDiscoveryEntity()) {
+            return;
+        }
+    }
 
-        publishMqttConf();
-        mqttNextConfigPublishTime = make_timeout_time_ms(10320);
-        configChanged = false;
-    } else if (!mqttNextInfoPublishTime.has_value() || absolute_time_diff_us(mqttNextInfoPublishTime.value(), get_absolute_time()) > 0) {
-        mqtt.publish(TOPIC_LWT, "online");
+    // Shot batches go out as soon as they're complete, next to the JSON documents
+    if (shotStreamer.isBatchReady()) {
+        publishMqttShotBatch();
+    }
 
-        publishMqttInfo();
-        mqttNextInfoPublishTime = make_timeout_time_ms(59300);
-    } else if (!mqttNextStatPublishTime.has_value() || absolute_time_diff_us(mqttNextStatPublishTime.value(), get_absolute_time()) > 0) {
-        mqtt.publish(TOPIC_LWT, "online");
+    // The broker only grants a few topic aliases, so they're kept for the topics published over and over
+    mqtt.setTopicAliasing(true);
+    eventQueue.loop(mqtt, topics.get(TOPIC_ID_EVENT));
+    mqtt.setTopicAliasing(false);
+
+    // Telemetry runs on its own schedule, next to the JSON documents
+    if (telemetryIntervalMs > 0 && (!mqttNextTelemetryPublishTime.has_value() || absolute_time_diff_us(mqttNextTelemetryPublishTime.value(), get_absolute_time()) > 0)) {
+        publishMqttTelemetry();
+        mqttNextTelemetryPublishTime = make_timeout_time_ms(telemetryIntervalMs);
+    }
 
+    // One document per loop, state first since it carries the brew events
+    if (publishScheduler.isStateDue(status)) {
         publishMqttStat();
-        mqttNextStatPublishTime = make_timeout_time_ms(4950);
+        publishScheduler.statePublished(status);
+    } else if (configChanged || publishScheduler.isConfigDue(status, settings)) {
+        publishMqttConf();
+        publishScheduler.configPublished(status, settings);
+        configChanged = false;
+    } else if (publishScheduler.isInfoDue()) {
+        publishMqttInfo();
+        publishScheduler.infoPublished();
     }
 }
 
 void NetworkController::publishMqttStat() {
-    DynamicJsonDocument statDoc(1024);
+    int32_t rssi = WiFi.RSSI();
+    mqtt.reportRssi((int8_t)rssi);
+    wifiSupervisor.reportRssi(rssi);
+
+    createStateDocument(rssi);
+
+    mqtt.setMessageExpiry(MQTT_STATE_MESSAGE_EXPIRY_S);
+    publishJson(topics.get(TOPIC_ID_STATE), publishDocument, false);
+    mqtt.setMessageExpiry(0);
+}
+
+// Shared by the state topic and the local status page
+void NetworkController::createStateDocument(int32_t rssi) {
+    publishDocument.clear();
+    char unknownBuf[16];
 
     switch (status->getState()) {
         case SYSTEM_CONTROLLER_STATE_UNDETERMINED:
-            statDoc["s"] = "Undetermined";
+            publishDocument["s"] = "Undetermined";
             break;
         case SYSTEM_CONTROLLER_STATE_HEATUP:
-            statDoc["s"] = "Heatup";
+            publishDocument["s"] = "Heatup";
             break;
         case SYSTEM_CONTROLLER_STATE_TEMPS_NORMALIZING:
-            statDoc["s"] = "Temperatures normalizing";
+            publishDocument["s"] = "Temperatures normalizing";
             break;
         case SYSTEM_CONTROLLER_STATE_WARM:
-            statDoc["s"] = "Warm";
+            publishDocument["s"] = "Warm";
             break;
         case SYSTEM_CONTROLLER_STATE_SLEEPING:
-            statDoc["s"] = "Sleeping";
+            publishDocument["s"] = "Sleeping";
             break;
         case SYSTEM_CONTROLLER_STATE_BAILED:
-            statDoc["s"] = "Bailed";
+            publishDocument["s"] = "Bailed";
             break;
         case SYSTEM_CONTROLLER_STATE_FIRST_RUN:
-            statDoc["s"] = "First run";
+            publishDocument["s"] = "First run";
             break;
         default:
-            statDoc["s"] = std::string("Unknown (") + std::to_string((uint8_t)status->getState()) + ")";
+            snprintf(unknownBuf, sizeof(unknownBuf), "Unknown (%u)", (uint8_t)status->getState());
+            publishDocument["s"] = unknownBuf;
             break;
     }
 
-    JsonObject stat_internal = statDoc.createNestedObject("i");
+    JsonObject stat_internal = publishDocument.createNestedObject("i");
     stat_internal["rx"] = status->hasReceivedControlBoardPacket;
     stat_internal["tx"] = status->hasSentLccPacket;
     stat_internal["b"] = status->hasBailed();
@@ -540,61 +631,130 @@ void NetworkController::publishMqttStat() {
             stat_internal["br"] = "SSR queue empty";
             break;
         default:
-            stat_internal["br"] = std::string("Unknown (") + std::to_string((uint8_t)status->bailReason()) + ")";
+            snprintf(unknownBuf, sizeof(unknownBuf), "Unknown (%u)", (uint8_t)status->bailReason());
+            stat_internal["br"] = unknownBuf;
             break;
     }
 
-    JsonObject stat_brew_pid = statDoc.createNestedObject("bp");
+    JsonObject stat_brew_pid = publishDocument.createNestedObject("bp");
     stat_brew_pid["p"] = status->getBrewPidRuntimeParameters().p;
     stat_brew_pid["i"] = status->getBrewPidRuntimeParameters().i;
     stat_brew_pid["d"] = status->getBrewPidRuntimeParameters().d;
     stat_brew_pid["in"] = status->getBrewPidRuntimeParameters().integral;
     stat_brew_pid["hm"] = status->getBrewPidRuntimeParameters().hysteresisMode;
 
-    JsonObject stat_service_pid = statDoc.createNestedObject("sp");
+    JsonObject stat_service_pid = publishDocument.createNestedObject("sp");
     stat_service_pid["p"] = status->getServicePidRuntimeParameters().p;
     stat_service_pid["i"] = status->getServicePidRuntimeParameters().i;
     stat_service_pid["d"] = status->getServicePidRuntimeParameters().d;
     stat_service_pid["in"] = status->getServicePidRuntimeParameters().integral;
     stat_service_pid["hm"] = status->getServicePidRuntimeParameters().hysteresisMode;
 
-    statDoc["r"] = WiFi.RSSI();
+    publishDocument["r"] = rssi;
 
-    statDoc["bt"] = status->getOffsetBrewTemperature();
-    statDoc["st"] = status->getServiceTemperature();
-    statDoc["wt"] = status->isWaterTankEmpty();
+    publishDocument["bt"] = status->getOffsetBrewTemperature();
+    publishDocument["st"] = status->getServiceTemperature();
+    publishDocument["wt"] = status->isWaterTankEmpty();
 
-    statDoc["tsb"] = ((double)to_us_since_boot(status->getCurrentTime())) / 60000000.f;
-    statDoc["lsea"] = ((double)to_us_since_boot(status->getLastSleepModeExitAt())) / 60000000.f;
+    publishDocument["tsb"] = ((double)to_us_since_boot(status->getCurrentTime())) / 60000000.f;
+    publishDocument["lsea"] = ((double)to_us_since_boot(status->getLastSleepModeExitAt())) / 60000000.f;
 
     if (!status->plannedAutoSleepAt.has_value()) {
-        statDoc["asi"] = false;
+        publishDocument["asi"] = false;
     } else {
         double sleepTime = (double)absolute_time_diff_us(get_absolute_time(), status->plannedAutoSleepAt.value()) / 60000000.f;
         if (sleepTime >= 0.f) {
-            statDoc["asi"] = sleepTime;
+            publishDocument["asi"] = sleepTime;
         } else {
-            statDoc["asi"] = false;
+            publishDocument["asi"] = false;
         }
     }
 
     if (status->hasPreviousBrew()) {
-        statDoc["ls"] = (float)status->previousBrewDurationMs() / 1000.f;
+        publishDocument["ls"] = (float)status->previousBrewDurationMs() / 1000.f;
     } else {
-        statDoc["ls"] = false;
+        publishDocument["ls"] = false;
     }
 
-    statDoc["rt"] = status->rp2040Temperature;
+    publishDocument["rt"] = status->rp2040Temperature;
+}
 
-    std::string statOutput;
-    serializeJson(statDoc, statOutput);
-    mqtt.publish(TOPIC_STATE, statOutput.c_str(), false);
+void NetworkController::publishMqttTelemetry() {
+    // Reading the RSSI is an SPI round trip to the WiFi module, so frames carry the one sampled with the last state publish
+    TelemetryFrame frame = create_telemetry_frame(status, telemetrySequence++, (int8_t)wifiSupervisor.getLastRssi(), watchdog_enable_caused_reboot());
+    mqtt.setMessageExpiry(MQTT_STATE_MESSAGE_EXPIRY_S);
+    mqtt.setTopicAliasing(true);
+    mqtt.publish(topics.get(TOPIC_ID_TELEMETRY), (const uint8_t *)&frame, sizeof(frame), false);
+    mqtt.setTopicAliasing(false);
+    mqtt.setMessageExpiry(0);
+}
+
+void NetworkController::handleStatusMessage(const SystemControllerStatusMessage &message) {
+    controlLoopStats.addStatusMessage(message);
+    faultLog.addStatusMessage(message);
+    shotStreamer.addStatusMessage(message, settings->getBrewTemperatureOffset());
+
+    // The cycle count doubles as the sequence, so that clients can tell dropped frames from a slow control loop
+    if (telemetryWebSocket.hasClients()) {
+        telemetryWebSocket.broadcast(create_telemetry_frame(message, settings->getBrewTemperatureOffset(), status->rp2040Temperature, controlLoopStats.getCycles(), (int8_t)wifiSupervisor.getLastRssi(), watchdog_enable_caused_reboot()));
+    }
+    enqueueEvents(message);
+}
+
+void NetworkController::enqueueEvents(const SystemControllerStatusMessage &message) {
+    char payload[EVENT_PAYLOAD_SIZE + 1];
+
+    if (message.currentlyBrewing && !eventBrewing) {
+        eventBrewStart = message.timestamp;
+    } else if (!message.currentlyBrewing && eventBrewing) {
+        int64_t durationMs = absolute_time_diff_us(eventBrewStart, message.timestamp) / 1000;
+        snprintf(payload, sizeof(payload), R"({"e":"shot","d":%lld,"t":%.1f})", durationMs, message.brewTemperature);
+        eventQueue.enqueue(payload);
+    }
+
+    eventBrewing = message.currentlyBrewing;
+
+    if (message.bailReason != eventBailReason) {
+        if (message.bailReason != BAIL_REASON_NONE) {
+            snprintf(payload, sizeof(payload), R"({"e":"bail","r":%u})", (uint8_t)message.bailReason);
+            eventQueue.enqueue(payload);
+        }
+
+        eventBailReason = message.bailReason;
+    }
+}
+
+void NetworkController::publishMqttShotBatch() {
+    size_t capacity = 0;
+    size_t batchSize = shotStreamer.getBatchSize();
+
+    // A batch that can't go out right away is dropped rather than retried, so a slow broker can't hold up the loop
+    mqtt.setTopicAliasing(true);
+    uint8_t* payload = mqtt.beginPublishInPlace(topics.get(TOPIC_ID_SHOT), &capacity);
+    mqtt.setTopicAliasing(false);
+    if (payload == nullptr || capacity < batchSize) {
+        DEBUGV("Dropping shot batch of %u bytes\n", batchSize);
+        shotStreamer.dropBatch();
+        return;
+    }
+
+    shotStreamer.writeBatch(payload);
+    mqtt.endPublishInPlace(batchSize, false);
+}
+
+void NetworkController::setTelemetryInterval(uint32_t intervalMs) {
+    if (intervalMs > 0 && intervalMs < TELEMETRY_MIN_INTERVAL_MS) {
+        intervalMs = TELEMETRY_MIN_INTERVAL_MS;
+    }
+
+    telemetryIntervalMs = intervalMs;
+    mqttNextTelemetryPublishTime.reset();
 }
 
 void NetworkController::publishMqttConf() {
-    DynamicJsonDocument confDoc(1024);
+    publishDocument.clear();
 
-    JsonObject conf_brew = confDoc.createNestedObject("b");
+    JsonObject conf_brew = publishDocument.createNestedObject("b");
     conf_brew["tt"] = status->getOffsetTargetBrewTemperature();
     conf_brew["to"] = status->getBrewTempOffset();
 
@@ -605,7 +765,7 @@ void NetworkController::publishMqttConf() {
     conf_brew_pid["wh"] = status->getBrewPidSettings().windupHigh;
     conf_brew_pid["wl"] = status->getBrewPidSettings().windupLow;
 
-    JsonObject conf_service = confDoc.createNestedObject("s");
+    JsonObject conf_service = publishDocument.createNestedObject("s");
     conf_service["tt"] = status->getTargetServiceTemp();
 
     JsonObject conf_service_pid = conf_service.createNestedObject("p");
@@ -615,331 +775,368 @@ void NetworkController::publishMqttConf() {
     conf_service_pid["wh"] = status->getServicePidSettings().windupHigh;
     conf_service_pid["wl"] = status->getServicePidSettings().windupLow;
 
-    confDoc["em"] = status->isInEcoMode();
-    confDoc["sm"] = status->isInSleepMode();
-    confDoc["asm"] = settings->getAutoSleepMin();
+    publishDocument["em"] = status->isInEcoMode();
+    publishDocument["sm"] = status->isInSleepMode();
+    publishDocument["asm"] = settings->getAutoSleepMin();
 
-    std::string confOutput;
-    serializeJson(confDoc, confOutput);
-    mqtt.publish(TOPIC_CONFIG, confOutput.c_str(), false);
+    publishJson(topics.get(TOPIC_ID_CONFIG), publishDocument, false);
 }
 
 void NetworkController::publishMqttInfo() {
-    DynamicJsonDocument infoDoc(1024);
+    publishDocument.clear();
 
     IPAddress ip = WiFi.localIP();
     uint8_t mac[WL_MAC_ADDR_LENGTH];
     WiFi.macAddress(mac);
 
-    std::string ipString = std::to_string(ip[0]) + "." + std::to_string(ip[1]) + "." + std::to_string(ip[2]) + "." + std::to_string(ip[3]);
+    char ipAddress[16];
+    snprintf(ipAddress, sizeof(ipAddress), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
 
     char macAddress[19];
     snprintf(macAddress, sizeof(macAddress), "%02X:%02X:%02X:%02X:%02X:%02X", mac[5], mac[4], mac[3], mac[2], mac[1], mac[0]);
 
-    JsonObject stat_wifi = infoDoc.createNestedObject("w");
+    JsonObject stat_wifi = publishDocument.createNestedObject("w");
     stat_wifi["s"] = WiFi.SSID();
-    stat_wifi["i"] = ipString;
+    stat_wifi["i"] = ipAddress;
     stat_wifi["m"] = macAddress;
     stat_wifi["n"] = WiFi.firmwareVersion();
 
-    std::string infoOutput;
-    serializeJson(infoDoc, infoOutput);
-    mqtt.publish(TOPIC_INFO, infoOutput.c_str(), false);
+    JsonObject stat_link = publishDocument.createNestedObject("wl");
+    stat_link["c"] = wifiSupervisor.getConnects();
+    stat_link["d"] = wifiSupervisor.getDisconnects();
+    stat_link["r"] = wifiSupervisor.getResets();
+    stat_link["ro"] = wifiSupervisor.getRoams();
+    stat_link["u"] = roundf(wifiSupervisor.getConnectedRatio() * 1000.f) / 1000.f;
+
+    publishDocument["mf"] = freeMemory();
+
+    JsonObject stat_events = publishDocument.createNestedObject("ev");
+    stat_events["q"] = eventQueue.size();
+    stat_events["d"] = eventQueue.getDroppedEvents();
+    stat_events["fw"] = eventQueue.getFlashWrites();
+
+    JsonObject stat_settings = publishDocument.createNestedObject("se");
+    stat_settings["fw"] = settings->getFlashWrites();
+    stat_settings["c"] = settings->getCoalescedChanges();
+
+    if (taskScheduler != nullptr) {
+        JsonObject stat_tasks = publishDocument.createNestedObject("ts");
+
+        for (size_t i = 0; i < taskScheduler->getTaskCount(); i++) {
+            const ScheduledTask &task = taskScheduler->getTask(i);
+            stat_tasks[task.getName()] = roundf(task.getCpuShare() * 1000.f) / 1000.f;
+        }
+    }
+
+    publishJson(topics.get(TOPIC_ID_INFO), publishDocument, false);
+}
+
+/*
+ * Serializes straight into the MQTT packet buffer, which avoids both an intermediate string and a second copy.
+ */
+bool NetworkController::publishJson(const char *topic, const JsonDocument &document, bool retained) {
+    size_t length = measureJson(document);
+
+    size_t capacity;
+    uint8_t* payload = mqtt.beginPublishInPlace(topic, &capacity);
+
+    if (payload == nullptr) {
+        return false;
+    }
+
+    // serializeJson() NUL-terminates, so the payload has to be strictly smaller than the capacity
+    if (length >= capacity) {
+        DEBUGV("JSON payload for %s too large (%u bytes)\n", topic, length);
+        return false;
+    }
+
+    length = serializeJson(document, (char *)payload, capacity);
+
+    return mqtt.endPublishInPlace(length, retained);
 }
 
-void NetworkController::callback(char *topic, byte *payload, unsigned int length) {
-    DEBUGV("Received callback of length %u\n", length);
+void NetworkController::callback(const MqttMessage &message) {
+    DEBUGV("Received callback of length %u\n", message.length);
 
-    StaticJsonDocument<128> doc;
+    nonstd::optional<TopicId> topicId = topics.lookup(message.topic, message.topicLength);
 
-    DeserializationError error = deserializeJson(doc, payload, length);
+    // Only the command topic is in the registry, anything else is a retained discovery payload
+    if (!topicId.has_value()) {
+        return handleRetainedDiscovery(message);
+    } else if (topicId.value() != TOPIC_ID_COMMAND) {
+        return;
+    }
+
+    // A mutable input puts ArduinoJson in zero-copy mode, so strings point into the receive buffer instead of being
+    // copied into the document. They're only used while the commands are handled, before the buffer is reused.
+    DeserializationError error = deserializeJson(commandDocument, (char *)message.payload, message.length);
 
     if (error) {
         DEBUGV("deserializeJson() failed: %s\n", error.c_str());
         return;
     }
 
-    std::string cmd = doc["cmd"];
-
-    // @todo Move this to check if config has actually changed
-    configChanged = true;
-
-    if (cmd == "set_brew_temp_target") {
-        settings->setOffsetTargetBrewTemp(doc["float_value"]);
-    } else if (cmd == "set_brew_temp_offset") {
-        settings->setBrewTemperatureOffset(doc["float_value"]);
-    } else if (cmd == "set_brew_pid_params") {
-        PidSettings params{
-            .Kp = doc["kp"],
-            .Ki = doc["ki"],
-            .Kd = doc["kd"],
-            .windupLow = doc["windup_low"],
-            .windupHigh = doc["windup_high"]
-        };
-
-        settings->setBrewPidParameters(params);
-    } else if (cmd == "set_service_pid_params") {
-        PidSettings params{
-                .Kp = doc["kp"],
-                .Ki = doc["ki"],
-                .Kd = doc["kd"],
-                .windupLow = doc["windup_low"],
-                .windupHigh = doc["windup_high"]
-        };
-
-        settings->setServicePidParameters(params);
-    } else if (cmd == "set_service_temp_target") {
-        settings->setTargetServiceTemp(doc["float_value"]);
-    } else if (cmd == "set_eco_mode") {
-        settings->setEcoMode(doc["bool_value"]);
-    } else if (cmd == "set_sleep_mode") {
-        settings->setSleepMode(doc["bool_value"]);
-    } else if (cmd == "set_auto_sleep_min") {
-        settings->setAutoSleepMin(doc["int_value"]);
+    // Either a single command object, or an array of them
+    if (commandDocument.is<JsonArrayConst>()) {
+        for (JsonObjectConst command : commandDocument.as<JsonArrayConst>()) {
+            handleCommand(command);
+        }
     } else {
-        DEBUGV("Unknown command");
+        handleCommand(commandDocument.as<JsonObjectConst>());
     }
 }
 
-void NetworkController::publishAutoconfigure() {
-    std::string mqttPayload;
-    DynamicJsonDocument device(256);
-    DynamicJsonDocument autoconfPayload(1024);
-    size_t len;
+const MqttCommand NetworkController::commandTable[] = {
+    {
+        fnv1a_hash("set_brew_temp_target"), "set_brew_temp_target", COMMAND_ARGUMENT_FLOAT, 0, 100,
+        [](NetworkController &c, const CommandArgument &a) { return c.settings->setOffsetTargetBrewTemp(a.floatValue); }
+    },
+    {
+        fnv1a_hash("set_brew_temp_offset"), "set_brew_temp_offset", COMMAND_ARGUMENT_FLOAT, -20, 20,
+        [](NetworkController &c, const CommandArgument &a) { return c.settings->setBrewTemperatureOffset(a.floatValue); }
+    },
+    {
+        fnv1a_hash("set_brew_pid_params"), "set_brew_pid_params", COMMAND_ARGUMENT_PID, 0, 1000,
+        [](NetworkController &c, const CommandArgument &a) { return c.settings->setBrewPidParameters(a.pidValue); }
+    },
+    {
+        fnv1a_hash("set_service_pid_params"), "set_service_pid_params", COMMAND_ARGUMENT_PID, 0, 1000,
+        [](NetworkController &c, const CommandArgument &a) { return c.settings->setServicePidParameters(a.pidValue); }
+    },
+    {
+        fnv1a_hash("set_service_temp_target"), "set_service_temp_target", COMMAND_ARGUMENT_FLOAT, 0, 150,
+        [](NetworkController &c, const CommandArgument &a) { return c.settings->setTargetServiceTemp(a.floatValue); }
+    },
+    {
+        fnv1a_hash("set_eco_mode"), "set_eco_mode", COMMAND_ARGUMENT_BOOL, 0, 0,
+        [](NetworkController &c, const CommandArgument &a) { return c.settings->setEcoMode(a.boolValue); }
+    },
+    {
+        fnv1a_hash("set_sleep_mode"), "set_sleep_mode", COMMAND_ARGUMENT_BOOL, 0, 0,
+        [](NetworkController &c, const CommandArgument &a) { return c.settings->setSleepMode(a.boolValue); }
+    },
+    {
+        fnv1a_hash("set_auto_sleep_min"), "set_auto_sleep_min", COMMAND_ARGUMENT_INT, 0, AUTO_SLEEP_MAX_MIN,
+        [](NetworkController &c, const CommandArgument &a) { return c.settings->setAutoSleepMin(a.intValue); }
+    },
+    {
+        fnv1a_hash("set_telemetry_interval"), "set_telemetry_interval", COMMAND_ARGUMENT_INT, 0, 3600000,
+        [](NetworkController &c, const CommandArgument &a) { c.setTelemetryInterval(a.intValue); return false; }
+    },
+};
+
+void NetworkController::handleCommand(JsonObjectConst command) {
+    const char* name = command["cmd"];
 
-    char macString[19];
-    uint8_t mac[WL_MAC_ADDR_LENGTH];
-    WiFi.macAddress(mac);
-    snprintf(macString, sizeof(macString), "%02x:%02x:%02x:%02x:%02x:%02x", mac[5], mac[4], mac[3], mac[2], mac[1], mac[0]);
+    if (name == nullptr) {
+        DEBUGV("Command without cmd\n");
+        return;
+    }
+
+    uint32_t nameHash = fnv1a_hash(name);
+
+    for (const MqttCommand &definition : commandTable) {
+        if (definition.nameHash != nameHash || strcmp(definition.name, name) != 0) {
+            continue;
+        }
+
+        CommandArgument argument;
+
+        if (!parse_command_argument(command, definition, argument)) {
+            DEBUGV("Rejected invalid argument for %s\n", name);
+            return;
+        }
 
-    device["ids"][0] = stdIdentifier;
-    device["cns"][0][0] = "mac";
-    device["cns"][0][1] = macString;
-    device["mf"] = "magnusnordlander";
-    device["mdl"] = "smart-lcc";
-    device["name"] = stdIdentifier;
-    device["sw"] = "0.2.0";
-
-    JsonObject devObj = device.as<JsonObject>();
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_STATE;
-    autoconfPayload["json_attr_t"] = TOPIC_STATE;
-    autoconfPayload["name"] = stdIdentifier + " State";
-    autoconfPayload["uniq_id"] = stdIdentifier + "_state";
-    autoconfPayload["ic"] = "mdi:eye";
-    autoconfPayload["val_tpl"] = "{{ value_json.s }}";
-    autoconfPayload["json_attr_tpl"] = R"({"bail_reason": "{{value_json.i.br}}", "watchdog_reset": "{{value_json.i.wr}}"})";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_STATE_SENSOR[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_STATE;
-    autoconfPayload["json_attr_t"] = TOPIC_STATE;
-    autoconfPayload["name"] = stdIdentifier + " Brew Boiler Temperature";
-    autoconfPayload["uniq_id"] = stdIdentifier +"_brew_temp";
-    autoconfPayload["unit_of_meas"] = "°C";
-    autoconfPayload["ic"] = "mdi:thermometer";
-    autoconfPayload["dev_cla"] = "temperature";
-    autoconfPayload["val_tpl"] = "{{ value_json.bt | round(1) }}";
-    autoconfPayload["json_attr_tpl"] = R"({"p": "{{value_json.bp.p}}", "i": "{{value_json.bp.i}}", "d": "{{value_json.bp.d}}", "integral": "{{value_json.bp.in}}",  "hysteresis_mode": "{{value_json.bp.hm}}"})";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_BREW_BOILER_SENSOR[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_STATE;
-    autoconfPayload["json_attr_t"] = TOPIC_STATE;
-    autoconfPayload["name"] = stdIdentifier + " Service Boiler Temperature";
-    autoconfPayload["uniq_id"] = stdIdentifier +"_serv_temp";
-    autoconfPayload["unit_of_meas"] = "°C";
-    autoconfPayload["ic"] = "mdi:thermometer";
-    autoconfPayload["dev_cla"] = "temperature";
-    autoconfPayload["val_tpl"] = "{{ value_json.st | round(1) }}";
-    autoconfPayload["json_attr_tpl"] = R"({"p": "{{value_json.sp.p}}", "i": "{{value_json.sp.i}}", "d": "{{value_json.sp.d}}", "integral": "{{value_json.sp.in}}",  "hysteresis_mode": "{{value_json.sp.hm}}"})";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_SERVICE_BOILER_SENSOR[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_STATE;
-    autoconfPayload["json_attr_t"] = TOPIC_INFO;
-    autoconfPayload["name"] = stdIdentifier + " WiFi";
-    autoconfPayload["uniq_id"] = stdIdentifier + "_wifi";
-    autoconfPayload["val_tpl"] = "{{value_json.r}}";
-    autoconfPayload["unit_of_meas"] = "dBm";
-    autoconfPayload["json_attr_tpl"] = R"({"ssid": "{{value_json.w.s}}", "ip": "{{value_json.w.i}}"})";
-    autoconfPayload["ic"] = "mdi:wifi";
-    autoconfPayload["entity_category"] = "diagnostic";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_WIFI_SENSOR[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_STATE;
-    autoconfPayload["json_attr_t"] = TOPIC_STATE;
-    autoconfPayload["name"] = stdIdentifier + " RP2040 Temperature";
-    autoconfPayload["uniq_id"] = stdIdentifier +"_rp2040_temp";
-    autoconfPayload["unit_of_meas"] = "°C";
-    autoconfPayload["ic"] = "mdi:thermometer";
-    autoconfPayload["dev_cla"] = "temperature";
-    autoconfPayload["val_tpl"] = "{{ value_json.rt | round(1) }}";
-    autoconfPayload["entity_category"] = "diagnostic";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_RP2040_TEMP_SENSOR[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_CONFIG;
-    autoconfPayload["json_attr_t"] = TOPIC_CONFIG;
-    autoconfPayload["cmd_t"] = TOPIC_COMMAND;
-    autoconfPayload["name"] = stdIdentifier + " Eco Mode";
-    autoconfPayload["uniq_id"] = stdIdentifier + "_eco_mode";
-    autoconfPayload["ic"] = "hass:leaf";
-    autoconfPayload["val_tpl"] = R"({{ 'ON' if value_json.em else 'OFF' }})";
-    autoconfPayload["pl_on"] = R"({"cmd": "set_eco_mode", "bool_value": true})";
-    autoconfPayload["pl_off"] = R"({"cmd": "set_eco_mode", "bool_value": false})";
-    autoconfPayload["stat_on"] = "ON";
-    autoconfPayload["stat_off"] = "OFF";
-    autoconfPayload["entity_category"] = "config";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_ECO_MODE_SWITCH[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_CONFIG;
-    autoconfPayload["json_attr_t"] = TOPIC_CONFIG;
-    autoconfPayload["cmd_t"] = TOPIC_COMMAND;
-    autoconfPayload["name"] = stdIdentifier + " Sleep Mode";
-    autoconfPayload["uniq_id"] = stdIdentifier + "_sleep_mode";
-    autoconfPayload["ic"] = "hass:sleep";
-    autoconfPayload["val_tpl"] = R"({{ 'ON' if value_json.sm else 'OFF' }})";
-    autoconfPayload["pl_on"] = R"({"cmd": "set_sleep_mode", "bool_value": true})";
-    autoconfPayload["pl_off"] = R"({"cmd": "set_sleep_mode", "bool_value": false})";
-    autoconfPayload["stat_on"] = "ON";
-    autoconfPayload["stat_off"] = "OFF";
-    autoconfPayload["entity_category"] = "config";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_SLEEP_MODE_SWITCH[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_CONFIG;
-    autoconfPayload["cmd_t"] = TOPIC_COMMAND;
-    autoconfPayload["name"] = stdIdentifier + " Brew Boiler Temperature Target";
-    autoconfPayload["uniq_id"] = stdIdentifier + "_brew_temp_target";
-    autoconfPayload["unit_of_meas"] = "°C";
-    autoconfPayload["ic"] = "mdi:thermometer";
-    autoconfPayload["step"] = 0.1;
-    autoconfPayload["min"] = 0;
-    autoconfPayload["max"] = 100;
-    autoconfPayload["val_tpl"] = R"({{ value_json.b.tt | round(1) }})";
-    autoconfPayload["cmd_tpl"] = R"({"cmd": "set_brew_temp_target", "float_value": {{value}} })";
-    autoconfPayload["entity_category"] = "config";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_BREW_TEMPERATURE_TARGET_NUMBER[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_CONFIG;
-    autoconfPayload["cmd_t"] = TOPIC_COMMAND;
-    autoconfPayload["name"] = stdIdentifier + " Service Boiler Temperature Target";
-    autoconfPayload["uniq_id"] = stdIdentifier + "_service_temp_target";
-    autoconfPayload["unit_of_meas"] = "°C";
-    autoconfPayload["ic"] = "mdi:thermometer";
-    autoconfPayload["step"] = 0.1;
-    autoconfPayload["min"] = 0;
-    autoconfPayload["max"] = 150;
-    autoconfPayload["val_tpl"] = R"({{ value_json.s.tt | round(1) }})";
-    autoconfPayload["cmd_tpl"] = R"({"cmd": "set_service_temp_target", "float_value": {{value}} })";
-    autoconfPayload["entity_category"] = "config";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_SERVICE_TEMPERATURE_TARGET_NUMBER[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_CONFIG;
-    autoconfPayload["cmd_t"] = TOPIC_COMMAND;
-    autoconfPayload["name"] = stdIdentifier + " Auto-sleep after";
-    autoconfPayload["uniq_id"] = stdIdentifier + "_auto_sleep_min";
-    autoconfPayload["unit_of_meas"] = "minutes";
-    autoconfPayload["ic"] = "hass:sleep";
-    autoconfPayload["step"] = 1;
-    autoconfPayload["min"] = 0;
-    autoconfPayload["max"] = 300;
-    autoconfPayload["val_tpl"] = R"({{ value_json.asm }})";
-    autoconfPayload["cmd_tpl"] = R"({"cmd": "set_auto_sleep_min", "int_value": {{value}} })";
-    autoconfPayload["entity_category"] = "config";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_AUTO_SLEEP_MIN[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_STATE;
-    autoconfPayload["cmd_t"] = TOPIC_COMMAND;
-    autoconfPayload["name"] = stdIdentifier + " Water Tank Low";
-    autoconfPayload["uniq_id"] = stdIdentifier + "_water_tank_low";
-    autoconfPayload["ic"] = "mdi:water-alert";
-    autoconfPayload["dev_cla"] = "problem";
-    autoconfPayload["val_tpl"] = R"({{ 'ON' if value_json.wt else 'OFF' }})";
-
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_WATER_TANK_LOW_BINARY_SENSOR[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
-
-
-    autoconfPayload["dev"] = devObj;
-    autoconfPayload["avty_t"] = TOPIC_LWT;
-    autoconfPayload["stat_t"] = TOPIC_STATE;
-    autoconfPayload["json_attr_t"] = TOPIC_STATE;
-    autoconfPayload["name"] = stdIdentifier + " Planned Auto Sleep in";
-    autoconfPayload["uniq_id"] = stdIdentifier + "_planned_auto_sleep";
-    autoconfPayload["val_tpl"] = "{{value_json.asi | round(0) }}";
-    autoconfPayload["unit_of_meas"] = "minutes";
-    autoconfPayload["ic"] = "hass:sleep";
-    autoconfPayload["entity_category"] = "diagnostic";
-
-    serializeJson(autoconfPayload, mqttPayload);
-    mqtt.publish(&TOPIC_AUTOCONF_PLANNED_AUTO_SLEEP_MIN[0], mqttPayload.c_str(), true);
-    autoconfPayload.clear();
-    mqttPayload.clear();
+        if (definition.handler(*this, argument)) {
+            configChanged = true;
+        }
+
+        return;
+    }
+
+    DEBUGV("Unknown command %s\n", name);
+}
+
+bool NetworkController::publishNextDiscoveryEntity() {
+    while (discoveryIndex < DISCOVERY_ENTITY_COUNT) {
+        if (publishDiscoveryEntity(discoveryIndex++)) {
+            return true;
+        }
+    }
+
+    DEBUGV("Discovery done\n");
+    mqtt.unsubscribe(topics.get(TOPIC_ID_DISCOVERY_WILDCARD));
+
+    return false;
+}
+
+bool NetworkController::publishDiscoveryEntity(uint8_t index) {
+    const DiscoveryEntity &entity = discoveryEntities[index];
+    char topic[DISCOVERY_TOPIC_LENGTH];
+
+    format_discovery_topic(topic, sizeof(topic), entity, discoveryContext);
+    create_discovery_payload(publishDocument, entity, discoveryContext);
+
+    size_t capacity = 0;
+    uint8_t* payload = mqtt.beginPublishInPlace(topic, &capacity);
+    if (payload == nullptr) {
+        return false;
+    }
+
+    size_t length = measureJson(publishDocument);
+    if (length >= capacity) {
+        DEBUGV("Discovery payload for %s doesn't fit (%u bytes)\n", entity.objectId, length);
+        return false;
+    }
+
+    serializeJson(publishDocument, (char*)payload, capacity);
+
+    // Abandoning the in-place publish before endPublishInPlace sends nothing
+    uint32_t hash = CRC32::calculate(payload, length);
+    if (hash == retainedDiscoveryHashes[index]) {
+        return false;
+    }
+
+    retainedDiscoveryHashes[index] = hash;
+    return mqtt.endPublishInPlace(length, true);
+}
+
+void NetworkController::handleRetainedDiscovery(const MqttMessage &message) {
+    char entityTopic[DISCOVERY_TOPIC_LENGTH];
+    if (message.topicLength >= sizeof(entityTopic)) {
+        return;
+    }
+
+    uint32_t topicHash = fnv1a_hash((const uint8_t *)message.topic, message.topicLength);
+
+    for (uint8_t i = 0; i < DISCOVERY_ENTITY_COUNT; i++) {
+        if (discoveryTopicHashes[i] != topicHash) {
+            continue;
+        }
+
+        format_discovery_topic(entityTopic, sizeof(entityTopic), discoveryEntities[i], discoveryContext);
+
+        if (strncmp(entityTopic, message.topic, message.topicLength) == 0 && entityTopic[message.topicLength] == '\0') {
+            retainedDiscoveryHashes[i] = CRC32::calculate(message.payload, message.length);
+            return;
+        }
+    }
+}
+
+size_t NetworkController::renderHttpResource(StatusHttpResource resource, char *buffer, size_t size) {
+    switch (resource) {
+        case STATUS_HTTP_RESOURCE_STATUS: {
+            createStateDocument(WiFi.RSSI());
+
+            JsonObject stat_loop = publishDocument.createNestedObject("cl");
+            stat_loop["bd"] = controlLoopStats.getBrewDutyCycle();
+            stat_loop["sd"] = controlLoopStats.getServiceDutyCycle();
+            stat_loop["j"] = controlLoopStats.getJitterUs();
+            stat_loop["jm"] = controlLoopStats.getMaxJitterUs();
+            stat_loop["lc"] = controlLoopStats.getLateCycles();
+            stat_loop["b"] = controlLoopStats.getBails();
+
+            publishDocument["mf"] = freeMemory();
+            publishDocument["mc"] = mqtt.connected();
+
+            if (measureJson(publishDocument) >= size) {
+                return 0;
+            }
+
+            return serializeJson(publishDocument, buffer, size);
+        }
+        case STATUS_HTTP_RESOURCE_METRICS: {
+            PrometheusWriter writer(buffer, size);
+
+            writer.gauge("lcc_brew_temperature_celsius", status->getOffsetBrewTemperature());
+            writer.gauge("lcc_brew_target_celsius", status->getOffsetTargetBrewTemperature());
+            writer.gauge("lcc_service_temperature_celsius", status->getServiceTemperature());
+            writer.gauge("lcc_service_target_celsius", status->getTargetServiceTemp());
+            writer.gauge("lcc_rp2040_temperature_celsius", status->rp2040Temperature);
+            writer.gauge("lcc_state", (int32_t)status->getState());
+
+            writer.gauge("lcc_brew_duty_cycle_ratio", controlLoopStats.getBrewDutyCycle());
+            writer.gauge("lcc_service_duty_cycle_ratio", controlLoopStats.getServiceDutyCycle());
+            writer.counter("lcc_brew_ssr_on_cycles_total", controlLoopStats.getBrewSsrOnCycles());
+            writer.counter("lcc_service_ssr_on_cycles_total", controlLoopStats.getServiceSsrOnCycles());
+            writer.counter("lcc_control_cycles_total", controlLoopStats.getCycles());
+            writer.counter("lcc_control_cycles_late_total", controlLoopStats.getLateCycles());
+            writer.gauge("lcc_control_cycle_jitter_seconds", controlLoopStats.getJitterUs() / 1000000.f);
+            writer.gauge("lcc_control_cycle_jitter_max_seconds", (float)controlLoopStats.getMaxJitterUs() / 1000000.f);
+
+            writer.gauge("lcc_bailed", (int32_t)status->hasBailed());
+            writer.gauge("lcc_bail_reason", (int32_t)status->bailReason());
+            writer.counter("lcc_bails_total", controlLoopStats.getBails());
+            writer.counter("lcc_faults_recorded_total", faultLog.getRecordedFaults());
+            writer.counter("lcc_faults_dropped_total", faultLog.getDroppedFaults());
+
+            writer.gauge("lcc_heap_free_bytes", (int32_t)freeMemory());
+
+            writer.gauge("lcc_wifi_rssi_dbm", (int32_t)WiFi.RSSI());
+            writer.counter("lcc_wifi_connects_total", wifiSupervisor.getConnects());
+            writer.counter("lcc_wifi_disconnects_total", wifiSupervisor.getDisconnects());
+            writer.counter("lcc_wifi_module_resets_total", wifiSupervisor.getResets());
+            writer.gauge("lcc_wifi_connected_ratio", wifiSupervisor.getConnectedRatio());
+
+            writer.gauge("lcc_mqtt_connected", (int32_t)mqtt.connected());
+            writer.gauge("lcc_mqtt_keepalive_seconds", (int32_t)mqtt.getKeepAlive());
+            writer.gauge("lcc_mqtt_events_queued", (int32_t)eventQueue.size());
+            writer.counter("lcc_mqtt_events_dropped_total", eventQueue.getDroppedEvents());
+
+            writer.counter("lcc_settings_flash_writes_total", settings->getFlashWrites());
+            writer.counter("lcc_settings_coalesced_changes_total", settings->getCoalescedChanges());
+            writer.counter("lcc_settings_flash_bytes_written_total", settings->getFlashBytesWritten());
+            writer.counter("lcc_settings_journal_compactions_total", settings->getJournalCompactions());
+
+            writer.counter("lcc_http_requests_total", statusHttpServer.getRequests());
+            writer.gauge("lcc_websocket_clients", (int32_t)telemetryWebSocket.getClients());
+            writer.counter("lcc_websocket_frames_dropped_total", telemetryWebSocket.getDroppedFrames());
+
+            if (uiController != nullptr) {
+                writer.counter("lcc_display_frames_drawn_total", uiController->getFramesDrawn());
+                writer.counter("lcc_display_frames_skipped_total", uiController->getFramesSkipped());
+                writer.counter("lcc_display_bytes_sent_total", uiController->getBytesSent());
+                writer.gauge("lcc_display_frame_seconds", (float)uiController->getLastFrameUs() / 1000000.f);
+                writer.gauge("lcc_display_frame_max_seconds", (float)uiController->getMaxFrameUs() / 1000000.f);
+            }
+
+            if (taskScheduler != nullptr) {
+                for (size_t i = 0; i < taskScheduler->getTaskCount(); i++) {
+                    const ScheduledTask &task = taskScheduler->getTask(i);
+                    writer.gauge("lcc_task_cpu_ratio", "task", task.getName(), task.getCpuShare());
+                }
+
+                for (size_t i = 0; i < taskScheduler->getTaskCount(); i++) {
+                    const ScheduledTask &task = taskScheduler->getTask(i);
+                    writer.counter("lcc_task_deadlines_missed_total", "task", task.getName(), task.getMissedDeadlines());
+                }
+            }
+
+            return writer.length();
+        }
+        case STATUS_HTTP_RESOURCE_FAULTS:
+            return faultLog.render(buffer, size);
+        case STATUS_HTTP_RESOURCE_PROFILE:
+            return LoopProfiler::render(loopProfile, buffer, size);
+        case STATUS_HTTP_RESOURCE_BLACK_BOX: {
+            size_t length = fileIO->size(BLACK_BOX_FILENAME);
+
+            // Without a recording, an empty one is served
+            if (length == 0 && size >= sizeof(BlackBoxHeader)) {
+                BlackBoxHeader header{BLACK_BOX_SCHEMA_ID, BLACK_BOX_SCHEMA_VERSION, sizeof(BlackBoxEntry), 0, 0};
+                memcpy(buffer, &header, sizeof(header));
+                return sizeof(header);
+            }
+
+            if (length > size) {
+                return 0;
+            }
+
+            return fileIO->read(BLACK_BOX_FILENAME, 0, (uint8_t*)buffer, length);
+        }
+    }
 
+    return 0;
 }
 
 nonstd::optional<IPAddress> NetworkController::getIPAddress() {
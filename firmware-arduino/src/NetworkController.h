@@ -9,23 +9,55 @@
 #include <WiFi_Generic.h>
 #include <ArduinoOTA.h>
 #include <PubSubClient.h>
+#include <ArduinoJson.h>
 #include <FS.h>
 #include <LittleFS.h>
 #include <string>
 #include "optional.hpp"
 #include "types.h"
 #include "SystemStatus.h"
+#include "PublishScheduler.h"
+#include "ShotStreamer.h"
+#include "EventQueue.h"
+#include "WifiSupervisor.h"
+#include "ControlLoopStats.h"
+#include "FaultLog.h"
+#include "TaskScheduler.h"
+#include "UIController.h"
+#include "BlackBox.h"
+#include "StatusHttpServer.h"
+#include "TelemetryWebSocketServer.h"
+#include "HomeAssistantDiscovery.h"
+#include "TopicRegistry.h"
+#include "mqtt_commands.h"
+#include "SystemController/LoopProfiler.h"
 
 // Because these libraries don't use .cpp files, we have to forward declare the class instead to linking errors.
 class WiFiWebServer;
 
-#define TOPIC_LENGTH 49
+#define PUBLISH_DOCUMENT_SIZE 768
+
+// Packets published in the same loop are coalesced, as every write to the NINA module is a separate SPI transaction
+#define MQTT_BATCH_BUFFER_SIZE 1536
+
+// On MQTT 5 brokers, state and telemetry that couldn't be delivered within this time are dropped rather than sent late
+#define MQTT_STATE_MESSAGE_EXPIRY_S 60
+
+// Binary telemetry is opt-in (see set_telemetry_interval), and can't be published faster than 10 Hz.
+#define TELEMETRY_MIN_INTERVAL_MS 100
+
+// How long to wait for the broker to send back retained discovery payloads before comparing against them
+#define DISCOVERY_RETAINED_WAIT_MS 2000
 
 class NetworkController {
 public:
     explicit NetworkController(FileIO* _fileIO, SystemStatus* _status, SystemSettings* _settings);
 
-    void init(SystemMode mode);
+    void init(SystemMode mode, bool core1Relaunched);
+    // Core 1's scheduler, whose per task CPU shares are published with the info and metrics
+    void setTaskScheduler(const TaskScheduler* scheduler);
+    // For the display's frame and SPI statistics
+    void setUIController(const UIController* controller);
 
     bool hasConfiguration();
     bool isConnectedToWifi() const;
@@ -36,6 +68,11 @@ public:
     }
 
     void loop();
+
+    // Called for every status message from core 0, so that shots can be streamed at the control loop rate
+    void handleStatusMessage(const SystemControllerStatusMessage &message);
+    // Called with core 0's loop profile once a minute, in builds with CONTROL_LOOP_PROFILING defined
+    void setLoopProfile(const LoopProfileReport &report);
 private:
     SystemMode mode;
     FileIO* fileIO;
@@ -45,14 +82,42 @@ private:
     uint8_t previousWifiStatus = 0;
 
     nonstd::optional<WiFiNINA_Configuration> config;
-    nonstd::optional<absolute_time_t> wifiConnectTimeoutTime;
+    WifiSupervisor wifiSupervisor;
+    ControlLoopStats controlLoopStats;
+    FaultLog faultLog;
+    const TaskScheduler* taskScheduler = nullptr;
+    const UIController* uiController = nullptr;
+    LoopProfileReport loopProfile{};
+    StatusHttpServer statusHttpServer;
+    TelemetryWebSocketServer telemetryWebSocket;
     nonstd::optional<absolute_time_t> mqttConnectTimeoutTime;
-    nonstd::optional<absolute_time_t> mqttNextStatPublishTime;
-    nonstd::optional<absolute_time_t> mqttNextInfoPublishTime;
-    nonstd::optional<absolute_time_t> mqttNextConfigPublishTime;
+    PublishScheduler publishScheduler;
+    nonstd::optional<absolute_time_t> mqttNextTelemetryPublishTime;
+
+    uint32_t telemetryIntervalMs = 0;
+    uint32_t telemetrySequence = 0;
+
+    ShotStreamer shotStreamer;
+
+    // Events that shouldn't be lost to a dropped connection go out with QoS 1 through the event queue
+    EventQueue eventQueue;
+    bool eventBrewing = false;
+    absolute_time_t eventBrewStart = nil_time;
+    SystemControllerBailReason eventBailReason = BAIL_REASON_NONE;
 
     bool configChanged = true;
 
+    DiscoveryContext discoveryContext{};
+    uint8_t discoveryIndex = DISCOVERY_ENTITY_COUNT;
+    absolute_time_t discoveryStartTime = nil_time;
+    uint32_t retainedDiscoveryHashes[DISCOVERY_ENTITY_COUNT]{};
+
+    // Reused for every state/config/info publish, so publishing never touches the heap
+    StaticJsonDocument<PUBLISH_DOCUMENT_SIZE> publishDocument;
+    StaticJsonDocument<COMMAND_DOCUMENT_SIZE> commandDocument;
+
+    static const MqttCommand commandTable[];
+
     ArduinoOTAMdnsClass <WiFiServer, WiFiClient, WiFiUDP> ArduinoOTA;
     WiFiClient client = WiFiClient();
     PubSubClient mqtt = PubSubClient(client);
@@ -61,56 +126,55 @@ private:
 
     bool otaInited = false;
     bool _isConnectedToWifi = false;
-    bool topicsFormatted = false;
 
     char identifier[24];
-    std::string stdIdentifier;
+    char macString[18];
 
     void initConfigMode();
     void initOTA();
     void loopNormal();
     void loopConfig();
     void loopOta();
-    void attemptWifiConnection();
+    void superviseWifi();
+    void persistBlackBox();
     void attemptReadConfig();
     void writeConfig(WiFiNINA_Configuration newConfig);
 
+    // Blocks for 100 ms, so only used during init. The loop resets the module through the supervisor.
     void resetModule();
 
     bool ensureConnectedMqttClient();
+    void beginMqttConnect();
+    void onMqttConnected();
     void ensureTopicsFormatted();
 
     void publishMqtt();
     void publishMqttStat();
+    void createStateDocument(int32_t rssi);
     void publishMqttConf();
     void publishMqttInfo();
+    void publishMqttTelemetry();
+    void publishMqttShotBatch();
+    void enqueueEvents(const SystemControllerStatusMessage &message);
+    bool publishJson(const char* topic, const JsonDocument& document, bool retained);
+
+    void setTelemetryInterval(uint32_t intervalMs);
+
+    size_t renderHttpResource(StatusHttpResource resource, char* buffer, size_t size);
 
     void handleConfigHTTPRequest();
     void sendHTTPHeaders();
-    void createHTML(String& root_html_template);
-
-    char TOPIC_LWT[TOPIC_LENGTH];
-    char TOPIC_STATE[TOPIC_LENGTH];
-    char TOPIC_CONFIG[TOPIC_LENGTH];
-    char TOPIC_INFO[TOPIC_LENGTH];
-    char TOPIC_COMMAND[TOPIC_LENGTH];
-
-    char TOPIC_AUTOCONF_STATE_SENSOR[128];
-    char TOPIC_AUTOCONF_BREW_BOILER_SENSOR[128];
-    char TOPIC_AUTOCONF_SERVICE_BOILER_SENSOR[128];
-    char TOPIC_AUTOCONF_ECO_MODE_SWITCH[128];
-    char TOPIC_AUTOCONF_SLEEP_MODE_SWITCH[128];
-    char TOPIC_AUTOCONF_BREW_TEMPERATURE_TARGET_NUMBER[128];
-    char TOPIC_AUTOCONF_SERVICE_TEMPERATURE_TARGET_NUMBER[128];
-    char TOPIC_AUTOCONF_WATER_TANK_LOW_BINARY_SENSOR[128];
-    char TOPIC_AUTOCONF_WIFI_SENSOR[128];
-    char TOPIC_AUTOCONF_RP2040_TEMP_SENSOR[128];
-    char TOPIC_AUTOCONF_AUTO_SLEEP_MIN[128];
-    char TOPIC_AUTOCONF_PLANNED_AUTO_SLEEP_MIN[128];
-
-    void callback(char *topic, byte *payload, unsigned int length);
-
-    void publishAutoconfigure();
+    void streamConfigHTML();
+
+    TopicRegistry topics;
+    uint32_t discoveryTopicHashes[DISCOVERY_ENTITY_COUNT]{};
+
+    void callback(const MqttMessage &message);
+    void handleCommand(JsonObjectConst command);
+
+    bool publishNextDiscoveryEntity();
+    bool publishDiscoveryEntity(uint8_t index);
+    void handleRetainedDiscovery(const MqttMessage &message);
 };
 
 
@@ -0,0 +1,56 @@
+#include "PrometheusWriter.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+void PrometheusWriter::gauge(const char *name, float value) {
+    previousName = nullptr;
+    append("# TYPE %s gauge\n%s %.3f\n", name, name, value);
+}
+
+void PrometheusWriter::gauge(const char *name, int32_t value) {
+    previousName = nullptr;
+    append("# TYPE %s gauge\n%s %ld\n", name, name, (long)value);
+}
+
+void PrometheusWriter::counter(const char *name, uint32_t value) {
+    previousName = nullptr;
+    append("# TYPE %s counter\n%s %lu\n", name, name, (unsigned long)value);
+}
+
+void PrometheusWriter::gauge(const char *name, const char *label, const char *labelValue, float value) {
+    type(name, "gauge");
+    append("%s{%s=\"%s\"} %.3f\n", name, label, labelValue, value);
+}
+
+void PrometheusWriter::counter(const char *name, const char *label, const char *labelValue, uint32_t value) {
+    type(name, "counter");
+    append("%s{%s=\"%s\"} %lu\n", name, label, labelValue, (unsigned long)value);
+}
+
+void PrometheusWriter::type(const char *name, const char *type) {
+    if (previousName != nullptr && strcmp(previousName, name) == 0) {
+        return;
+    }
+
+    append("# TYPE %s %s\n", name, type);
+    previousName = name;
+}
+
+void PrometheusWriter::append(const char *format, ...) {
+    if (overflowed) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + position, size - position, format, args);
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= size - position) {
+        overflowed = true;
+        return;
+    }
+
+    position += written;
+}
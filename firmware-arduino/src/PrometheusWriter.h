@@ -0,0 +1,36 @@
+#ifndef FIRMWARE_ARDUINO_PROMETHEUSWRITER_H
+#define FIRMWARE_ARDUINO_PROMETHEUSWRITER_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Appends Prometheus text format samples to a buffer. Once something doesn't fit, everything after it is dropped and
+ * the writer reports an overflow.
+ */
+class PrometheusWriter {
+public:
+    PrometheusWriter(char* buffer, size_t size): buffer(buffer), size(size) {}
+
+    void gauge(const char* name, float value);
+    void gauge(const char* name, int32_t value);
+    void counter(const char* name, uint32_t value);
+    // Samples of one family with a single label. The family's type is only written before its first sample, so a family's
+    // samples must be written one after the other.
+    void gauge(const char* name, const char* label, const char* labelValue, float value);
+    void counter(const char* name, const char* label, const char* labelValue, uint32_t value);
+
+    inline size_t length() const { return overflowed ? 0 : position; }
+private:
+    char* buffer;
+    size_t size;
+    size_t position = 0;
+    bool overflowed = false;
+    const char* previousName = nullptr;
+
+    void type(const char* name, const char* type);
+    void append(const char* format, ...);
+};
+
+
+#endif //FIRMWARE_ARDUINO_PROMETHEUSWRITER_H
@@ -0,0 +1,98 @@
+#include "PublishScheduler.h"
+#include <cmath>
+
+StateSnapshot::StateSnapshot(const SystemStatus *status):
+    state(status->getState()),
+    bailReason(status->bailReason()),
+    brewing(status->currentlyBrewing()),
+    hasPreviousBrew(status->hasPreviousBrew()),
+    waterTankLow(status->isWaterTankEmpty()),
+    brewTemperature(status->getOffsetBrewTemperature()),
+    serviceTemperature(status->getServiceTemperature()) {
+}
+
+bool StateSnapshot::hasEventChange(const StateSnapshot &other) const {
+    return state != other.state ||
+           bailReason != other.bailReason ||
+           brewing != other.brewing ||
+           hasPreviousBrew != other.hasPreviousBrew ||
+           waterTankLow != other.waterTankLow;
+}
+
+bool StateSnapshot::isOutsideDeadband(const StateSnapshot &other) const {
+    return fabsf(brewTemperature - other.brewTemperature) >= TEMPERATURE_DEADBAND ||
+           fabsf(serviceTemperature - other.serviceTemperature) >= TEMPERATURE_DEADBAND;
+}
+
+ConfigSnapshot::ConfigSnapshot(const SystemStatus *status, const SystemSettings *settings):
+    offsetTargetBrewTemperature(status->getOffsetTargetBrewTemperature()),
+    brewTemperatureOffset(status->getBrewTempOffset()),
+    targetServiceTemperature(status->getTargetServiceTemp()),
+    brewPidSettings(status->getBrewPidSettings()),
+    servicePidSettings(status->getServicePidSettings()),
+    ecoMode(status->isInEcoMode()),
+    sleepMode(status->isInSleepMode()),
+    autoSleepMin(settings->getAutoSleepMin()) {
+}
+
+bool ConfigSnapshot::operator!=(const ConfigSnapshot &other) const {
+    return offsetTargetBrewTemperature != other.offsetTargetBrewTemperature ||
+           brewTemperatureOffset != other.brewTemperatureOffset ||
+           targetServiceTemperature != other.targetServiceTemperature ||
+           brewPidSettings != other.brewPidSettings ||
+           servicePidSettings != other.servicePidSettings ||
+           ecoMode != other.ecoMode ||
+           sleepMode != other.sleepMode ||
+           autoSleepMin != other.autoSleepMin;
+}
+
+void PublishScheduler::reset() {
+    hasPublishedState = false;
+    hasPublishedConfig = false;
+    hasPublishedInfo = false;
+}
+
+bool PublishScheduler::isStateDue(const SystemStatus *status) const {
+    if (!hasPublishedState || hasElapsed(lastStatePublishAt, STATE_HEARTBEAT_MS)) {
+        return true;
+    }
+
+    StateSnapshot current(status);
+
+    if (current.hasEventChange(lastState)) {
+        return true;
+    }
+
+    uint32_t minInterval = current.brewing ? STATE_MIN_INTERVAL_BREWING_MS : STATE_MIN_INTERVAL_IDLE_MS;
+
+    return current.isOutsideDeadband(lastState) && hasElapsed(lastStatePublishAt, minInterval);
+}
+
+bool PublishScheduler::isConfigDue(const SystemStatus *status, const SystemSettings *settings) const {
+    if (!hasPublishedConfig || hasElapsed(lastConfigPublishAt, CONFIG_HEARTBEAT_MS)) {
+        return true;
+    }
+
+    return ConfigSnapshot(status, settings) != lastConfig;
+}
+
+bool PublishScheduler::isInfoDue() const {
+    return !hasPublishedInfo || hasElapsed(lastInfoPublishAt, INFO_HEARTBEAT_MS);
+}
+
+void PublishScheduler::statePublished(const SystemStatus *status) {
+    lastState = StateSnapshot(status);
+    lastStatePublishAt = get_absolute_time();
+    hasPublishedState = true;
+}
+
+void PublishScheduler::configPublished(const SystemStatus *status, const SystemSettings *settings) {
+    lastConfig = ConfigSnapshot(status, settings);
+    lastConfigPublishAt = get_absolute_time();
+    hasPublishedConfig = true;
+}
+
+void PublishScheduler::infoPublished() {
+    lastInfoPublishAt = get_absolute_time();
+    hasPublishedInfo = true;
+}
@@ -0,0 +1,87 @@
+#ifndef FIRMWARE_ARDUINO_PUBLISHSCHEDULER_H
+#define FIRMWARE_ARDUINO_PUBLISHSCHEDULER_H
+
+#include <pico/time.h>
+#include "SystemStatus.h"
+#include "SystemSettings.h"
+
+// Heartbeats, used when nothing has changed
+#define STATE_HEARTBEAT_MS 30000
+#define CONFIG_HEARTBEAT_MS 60000
+#define INFO_HEARTBEAT_MS 300000
+
+// Minimum time between state publishes caused by values drifting outside their deadband
+#define STATE_MIN_INTERVAL_IDLE_MS 1000
+#define STATE_MIN_INTERVAL_BREWING_MS 100
+
+#define TEMPERATURE_DEADBAND 0.1f
+
+struct StateSnapshot {
+    SystemControllerState state = SYSTEM_CONTROLLER_STATE_UNDETERMINED;
+    SystemControllerBailReason bailReason = BAIL_REASON_NONE;
+    bool brewing = false;
+    bool hasPreviousBrew = false;
+    bool waterTankLow = false;
+    float brewTemperature = 0.f;
+    float serviceTemperature = 0.f;
+
+    explicit StateSnapshot(const SystemStatus *status);
+    StateSnapshot() = default;
+
+    // Changes that should reach the broker right away, regardless of rate limiting
+    bool hasEventChange(const StateSnapshot &other) const;
+    bool isOutsideDeadband(const StateSnapshot &other) const;
+};
+
+struct ConfigSnapshot {
+    float offsetTargetBrewTemperature = 0.f;
+    float brewTemperatureOffset = 0.f;
+    float targetServiceTemperature = 0.f;
+    PidSettings brewPidSettings{};
+    PidSettings servicePidSettings{};
+    bool ecoMode = false;
+    bool sleepMode = false;
+    uint16_t autoSleepMin = 0;
+
+    ConfigSnapshot(const SystemStatus *status, const SystemSettings *settings);
+    ConfigSnapshot() = default;
+
+    bool operator!=(const ConfigSnapshot &other) const;
+};
+
+/*
+ * Decides when the state, config and info documents are due. Documents are compared against what was last
+ * published, and go out as soon as they change in a meaningful way. When nothing changes they fall back to a slow
+ * heartbeat. During a brew, state is allowed out at up to 10 Hz.
+ */
+class PublishScheduler {
+public:
+    // Forces every document to be published again, e.g. after a reconnect
+    void reset();
+
+    bool isStateDue(const SystemStatus *status) const;
+    bool isConfigDue(const SystemStatus *status, const SystemSettings *settings) const;
+    bool isInfoDue() const;
+
+    void statePublished(const SystemStatus *status);
+    void configPublished(const SystemStatus *status, const SystemSettings *settings);
+    void infoPublished();
+private:
+    bool hasPublishedState = false;
+    bool hasPublishedConfig = false;
+    bool hasPublishedInfo = false;
+
+    StateSnapshot lastState;
+    ConfigSnapshot lastConfig;
+
+    absolute_time_t lastStatePublishAt = nil_time;
+    absolute_time_t lastConfigPublishAt = nil_time;
+    absolute_time_t lastInfoPublishAt = nil_time;
+
+    static inline bool hasElapsed(absolute_time_t since, uint32_t ms) {
+        return absolute_time_diff_us(since, get_absolute_time()) >= (int64_t)ms * 1000;
+    }
+};
+
+
+#endif //FIRMWARE_ARDUINO_PUBLISHSCHEDULER_H
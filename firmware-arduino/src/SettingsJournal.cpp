@@ -0,0 +1,316 @@
+#include "SettingsJournal.h"
+#include <Arduino.h>
+#include <CRC32.h>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+
+// How a value is checked on replay. A value that fails the check is skipped, leaving the setting as it was.
+typedef enum : uint8_t {
+    SETTING_TYPE_FLOAT,
+    SETTING_TYPE_BOOL,
+    SETTING_TYPE_UINT16,
+    SETTING_TYPE_PID,
+} SettingType;
+
+struct SettingField {
+    SettingKey key;
+    SettingType type;
+    size_t offset;
+    uint8_t length;
+    // Largest value accepted for a SETTING_TYPE_UINT16
+    uint16_t maximum;
+};
+
+#define SETTING_FIELD(key, type, member) {key, type, offsetof(SettingStruct, member), sizeof(SettingStruct::member), UINT16_MAX}
+#define SETTING_FIELD_MAX(key, type, member, maximum) {key, type, offsetof(SettingStruct, member), sizeof(SettingStruct::member), maximum}
+
+static constexpr SettingField settingFields[] = {
+    SETTING_FIELD(SETTING_KEY_BREW_TEMPERATURE_OFFSET, SETTING_TYPE_FLOAT, brewTemperatureOffset),
+    SETTING_FIELD(SETTING_KEY_SLEEP_MODE, SETTING_TYPE_BOOL, sleepMode),
+    SETTING_FIELD(SETTING_KEY_ECO_MODE, SETTING_TYPE_BOOL, ecoMode),
+    SETTING_FIELD(SETTING_KEY_BREW_TEMPERATURE_TARGET, SETTING_TYPE_FLOAT, brewTemperatureTarget),
+    SETTING_FIELD(SETTING_KEY_SERVICE_TEMPERATURE_TARGET, SETTING_TYPE_FLOAT, serviceTemperatureTarget),
+    SETTING_FIELD_MAX(SETTING_KEY_AUTO_SLEEP_MIN, SETTING_TYPE_UINT16, autoSleepMin, AUTO_SLEEP_MAX_MIN),
+    SETTING_FIELD(SETTING_KEY_BREW_PID_PARAMETERS, SETTING_TYPE_PID, brewPidParameters),
+    SETTING_FIELD(SETTING_KEY_SERVICE_PID_PARAMETERS, SETTING_TYPE_PID, servicePidParameters),
+};
+
+#define SETTING_FIELD_COUNT (sizeof(settingFields) / sizeof(settingFields[0]))
+#define SETTINGS_JOURNAL_MAX_RECORD (sizeof(SettingsJournalRecordHeader) + sizeof(PidSettings) + sizeof(uint32_t))
+#define SETTINGS_JOURNAL_SCHEMA_RECORD (sizeof(SettingsJournalRecordHeader) + sizeof(uint8_t) + sizeof(uint32_t))
+
+// Large enough for the schema record and a record of every setting, which is what a snapshot is
+#define SETTINGS_JOURNAL_SNAPSHOT_SIZE (SETTINGS_JOURNAL_SCHEMA_RECORD + SETTING_FIELD_COUNT * SETTINGS_JOURNAL_MAX_RECORD)
+
+static constexpr size_t settingTypeLength(SettingType type) {
+    return type == SETTING_TYPE_FLOAT ? sizeof(float) :
+           type == SETTING_TYPE_BOOL ? sizeof(bool) :
+           type == SETTING_TYPE_UINT16 ? sizeof(uint16_t) :
+           sizeof(PidSettings);
+}
+
+// Checked at compile time, so a mistake in the table above can't make it to a journal
+static constexpr bool settingFieldsAreValid() {
+    for (size_t i = 0; i < SETTING_FIELD_COUNT; i++) {
+        if (settingFields[i].key == SETTING_KEY_SCHEMA_VERSION ||
+            settingFields[i].length != settingTypeLength(settingFields[i].type) ||
+            settingFields[i].offset + settingFields[i].length > sizeof(SettingStruct)) {
+            return false;
+        }
+
+        for (size_t j = i + 1; j < SETTING_FIELD_COUNT; j++) {
+            if (settingFields[i].key == settingFields[j].key) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static_assert(settingFieldsAreValid(), "Setting keys must be unique, and fields must match their type");
+static_assert(SETTINGS_JOURNAL_MAX_RECORD <= SETTINGS_JOURNAL_READ_CHUNK, "Settings journal records must fit the read chunk");
+
+static bool isValidValue(const SettingField &field, const uint8_t* value) {
+    switch (field.type) {
+        case SETTING_TYPE_FLOAT: {
+            float number;
+            memcpy(&number, value, sizeof(number));
+            return std::isfinite(number);
+        }
+        case SETTING_TYPE_BOOL:
+            return *value <= 1;
+        case SETTING_TYPE_UINT16: {
+            uint16_t number;
+            memcpy(&number, value, sizeof(number));
+            return number <= field.maximum;
+        }
+        case SETTING_TYPE_PID: {
+            PidSettings pid;
+            memcpy(&pid, value, sizeof(pid));
+            return std::isfinite(pid.Kp) && std::isfinite(pid.Ki) && std::isfinite(pid.Kd) &&
+                   std::isfinite(pid.windupLow) && std::isfinite(pid.windupHigh) && pid.windupLow <= pid.windupHigh;
+        }
+    }
+
+    return false;
+}
+
+SettingsJournal::SettingsJournal(FileStore *fileStore, const char *filename, const char *compactionFilename):
+    fileStore(fileStore), filename(filename), compactionFilename(compactionFilename) {
+}
+
+bool SettingsJournal::replay(SettingStruct &settings) {
+    size_t fileSize = fileStore->size(filename);
+
+    if (fileSize == 0) {
+        return false;
+    }
+
+    uint8_t chunk[SETTINGS_JOURNAL_READ_CHUNK];
+    size_t offset = 0;
+    bool damaged = false;
+    uint32_t lastSequence = 0;
+    schemaVersion = SETTINGS_SCHEMA_JOURNAL;
+
+    while (offset < fileSize && !damaged) {
+        size_t length = fileStore->read(filename, offset, chunk, sizeof(chunk));
+        size_t position = 0;
+
+        while (length - position >= sizeof(SettingsJournalRecordHeader)) {
+            SettingsJournalRecordHeader header{};
+            memcpy(&header, chunk + position, sizeof(header));
+
+            size_t recordLength = sizeof(header) + header.length + sizeof(uint32_t);
+
+            if (recordLength > SETTINGS_JOURNAL_MAX_RECORD) {
+                damaged = true;
+                break;
+            }
+
+            // The rest of the record is in the next chunk
+            if (length - position < recordLength) {
+                break;
+            }
+
+            uint32_t checksum;
+            memcpy(&checksum, chunk + position + sizeof(header) + header.length, sizeof(checksum));
+
+            if (CRC32::calculate(chunk + position, sizeof(header) + header.length) != checksum || header.sequence <= lastSequence) {
+                damaged = true;
+                break;
+            }
+
+            const uint8_t* value = chunk + position + sizeof(header);
+
+            if (header.key == SETTING_KEY_SCHEMA_VERSION && header.length == sizeof(uint8_t)) {
+                schemaVersion = *value;
+            }
+
+            for (const auto &field : settingFields) {
+                if (field.key == header.key) {
+                    if (field.length == header.length && isValidValue(field, value)) {
+                        memcpy((uint8_t*)&settings + field.offset, value, field.length);
+                    } else {
+                        rejectedRecords++;
+                    }
+                    break;
+                }
+            }
+
+            lastSequence = header.sequence;
+            replayedRecords++;
+            position += recordLength;
+        }
+
+        // Nothing could be read from what's left, i.e. the last write was cut short
+        if (position == 0) {
+            damaged = true;
+        }
+
+        offset += position;
+    }
+
+    nextSequence = lastSequence + 1;
+    journalSize = offset;
+
+    if (replayedRecords == 0) {
+        return false;
+    }
+
+    if (schemaVersion < SETTINGS_SCHEMA_VERSION) {
+        DEBUGV("Migrating settings journal from schema %u\n", schemaVersion);
+        migrate(schemaVersion, settings);
+        compact(settings);
+    } else if (damaged) {
+        // Records appended after a damaged one would never be replayed, so the damage has to go first
+        DEBUGV("Settings journal damaged after %u bytes, compacting\n", offset);
+        compact(settings);
+    }
+
+    return true;
+}
+
+bool SettingsJournal::commit(const SettingStruct &previous, const SettingStruct &current) {
+    uint8_t buffer[SETTINGS_JOURNAL_SNAPSHOT_SIZE];
+    size_t length = 0;
+    uint32_t sequence = nextSequence;
+
+    for (const auto &field : settingFields) {
+        const uint8_t* previousValue = (const uint8_t*)&previous + field.offset;
+        const uint8_t* currentValue = (const uint8_t*)&current + field.offset;
+
+        if (memcmp(previousValue, currentValue, field.length) != 0) {
+            length += encodeRecord(buffer + length, sizeof(buffer) - length, field.key, currentValue, field.length);
+        }
+    }
+
+    if (length == 0) {
+        return true;
+    }
+
+    if (journalSize + length > SETTINGS_JOURNAL_COMPACT_BYTES) {
+        nextSequence = sequence;
+        return compact(current);
+    }
+
+    if (!fileStore->append(filename, buffer, length)) {
+        // Whatever made it to flash may be torn, so start over from a snapshot
+        return compact(current);
+    }
+
+    journalSize += length;
+    bytesWritten += length;
+    return true;
+}
+
+bool SettingsJournal::compact(const SettingStruct &settings) {
+    uint8_t buffer[SETTINGS_JOURNAL_SNAPSHOT_SIZE];
+    uint8_t schema = SETTINGS_SCHEMA_VERSION;
+    size_t length = encodeRecord(buffer, sizeof(buffer), SETTING_KEY_SCHEMA_VERSION, &schema, sizeof(schema));
+
+    for (const auto &field : settingFields) {
+        length += encodeRecord(buffer + length, sizeof(buffer) - length, field.key, (const uint8_t*)&settings + field.offset, field.length);
+    }
+
+    if (!fileStore->write(compactionFilename, buffer, length) || !fileStore->rename(compactionFilename, filename)) {
+        DEBUGV("Unable to compact settings journal\n");
+        return false;
+    }
+
+    journalSize = length;
+    bytesWritten += length;
+    compactions++;
+    schemaVersion = SETTINGS_SCHEMA_VERSION;
+    return true;
+}
+
+bool SettingsJournal::importLegacy(const char *legacyFilename, SettingStruct &settings) {
+    uint8_t buffer[sizeof(uint8_t) + sizeof(SettingStruct) + sizeof(uint32_t)];
+
+    if (fileStore->read(legacyFilename, 0, buffer, sizeof(buffer)) != sizeof(buffer) || buffer[0] != SETTINGS_LEGACY_FILE_VERSION) {
+        return false;
+    }
+
+    SettingStruct legacy;
+    uint32_t checksum;
+    memcpy(&legacy, buffer + sizeof(uint8_t), sizeof(legacy));
+    memcpy(&checksum, buffer + sizeof(uint8_t) + sizeof(legacy), sizeof(checksum));
+
+    if (CRC32::calculate((const uint8_t*)&legacy, sizeof(legacy)) != checksum) {
+        return false;
+    }
+
+    migrate(SETTINGS_SCHEMA_LEGACY, legacy);
+    settings = legacy;
+
+    // Only removed once the journal holds the settings, so a failed compaction is retried on the next boot
+    if (compact(settings)) {
+        fileStore->remove(legacyFilename);
+    }
+
+    return true;
+}
+
+/*
+ * Each step converts settings read in one schema to the next, and falls through to the steps after it. Settings a
+ * step doesn't touch are carried over as is.
+ */
+void SettingsJournal::migrate(uint8_t fromVersion, SettingStruct &settings) {
+    switch (fromVersion) {
+        case SETTINGS_SCHEMA_LEGACY: {
+            // settings.dat was only checked as a whole, so each field is held to what replay accepts from a record
+            SettingStruct defaults{};
+
+            for (const auto &field : settingFields) {
+                if (!isValidValue(field, (const uint8_t*)&settings + field.offset)) {
+                    memcpy((uint8_t*)&settings + field.offset, (const uint8_t*)&defaults + field.offset, field.length);
+                    rejectedRecords++;
+                }
+            }
+        }
+        // fall through
+        case SETTINGS_SCHEMA_JOURNAL:
+        default:
+            break;
+    }
+}
+
+size_t SettingsJournal::encodeRecord(uint8_t *buffer, size_t size, SettingKey key, const uint8_t *value, uint8_t length) {
+    SettingsJournalRecordHeader header{nextSequence, key, length};
+    size_t recordLength = sizeof(header) + length + sizeof(uint32_t);
+
+    if (recordLength > size) {
+        return 0;
+    }
+
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), value, length);
+
+    uint32_t checksum = CRC32::calculate(buffer, sizeof(header) + length);
+    memcpy(buffer + sizeof(header) + length, &checksum, sizeof(checksum));
+
+    nextSequence++;
+    return recordLength;
+}
@@ -0,0 +1,92 @@
+#ifndef FIRMWARE_ARDUINO_SETTINGSJOURNAL_H
+#define FIRMWARE_ARDUINO_SETTINGSJOURNAL_H
+
+#include <cstdint>
+#include <cstddef>
+#include "types.h"
+#include "FileStore.h"
+
+// Once appending would take the journal past this size, it's compacted into a snapshot instead
+#define SETTINGS_JOURNAL_COMPACT_BYTES 512
+
+// The journal is replayed in chunks of this size. Must hold the largest record.
+#define SETTINGS_JOURNAL_READ_CHUNK 256
+
+// Bumped whenever the meaning of an existing key changes, along with a step in SettingsJournal::migrate()
+#define SETTINGS_SCHEMA_VERSION 2
+// The single struct settings.dat that came before the journal
+#define SETTINGS_SCHEMA_LEGACY 1
+// The first journal schema. Journals written before the schema record are this one.
+#define SETTINGS_SCHEMA_JOURNAL 2
+
+// The version byte at the start of the last settings.dat layout. Earlier layouts were already discarded on boot.
+#define SETTINGS_LEGACY_FILE_VERSION ((uint8_t)5)
+
+// Keys are never reused. Records with unknown keys are skipped on replay, so older firmware can read newer journals.
+typedef enum : uint8_t {
+    // Written first in every snapshot
+    SETTING_KEY_SCHEMA_VERSION = 0,
+    SETTING_KEY_BREW_TEMPERATURE_OFFSET = 1,
+    SETTING_KEY_SLEEP_MODE = 2,
+    SETTING_KEY_ECO_MODE = 3,
+    SETTING_KEY_BREW_TEMPERATURE_TARGET = 4,
+    SETTING_KEY_SERVICE_TEMPERATURE_TARGET = 5,
+    SETTING_KEY_AUTO_SLEEP_MIN = 6,
+    SETTING_KEY_BREW_PID_PARAMETERS = 7,
+    SETTING_KEY_SERVICE_PID_PARAMETERS = 8,
+} SettingKey;
+
+// Followed by the value and a CRC32 over the header and value
+struct __attribute__((packed)) SettingsJournalRecordHeader {
+    uint32_t sequence;
+    uint8_t key;
+    uint8_t length;
+};
+
+/*
+ * An append-only journal of setting changes. Every commit appends one small record per changed setting, rather than
+ * rewriting the whole struct. On boot the records are replayed in order until the first one that's torn or corrupt,
+ * so a power cut mid-write loses at most the change being written. Compaction writes a snapshot to a temporary file
+ * and renames it over the journal, which LittleFS does atomically.
+ *
+ * Settings without a valid record keep their default from SettingStruct, so adding a setting, or dropping one, never
+ * costs the others. Journals from an older schema, and the settings.dat before them, are migrated and compacted into
+ * the current schema.
+ */
+class SettingsJournal {
+public:
+    SettingsJournal(FileStore* fileStore, const char* filename, const char* compactionFilename);
+
+    // Applies the journal on top of settings. Returns false if there's no journal to replay.
+    bool replay(SettingStruct &settings);
+    // Appends a record for every setting that differs between previous and current
+    bool commit(const SettingStruct &previous, const SettingStruct &current);
+    // Replaces the journal with one record per setting
+    bool compact(const SettingStruct &settings);
+    // Reads a settings.dat into settings and moves it into the journal. Returns false if there's no valid file.
+    bool importLegacy(const char* legacyFilename, SettingStruct &settings);
+
+    inline uint32_t getReplayedRecords() const { return replayedRecords; }
+    inline uint32_t getBytesWritten() const { return bytesWritten; }
+    inline uint32_t getCompactions() const { return compactions; }
+    inline uint32_t getRejectedRecords() const { return rejectedRecords; }
+private:
+    FileStore* fileStore;
+    const char* filename;
+    const char* compactionFilename;
+
+    uint32_t nextSequence = 1;
+    size_t journalSize = 0;
+    uint8_t schemaVersion = SETTINGS_SCHEMA_VERSION;
+
+    uint32_t replayedRecords = 0;
+    uint32_t bytesWritten = 0;
+    uint32_t compactions = 0;
+    uint32_t rejectedRecords = 0;
+
+    void migrate(uint8_t fromVersion, SettingStruct &settings);
+    size_t encodeRecord(uint8_t* buffer, size_t size, SettingKey key, const uint8_t* value, uint8_t length);
+};
+
+
+#endif //FIRMWARE_ARDUINO_SETTINGSJOURNAL_H
@@ -0,0 +1,69 @@
+#include "ShotStreamer.h"
+#include <cstring>
+
+void ShotStreamer::addStatusMessage(const SystemControllerStatusMessage &message, float brewTempOffset) {
+    if (message.currentlyBrewing) {
+        if (!streaming) {
+            streaming = true;
+            shotId++;
+            sampleCount = 0;
+            batchSequence = 0;
+            droppedSamples = 0;
+        }
+
+        stopAt.reset();
+    } else if (streaming) {
+        if (!stopAt.has_value()) {
+            stopAt = delayed_by_ms(message.timestamp, SHOT_STREAM_TAIL_MS);
+        } else if (absolute_time_diff_us(stopAt.value(), message.timestamp) > 0) {
+            streaming = false;
+            stopAt.reset();
+            return;
+        }
+    } else {
+        return;
+    }
+
+    if (sampleCount >= SHOT_STREAM_MAX_SAMPLES) {
+        droppedSamples++;
+        return;
+    }
+
+    samples[sampleCount++] = create_shot_sample(message, brewTempOffset);
+}
+
+bool ShotStreamer::isBatchReady() const {
+    // Flush whatever is left once the stream has ended
+    return sampleCount >= SHOT_STREAM_BATCH_SAMPLES || (!streaming && sampleCount > 0);
+}
+
+size_t ShotStreamer::getBatchSize() const {
+    return sizeof(ShotStreamHeader) + sampleCount * sizeof(ShotSample);
+}
+
+void ShotStreamer::writeBatch(uint8_t *buffer) {
+    ShotStreamHeader header = ShotStreamHeader();
+
+    header.schemaId = SHOT_STREAM_SCHEMA_ID;
+    header.schemaVersion = SHOT_STREAM_SCHEMA_VERSION;
+    header.sampleCount = sampleCount;
+    header.shotId = shotId;
+    header.batchSequence = batchSequence;
+    header.droppedSamples = droppedSamples;
+
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), samples, sampleCount * sizeof(ShotSample));
+
+    droppedSamples = 0;
+    clearBatch();
+}
+
+void ShotStreamer::dropBatch() {
+    droppedSamples += sampleCount;
+    clearBatch();
+}
+
+void ShotStreamer::clearBatch() {
+    sampleCount = 0;
+    batchSequence++;
+}
@@ -0,0 +1,47 @@
+#ifndef FIRMWARE_ARDUINO_SHOTSTREAMER_H
+#define FIRMWARE_ARDUINO_SHOTSTREAMER_H
+
+#include <pico/time.h>
+#include "optional.hpp"
+#include "types.h"
+#include "telemetry_protocol.h"
+
+// The control loop runs at 10 Hz, so a batch is one second of samples
+#define SHOT_STREAM_BATCH_SAMPLES 10
+// Room for a few batches if the network loop falls behind, after which samples are dropped
+#define SHOT_STREAM_MAX_SAMPLES 30
+// Keep streaming for a while after the brew ends, to capture the temperature recovery
+#define SHOT_STREAM_TAIL_MS 3000
+
+#define SHOT_STREAM_MAX_BATCH_SIZE (sizeof(ShotStreamHeader) + SHOT_STREAM_MAX_SAMPLES * sizeof(ShotSample))
+
+/*
+ * Collects a sample from every control cycle status message while brewing, and hands them out in batches. The
+ * streamer never waits for the network: if batches aren't taken in time, new samples are dropped and counted.
+ */
+class ShotStreamer {
+public:
+    void addStatusMessage(const SystemControllerStatusMessage &message, float brewTempOffset);
+
+    bool isBatchReady() const;
+    size_t getBatchSize() const;
+
+    // Writes the pending batch to buffer, which must fit getBatchSize() bytes, and clears it
+    void writeBatch(uint8_t *buffer);
+    void dropBatch();
+private:
+    bool streaming = false;
+    nonstd::optional<absolute_time_t> stopAt;
+
+    ShotSample samples[SHOT_STREAM_MAX_SAMPLES];
+    uint8_t sampleCount = 0;
+    uint16_t droppedSamples = 0;
+
+    uint16_t shotId = 0;
+    uint16_t batchSequence = 0;
+
+    void clearBatch();
+};
+
+
+#endif //FIRMWARE_ARDUINO_SHOTSTREAMER_H
@@ -0,0 +1,207 @@
+#include "StatusHttpServer.h"
+#include <cstdio>
+#include <cstring>
+
+void StatusHttpServer::setRenderer(StatusHttpRenderer _renderer) {
+    renderer = _renderer;
+}
+
+void StatusHttpServer::loop(bool linkUp) {
+    if (!linkUp) {
+        // The sockets went away with the link, so there's nothing to stop
+        listening = false;
+        clientState = STATUS_HTTP_CLIENT_NONE;
+        client = WiFiClient();
+        return;
+    }
+
+    if (!listening) {
+        DEBUGV("Starting status HTTP server\n");
+        server.begin();
+        listening = true;
+    }
+
+    if (clientState == STATUS_HTTP_CLIENT_NONE) {
+        client = server.available();
+
+        if (!client) {
+            return;
+        }
+
+        clientState = STATUS_HTTP_CLIENT_READING;
+        requestLineLength = 0;
+        clientDeadline = make_timeout_time_ms(STATUS_HTTP_CLIENT_TIMEOUT_MS);
+    }
+
+    if (absolute_time_diff_us(clientDeadline, get_absolute_time()) > 0) {
+        DEBUGV("Dropping slow status HTTP client\n");
+        return closeClient();
+    }
+
+    switch (clientState) {
+        case STATUS_HTTP_CLIENT_READING:
+            return readRequest();
+        case STATUS_HTTP_CLIENT_WRITING:
+            return writeResponse();
+        case STATUS_HTTP_CLIENT_NONE:
+            return;
+    }
+}
+
+/*
+ * Only the request line matters. The headers that follow are discarded while the response is written.
+ */
+void StatusHttpServer::readRequest() {
+    if (!client.connected()) {
+        return closeClient();
+    }
+
+    uint8_t chunk[64];
+    size_t budget = STATUS_HTTP_SLICE_BYTES;
+
+    while (budget > 0 && client.available() > 0) {
+        int length = client.read(chunk, budget < sizeof(chunk) ? budget : sizeof(chunk));
+
+        if (length <= 0) {
+            return;
+        }
+
+        budget -= length;
+
+        for (int i = 0; i < length; i++) {
+            if (chunk[i] == '\n') {
+                requestLine[requestLineLength] = '\0';
+                return respond();
+            }
+
+            // Overlong request lines are truncated, and end up as a 404
+            if (chunk[i] != '\r' && requestLineLength < sizeof(requestLine) - 1) {
+                requestLine[requestLineLength++] = (char)chunk[i];
+            }
+        }
+    }
+}
+
+void StatusHttpServer::respond() {
+    requests++;
+
+    char* method = requestLine;
+    char* path = strchr(requestLine, ' ');
+
+    if (path == nullptr) {
+        static const char badRequest[] = "Bad request\n";
+        return prepareResponse("400 Bad Request", "text/plain", badRequest, sizeof(badRequest) - 1);
+    }
+
+    *path++ = '\0';
+    path[strcspn(path, " ?")] = '\0';
+
+    if (strcmp(method, "GET") != 0) {
+        static const char methodNotAllowed[] = "Method not allowed\n";
+        return prepareResponse("405 Method Not Allowed", "text/plain", methodNotAllowed, sizeof(methodNotAllowed) - 1);
+    }
+
+    StatusHttpResource resource;
+    const char* contentType;
+
+    if (strcmp(path, "/") == 0 || strcmp(path, "/status") == 0) {
+        resource = STATUS_HTTP_RESOURCE_STATUS;
+        contentType = "application/json";
+    } else if (strcmp(path, "/metrics") == 0) {
+        resource = STATUS_HTTP_RESOURCE_METRICS;
+        contentType = "text/plain; version=0.0.4";
+    } else if (strcmp(path, "/faults") == 0) {
+        resource = STATUS_HTTP_RESOURCE_FAULTS;
+        contentType = "application/json";
+    } else if (strcmp(path, "/blackbox") == 0) {
+        resource = STATUS_HTTP_RESOURCE_BLACK_BOX;
+        contentType = "application/octet-stream";
+    } else if (strcmp(path, "/profile") == 0) {
+        resource = STATUS_HTTP_RESOURCE_PROFILE;
+        contentType = "application/json";
+    } else {
+        static const char notFound[] = "Not found\n";
+        return prepareResponse("404 Not Found", "text/plain", notFound, sizeof(notFound) - 1);
+    }
+
+    if (!render(resource)) {
+        static const char renderFailed[] = "Couldn't render response\n";
+        return prepareResponse("500 Internal Server Error", "text/plain", renderFailed, sizeof(renderFailed) - 1);
+    }
+
+    prepareResponse("200 OK", contentType, body, bodyLength);
+}
+
+void StatusHttpServer::prepareResponse(const char *status, const char *contentType, const char *_responseBody, size_t length) {
+    int written = snprintf(header, sizeof(header), "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n", status, contentType, length);
+
+    headerLength = written > 0 && (size_t)written < sizeof(header) ? written : 0;
+    responseBody = _responseBody;
+    responseBodyLength = length;
+    responseSent = 0;
+
+    clientState = STATUS_HTTP_CLIENT_WRITING;
+    clientDeadline = make_timeout_time_ms(STATUS_HTTP_CLIENT_TIMEOUT_MS);
+}
+
+void StatusHttpServer::writeResponse() {
+    // Closing a socket with unread data resets the connection, which can cut the response short
+    uint8_t discard[64];
+    if (client.available() > 0) {
+        client.read(discard, sizeof(discard));
+    }
+
+    size_t total = headerLength + responseBodyLength;
+    size_t budget = STATUS_HTTP_SLICE_BYTES;
+
+    while (budget > 0 && responseSent < total) {
+        const char* from;
+        size_t remaining;
+
+        if (responseSent < headerLength) {
+            from = header + responseSent;
+            remaining = headerLength - responseSent;
+        } else {
+            from = responseBody + (responseSent - headerLength);
+            remaining = total - responseSent;
+        }
+
+        size_t written = client.write((const uint8_t*)from, remaining < budget ? remaining : budget);
+
+        // The module's buffers are full, try again next loop
+        if (written == 0) {
+            return;
+        }
+
+        responseSent += written;
+        budget -= written;
+    }
+
+    if (responseSent >= total) {
+        closeClient();
+    }
+}
+
+bool StatusHttpServer::render(StatusHttpResource resource) {
+    if (cachedResource.has_value() && cachedResource.value() == resource &&
+        absolute_time_diff_us(cachedAt, get_absolute_time()) < (int64_t)STATUS_HTTP_CACHE_MS * 1000) {
+        return true;
+    }
+
+    bodyLength = renderer ? renderer(resource, body, sizeof(body)) : 0;
+
+    if (bodyLength == 0) {
+        cachedResource.reset();
+        return false;
+    }
+
+    cachedResource = resource;
+    cachedAt = get_absolute_time();
+    return true;
+}
+
+void StatusHttpServer::closeClient() {
+    client.stop();
+    client = WiFiClient();
+    clientState = STATUS_HTTP_CLIENT_NONE;
+}
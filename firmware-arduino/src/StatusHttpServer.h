@@ -0,0 +1,90 @@
+#ifndef FIRMWARE_ARDUINO_STATUSHTTPSERVER_H
+#define FIRMWARE_ARDUINO_STATUSHTTPSERVER_H
+
+#include <WiFiNINA_Pinout_Generic.h>
+#include <WiFi_Generic.h>
+#include <functional>
+#include <pico/time.h>
+#include "optional.hpp"
+
+#define STATUS_HTTP_PORT 80
+
+#define STATUS_HTTP_BUFFER_SIZE 4096
+#define STATUS_HTTP_REQUEST_LINE_SIZE 96
+#define STATUS_HTTP_HEADER_SIZE 160
+
+// At most this much is read or written per loop, so that a slow client can't hold up core 1
+#define STATUS_HTTP_SLICE_BYTES 512
+
+// Clients that haven't sent their request or taken their response by then are dropped
+#define STATUS_HTTP_CLIENT_TIMEOUT_MS 2000
+
+// Polling faster than this gets the same rendering back
+#define STATUS_HTTP_CACHE_MS 1000
+
+typedef enum : uint8_t {
+    STATUS_HTTP_RESOURCE_STATUS,   // GET / or /status, JSON
+    STATUS_HTTP_RESOURCE_METRICS,  // GET /metrics, Prometheus text format
+    STATUS_HTTP_RESOURCE_FAULTS,   // GET /faults, JSON
+    STATUS_HTTP_RESOURCE_BLACK_BOX, // GET /blackbox, binary, see BlackBox.h
+    STATUS_HTTP_RESOURCE_PROFILE,  // GET /profile, JSON, see LoopProfiler.h
+} StatusHttpResource;
+
+// Renders a resource into the buffer and returns its length, or 0 if it didn't fit
+typedef std::function<size_t(StatusHttpResource resource, char* buffer, size_t size)> StatusHttpRenderer;
+
+/*
+ * A minimal HTTP/1.0 server for local dashboards in normal mode. It serves one client at a time and never blocks:
+ * the request is read and the response written in slices spread over consecutive loops. Responses are rendered into a
+ * preallocated buffer and cached for a second, so polling clients don't cost a rendering each.
+ */
+class StatusHttpServer {
+public:
+    void setRenderer(StatusHttpRenderer renderer);
+
+    // Starts listening once the link is up. The module forgets its sockets when the link goes down.
+    void loop(bool linkUp);
+
+    inline uint32_t getRequests() const { return requests; }
+private:
+    typedef enum : uint8_t {
+        STATUS_HTTP_CLIENT_NONE,
+        STATUS_HTTP_CLIENT_READING,
+        STATUS_HTTP_CLIENT_WRITING,
+    } ClientState;
+
+    StatusHttpRenderer renderer;
+
+    WiFiServer server = WiFiServer(STATUS_HTTP_PORT);
+    WiFiClient client;
+    bool listening = false;
+
+    ClientState clientState = STATUS_HTTP_CLIENT_NONE;
+    absolute_time_t clientDeadline = nil_time;
+
+    char requestLine[STATUS_HTTP_REQUEST_LINE_SIZE];
+    size_t requestLineLength = 0;
+
+    char header[STATUS_HTTP_HEADER_SIZE];
+    size_t headerLength = 0;
+    const char* responseBody = nullptr;
+    size_t responseBodyLength = 0;
+    size_t responseSent = 0;
+
+    char body[STATUS_HTTP_BUFFER_SIZE];
+    size_t bodyLength = 0;
+    nonstd::optional<StatusHttpResource> cachedResource;
+    absolute_time_t cachedAt = nil_time;
+
+    uint32_t requests = 0;
+
+    void readRequest();
+    void respond();
+    void writeResponse();
+    void prepareResponse(const char* status, const char* contentType, const char* responseBody, size_t length);
+    bool render(StatusHttpResource resource);
+    void closeClient();
+};
+
+
+#endif //FIRMWARE_ARDUINO_STATUSHTTPSERVER_H
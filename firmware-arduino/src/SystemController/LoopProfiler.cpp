@@ -0,0 +1,149 @@
+#include "LoopProfiler.h"
+#include <cstdio>
+
+// Values below 4 us get a bucket each. Above that, every power of two is split in four.
+static uint8_t bucketIndex(uint32_t us) {
+    if (us < 4) {
+        return us;
+    }
+
+    uint8_t msb = 31 - __builtin_clz(us);
+    uint32_t index = (msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+
+    return index < LOOP_PROFILER_BUCKETS ? index : LOOP_PROFILER_BUCKETS - 1;
+}
+
+static uint32_t bucketUpperBound(uint8_t index) {
+    if (index < 4) {
+        return index;
+    }
+
+    uint8_t msb = index / 4 + 1;
+    return ((uint32_t)(4 + index % 4 + 1) << (msb - 2)) - 1;
+}
+
+void ProfileStageStats::add(uint32_t us) {
+    samples++;
+    sum += us;
+
+    if (us < min) {
+        min = us;
+    }
+
+    if (us > max) {
+        max = us;
+    }
+
+    uint16_t &bucket = buckets[bucketIndex(us)];
+
+    if (bucket < UINT16_MAX) {
+        bucket++;
+    }
+}
+
+void ProfileStageStats::reset() {
+    *this = ProfileStageStats();
+}
+
+uint32_t ProfileStageStats::getPercentile(uint8_t percentile) const {
+    if (samples == 0) {
+        return 0;
+    }
+
+    // The rank of the sample at the percentile, rounded up
+    uint32_t rank = (samples * percentile + 99) / 100;
+    uint32_t seen = 0;
+
+    for (uint8_t i = 0; i < LOOP_PROFILER_BUCKETS; i++) {
+        seen += buckets[i];
+
+        if (seen >= rank) {
+            // The last bucket is open ended, and nothing is above the max anyway
+            uint32_t bound = i < LOOP_PROFILER_BUCKETS - 1 ? bucketUpperBound(i) : max;
+            return bound < max ? bound : max;
+        }
+    }
+
+    return max;
+}
+
+bool LoopProfiler::endCycle() {
+    for (uint8_t stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        if (cycleTouched & (1 << stage)) {
+            stats[stage].add(cycleTotals[stage]);
+            cycleTotals[stage] = 0;
+        }
+    }
+
+    cycleTouched = 0;
+
+    return ++cycles >= LOOP_PROFILER_REPORT_CYCLES;
+}
+
+void LoopProfiler::report(LoopProfileReport &report) {
+    report.cycles = cycles;
+
+    for (uint8_t stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        report.stages[stage] = LoopProfileStageReport{stats[stage].getMin(), stats[stage].getMean(),
+                                                      stats[stage].getPercentile(99), stats[stage].getMax()};
+        stats[stage].reset();
+    }
+
+    cycles = 0;
+}
+
+/*
+ * {"n":cycles,"s":{"stage":[min us,mean us,p99 us,max us],...}}
+ */
+size_t LoopProfiler::render(const LoopProfileReport &report, char *buffer, size_t size) {
+    int written = snprintf(buffer, size, "{\"n\":%u,\"s\":{", report.cycles);
+    size_t position = 0;
+
+    // Without any cycles, there's nothing to show for the stages
+    for (uint8_t stage = 0; stage < PROFILE_STAGE_COUNT && report.cycles > 0 && written > 0 && position + written < size; stage++) {
+        position += written;
+
+        const LoopProfileStageReport &stageReport = report.stages[stage];
+        written = snprintf(buffer + position, size - position, "%s\"%s\":[%lu,%lu,%lu,%lu]", stage > 0 ? "," : "",
+                           getStageName((ProfileStage)stage), (unsigned long)stageReport.min,
+                           (unsigned long)stageReport.mean, (unsigned long)stageReport.p99, (unsigned long)stageReport.max);
+    }
+
+    if (written > 0 && position + written < size) {
+        position += written;
+        written = snprintf(buffer + position, size - position, "}}");
+    }
+
+    if (written <= 0 || position + written >= size) {
+        return 0;
+    }
+
+    return position + written;
+}
+
+const char *LoopProfiler::getStageName(ProfileStage stage) {
+    switch (stage) {
+        case PROFILE_STAGE_CYCLE:
+            return "cycle";
+        case PROFILE_STAGE_VALIDATION:
+            return "validation";
+        case PROFILE_STAGE_UART_WRITE:
+            return "uart_write";
+        case PROFILE_STAGE_UART_READ:
+            return "uart_read";
+        case PROFILE_STAGE_PARSE:
+            return "parse";
+        case PROFILE_STAGE_HANDLE_COMMANDS:
+            return "handle_commands";
+        case PROFILE_STAGE_CONTROL:
+            return "control";
+        case PROFILE_STAGE_STATUS_ENQUEUE:
+            return "status_enqueue";
+        case PROFILE_STAGE_BLACK_BOX:
+            return "black_box";
+        case PROFILE_STAGE_COUNT:
+            break;
+    }
+
+    return "unknown";
+}
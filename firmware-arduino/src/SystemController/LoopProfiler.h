@@ -0,0 +1,113 @@
+#ifndef FIRMWARE_ARDUINO_LOOPPROFILER_H
+#define FIRMWARE_ARDUINO_LOOPPROFILER_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Stage timings are aggregated over this many cycles, i.e. a minute, then reported and reset
+#define LOOP_PROFILER_REPORT_CYCLES 600
+
+// Four buckets per power of two, up to 2^18 us. Percentiles are therefore accurate to within 25%.
+#define LOOP_PROFILER_BUCKETS 68
+
+// Defaults to the RP2040 timer. A host build can provide its own microsecond clock.
+#ifndef LOOP_PROFILER_CLOCK_US
+#include <pico/time.h>
+#define LOOP_PROFILER_CLOCK_US() time_us_32()
+#endif
+
+typedef enum : uint8_t {
+    PROFILE_STAGE_CYCLE,            // Everything but the sleep until the next cycle
+    PROFILE_STAGE_VALIDATION,
+    PROFILE_STAGE_UART_WRITE,
+    PROFILE_STAGE_UART_READ,        // Mostly waiting for the control board to answer
+    PROFILE_STAGE_PARSE,
+    PROFILE_STAGE_HANDLE_COMMANDS,
+    PROFILE_STAGE_CONTROL,          // handleControlBoardPacket()
+    PROFILE_STAGE_STATUS_ENQUEUE,
+    PROFILE_STAGE_BLACK_BOX,
+    PROFILE_STAGE_COUNT,
+} ProfileStage;
+
+// A stage's timings over one report, in us
+struct LoopProfileStageReport {
+    uint32_t min;
+    uint32_t mean;
+    uint32_t p99;
+    uint32_t max;
+};
+
+// What core 0 hands core 1 once a report is due
+struct LoopProfileReport {
+    uint16_t cycles;
+    LoopProfileStageReport stages[PROFILE_STAGE_COUNT];
+};
+
+/*
+ * Timings of one stage. Min, mean and max are exact, while percentiles come from a log scale histogram, so that
+ * aggregating never allocates or sorts.
+ */
+class ProfileStageStats {
+public:
+    void add(uint32_t us);
+    void reset();
+
+    inline uint32_t getSamples() const { return samples; }
+    inline uint32_t getMin() const { return samples > 0 ? min : 0; }
+    inline uint32_t getMax() const { return max; }
+    inline uint32_t getMean() const { return samples > 0 ? (uint32_t)(sum / samples) : 0; }
+    // The upper bound of the bucket the percentile falls in
+    uint32_t getPercentile(uint8_t percentile) const;
+private:
+    uint32_t samples = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t sum = 0;
+    uint16_t buckets[LOOP_PROFILER_BUCKETS]{};
+};
+
+/*
+ * Where core 0's cycle goes. Stages may be timed more than once per cycle, e.g. validation before sending and after
+ * receiving, and are added up into one sample per cycle.
+ */
+class LoopProfiler {
+public:
+    inline void begin(ProfileStage stage) { stageStarts[stage] = LOOP_PROFILER_CLOCK_US(); }
+    inline void end(ProfileStage stage) { add(stage, LOOP_PROFILER_CLOCK_US() - stageStarts[stage]); }
+    inline void add(ProfileStage stage, uint32_t us) { cycleTotals[stage] += us; cycleTouched |= 1 << stage; }
+    // Returns true once a report is due. The stats are reset after reporting.
+    bool endCycle();
+    void report(LoopProfileReport &report);
+
+    // Renders a report as JSON. Returns the length, or 0 if it doesn't fit.
+    static size_t render(const LoopProfileReport &report, char* buffer, size_t size);
+
+    inline const ProfileStageStats &getStats(ProfileStage stage) const { return stats[stage]; }
+    static const char* getStageName(ProfileStage stage);
+private:
+    ProfileStageStats stats[PROFILE_STAGE_COUNT];
+    uint32_t stageStarts[PROFILE_STAGE_COUNT]{};
+    uint32_t cycleTotals[PROFILE_STAGE_COUNT]{};
+    uint16_t cycleTouched = 0;
+    uint16_t cycles = 0;
+};
+
+static_assert(PROFILE_STAGE_COUNT <= 16, "Touched stages are kept in a uint16_t");
+
+/*
+ * Builds with CONTROL_LOOP_PROFILING defined time the stages of SystemController::loop(), and hand a report to core 1
+ * through the reports queue once a minute. Core 1 serves it on /profile. Otherwise these are no-ops.
+ */
+#ifdef CONTROL_LOOP_PROFILING
+#define PROFILE_BEGIN(profiler, stage) (profiler).begin(stage)
+#define PROFILE_END(profiler, stage) (profiler).end(stage)
+// A report is dropped if core 1 hasn't taken the previous one, which it has a minute to do
+#define PROFILE_END_CYCLE(profiler, reports) do { if ((profiler).endCycle()) { LoopProfileReport _report; (profiler).report(_report); (reports).tryAdd(&_report); } } while (0)
+#else
+#define PROFILE_BEGIN(profiler, stage) do {} while (0)
+#define PROFILE_END(profiler, stage) do {} while (0)
+#define PROFILE_END_CYCLE(profiler, reports) do {} while (0)
+#endif
+
+
+#endif //FIRMWARE_ARDUINO_LOOPPROFILER_H
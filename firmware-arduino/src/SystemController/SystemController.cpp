@@ -4,9 +4,11 @@
 
 #include "../utils/hex_format.h"
 #include "SystemController.h"
+#include "../BlackBox.h"
 #include <hardware/watchdog.h>
 #include "pico/timeout_helper.h"
 #include <cmath>
+#include <cstring>
 #include <pico/multicore.h>
 #include <hardware/timer.h>
 #include <hardware/irq.h>
@@ -14,6 +16,8 @@
 
 extern "C" void main1();
 
+volatile uint32_t core1Relaunches = 0;
+
 static inline bool uart_read_blocking_timeout(uart_inst_t *uart, uint8_t *dst, size_t len, absolute_time_t timeout_time) {
     timeout_state_t ts;
     check_timeout_fn timeout_check = init_single_timeout_until(&ts, timeout_time);
@@ -63,11 +67,15 @@ void SystemController::loop() {
     if (core1RebootTimer.has_value() && absolute_time_diff_us(core1RebootTimer.value(), get_absolute_time()) > 0) {
         DEBUGV("Resetting Core1\n");
         multicore_reset_core1();
+        core1Relaunches++;
         multicore_launch_core1(main1);
         DEBUGV("Reset done\n");
         core1RebootTimer = make_timeout_time_ms(5000);
     }
 
+        uint32_t cycleStartUs = time_us_32();
+        PROFILE_BEGIN(profiler, PROFILE_STAGE_CYCLE);
+
         if(uart_is_readable(uart)) {
 //            printf("There's cruft inside the UART. That's weird. Wait a little. Clear that out, and wait a little.\n");
             sleep_ms(50);
@@ -78,6 +86,7 @@ void SystemController::loop() {
 //            printf("We're getting on with it.\n");
         }
 
+        PROFILE_BEGIN(profiler, PROFILE_STAGE_VALIDATION);
         LccRawPacket rawLccPacket = convert_lcc_parsed_to_raw(currentLccParsedPacket);
         uint16_t lccValidation = validate_lcc_raw_packet(rawLccPacket);
         if (lccValidation) {
@@ -85,22 +94,30 @@ void SystemController::loop() {
 
 //            printf("LCC Invalid: 0x%4x\n", lccValidation);
         }
+        PROFILE_END(profiler, PROFILE_STAGE_VALIDATION);
+
+        bool sentSafePacket = onlySendSafePackages();
 
-        if (onlySendSafePackages()) {
+        PROFILE_BEGIN(profiler, PROFILE_STAGE_UART_WRITE);
+        if (sentSafePacket) {
             uart_write_blocking(uart, (uint8_t *)&safeLccRawPacket, sizeof(safeLccRawPacket));
         } else {
             uart_write_blocking(uart, (uint8_t *)&rawLccPacket, sizeof(rawLccPacket));
         }
+        PROFILE_END(profiler, PROFILE_STAGE_UART_WRITE);
 
         // This timeout is used both as a timeout for reading from the UART and to know when to send the next packet.
         auto timeout = make_timeout_time_ms(100);
 
+        PROFILE_BEGIN(profiler, PROFILE_STAGE_UART_READ);
         bool success = uart_read_blocking_timeout(uart, reinterpret_cast<uint8_t *>(&currentControlBoardRawPacket), sizeof(currentControlBoardRawPacket), timeout);
+        PROFILE_END(profiler, PROFILE_STAGE_UART_READ);
 
         if (!success) {
             softBail(BAIL_REASON_CB_UNRESPONSIVE);
         }
 
+        PROFILE_BEGIN(profiler, PROFILE_STAGE_VALIDATION);
         uint16_t cbValidation = validate_raw_packet(currentControlBoardRawPacket);
 
         if (cbValidation) {
@@ -108,6 +125,7 @@ void SystemController::loop() {
 
 //            printf("CB Invalid: 0x%4x\n", cbValidation);
         }
+        PROFILE_END(profiler, PROFILE_STAGE_VALIDATION);
 
         if (isBailed()) {
             if (isSoftBailed()) {
@@ -120,7 +138,9 @@ void SystemController::loop() {
                 }
             }
         } else {
+            PROFILE_BEGIN(profiler, PROFILE_STAGE_PARSE);
             currentControlBoardParsedPacket = convert_raw_control_board_packet(currentControlBoardRawPacket);
+            PROFILE_END(profiler, PROFILE_STAGE_PARSE);
 
             if (sleepModeRequested && internalState != SLEEPING) {
                 setSleepMode(true);
@@ -145,17 +165,27 @@ void SystemController::loop() {
             }
         }
 
+        BlackBoxEntry blackBoxEntry{};
+        blackBoxEntry.cycleStartUs = cycleStartUs;
+        memcpy(blackBoxEntry.controlBoardPacket, &currentControlBoardRawPacket, sizeof(blackBoxEntry.controlBoardPacket));
+        memcpy(blackBoxEntry.lccPacket, sentSafePacket ? &safeLccRawPacket : &rawLccPacket, sizeof(blackBoxEntry.lccPacket));
+
         // Reset the current raw packet.
         currentControlBoardRawPacket = ControlBoardRawPacket();
 
+        PROFILE_BEGIN(profiler, PROFILE_STAGE_HANDLE_COMMANDS);
         handleCommands();
+        PROFILE_END(profiler, PROFILE_STAGE_HANDLE_COMMANDS);
 
+        PROFILE_BEGIN(profiler, PROFILE_STAGE_CONTROL);
         if (!isBailed()) {
             currentLccParsedPacket = handleControlBoardPacket(currentControlBoardParsedPacket);
         } else {
             currentLccParsedPacket = convert_lcc_raw_to_parsed(safeLccRawPacket);
         }
+        PROFILE_END(profiler, PROFILE_STAGE_CONTROL);
 
+        PROFILE_BEGIN(profiler, PROFILE_STAGE_STATUS_ENQUEUE);
         SystemControllerStatusMessage message = {
                 .timestamp = get_absolute_time(),
                 .brewTemperature = static_cast<float>(brewTempAverage.average()),
@@ -177,7 +207,9 @@ void SystemController::loop() {
                 .lastSleepModeExitAt = lastSleepModeExitAt
         };
 
-        if (!outgoingQueue->isFull()) {
+        bool statusQueueFull = outgoingQueue->isFull();
+
+        if (!statusQueueFull) {
             core1RebootTimer.reset();
             outgoingQueue->tryAdd(&message);
         } else {
@@ -186,6 +218,25 @@ void SystemController::loop() {
                 core1RebootTimer = make_timeout_time_ms(2000);
             }
         }
+        PROFILE_END(profiler, PROFILE_STAGE_STATUS_ENQUEUE);
+
+        PROFILE_BEGIN(profiler, PROFILE_STAGE_BLACK_BOX);
+        blackBoxEntry.cycleEndUs = time_us_32();
+        // The averages are NaN until the first packet has been handled
+        blackBoxEntry.brewTemperature = std::isfinite(message.brewTemperature) ? (int16_t)(message.brewTemperature * 10.f) : INT16_MIN;
+        blackBoxEntry.serviceTemperature = std::isfinite(message.serviceTemperature) ? (int16_t)(message.serviceTemperature * 10.f) : INT16_MIN;
+        blackBoxEntry.internalState = internalState;
+        blackBoxEntry.bailReason = bail_reason;
+        blackBoxEntry.flags = (success ? BLACK_BOX_FLAG_CONTROL_BOARD_RESPONDED : 0) |
+                              (message.brewSSRActive ? BLACK_BOX_FLAG_BREW_SSR_ON : 0) |
+                              (message.serviceSSRActive ? BLACK_BOX_FLAG_SERVICE_SSR_ON : 0) |
+                              (sentSafePacket ? BLACK_BOX_FLAG_SAFE_PACKET_SENT : 0) |
+                              (statusQueueFull ? BLACK_BOX_FLAG_STATUS_QUEUE_FULL : 0);
+        black_box_record(blackBoxEntry);
+        PROFILE_END(profiler, PROFILE_STAGE_BLACK_BOX);
+
+        PROFILE_END(profiler, PROFILE_STAGE_CYCLE);
+        PROFILE_END_CYCLE(profiler, profileReports);
 
         sleep_until(timeout);
 }
@@ -342,6 +393,7 @@ void SystemController::handleCommands() {
             case COMMAND_TRIGGER_FIRST_RUN:
                 break;
             case COMMAND_BEGIN:
+                black_box_begin();
                 readyToGo = true;
                 break;
         }
@@ -10,6 +10,7 @@
 #include "TimedLatch.h"
 #include "HysteresisController.h"
 #include "HybridController.h"
+#include "LoopProfiler.h"
 #include <queue>
 #include "../types.h"
 #include <hardware/uart.h>
@@ -17,6 +18,10 @@
 #include "../utils/PicoQueue.h"
 #include "../utils/MovingAverage.h"
 
+// How often core 0 has reset and relaunched core 1 since the chip booted. Zeroed by the C runtime on every chip boot,
+// and left alone by a relaunch, so core 1's setup can tell the two apart.
+extern volatile uint32_t core1Relaunches;
+
 typedef enum {
     UNDETERMINED,
     HEATUP_STAGE_1, // Bring the Brew boiler up to 130, don't run the service boiler
@@ -48,6 +53,11 @@ public:
 
     void init();
     void loop();
+
+#ifdef CONTROL_LOOP_PROFILING
+    // Called by core 1. Returns false if no report has come in since the last call.
+    inline bool takeProfileReport(LoopProfileReport &report) { return profileReports.tryRemove(&report); }
+#endif
 private:
     SystemControllerBailReason bail_reason = BAIL_REASON_NONE;
     SystemControllerInternalState internalState = UNDETERMINED;
@@ -119,6 +129,11 @@ private:
 
     PicoQueue<SsrState> ssrStateQueue = PicoQueue<SsrState>(25);
 
+#ifdef CONTROL_LOOP_PROFILING
+    LoopProfiler profiler;
+    PicoQueue<LoopProfileReport> profileReports = PicoQueue<LoopProfileReport>(1);
+#endif
+
     TimedLatch waterTankEmptyLatch = TimedLatch(1000, false);
     TimedLatch serviceBoilerLowLatch = TimedLatch(500, false);
 
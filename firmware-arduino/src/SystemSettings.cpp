@@ -3,13 +3,16 @@
 //
 
 #include "SystemSettings.h"
-#include <CRC32.h>
 #include <hardware/watchdog.h>
 
+// Settings were kept as a single struct before the journal, and are migrated from there once
 #define SETTING_FILENAME ("/fs/settings.dat")
-#define SETTING_VERSION ((uint8_t)5)
 
-SystemSettings::SystemSettings(PicoQueue<SystemControllerCommand> *commandQueue, FileIO* fileIO): _commandQueue(commandQueue), _fileIO(fileIO) {
+#define SETTING_JOURNAL_FILENAME ("/fs/settings.jnl")
+#define SETTING_JOURNAL_COMPACTION_FILENAME ("/fs/settings.jnl.tmp")
+
+SystemSettings::SystemSettings(PicoQueue<SystemControllerCommand> *commandQueue, FileIO* fileIO):
+    _commandQueue(commandQueue), journal(fileIO, SETTING_JOURNAL_FILENAME, SETTING_JOURNAL_COMPACTION_FILENAME) {
 
 }
 
@@ -19,7 +22,7 @@ void SystemSettings::initialize() {
     // If we've reset due to the watchdog or for some other reason, use the previous sleep mode setting, otherwise reset it to false
     if (currentSettings.sleepMode && !watchdog_enable_caused_reboot() && to_ms_since_boot(get_absolute_time()) < 20000) {
         currentSettings.sleepMode = false;
-        writeSettings();
+        markDirty();
     }
 
     // This is run before core1 is launched, and the System controller processes all commands before starting to
@@ -32,50 +35,98 @@ void SystemSettings::initialize() {
     sendCommand(COMMAND_SET_SERVICE_SET_POINT, currentSettings.serviceTemperatureTarget);
 }
 
-void SystemSettings::setBrewTemperatureOffset(float offset) {
+bool SystemSettings::setBrewTemperatureOffset(float offset) {
+    if (currentSettings.brewTemperatureOffset == offset) {
+        return false;
+    }
+
     currentSettings.brewTemperatureOffset = offset;
-    writeSettings();
+    markDirty();
+    return true;
 }
 
-void SystemSettings::setAutoSleepMin(uint16_t minutes) {
+bool SystemSettings::setAutoSleepMin(uint16_t minutes) {
+    if (currentSettings.autoSleepMin == minutes) {
+        return false;
+    }
+
     currentSettings.autoSleepMin = minutes;
-    writeSettings();
+    markDirty();
+    return true;
 }
 
-void SystemSettings::setEcoMode(bool _ecoMode) {
-    currentSettings.ecoMode = _ecoMode;
-    writeSettings();
+// The commands below are sent even when nothing changed, so the system controller always ends up with the setting
+
+bool SystemSettings::setEcoMode(bool _ecoMode) {
+    bool changed = currentSettings.ecoMode != _ecoMode;
+
+    if (changed) {
+        currentSettings.ecoMode = _ecoMode;
+        markDirty();
+    }
+
     sendCommand(COMMAND_SET_ECO_MODE, _ecoMode);
+    return changed;
 }
 
-void SystemSettings::setSleepMode(bool _sleepMode) {
-    currentSettings.sleepMode = _sleepMode;
-    writeSettings();
+bool SystemSettings::setSleepMode(bool _sleepMode) {
+    bool changed = currentSettings.sleepMode != _sleepMode;
+
+    if (changed) {
+        currentSettings.sleepMode = _sleepMode;
+        markDirty();
+    }
+
     sendCommand(COMMAND_SET_SLEEP_MODE, _sleepMode);
+    return changed;
 }
 
-void SystemSettings::setTargetBrewTemp(float targetBrew) {
-    currentSettings.brewTemperatureTarget = targetBrew;
-    writeSettings();
+bool SystemSettings::setTargetBrewTemp(float targetBrew) {
+    bool changed = currentSettings.brewTemperatureTarget != targetBrew;
+
+    if (changed) {
+        currentSettings.brewTemperatureTarget = targetBrew;
+        markDirty();
+    }
+
     sendCommand(COMMAND_SET_BREW_SET_POINT, targetBrew);
+    return changed;
 }
 
-void SystemSettings::setTargetServiceTemp(float targetServiceTemp) {
-    currentSettings.serviceTemperatureTarget = targetServiceTemp;
-    writeSettings();
+bool SystemSettings::setTargetServiceTemp(float targetServiceTemp) {
+    bool changed = currentSettings.serviceTemperatureTarget != targetServiceTemp;
+
+    if (changed) {
+        currentSettings.serviceTemperatureTarget = targetServiceTemp;
+        markDirty();
+    }
+
     sendCommand(COMMAND_SET_SERVICE_SET_POINT, targetServiceTemp);
+    return changed;
 }
 
-void SystemSettings::setBrewPidParameters(PidSettings params) {
-    currentSettings.brewPidParameters = params;
-    writeSettings();
+bool SystemSettings::setBrewPidParameters(PidSettings params) {
+    bool changed = currentSettings.brewPidParameters != params;
+
+    if (changed) {
+        currentSettings.brewPidParameters = params;
+        markDirty();
+    }
+
     sendCommand(COMMAND_SET_BREW_PID_PARAMETERS, params);
+    return changed;
 }
 
-void SystemSettings::setServicePidParameters(PidSettings params) {
-    currentSettings.servicePidParameters = params;
-    writeSettings();
+bool SystemSettings::setServicePidParameters(PidSettings params) {
+    bool changed = currentSettings.servicePidParameters != params;
+
+    if (changed) {
+        currentSettings.servicePidParameters = params;
+        markDirty();
+    }
+
     sendCommand(COMMAND_SET_SERVICE_PID_PARAMETERS, params);
+    return changed;
 }
 
 void SystemSettings::sendCommand(SystemControllerCommandType commandType, bool value) {
@@ -112,17 +163,77 @@ void SystemSettings::sendCommandObject(SystemControllerCommand command) {
 }
 
 void SystemSettings::readSettings() {
-    nonstd::optional<SettingStruct> settings = _fileIO->readSystemSettings(SETTING_FILENAME, SETTING_VERSION);
+    currentSettings = SettingStruct{};
 
-    if (!settings.has_value()) {
-        currentSettings = SettingStruct{};
+    if (journal.replay(currentSettings)) {
+        DEBUGV("Replayed %u settings records (%u rejected)\n", journal.getReplayedRecords(), journal.getRejectedRecords());
+    } else if (journal.importLegacy(SETTING_FILENAME, currentSettings)) {
+        DEBUGV("Migrated settings to the journal\n");
     } else {
-        currentSettings = settings.value();
+        journal.compact(currentSettings);
     }
+
+    persistedSettings = currentSettings;
 }
 
-void SystemSettings::writeSettings() {
-    if (!_fileIO->saveSystemSettings(currentSettings, SETTING_FILENAME, SETTING_VERSION)) {
+bool SystemSettings::writeSettings() {
+    flashWrites++;
+
+    if (!journal.commit(persistedSettings, currentSettings)) {
         DEBUGV("Unable to save system settings\n");
+        return false;
+    }
+
+    persistedSettings = currentSettings;
+    return true;
+}
+
+void SystemSettings::markDirty() {
+    if (dirty) {
+        coalescedChanges++;
+    } else {
+        dirty = true;
+        persistDeadline = make_timeout_time_ms(SETTINGS_PERSIST_MAX_DELAY_MS);
+    }
+
+    persistAt = make_timeout_time_ms(SETTINGS_PERSIST_DEBOUNCE_MS);
+}
+
+static bool settings_equal(const SettingStruct &a, const SettingStruct &b) {
+    return a.brewTemperatureOffset == b.brewTemperatureOffset &&
+           a.sleepMode == b.sleepMode &&
+           a.ecoMode == b.ecoMode &&
+           a.brewTemperatureTarget == b.brewTemperatureTarget &&
+           a.serviceTemperatureTarget == b.serviceTemperatureTarget &&
+           a.autoSleepMin == b.autoSleepMin &&
+           a.brewPidParameters == b.brewPidParameters &&
+           a.servicePidParameters == b.servicePidParameters;
+}
+
+void SystemSettings::loop() {
+    if (!dirty) {
+        return;
+    }
+
+    absolute_time_t now = get_absolute_time();
+
+    if (absolute_time_diff_us(persistAt, now) < 0 && absolute_time_diff_us(persistDeadline, now) < 0) {
+        return;
+    }
+
+    if (settings_equal(currentSettings, persistedSettings) || writeSettings()) {
+        dirty = false;
+        persistRetryMs = SETTINGS_PERSIST_RETRY_MIN_MS;
+        return;
+    }
+
+    // Stay dirty, so a failed write isn't lost until some other setting changes. Back off, since flash that just
+    // failed is unlikely to work on the next pass.
+    persistAt = make_timeout_time_ms(persistRetryMs);
+    persistDeadline = persistAt;
+    if (persistRetryMs < SETTINGS_PERSIST_RETRY_MAX_MS / 2) {
+        persistRetryMs *= 2;
+    } else {
+        persistRetryMs = SETTINGS_PERSIST_RETRY_MAX_MS;
     }
 }
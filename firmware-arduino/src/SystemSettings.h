@@ -8,7 +8,23 @@
 #include "utils/PicoQueue.h"
 #include "types.h"
 #include "FileIO.h"
+#include "SettingsJournal.h"
+#include <pico/time.h>
 
+// Changes are applied right away, but only written to flash once they've settled for this long
+#define SETTINGS_PERSIST_DEBOUNCE_MS 2000
+
+// A steady stream of changes is still written at least this often
+#define SETTINGS_PERSIST_MAX_DELAY_MS 10000
+
+// A failed write is retried after this long, doubling on each further failure
+#define SETTINGS_PERSIST_RETRY_MIN_MS 1000
+#define SETTINGS_PERSIST_RETRY_MAX_MS 60000
+
+/*
+ * Settings live in RAM, and are sent to core 0 as soon as they change. Writing them to flash is left to loop(), which
+ * coalesces bursts of changes (e.g. the + button held down) into a single write.
+ */
 class SystemSettings {
 public:
     explicit SystemSettings(PicoQueue<SystemControllerCommand> *commandQueue, FileIO* fileIO);
@@ -16,25 +32,46 @@ public:
     void initialize();
 
     inline float getBrewTemperatureOffset() const { return currentSettings.brewTemperatureOffset; };
-    inline uint8_t getAutoSleepMin() const { return currentSettings.autoSleepMin; };
-
-    void setBrewTemperatureOffset(float offset);
-    void setEcoMode(bool ecoMode);
-    void setSleepMode(bool sleepMode);
-    void setTargetBrewTemp(float targetBrewTemp);
-    void setAutoSleepMin(uint16_t minutes);
-    inline void setOffsetTargetBrewTemp(float offsetTargetBrewTemp) { setTargetBrewTemp(offsetTargetBrewTemp - currentSettings.brewTemperatureOffset); };
-    void setTargetServiceTemp(float targetServiceTemp);
-    void setBrewPidParameters(PidSettings params);
-    void setServicePidParameters(PidSettings params);
+    inline uint16_t getAutoSleepMin() const { return currentSettings.autoSleepMin; };
+
+    // Setters return whether the value changed. Settings are only written when something changed.
+    bool setBrewTemperatureOffset(float offset);
+    bool setEcoMode(bool ecoMode);
+    bool setSleepMode(bool sleepMode);
+    bool setTargetBrewTemp(float targetBrewTemp);
+    bool setAutoSleepMin(uint16_t minutes);
+    inline bool setOffsetTargetBrewTemp(float offsetTargetBrewTemp) { return setTargetBrewTemp(offsetTargetBrewTemp - currentSettings.brewTemperatureOffset); };
+    bool setTargetServiceTemp(float targetServiceTemp);
+    bool setBrewPidParameters(PidSettings params);
+    bool setServicePidParameters(PidSettings params);
+
+    // Writes pending changes to flash once they're due. Called from core 1's loop.
+    void loop();
+
+    inline uint32_t getFlashWrites() const { return flashWrites; }
+    inline uint32_t getCoalescedChanges() const { return coalescedChanges; }
+    inline uint32_t getFlashBytesWritten() const { return journal.getBytesWritten(); }
+    inline uint32_t getJournalCompactions() const { return journal.getCompactions(); }
 private:
     PicoQueue<SystemControllerCommand> *_commandQueue;
 
-    FileIO* _fileIO;
+    SettingsJournal journal;
 
     SettingStruct currentSettings;
+    // What's on flash, so that changes that cancel out don't cause a write
+    SettingStruct persistedSettings;
+
+    bool dirty = false;
+    absolute_time_t persistAt = nil_time;
+    absolute_time_t persistDeadline = nil_time;
+    uint32_t persistRetryMs = SETTINGS_PERSIST_RETRY_MIN_MS;
+
+    uint32_t flashWrites = 0;
+    uint32_t coalescedChanges = 0;
+
     void readSettings();
-    void writeSettings();
+    bool writeSettings();
+    void markDirty();
 
     void sendCommand(SystemControllerCommandType commandType, bool value);
     void sendCommand(SystemControllerCommandType commandType, float value);
@@ -5,6 +5,7 @@
 #ifndef FIRMWARE_SYSTEMSTATUS_H
 #define FIRMWARE_SYSTEMSTATUS_H
 
+#include <Arduino.h>
 #include <pico/time.h>
 #include "SystemController/lcc_protocol.h"
 #include "SystemController/control_board_protocol.h"
@@ -64,6 +65,8 @@ public:
 
     inline absolute_time_t getLastSleepModeExitAt() const { return latestStatusMessage.lastSleepModeExitAt; };
 
+    inline const SystemControllerStatusMessage& getLatestStatusMessage() const { return latestStatusMessage; }
+
     void updateStatusMessage(SystemControllerStatusMessage message);
 private:
     SystemSettings* settings;
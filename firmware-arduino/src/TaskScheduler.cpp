@@ -0,0 +1,68 @@
+#include "TaskScheduler.h"
+
+void TaskScheduler::loop() {
+    absolute_time_t now = get_absolute_time();
+
+    if (is_nil_time(windowStart)) {
+        windowStart = now;
+    }
+
+    for (size_t i = 0; i < taskCount; i++) {
+        ScheduledTask &task = tasks[i];
+
+        if (task.periodUs > 0) {
+            now = get_absolute_time();
+
+            if (!is_nil_time(task.nextRunAt) && absolute_time_diff_us(now, task.nextRunAt) > 0) {
+                continue;
+            }
+        }
+
+        run(task, now);
+    }
+
+    now = get_absolute_time();
+
+    if (absolute_time_diff_us(windowStart, now) >= TASK_SCHEDULER_WINDOW_MS * 1000) {
+        closeWindow(now);
+    }
+}
+
+void TaskScheduler::run(ScheduledTask &task, absolute_time_t now) {
+    if (task.periodUs > 0) {
+        if (is_nil_time(task.nextRunAt)) {
+            task.nextRunAt = now;
+        }
+
+        int64_t lateness = absolute_time_diff_us(task.nextRunAt, now);
+
+        if (task.deadlineUs > 0 && lateness > task.deadlineUs) {
+            task.missedDeadlines++;
+        }
+
+        // A task that fell more than a period behind starts over, rather than running back to back to catch up
+        task.nextRunAt = lateness > task.periodUs ? delayed_by_us(now, task.periodUs) : delayed_by_us(task.nextRunAt, task.periodUs);
+    }
+
+    uint32_t start = time_us_32();
+    task.function();
+    uint32_t elapsed = time_us_32() - start;
+
+    task.runs++;
+    task.windowBusyUs += elapsed;
+
+    if (elapsed > task.maxRunUs) {
+        task.maxRunUs = elapsed;
+    }
+}
+
+void TaskScheduler::closeWindow(absolute_time_t now) {
+    auto window = (float)absolute_time_diff_us(windowStart, now);
+
+    for (size_t i = 0; i < taskCount; i++) {
+        tasks[i].cpuShare = (float)tasks[i].windowBusyUs / window;
+        tasks[i].windowBusyUs = 0;
+    }
+
+    windowStart = now;
+}
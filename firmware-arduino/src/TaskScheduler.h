@@ -0,0 +1,68 @@
+#ifndef FIRMWARE_ARDUINO_TASKSCHEDULER_H
+#define FIRMWARE_ARDUINO_TASKSCHEDULER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <pico/time.h>
+
+// CPU shares are measured over windows of this length
+#define TASK_SCHEDULER_WINDOW_MS 10000
+
+typedef void (*TaskFunction)();
+
+/*
+ * A task runs every pass of the scheduler if it has no period. Otherwise it runs once per period, and a run that
+ * starts more than the deadline after it was due counts as missed.
+ */
+class ScheduledTask {
+public:
+    ScheduledTask(const char* name, TaskFunction function, uint32_t periodMs = 0, uint32_t deadlineMs = 0):
+        name(name), function(function), periodUs(periodMs * 1000), deadlineUs(deadlineMs * 1000) {}
+
+    inline const char* getName() const { return name; }
+    inline uint32_t getRuns() const { return runs; }
+    inline uint32_t getMissedDeadlines() const { return missedDeadlines; }
+    inline uint32_t getMaxRunUs() const { return maxRunUs; }
+    // Of the last full window, 0 to 1
+    inline float getCpuShare() const { return cpuShare; }
+private:
+    friend class TaskScheduler;
+
+    const char* name;
+    TaskFunction function;
+    uint32_t periodUs;
+    uint32_t deadlineUs;
+
+    absolute_time_t nextRunAt = nil_time;
+
+    uint32_t runs = 0;
+    uint32_t missedDeadlines = 0;
+    uint32_t maxRunUs = 0;
+    uint32_t windowBusyUs = 0;
+    float cpuShare = 0.f;
+};
+
+/*
+ * Cooperative scheduler for core 1. Tasks run to completion in the order they're given, so tasks are expected to do
+ * a slice of work and return, rather than block. Every run is timed, which gives each task's share of the CPU.
+ */
+class TaskScheduler {
+public:
+    TaskScheduler(ScheduledTask* tasks, size_t taskCount): tasks(tasks), taskCount(taskCount) {}
+
+    void loop();
+
+    inline size_t getTaskCount() const { return taskCount; }
+    inline const ScheduledTask &getTask(size_t index) const { return tasks[index]; }
+private:
+    ScheduledTask* tasks;
+    size_t taskCount;
+
+    absolute_time_t windowStart = nil_time;
+
+    void run(ScheduledTask &task, absolute_time_t now);
+    void closeWindow(absolute_time_t now);
+};
+
+
+#endif //FIRMWARE_ARDUINO_TASKSCHEDULER_H
@@ -0,0 +1,309 @@
+#include "TelemetryWebSocketServer.h"
+#include "utils/sha1.h"
+#include "utils/base64.h"
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+
+#define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+#define WEBSOCKET_OPCODE_BINARY 0x2
+#define WEBSOCKET_OPCODE_CLOSE 0x8
+#define WEBSOCKET_OPCODE_PING 0x9
+#define WEBSOCKET_OPCODE_PONG 0xA
+#define WEBSOCKET_FINAL_FRAGMENT 0x80
+#define WEBSOCKET_MASKED 0x80
+
+void TelemetryWebSocketServer::loop(bool linkUp) {
+    if (!linkUp) {
+        // The sockets went away with the link, so there's nothing to stop
+        for (auto &client : clients) {
+            if (client.state != WEBSOCKET_CLIENT_NONE) {
+                closedDroppedFrames += client.droppedFrames;
+                client.state = WEBSOCKET_CLIENT_NONE;
+                client.client = WiFiClient();
+            }
+        }
+
+        openClients = 0;
+        listening = false;
+        return;
+    }
+
+    if (!listening) {
+        DEBUGV("Starting telemetry WebSocket server\n");
+        server.begin();
+        listening = true;
+    }
+
+    accept();
+
+    for (auto &client : clients) {
+        switch (client.state) {
+            case WEBSOCKET_CLIENT_NONE:
+                break;
+            case WEBSOCKET_CLIENT_HANDSHAKE:
+                readHandshake(client);
+                break;
+            case WEBSOCKET_CLIENT_OPEN:
+                readFrames(client);
+
+                if (client.state == WEBSOCKET_CLIENT_OPEN) {
+                    writeFrames(client);
+                }
+                break;
+        }
+    }
+}
+
+void TelemetryWebSocketServer::broadcast(const TelemetryFrame &frame) {
+    for (auto &client : clients) {
+        if (client.state != WEBSOCKET_CLIENT_OPEN) {
+            continue;
+        }
+
+        if (client.queueCount == WEBSOCKET_QUEUE_FRAMES) {
+            client.queueHead = (client.queueHead + 1) % WEBSOCKET_QUEUE_FRAMES;
+            client.queueCount--;
+            client.droppedFrames++;
+        }
+
+        client.queue[(client.queueHead + client.queueCount) % WEBSOCKET_QUEUE_FRAMES] = frame;
+        client.queueCount++;
+    }
+}
+
+uint32_t TelemetryWebSocketServer::getDroppedFrames() const {
+    uint32_t droppedFrames = closedDroppedFrames;
+
+    for (const auto &client : clients) {
+        if (client.state != WEBSOCKET_CLIENT_NONE) {
+            droppedFrames += client.droppedFrames;
+        }
+    }
+
+    return droppedFrames;
+}
+
+void TelemetryWebSocketServer::accept() {
+    WiFiClient incoming = server.available();
+
+    if (!incoming) {
+        return;
+    }
+
+    // The server hands back any socket with data waiting, including the ones already being served
+    for (auto &client : clients) {
+        if (client.state != WEBSOCKET_CLIENT_NONE && client.client == incoming) {
+            return;
+        }
+    }
+
+    for (auto &client : clients) {
+        if (client.state == WEBSOCKET_CLIENT_NONE) {
+            client.client = incoming;
+            client.state = WEBSOCKET_CLIENT_HANDSHAKE;
+            client.handshakeDeadline = make_timeout_time_ms(WEBSOCKET_HANDSHAKE_TIMEOUT_MS);
+            client.lineLength = 0;
+            client.isUpgrade = false;
+            client.key[0] = '\0';
+            client.receivedLength = 0;
+            client.queueHead = 0;
+            client.queueCount = 0;
+            client.droppedFrames = 0;
+            return;
+        }
+    }
+
+    DEBUGV("Too many WebSocket clients, turning one away\n");
+    incoming.stop();
+}
+
+/*
+ * The request is read a line at a time, and only the Upgrade and Sec-WebSocket-Key headers are looked at.
+ */
+void TelemetryWebSocketServer::readHandshake(WebSocketClient &client) {
+    if (!client.client.connected() || absolute_time_diff_us(client.handshakeDeadline, get_absolute_time()) > 0) {
+        return closeClient(client);
+    }
+
+    uint8_t chunk[64];
+
+    for (uint8_t reads = 0; reads < 4 && client.client.available() > 0; reads++) {
+        int length = client.client.read(chunk, sizeof(chunk));
+
+        if (length <= 0) {
+            return;
+        }
+
+        for (int i = 0; i < length; i++) {
+            if (chunk[i] == '\r') {
+                continue;
+            }
+
+            if (chunk[i] != '\n') {
+                // Overlong lines are truncated, which is fine for the headers we care about
+                if (client.lineLength < sizeof(client.line) - 1) {
+                    client.line[client.lineLength++] = (char)chunk[i];
+                }
+                continue;
+            }
+
+            client.line[client.lineLength] = '\0';
+
+            if (client.lineLength == 0) {
+                return completeHandshake(client);
+            }
+
+            char* value = strchr(client.line, ':');
+
+            if (value != nullptr) {
+                *value++ = '\0';
+                value += strspn(value, " \t");
+
+                if (strcasecmp(client.line, "Upgrade") == 0 && strcasecmp(value, "websocket") == 0) {
+                    client.isUpgrade = true;
+                } else if (strcasecmp(client.line, "Sec-WebSocket-Key") == 0) {
+                    strncpy(client.key, value, sizeof(client.key) - 1);
+                    client.key[sizeof(client.key) - 1] = '\0';
+                }
+            }
+
+            client.lineLength = 0;
+        }
+    }
+}
+
+void TelemetryWebSocketServer::completeHandshake(WebSocketClient &client) {
+    if (!client.isUpgrade || client.key[0] == '\0') {
+        static const char badRequest[] = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        client.client.write((const uint8_t*)badRequest, sizeof(badRequest) - 1);
+        return closeClient(client);
+    }
+
+    char keyAndGuid[sizeof(client.key) + sizeof(WEBSOCKET_GUID)];
+    int keyAndGuidLength = snprintf(keyAndGuid, sizeof(keyAndGuid), "%s%s", client.key, WEBSOCKET_GUID);
+
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    sha1((const uint8_t*)keyAndGuid, keyAndGuidLength, digest);
+
+    char accept[BASE64_ENCODED_LENGTH(SHA1_DIGEST_SIZE) + 1];
+    base64_encode(digest, sizeof(digest), accept, sizeof(accept));
+
+    char response[160];
+    int length = snprintf(response, sizeof(response), "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept);
+
+    if (client.client.write((const uint8_t*)response, length) != (size_t)length) {
+        return closeClient(client);
+    }
+
+    DEBUGV("WebSocket client connected\n");
+    client.state = WEBSOCKET_CLIENT_OPEN;
+    openClients++;
+}
+
+/*
+ * Clients have nothing to tell us, so apart from ping and close, whatever they send is discarded.
+ */
+void TelemetryWebSocketServer::readFrames(WebSocketClient &client) {
+    if (!client.client.connected()) {
+        return closeClient(client);
+    }
+
+    if (client.client.available() > 0 && client.receivedLength < sizeof(client.received)) {
+        int length = client.client.read(client.received + client.receivedLength, sizeof(client.received) - client.receivedLength);
+
+        if (length > 0) {
+            client.receivedLength += length;
+        }
+    }
+
+    while (client.receivedLength >= 2) {
+        uint8_t opcode = client.received[0] & 0x0F;
+        bool masked = client.received[1] & WEBSOCKET_MASKED;
+        uint8_t length = client.received[1] & 0x7F;
+
+        // Clients must mask their frames, and longer payloads use an extended length we don't support
+        if (!masked || length > 125) {
+            DEBUGV("Unsupported WebSocket frame, closing\n");
+            return closeClient(client);
+        }
+
+        size_t frameLength = 2 + 4 + length;
+
+        if (client.receivedLength < frameLength) {
+            return;
+        }
+
+        uint8_t* mask = client.received + 2;
+        uint8_t* payload = client.received + 6;
+
+        for (uint8_t i = 0; i < length; i++) {
+            payload[i] ^= mask[i % 4];
+        }
+
+        switch (opcode) {
+            case WEBSOCKET_OPCODE_CLOSE:
+                // Echo the status code back, as the closing handshake requires
+                sendControlFrame(client, WEBSOCKET_OPCODE_CLOSE, payload, length < 2 ? length : 2);
+                return closeClient(client);
+            case WEBSOCKET_OPCODE_PING:
+                sendControlFrame(client, WEBSOCKET_OPCODE_PONG, payload, length);
+                break;
+            default:
+                break;
+        }
+
+        memmove(client.received, client.received + frameLength, client.receivedLength - frameLength);
+        client.receivedLength -= frameLength;
+    }
+}
+
+/*
+ * Frames are written whole, so that control frames never end up in the middle of one.
+ */
+void TelemetryWebSocketServer::writeFrames(WebSocketClient &client) {
+    uint8_t encoded[2 + sizeof(TelemetryFrame)];
+    encoded[0] = WEBSOCKET_FINAL_FRAGMENT | WEBSOCKET_OPCODE_BINARY;
+    encoded[1] = sizeof(TelemetryFrame);
+
+    for (uint8_t i = 0; i < WEBSOCKET_FRAMES_PER_LOOP && client.queueCount > 0; i++) {
+        memcpy(encoded + 2, &client.queue[client.queueHead], sizeof(TelemetryFrame));
+
+        size_t written = client.client.write(encoded, sizeof(encoded));
+
+        // The module's buffers are full. The queue absorbs the backlog until the next loop.
+        if (written == 0) {
+            return;
+        }
+
+        // A torn frame can't be recovered from
+        if (written != sizeof(encoded)) {
+            return closeClient(client);
+        }
+
+        client.queueHead = (client.queueHead + 1) % WEBSOCKET_QUEUE_FRAMES;
+        client.queueCount--;
+    }
+}
+
+void TelemetryWebSocketServer::sendControlFrame(WebSocketClient &client, uint8_t opcode, const uint8_t *payload, uint8_t length) {
+    uint8_t encoded[2 + 125];
+    encoded[0] = WEBSOCKET_FINAL_FRAGMENT | opcode;
+    encoded[1] = length;
+    memcpy(encoded + 2, payload, length);
+
+    client.client.write(encoded, 2 + length);
+}
+
+void TelemetryWebSocketServer::closeClient(WebSocketClient &client) {
+    if (client.state == WEBSOCKET_CLIENT_OPEN) {
+        DEBUGV("WebSocket client disconnected\n");
+        openClients--;
+    }
+
+    closedDroppedFrames += client.droppedFrames;
+    client.client.stop();
+    client.client = WiFiClient();
+    client.state = WEBSOCKET_CLIENT_NONE;
+}
@@ -0,0 +1,85 @@
+#ifndef FIRMWARE_ARDUINO_TELEMETRYWEBSOCKETSERVER_H
+#define FIRMWARE_ARDUINO_TELEMETRYWEBSOCKETSERVER_H
+
+#include <WiFiNINA_Pinout_Generic.h>
+#include <WiFi_Generic.h>
+#include <pico/time.h>
+#include "telemetry_protocol.h"
+
+// Next to the status page on port 80, which only ever serves one client at a time
+#define WEBSOCKET_PORT 81
+
+// Every client holds a socket on the NINA module, which only has a handful to go around
+#define WEBSOCKET_MAX_CLIENTS 2
+
+// Per client. Once full, the oldest frame is dropped for the newest, so a slow client sees gaps rather than lag.
+#define WEBSOCKET_QUEUE_FRAMES 16
+
+#define WEBSOCKET_HANDSHAKE_TIMEOUT_MS 2000
+#define WEBSOCKET_LINE_SIZE 128
+
+// Largest frame accepted from a client. Only control frames are acted upon, anything larger closes the connection.
+#define WEBSOCKET_RECEIVE_SIZE 131
+
+// At most this many frames are written to each client per loop
+#define WEBSOCKET_FRAMES_PER_LOOP 4
+
+typedef enum : uint8_t {
+    WEBSOCKET_CLIENT_NONE,
+    WEBSOCKET_CLIENT_HANDSHAKE,
+    WEBSOCKET_CLIENT_OPEN,
+} WebSocketClientState;
+
+struct WebSocketClient {
+    WiFiClient client;
+    WebSocketClientState state = WEBSOCKET_CLIENT_NONE;
+    absolute_time_t handshakeDeadline = nil_time;
+
+    char line[WEBSOCKET_LINE_SIZE];
+    size_t lineLength = 0;
+    bool isUpgrade = false;
+    char key[32];
+
+    uint8_t received[WEBSOCKET_RECEIVE_SIZE];
+    size_t receivedLength = 0;
+
+    TelemetryFrame queue[WEBSOCKET_QUEUE_FRAMES];
+    uint8_t queueHead = 0;
+    uint8_t queueCount = 0;
+    uint32_t droppedFrames = 0;
+};
+
+/*
+ * Pushes a TelemetryFrame to local WebSocket clients (ws://<ip>:81/) for every control cycle, as binary messages.
+ * Nothing here blocks: the handshake is read line by line over consecutive loops, frames are queued per client and
+ * written a few at a time, and a client that can't keep up loses its oldest frames.
+ */
+class TelemetryWebSocketServer {
+public:
+    // Starts listening once the link is up. The module forgets its sockets when the link goes down.
+    void loop(bool linkUp);
+
+    inline bool hasClients() const { return openClients > 0; }
+    void broadcast(const TelemetryFrame &frame);
+
+    inline uint8_t getClients() const { return openClients; }
+    uint32_t getDroppedFrames() const;
+private:
+    WiFiServer server = WiFiServer(WEBSOCKET_PORT);
+    bool listening = false;
+
+    WebSocketClient clients[WEBSOCKET_MAX_CLIENTS];
+    uint8_t openClients = 0;
+    uint32_t closedDroppedFrames = 0;
+
+    void accept();
+    void readHandshake(WebSocketClient &client);
+    void completeHandshake(WebSocketClient &client);
+    void readFrames(WebSocketClient &client);
+    void writeFrames(WebSocketClient &client);
+    void sendControlFrame(WebSocketClient &client, uint8_t opcode, const uint8_t* payload, uint8_t length);
+    void closeClient(WebSocketClient &client);
+};
+
+
+#endif //FIRMWARE_ARDUINO_TELEMETRYWEBSOCKETSERVER_H
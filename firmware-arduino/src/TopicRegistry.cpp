@@ -0,0 +1,51 @@
+#include "TopicRegistry.h"
+#include "utils/fnv_hash.h"
+#include <cstdio>
+#include <cstring>
+
+// Formatted with the prefix and the identifier, in that order
+static constexpr const char* topicFormats[TOPIC_ID_COUNT] = {
+    "%s/%s/lwt",
+    "%s/%s/state",
+    "%s/%s/conf",
+    "%s/%s/info",
+    "%s/%s/cmd",
+    "%s/%s/tele",
+    "%s/%s/shot",
+    "%s/%s/event",
+    "homeassistant/+/%s/+/config",
+};
+
+bool TopicRegistry::build(const char *prefix, const char *identifier) {
+    size_t offset = 0;
+
+    for (uint8_t i = 0; i < TOPIC_ID_COUNT; i++) {
+        int length = snprintf(&arena[offset], TOPIC_ARENA_SIZE - offset, topicFormats[i], prefix, identifier);
+
+        if (length < 0 || offset + length + 1 > TOPIC_ARENA_SIZE) {
+            built = false;
+            return false;
+        }
+
+        offsets[i] = offset;
+        hashes[i] = fnv1a_hash(&arena[offset]);
+        offset += length + 1;
+    }
+
+    built = true;
+    return true;
+}
+
+nonstd::optional<TopicId> TopicRegistry::lookup(const char *topic, size_t length) const {
+    uint32_t hash = fnv1a_hash((const uint8_t *)topic, length);
+
+    for (uint8_t i = 0; i < TOPIC_ID_COUNT; i++) {
+        const char* candidate = get((TopicId)i);
+
+        if (hashes[i] == hash && strncmp(candidate, topic, length) == 0 && candidate[length] == '\0') {
+            return (TopicId)i;
+        }
+    }
+
+    return {};
+}
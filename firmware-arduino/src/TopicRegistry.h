@@ -0,0 +1,46 @@
+#ifndef FIRMWARE_ARDUINO_TOPICREGISTRY_H
+#define FIRMWARE_ARDUINO_TOPICREGISTRY_H
+
+#include <cstdint>
+#include <cstddef>
+#include "optional.hpp"
+
+// Fits every topic with the longest allowed prefix and the LCC-XXXXXX identifier
+#define TOPIC_ARENA_SIZE 384
+
+typedef enum : uint8_t {
+    TOPIC_ID_LWT,
+    TOPIC_ID_STATE,
+    TOPIC_ID_CONFIG,
+    TOPIC_ID_INFO,
+    TOPIC_ID_COMMAND,
+    TOPIC_ID_TELEMETRY,
+    TOPIC_ID_SHOT,
+    TOPIC_ID_EVENT,
+    TOPIC_ID_DISCOVERY_WILDCARD,
+    TOPIC_ID_COUNT,
+} TopicId;
+
+/*
+ * Every topic is formatted once, back to back, into a single arena. Topics are looked up by ID, and incoming
+ * topics are resolved by comparing a hash against the precomputed hashes before confirming with a string compare.
+ */
+class TopicRegistry {
+public:
+    // Returns false if the topics don't fit in the arena
+    bool build(const char *prefix, const char *identifier);
+
+    inline bool isBuilt() const { return built; }
+    inline const char* get(TopicId id) const { return &arena[offsets[id]]; }
+
+    // The topic doesn't have to be NUL-terminated, so it can be looked up straight from the receive buffer
+    nonstd::optional<TopicId> lookup(const char *topic, size_t length) const;
+private:
+    bool built = false;
+    char arena[TOPIC_ARENA_SIZE]{};
+    uint16_t offsets[TOPIC_ID_COUNT]{};
+    uint32_t hashes[TOPIC_ID_COUNT]{};
+};
+
+
+#endif //FIRMWARE_ARDUINO_TOPICREGISTRY_H
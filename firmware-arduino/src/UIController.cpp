@@ -4,6 +4,8 @@
 
 #include <U8g2lib.h>
 #include <string>
+#include <cstring>
+#include <cmath>
 #include "UIController.h"
 #include "lccmacros.h"
 #include "xbm/bssr_on.h"
@@ -19,7 +21,6 @@
 
 UIController::UIController(SystemStatus *status, SystemSettings* settings, U8G2 *display, uint minus_gpio, uint plus_gpio):
 status(status), settings(settings), display(display), minus_gpio(minus_gpio), plus_gpio(plus_gpio) {
-    blip = 0;
 }
 
 #define X_START 15
@@ -33,7 +34,7 @@ status(status), settings(settings), display(display), minus_gpio(minus_gpio), pl
 #define X_END_MARGIN (X_END - 2)
 #define Y_END_MARGIN (Y_END - 2)
 
-void UIController::loop() {
+void UIController::handleButtons() {
     previousMinus = minus;
     previousPlus = plus;
 
@@ -86,7 +87,108 @@ void UIController::loop() {
             }
         }
     }
+}
+
+// Truncated to tenths, like the temperatures are drawn
+static int16_t tenths(float value) {
+    return std::isfinite(value) ? (int16_t)(value * 10) : INT16_MIN;
+}
+
+void UIController::buildModel(UIModel &model) {
+    memset(&model, 0, sizeof(model));
+
+    model.state = status->getState();
+    model.progressFrame = UI_PROGRESS_HIDDEN;
+
+    if (status->mode == SYSTEM_MODE_CONFIG) {
+        model.screen = UI_SCREEN_CONFIG;
+    } else if (status->mode == SYSTEM_MODE_OTA) {
+        model.screen = UI_SCREEN_OTA;
+
+        if (status->ipAddress.has_value()) {
+            IPAddress ip = status->ipAddress.value();
+
+            for (uint8_t i = 0; i < 4; i++) {
+                model.ipAddress[i] = ip[i];
+            }
+        }
+    } else if (model.state == SYSTEM_CONTROLLER_STATE_UNDETERMINED) {
+        model.screen = UI_SCREEN_UNDETERMINED;
+    } else if (model.state == SYSTEM_CONTROLLER_STATE_BAILED) {
+        model.screen = UI_SCREEN_BAILED;
+    } else if (model.state == SYSTEM_CONTROLLER_STATE_FIRST_RUN) {
+        model.screen = UI_SCREEN_FIRST_RUN;
+    } else if (status->currentlyBrewing()) {
+        auto micros = absolute_time_diff_us(status->lastBrewStartedAt.value(), get_absolute_time());
+
+        model.screen = UI_SCREEN_BREWING;
+        model.brewSeconds = (uint8_t)round((float)micros / 1000000.f);
+    } else if (status->lastBrewEndedAt.has_value() && absolute_time_diff_us(status->lastBrewEndedAt.value(), get_absolute_time()) < 7500000) {
+        auto micros = absolute_time_diff_us(status->lastBrewStartedAt.value(), status->lastBrewEndedAt.value());
+
+        model.screen = UI_SCREEN_BREW_DONE;
+        model.brewSeconds = (uint8_t)round((float)micros / 1000000.f);
+    } else if (model.state == SYSTEM_CONTROLLER_STATE_SLEEPING) {
+        model.screen = UI_SCREEN_SLEEPING;
+    } else {
+        model.screen = UI_SCREEN_TEMPERATURES;
+
+        if (model.state == SYSTEM_CONTROLLER_STATE_HEATUP || model.state == SYSTEM_CONTROLLER_STATE_TEMPS_NORMALIZING) {
+            // Goes between 0 and 57, over two seconds
+            model.progressFrame = (uint8_t)(((micros() / 1000) % 2000) / 35);
+        }
+    }
+
+    model.brewTemperature = tenths(status->getOffsetBrewTemperature());
+    model.serviceTemperature = tenths(status->getServiceTemperature());
+    model.targetBrewTemperature = tenths(status->getOffsetTargetBrewTemperature());
+    model.targetServiceTemperature = tenths(status->getTargetServiceTemp());
+
+    if (status->wifiConnected) {
+        model.icons |= UI_ICON_WIFI;
+    }
+
+    if (status->mqttConnected) {
+        model.icons |= UI_ICON_MQTT;
+    }
+
+    if (status->isInEcoMode()) {
+        model.icons |= UI_ICON_ECO_MODE;
+    }
+
+    if (status->isWaterTankEmpty()) {
+        model.icons |= UI_ICON_NO_WATER;
+    }
 
+    if (status->currentlyFillingServiceBoiler()) {
+        model.icons |= UI_ICON_PUMP;
+    }
+
+    if (status->isBrewSsrOn()) {
+        model.icons |= UI_ICON_BREW_SSR;
+    }
+
+    if (status->isServiceSsrOn()) {
+        model.icons |= UI_ICON_SERVICE_SSR;
+    }
+
+    if ((micros() / 1000) % UI_BLIP_PERIOD_MS < UI_BLIP_PERIOD_MS / 2) {
+        model.icons |= UI_ICON_BLIP;
+    }
+}
+
+void UIController::render() {
+    UIModel model;
+    buildModel(model);
+
+    if (displayTiles.knowsPanel() && memcmp(&model, &previousModel, sizeof(model)) == 0) {
+        framesSkipped++;
+        return;
+    }
+
+    memcpy(&previousModel, &model, sizeof(model));
+
+    uint32_t start = time_us_32();
 
     display->clearBuffer();
     display->setFont(u8g2_font_5x7_tf);
@@ -94,46 +196,40 @@ void UIController::loop() {
     // Bounds frame, debug only
     // display->drawFrame(X_START, Y_START, S_WIDTH, S_HEIGHT);
 
-    drawStatusIcons();
+    drawStatusIcons(model.icons);
 
-    if (status->mode == SYSTEM_MODE_CONFIG) {
+    if (model.screen == UI_SCREEN_CONFIG) {
         display->setFont(u8g2_font_9x15_tf);
         display->drawStr(X_START + 10, Y_START + 20, "Network");
         display->drawStr(X_START + 10, Y_START + 35, "Config");
-    } else if (status->mode == SYSTEM_MODE_OTA) {
+    } else if (model.screen == UI_SCREEN_OTA) {
         display->setFont(u8g2_font_9x15_tf);
         display->drawStr(X_START + 10, Y_START + 20, "OTA mode");
         if (status->ipAddress.has_value()) {
-            IPAddress ip = status->ipAddress.value();
+            const uint8_t* ip = model.ipAddress;
 
             display->setFont(u8g2_font_5x7_tf);
             std::string ipString = std::to_string(ip[0]) + "." + std::to_string(ip[1]) + "." + std::to_string(ip[2]) + "." + std::to_string(ip[3]);
             display->drawStr(X_START + 10, Y_START + 43, ipString.c_str());
         }
-    } else if (status->getState() == SYSTEM_CONTROLLER_STATE_UNDETERMINED) {
+    } else if (model.screen == UI_SCREEN_UNDETERMINED) {
         display->setFont(u8g2_font_9x15_tf);
         display->drawStr(X_START + 10, Y_START + 20, "Undetermined");
-    } else if (status->getState() == SYSTEM_CONTROLLER_STATE_BAILED) {
+    } else if (model.screen == UI_SCREEN_BAILED) {
         display->setFont(u8g2_font_9x15_tf);
         display->drawStr(X_START + 10, Y_START + 20, "Bailed");
-    } else if (status->getState() == SYSTEM_CONTROLLER_STATE_FIRST_RUN) {
+    } else if (model.screen == UI_SCREEN_FIRST_RUN) {
         display->setFont(u8g2_font_9x15_tf);
         display->drawStr(X_START + 10, Y_START + 20, "First run");
-    } else if (status->currentlyBrewing()) {
-        auto micros = absolute_time_diff_us(status->lastBrewStartedAt.value(), get_absolute_time());
-        auto seconds = (uint8_t)round((float)micros / 1000000.f);
-
-        if (seconds % 2 == 0) {
-            drawBrewScreen(BREW_SCREEN_MOVING_1, seconds);
+    } else if (model.screen == UI_SCREEN_BREWING) {
+        if (model.brewSeconds % 2 == 0) {
+            drawBrewScreen(BREW_SCREEN_MOVING_1, model.brewSeconds);
         } else {
-            drawBrewScreen(BREW_SCREEN_MOVING_2, seconds);
+            drawBrewScreen(BREW_SCREEN_MOVING_2, model.brewSeconds);
         }
-    } else if (status->lastBrewEndedAt.has_value() && absolute_time_diff_us(status->lastBrewEndedAt.value(), get_absolute_time()) < 7500000) {
-        auto micros = absolute_time_diff_us(status->lastBrewStartedAt.value(), status->lastBrewEndedAt.value());
-        auto seconds = (uint8_t)round((float)micros / 1000000.f);
-
-        drawBrewScreen(BREW_SCREEN_IDLE, seconds);
-    } else if (status->getState() == SYSTEM_CONTROLLER_STATE_SLEEPING) {
+    } else if (model.screen == UI_SCREEN_BREW_DONE) {
+        drawBrewScreen(BREW_SCREEN_IDLE, model.brewSeconds);
+    } else if (model.screen == UI_SCREEN_SLEEPING) {
         display->setFont(u8g2_font_9x15_tf);
         display->drawStr(X_START + 10, Y_START + 20, "Sleeping");
 
@@ -152,8 +248,8 @@ void UIController::loop() {
 
         uint8_t progressOffset = 1;
 
-        if (status->getState() == SYSTEM_CONTROLLER_STATE_HEATUP || status->getState() == SYSTEM_CONTROLLER_STATE_TEMPS_NORMALIZING) {
-            drawProgressBar();
+        if (model.progressFrame != UI_PROGRESS_HIDDEN) {
+            drawProgressBar(model.progressFrame);
             progressOffset = 5;
         }
 
@@ -216,36 +312,44 @@ void UIController::loop() {
         }
     }
 
-    if (blip < 25) {
+    if (model.icons & UI_ICON_BLIP) {
         display->drawDisc(104, 10, 2);
     }
-    blip = (blip + 1) % 50;
 
-    display->sendBuffer();
+    bytesSent += displayTiles.send(display->getBufferPtr(), [this] (uint8_t tileX, uint8_t tileY, uint8_t tilesWide, uint8_t tilesHigh) {
+        display->updateDisplayArea(tileX, tileY, tilesWide, tilesHigh);
+    });
+
+    lastFrameUs = time_us_32() - start;
+    framesDrawn++;
+
+    if (lastFrameUs > maxFrameUs) {
+        maxFrameUs = lastFrameUs;
+    }
 }
 
-void UIController::drawStatusIcons() {
-    if (status->wifiConnected && status->mqttConnected) {
+void UIController::drawStatusIcons(uint8_t icons) {
+    if ((icons & UI_ICON_WIFI) && (icons & UI_ICON_MQTT)) {
         display->drawXBM(X_END_MARGIN - wifi_mqtt_width, Y_START_MARGIN, wifi_mqtt_width, wifi_mqtt_height, wifi_mqtt_bits);
-    } else if (status->wifiConnected) {
+    } else if (icons & UI_ICON_WIFI) {
         display->drawXBM(X_END_MARGIN - wifi_no_mqtt_width, Y_START_MARGIN, wifi_no_mqtt_width, wifi_no_mqtt_height, wifi_no_mqtt_bits);
     }
 
-    if (status->isInEcoMode()) {
+    if (icons & UI_ICON_ECO_MODE) {
         display->drawXBM(X_END_MARGIN - eco_mode_width, Y_START_MARGIN + wifi_mqtt_height + 1, eco_mode_width, eco_mode_height, eco_mode_bits);
     }
 
-    if (status->isWaterTankEmpty()) {
+    if (icons & UI_ICON_NO_WATER) {
         display->drawXBM(X_END_MARGIN - eco_mode_width, Y_START_MARGIN + wifi_mqtt_height + 1 + eco_mode_height + 1, no_water_width, no_water_height, no_water_bits);
     }
 
-    if (status->currentlyFillingServiceBoiler()) {
+    if (icons & UI_ICON_PUMP) {
         display->drawXBM(X_END_MARGIN - pump_on_width, Y_START_MARGIN + wifi_mqtt_height + 1 + eco_mode_height + 1 + no_water_height + 1, pump_on_width, pump_on_height, pump_on_bits);
     }
 
-    if (status->isBrewSsrOn()) {
+    if (icons & UI_ICON_BREW_SSR) {
         display->drawXBM(X_END_MARGIN - bssr_on_width - 1, Y_END_MARGIN - bssr_on_height, bssr_on_width, bssr_on_height, bssr_on_bits);
-    } else if (status->isServiceSsrOn()) {
+    } else if (icons & UI_ICON_SERVICE_SSR) {
         display->drawXBM(X_END_MARGIN - sssr_on_width - 1, Y_END_MARGIN - sssr_on_height, sssr_on_width, sssr_on_height, sssr_on_bits);
     }
 
@@ -283,17 +387,12 @@ void UIController::drawBrewScreen(BrewScreen screen, uint8_t seconds) {
     display->drawUTF8(X_START + 52, Y_END - 1, degreeBuf);
 }
 
-void UIController::drawProgressBar() {
+void UIController::drawProgressBar(uint8_t frame) {
     display->drawFrame(X_START_MARGIN + 3, Y_START_MARGIN + 3, 76, 5);
 
     uint8_t x = X_START_MARGIN + 3;
     uint8_t y = Y_START_MARGIN + 3;
 
-    unsigned short doublemilli = (micros() / 1000) % 2000;
-
-    // Goes between 0 and 57
-    unsigned short frame = doublemilli / 35;
-
     unsigned short start;
     unsigned short width;
 
@@ -6,22 +6,83 @@
 #define FIRMWARE_UICONTROLLER_H
 
 #include "SystemStatus.h"
+#include "DisplayTiles.h"
 #include <U8g2lib.h>
 
 // Define the dimension of the U8x8log window
 #define U8LOG_WIDTH 16
 #define U8LOG_HEIGHT 8
 
+// Frame rate cap, i.e. at most 20 frames per second
+#define UI_FRAME_INTERVAL_MS 50
+
+// The blip is on for the first half of every period, going by the clock rather than by frames drawn
+#define UI_BLIP_PERIOD_MS 2500
+
 typedef enum {
     BREW_SCREEN_IDLE,
     BREW_SCREEN_MOVING_1,
     BREW_SCREEN_MOVING_2
 } BrewScreen;
 
+typedef enum : uint8_t {
+    UI_SCREEN_CONFIG,
+    UI_SCREEN_OTA,
+    UI_SCREEN_UNDETERMINED,
+    UI_SCREEN_BAILED,
+    UI_SCREEN_FIRST_RUN,
+    UI_SCREEN_BREWING,
+    UI_SCREEN_BREW_DONE,
+    UI_SCREEN_SLEEPING,
+    UI_SCREEN_TEMPERATURES,
+} UIScreen;
+
+#define UI_ICON_WIFI (1 << 0)
+#define UI_ICON_MQTT (1 << 1)
+#define UI_ICON_ECO_MODE (1 << 2)
+#define UI_ICON_NO_WATER (1 << 3)
+#define UI_ICON_PUMP (1 << 4)
+#define UI_ICON_BREW_SSR (1 << 5)
+#define UI_ICON_SERVICE_SSR (1 << 6)
+#define UI_ICON_BLIP (1 << 7)
+
+/*
+ * Everything the screen shows, at the precision it's shown in. A frame is only drawn when this changes, and is
+ * compared with memcmp, so it's zeroed before being filled in.
+ */
+struct UIModel {
+    UIScreen screen;
+    SystemControllerState state;
+    uint8_t icons;
+    uint8_t brewSeconds;
+    // UI_PROGRESS_HIDDEN unless heating up
+    uint8_t progressFrame;
+    uint8_t ipAddress[4];
+    // Tenths of a degree
+    int16_t brewTemperature;
+    int16_t serviceTemperature;
+    int16_t targetBrewTemperature;
+    int16_t targetServiceTemperature;
+};
+
+#define UI_PROGRESS_HIDDEN UINT8_MAX
+
 class UIController {
 public:
     UIController(SystemStatus *status, SystemSettings* settings, U8G2 *display, uint minus_gpio, uint plus_gpio);
-    void loop();
+    // Buttons are polled far more often than the display is redrawn, so a press is never missed to a slow refresh
+    void handleButtons();
+    // Draws a frame if anything shown has changed, and sends the parts of it that differ from the last frame sent
+    void render();
+    // Forgets what the panel shows, so the next frame is drawn and sent whole. Called after drawing to it directly.
+    inline void invalidate() { displayTiles.invalidate(); }
+
+    inline uint32_t getFramesDrawn() const { return framesDrawn; }
+    inline uint32_t getFramesSkipped() const { return framesSkipped; }
+    // Pixel data only, the few command bytes addressing each update aren't counted
+    inline uint32_t getBytesSent() const { return bytesSent; }
+    inline uint32_t getLastFrameUs() const { return lastFrameUs; }
+    inline uint32_t getMaxFrameUs() const { return maxFrameUs; }
 
 private:
     SystemStatus* status;
@@ -42,11 +103,20 @@ private:
     nonstd::optional<absolute_time_t> minusStartedAt;
     nonstd::optional<absolute_time_t> plusStartedAt;
 
-    uint8_t blip;
+    UIModel previousModel{};
+    DisplayTiles displayTiles;
+
+    uint32_t framesDrawn = 0;
+    uint32_t framesSkipped = 0;
+    uint32_t bytesSent = 0;
+    uint32_t lastFrameUs = 0;
+    uint32_t maxFrameUs = 0;
+
+    void buildModel(UIModel &model);
 
-    void drawStatusIcons();
+    void drawStatusIcons(uint8_t icons);
     void drawBrewScreen(BrewScreen screen, uint8_t seconds);
-    void drawProgressBar();
+    void drawProgressBar(uint8_t frame);
 
     inline bool allowedByTimeout(nonstd::optional<absolute_time_t> timeout);
 };
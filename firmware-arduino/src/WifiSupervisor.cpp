@@ -0,0 +1,202 @@
+#include "WifiSupervisor.h"
+#include <Arduino.h>
+#include <WiFiNINA_Pinout_Generic.h>
+#include <WiFi_Generic.h>
+
+WifiLinkAction WifiSupervisor::update(uint8_t wifiStatus) {
+    if (is_nil_time(supervisingSince)) {
+        supervisingSince = get_absolute_time();
+        jitterState = time_us_32() | 1;
+    }
+
+    if (state == WIFI_LINK_RESETTING) {
+        if (!hasPassed(deadline)) {
+            return WIFI_ACTION_NONE;
+        }
+
+        DEBUGV("Re-initing WiFi module\n");
+        state = WIFI_LINK_IDLE;
+        return WIFI_ACTION_INIT_MODULE;
+    }
+
+    if (wifiStatus == WL_CONNECTED) {
+        if (state != WIFI_LINK_CONNECTED) {
+            onLinkUp();
+        }
+
+        if (roamPending) {
+            DEBUGV("WiFi link has been weak for a while, re-associating\n");
+            roamPending = false;
+            roaming = true;
+            roams++;
+            lastRoamAt = get_absolute_time();
+            return WIFI_ACTION_DISCONNECT;
+        }
+
+        return WIFI_ACTION_NONE;
+    }
+
+    if (state == WIFI_LINK_CONNECTED) {
+        onLinkDown();
+    }
+
+    switch (state) {
+        case WIFI_LINK_CONNECTING:
+            if (wifiStatus == WL_NO_MODULE || hasPassed(deadline)) {
+                DEBUGV("WiFi connection attempt failed (status %u)\n", wifiStatus);
+                return attemptFailed();
+            }
+
+            return WIFI_ACTION_NONE;
+        case WIFI_LINK_BACKOFF:
+            if (!hasPassed(deadline)) {
+                return WIFI_ACTION_NONE;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (wifiStatus == WL_NO_MODULE) {
+        // A reset that didn't bring the module back counts as a failed attempt, so that resets are backed off too
+        if (moduleWasReset) {
+            moduleWasReset = false;
+            return attemptFailed();
+        }
+
+        return beginReset();
+    }
+
+    if (resetDue) {
+        resetDue = false;
+        return beginReset();
+    }
+
+    moduleWasReset = false;
+    state = WIFI_LINK_CONNECTING;
+    deadline = make_timeout_time_ms(WIFI_CONNECT_TIMEOUT_MS);
+    return WIFI_ACTION_CONNECT;
+}
+
+void WifiSupervisor::reportRssi(int32_t rssi) {
+    lastRssi = rssi;
+
+    // The module reports 0 when it doesn't have a reading
+    if (state != WIFI_LINK_CONNECTED || rssi == 0 || rssi >= WIFI_ROAM_RSSI) {
+        weakSince = nil_time;
+        return;
+    }
+
+    if (is_nil_time(weakSince)) {
+        weakSince = get_absolute_time();
+        return;
+    }
+
+    absolute_time_t now = get_absolute_time();
+
+    if (absolute_time_diff_us(weakSince, now) < (int64_t)WIFI_ROAM_WEAK_MS * 1000) {
+        return;
+    }
+
+    if (!is_nil_time(lastRoamAt) && absolute_time_diff_us(lastRoamAt, now) < (int64_t)WIFI_ROAM_MIN_INTERVAL_MS * 1000) {
+        return;
+    }
+
+    roamPending = true;
+}
+
+float WifiSupervisor::getConnectedRatio() const {
+    if (is_nil_time(supervisingSince)) {
+        return 0.f;
+    }
+
+    absolute_time_t now = get_absolute_time();
+    int64_t totalUs = absolute_time_diff_us(supervisingSince, now);
+    uint64_t upUs = connectedUs;
+
+    if (state == WIFI_LINK_CONNECTED) {
+        upUs += absolute_time_diff_us(connectedSince, now);
+    }
+
+    if (totalUs <= 0) {
+        return 0.f;
+    }
+
+    return (float)((double)upUs / (double)totalUs);
+}
+
+void WifiSupervisor::onLinkUp() {
+    DEBUGV("WiFi link up after %u failed attempts\n", consecutiveFailures);
+    state = WIFI_LINK_CONNECTED;
+    connects++;
+    consecutiveFailures = 0;
+    failuresSinceReset = 0;
+    backoffMs = 0;
+    resetDue = false;
+    moduleWasReset = false;
+    connectedSince = get_absolute_time();
+    weakSince = nil_time;
+}
+
+void WifiSupervisor::onLinkDown() {
+    connectedUs += absolute_time_diff_us(connectedSince, get_absolute_time());
+    state = WIFI_LINK_IDLE;
+    roamPending = false;
+
+    // A drop we caused ourselves to roam isn't counted, and is reconnected right away like any other drop
+    if (roaming) {
+        roaming = false;
+    } else {
+        DEBUGV("WiFi link down\n");
+        disconnects++;
+    }
+}
+
+WifiLinkAction WifiSupervisor::attemptFailed() {
+    if (consecutiveFailures < UINT8_MAX) {
+        consecutiveFailures++;
+    }
+
+    if (++failuresSinceReset >= WIFI_RESET_AFTER_FAILURES) {
+        resetDue = true;
+    }
+
+    backoffMs = nextBackoffMs();
+    DEBUGV("Retrying WiFi in %u ms\n", backoffMs);
+
+    state = WIFI_LINK_BACKOFF;
+    deadline = make_timeout_time_ms(backoffMs);
+    return WIFI_ACTION_NONE;
+}
+
+WifiLinkAction WifiSupervisor::beginReset() {
+    DEBUGV("Resetting WiFi module\n");
+    resets++;
+    failuresSinceReset = 0;
+    moduleWasReset = true;
+
+    state = WIFI_LINK_RESETTING;
+    deadline = make_timeout_time_ms(WIFI_RESET_HOLD_MS);
+    return WIFI_ACTION_DEINIT_MODULE;
+}
+
+/*
+ * Equal jitter: half of the exponential delay is fixed, the other half random. Attempts never bunch up near zero,
+ * but devices that lost the link at the same time (e.g. an AP reboot) still spread out.
+ */
+uint32_t WifiSupervisor::nextBackoffMs() {
+    uint8_t exponent = consecutiveFailures > 0 ? consecutiveFailures - 1 : 0;
+    uint32_t delay = WIFI_BACKOFF_MAX_MS;
+
+    if (exponent < 16 && ((uint32_t)WIFI_BACKOFF_BASE_MS << exponent) < WIFI_BACKOFF_MAX_MS) {
+        delay = (uint32_t)WIFI_BACKOFF_BASE_MS << exponent;
+    }
+
+    // xorshift32, seeded from the timer on the first update
+    jitterState ^= jitterState << 13;
+    jitterState ^= jitterState >> 17;
+    jitterState ^= jitterState << 5;
+
+    uint32_t half = delay / 2;
+    return half + jitterState % (half + 1);
+}
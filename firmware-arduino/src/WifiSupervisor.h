@@ -0,0 +1,107 @@
+#ifndef FIRMWARE_ARDUINO_WIFISUPERVISOR_H
+#define FIRMWARE_ARDUINO_WIFISUPERVISOR_H
+
+#include <cstdint>
+#include <pico/time.h>
+
+// How long an association attempt may take before it's considered failed
+#define WIFI_CONNECT_TIMEOUT_MS 5000
+
+// Retry delays double from the base up to the max, and are jittered so that a fleet doesn't retry in lockstep
+#define WIFI_BACKOFF_BASE_MS 1000
+#define WIFI_BACKOFF_MAX_MS 60000
+
+// After this many failed attempts in a row the module is reset, in case it has wedged
+#define WIFI_RESET_AFTER_FAILURES 6
+
+// How long the module is held de-inited during a reset
+#define WIFI_RESET_HOLD_MS 100
+
+// A link that stays this weak for this long is dropped and re-associated, which lets the module pick a better AP
+#define WIFI_ROAM_RSSI -80
+#define WIFI_ROAM_WEAK_MS 60000
+#define WIFI_ROAM_MIN_INTERVAL_MS 600000
+
+typedef enum : uint8_t {
+    WIFI_LINK_IDLE,
+    WIFI_LINK_CONNECTING,
+    WIFI_LINK_CONNECTED,
+    WIFI_LINK_BACKOFF,
+    WIFI_LINK_RESETTING,
+} WifiLinkState;
+
+// What the caller should do with the module after an update
+typedef enum : uint8_t {
+    WIFI_ACTION_NONE,
+    WIFI_ACTION_CONNECT,
+    WIFI_ACTION_DISCONNECT,
+    WIFI_ACTION_DEINIT_MODULE,
+    WIFI_ACTION_INIT_MODULE,
+} WifiLinkAction;
+
+/*
+ * Supervises the WiFi link. Fed the module status once per loop, it decides when to (re)connect, backs off
+ * exponentially between failed attempts, and resets the module without blocking. It never talks to the module itself,
+ * so the caller has to carry out the returned action.
+ */
+class WifiSupervisor {
+public:
+    WifiLinkAction update(uint8_t wifiStatus);
+
+    // Sampled whenever the RSSI is read anyway, and used to decide when to roam
+    void reportRssi(int32_t rssi);
+
+    // The module must not be queried while it's being reset
+    inline bool isResetting() const { return state == WIFI_LINK_RESETTING; }
+    inline bool isConnected() const { return state == WIFI_LINK_CONNECTED; }
+    inline WifiLinkState getState() const { return state; }
+
+    inline uint32_t getConnects() const { return connects; }
+    inline uint32_t getDisconnects() const { return disconnects; }
+    inline uint32_t getResets() const { return resets; }
+    inline uint32_t getRoams() const { return roams; }
+    inline uint32_t getBackoffMs() const { return backoffMs; }
+    inline int32_t getLastRssi() const { return lastRssi; }
+
+    // Share of the time since the first update that the link has been up, between 0 and 1
+    float getConnectedRatio() const;
+private:
+    WifiLinkState state = WIFI_LINK_IDLE;
+    absolute_time_t deadline = nil_time;
+
+    uint8_t consecutiveFailures = 0;
+    // Kept apart from consecutiveFailures, which saturates and drives the backoff
+    uint8_t failuresSinceReset = 0;
+    uint32_t backoffMs = 0;
+    uint32_t jitterState = 0;
+    bool resetDue = false;
+    bool moduleWasReset = false;
+
+    int32_t lastRssi = 0;
+    bool roamPending = false;
+    bool roaming = false;
+    absolute_time_t weakSince = nil_time;
+    absolute_time_t lastRoamAt = nil_time;
+
+    uint32_t connects = 0;
+    uint32_t disconnects = 0;
+    uint32_t resets = 0;
+    uint32_t roams = 0;
+
+    absolute_time_t supervisingSince = nil_time;
+    absolute_time_t connectedSince = nil_time;
+    uint64_t connectedUs = 0;
+
+    void onLinkUp();
+    void onLinkDown();
+    WifiLinkAction attemptFailed();
+    WifiLinkAction beginReset();
+    uint32_t nextBackoffMs();
+
+    static inline bool hasPassed(absolute_time_t time) {
+        return absolute_time_diff_us(time, get_absolute_time()) >= 0;
+    }
+};
+
+
+#endif //FIRMWARE_ARDUINO_WIFISUPERVISOR_H
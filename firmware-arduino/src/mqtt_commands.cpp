@@ -0,0 +1,51 @@
+#include "mqtt_commands.h"
+#include <cmath>
+
+static inline bool is_in_range(float value, const MqttCommand &definition) {
+    return std::isfinite(value) && value >= definition.min && value <= definition.max;
+}
+
+static bool parse_float(JsonVariantConst value, float &result) {
+    if (!value.is<float>()) {
+        return false;
+    }
+
+    result = value.as<float>();
+    return std::isfinite(result);
+}
+
+bool parse_command_argument(JsonObjectConst command, const MqttCommand &definition, CommandArgument &argument) {
+    switch (definition.argumentType) {
+        case COMMAND_ARGUMENT_FLOAT:
+            return parse_float(command["float_value"], argument.floatValue) && is_in_range(argument.floatValue, definition);
+        case COMMAND_ARGUMENT_BOOL:
+            if (!command["bool_value"].is<bool>()) {
+                return false;
+            }
+
+            argument.boolValue = command["bool_value"].as<bool>();
+            return true;
+        case COMMAND_ARGUMENT_INT:
+            if (!command["int_value"].is<int32_t>()) {
+                return false;
+            }
+
+            argument.intValue = command["int_value"].as<int32_t>();
+            return is_in_range((float)argument.intValue, definition);
+        case COMMAND_ARGUMENT_PID:
+            if (!parse_float(command["kp"], argument.pidValue.Kp) ||
+                !parse_float(command["ki"], argument.pidValue.Ki) ||
+                !parse_float(command["kd"], argument.pidValue.Kd) ||
+                !parse_float(command["windup_low"], argument.pidValue.windupLow) ||
+                !parse_float(command["windup_high"], argument.pidValue.windupHigh)) {
+                return false;
+            }
+
+            return is_in_range(argument.pidValue.Kp, definition) &&
+                   is_in_range(argument.pidValue.Ki, definition) &&
+                   is_in_range(argument.pidValue.Kd, definition) &&
+                   argument.pidValue.windupLow <= argument.pidValue.windupHigh;
+    }
+
+    return false;
+}
@@ -0,0 +1,44 @@
+#ifndef FIRMWARE_ARDUINO_MQTT_COMMANDS_H
+#define FIRMWARE_ARDUINO_MQTT_COMMANDS_H
+
+#include <cstdint>
+#include <ArduinoJson.h>
+#include "types.h"
+#include "utils/fnv_hash.h"
+
+// Room for a handful of batched commands, e.g. [{"cmd": "set_eco_mode", "bool_value": true}, ...]
+#define COMMAND_DOCUMENT_SIZE 512
+
+typedef enum : uint8_t {
+    COMMAND_ARGUMENT_FLOAT,  // float_value
+    COMMAND_ARGUMENT_BOOL,   // bool_value
+    COMMAND_ARGUMENT_INT,    // int_value
+    COMMAND_ARGUMENT_PID,    // kp, ki, kd, windup_low, windup_high
+} CommandArgumentType;
+
+struct CommandArgument {
+    float floatValue{};
+    bool boolValue{};
+    int32_t intValue{};
+    PidSettings pidValue{};
+};
+
+class NetworkController;
+
+// Returns whether the command changed the configuration, so that it's only republished when needed
+typedef bool (*CommandHandler)(NetworkController &controller, const CommandArgument &argument);
+
+struct MqttCommand {
+    uint32_t nameHash;
+    const char* name;
+    CommandArgumentType argumentType;
+    // Inclusive range for float and int arguments. For PID arguments it applies to Kp, Ki and Kd.
+    float min;
+    float max;
+    CommandHandler handler;
+};
+
+// Extracts and validates the argument of a command, returning false if it's missing, of the wrong type or out of range
+bool parse_command_argument(JsonObjectConst command, const MqttCommand &definition, CommandArgument &argument);
+
+#endif //FIRMWARE_ARDUINO_MQTT_COMMANDS_H
@@ -0,0 +1,76 @@
+#include "telemetry_protocol.h"
+#include <algorithm>
+#include <cmath>
+
+// The averages are NaN until the first packet. Converting that to an integer is undefined, so it's sent as INT16_MIN.
+static inline int16_t scale_to_int16(float value, float scale) {
+    float scaled = roundf(value * scale);
+
+    if (!std::isfinite(scaled)) {
+        return INT16_MIN;
+    }
+
+    return (int16_t)std::max((float)INT16_MIN, std::min((float)INT16_MAX, scaled));
+}
+
+TelemetryFrame create_telemetry_frame(const SystemStatus *status, uint32_t sequence, int8_t rssi, bool watchdogReboot) {
+    return create_telemetry_frame(status->getLatestStatusMessage(), status->getBrewTempOffset(), status->rp2040Temperature, sequence, rssi, watchdogReboot);
+}
+
+TelemetryFrame create_telemetry_frame(const SystemControllerStatusMessage &message, float brewTempOffset, float rp2040Temperature, uint32_t sequence, int8_t rssi, bool watchdogReboot) {
+    TelemetryFrame frame = TelemetryFrame();
+
+    frame.schemaId = TELEMETRY_SCHEMA_ID;
+    frame.schemaVersion = TELEMETRY_SCHEMA_VERSION;
+
+    const PidRuntimeParameters &brewPid = message.brewPidParameters;
+
+    frame.flags = (message.brewSSRActive ? TELEMETRY_FLAG_BREW_SSR_ON : 0) |
+                  (message.serviceSSRActive ? TELEMETRY_FLAG_SERVICE_SSR_ON : 0) |
+                  (message.ecoMode ? TELEMETRY_FLAG_ECO_MODE : 0) |
+                  (message.currentlyBrewing ? TELEMETRY_FLAG_BREWING : 0) |
+                  (message.currentlyFillingServiceBoiler ? TELEMETRY_FLAG_FILLING_SERVICE_BOILER : 0) |
+                  (message.waterTankLow ? TELEMETRY_FLAG_WATER_TANK_LOW : 0) |
+                  (brewPid.hysteresisMode ? TELEMETRY_FLAG_BREW_HYSTERESIS_MODE : 0) |
+                  (watchdogReboot ? TELEMETRY_FLAG_WATCHDOG_REBOOT : 0);
+
+    frame.sequence = sequence;
+    frame.timestampMs = to_ms_since_boot(message.timestamp);
+
+    frame.brewTemperature = scale_to_int16(message.brewTemperature + brewTempOffset, 100.f);
+    frame.brewSetPoint = scale_to_int16(message.brewSetPoint + brewTempOffset, 100.f);
+    frame.serviceTemperature = scale_to_int16(message.serviceTemperature, 100.f);
+    frame.serviceSetPoint = scale_to_int16(message.serviceSetPoint, 100.f);
+
+    frame.brewP = scale_to_int16(brewPid.p, 1000.f);
+    frame.brewI = scale_to_int16(brewPid.i, 1000.f);
+    frame.brewD = scale_to_int16(brewPid.d, 1000.f);
+    frame.brewIntegral = scale_to_int16(brewPid.integral, 1000.f);
+
+    frame.state = (uint8_t)message.state;
+    frame.bailReason = (uint8_t)message.bailReason;
+    frame.rssi = rssi;
+    frame.rp2040Temperature = (int8_t)scale_to_int16(rp2040Temperature, 1.f);
+
+    return frame;
+}
+
+ShotSample create_shot_sample(const SystemControllerStatusMessage &message, float brewTempOffset) {
+    ShotSample sample = ShotSample();
+
+    sample.timestampMs = to_ms_since_boot(message.timestamp);
+
+    sample.brewTemperature = scale_to_int16(message.brewTemperature + brewTempOffset, 100.f);
+    sample.brewSetPoint = scale_to_int16(message.brewSetPoint + brewTempOffset, 100.f);
+
+    sample.brewP = scale_to_int16(message.brewPidParameters.p, 1000.f);
+    sample.brewI = scale_to_int16(message.brewPidParameters.i, 1000.f);
+    sample.brewD = scale_to_int16(message.brewPidParameters.d, 1000.f);
+
+    sample.flags = (message.brewSSRActive ? SHOT_SAMPLE_FLAG_BREW_SSR_ON : 0) |
+                   (message.serviceSSRActive ? SHOT_SAMPLE_FLAG_SERVICE_SSR_ON : 0) |
+                   (message.currentlyBrewing ? SHOT_SAMPLE_FLAG_BREWING : 0) |
+                   (message.brewPidParameters.hysteresisMode ? SHOT_SAMPLE_FLAG_BREW_HYSTERESIS_MODE : 0);
+
+    return sample;
+}
@@ -0,0 +1,89 @@
+#ifndef FIRMWARE_ARDUINO_TELEMETRY_PROTOCOL_H
+#define FIRMWARE_ARDUINO_TELEMETRY_PROTOCOL_H
+
+#include <cstdint>
+#include "SystemStatus.h"
+
+// Frames start with the schema ID, followed by the schema version. Consumers must check both before decoding, and
+// the version must be bumped whenever the layout below changes. See telemetry_decode.py for the consumer side.
+#define TELEMETRY_SCHEMA_ID ((uint16_t)0x4C43)
+#define TELEMETRY_SCHEMA_VERSION ((uint8_t)1)
+
+typedef enum : uint8_t {
+    TELEMETRY_FLAG_BREW_SSR_ON = 1 << 0,
+    TELEMETRY_FLAG_SERVICE_SSR_ON = 1 << 1,
+    TELEMETRY_FLAG_ECO_MODE = 1 << 2,
+    TELEMETRY_FLAG_BREWING = 1 << 3,
+    TELEMETRY_FLAG_FILLING_SERVICE_BOILER = 1 << 4,
+    TELEMETRY_FLAG_WATER_TANK_LOW = 1 << 5,
+    TELEMETRY_FLAG_BREW_HYSTERESIS_MODE = 1 << 6,
+    TELEMETRY_FLAG_WATCHDOG_REBOOT = 1 << 7,
+} TelemetryFlag;
+
+// Little endian, no padding. Temperatures are in centidegrees, PID terms in thousandths. Values without a reading yet
+// are INT16_MIN.
+struct __attribute__((packed)) TelemetryFrame {
+    uint16_t schemaId{};
+    uint8_t schemaVersion{};
+    uint8_t flags{};
+    uint32_t sequence{};
+    uint32_t timestampMs{};
+    int16_t brewTemperature{};
+    int16_t brewSetPoint{};
+    int16_t serviceTemperature{};
+    int16_t serviceSetPoint{};
+    int16_t brewP{};
+    int16_t brewI{};
+    int16_t brewD{};
+    int16_t brewIntegral{};
+    uint8_t state{};
+    uint8_t bailReason{};
+    int8_t rssi{};
+    int8_t rp2040Temperature{};
+};
+
+static_assert(sizeof(TelemetryFrame) == 32, "Telemetry frame layout changed, bump TELEMETRY_SCHEMA_VERSION");
+
+TelemetryFrame create_telemetry_frame(const SystemStatus *status, uint32_t sequence, int8_t rssi, bool watchdogReboot);
+// For frames built per control cycle, straight from the status message
+TelemetryFrame create_telemetry_frame(const SystemControllerStatusMessage &message, float brewTempOffset, float rp2040Temperature, uint32_t sequence, int8_t rssi, bool watchdogReboot);
+
+// Shot stream batches are published on <prefix>/<identifier>/shot while brewing. Each batch is a header followed by
+// sampleCount samples, one per control cycle.
+#define SHOT_STREAM_SCHEMA_ID ((uint16_t)0x4C53)
+#define SHOT_STREAM_SCHEMA_VERSION ((uint8_t)1)
+
+typedef enum : uint8_t {
+    SHOT_SAMPLE_FLAG_BREW_SSR_ON = 1 << 0,
+    SHOT_SAMPLE_FLAG_SERVICE_SSR_ON = 1 << 1,
+    SHOT_SAMPLE_FLAG_BREWING = 1 << 2,
+    SHOT_SAMPLE_FLAG_BREW_HYSTERESIS_MODE = 1 << 3,
+} ShotSampleFlag;
+
+struct __attribute__((packed)) ShotStreamHeader {
+    uint16_t schemaId{};
+    uint8_t schemaVersion{};
+    uint8_t sampleCount{};
+    uint16_t shotId{};
+    uint16_t batchSequence{};
+    // Samples lost since the previous batch because the buffer was full
+    uint16_t droppedSamples{};
+};
+
+// Same scaling as TelemetryFrame. The timestamp is the control cycle timestamp.
+struct __attribute__((packed)) ShotSample {
+    uint32_t timestampMs{};
+    int16_t brewTemperature{};
+    int16_t brewSetPoint{};
+    int16_t brewP{};
+    int16_t brewI{};
+    int16_t brewD{};
+    uint8_t flags{};
+};
+
+static_assert(sizeof(ShotStreamHeader) == 10, "Shot stream header layout changed, bump SHOT_STREAM_SCHEMA_VERSION");
+static_assert(sizeof(ShotSample) == 15, "Shot sample layout changed, bump SHOT_STREAM_SCHEMA_VERSION");
+
+ShotSample create_shot_sample(const SystemControllerStatusMessage &message, float brewTempOffset);
+
+#endif //FIRMWARE_ARDUINO_TELEMETRY_PROTOCOL_H
@@ -38,6 +38,11 @@ struct PidSettings {
     float Kd{};
     float windupLow{};
     float windupHigh{};
+
+    inline bool operator==(const PidSettings &other) const {
+        return Kp == other.Kp && Ki == other.Ki && Kd == other.Kd && windupLow == other.windupLow && windupHigh == other.windupHigh;
+    }
+    inline bool operator!=(const PidSettings &other) const { return !(*this == other); }
 };
 
 struct PidRuntimeParameters {
@@ -48,13 +53,15 @@ struct PidRuntimeParameters {
     float integral = 0;
 };
 
+#define AUTO_SLEEP_MAX_MIN 300
+
 struct SettingStruct {
     float brewTemperatureOffset = -10;
     bool sleepMode = false;
     bool ecoMode = false;
     float brewTemperatureTarget = 105;
     float serviceTemperatureTarget = 120;
-    uint16_t autoSleepMin = 0;
+    uint16_t autoSleepMin = 0; // At most AUTO_SLEEP_MAX_MIN
     PidSettings brewPidParameters = PidSettings{.Kp = 0.8, .Ki = 0.12, .Kd = 12.0, .windupLow = -7.f, .windupHigh = 7.f};
     PidSettings servicePidParameters = PidSettings{.Kp = 0.6, .Ki = 0.1, .Kd = 1.0, .windupLow = -10.f, .windupHigh = 10.f};
 };
@@ -0,0 +1,33 @@
+#include "base64.h"
+
+static const char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64_encode(const uint8_t *in, size_t length, char *out, size_t outSize) {
+    size_t encodedLength = BASE64_ENCODED_LENGTH(length);
+
+    if (encodedLength >= outSize) {
+        return 0;
+    }
+
+    char* pout = out;
+
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t triple = (uint32_t)in[i] << 16;
+
+        if (i + 1 < length) {
+            triple |= (uint32_t)in[i + 1] << 8;
+        }
+
+        if (i + 2 < length) {
+            triple |= in[i + 2];
+        }
+
+        *pout++ = base64Alphabet[(triple >> 18) & 0x3F];
+        *pout++ = base64Alphabet[(triple >> 12) & 0x3F];
+        *pout++ = i + 1 < length ? base64Alphabet[(triple >> 6) & 0x3F] : '=';
+        *pout++ = i + 2 < length ? base64Alphabet[triple & 0x3F] : '=';
+    }
+
+    *pout = '\0';
+    return encodedLength;
+}
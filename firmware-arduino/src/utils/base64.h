@@ -0,0 +1,13 @@
+#ifndef FIRMWARE_ARDUINO_BASE64_H
+#define FIRMWARE_ARDUINO_BASE64_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Encoded length, excluding the NUL terminator
+#define BASE64_ENCODED_LENGTH(length) ((((length) + 2) / 3) * 4)
+
+// Standard alphabet with padding. Returns the encoded length, or 0 if the output (including the NUL) doesn't fit.
+size_t base64_encode(const uint8_t *in, size_t length, char *out, size_t outSize);
+
+#endif //FIRMWARE_ARDUINO_BASE64_H
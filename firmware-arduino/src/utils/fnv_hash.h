@@ -0,0 +1,31 @@
+#ifndef FIRMWARE_ARDUINO_FNV_HASH_H
+#define FIRMWARE_ARDUINO_FNV_HASH_H
+
+#include <cstdint>
+#include <cstddef>
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+// 32-bit FNV-1a. Usable at compile time, so tables can be keyed on hashes of string literals.
+constexpr uint32_t fnv1a_hash(const char *str) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (; *str != '\0'; str++) {
+        hash = (hash ^ (uint8_t)*str) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+inline uint32_t fnv1a_hash(const uint8_t *buf, size_t len) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ buf[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+#endif //FIRMWARE_ARDUINO_FNV_HASH_H
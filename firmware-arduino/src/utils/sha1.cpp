@@ -0,0 +1,87 @@
+#include "sha1.h"
+#include <cstring>
+
+static inline uint32_t rotate_left(uint32_t value, uint8_t bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1_block(uint32_t state[5], const uint8_t block[64]) {
+    uint32_t w[80];
+
+    for (uint8_t i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 | (uint32_t)block[i * 4 + 2] << 8 | block[i * 4 + 3];
+    }
+
+    for (uint8_t i = 16; i < 80; i++) {
+        w[i] = rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+    for (uint8_t i = 0; i < 80; i++) {
+        uint32_t f, k;
+
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        uint32_t temp = rotate_left(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotate_left(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void sha1(const uint8_t *data, size_t length, uint8_t digest[SHA1_DIGEST_SIZE]) {
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    uint8_t block[64];
+    size_t offset = 0;
+
+    for (; offset + 64 <= length; offset += 64) {
+        sha1_block(state, data + offset);
+    }
+
+    // The tail, a 1 bit, zero padding and the length in bits, spilling into a second block if needed
+    size_t remaining = length - offset;
+    memset(block, 0, sizeof(block));
+    memcpy(block, data + offset, remaining);
+    block[remaining] = 0x80;
+
+    if (remaining >= 56) {
+        sha1_block(state, block);
+        memset(block, 0, sizeof(block));
+    }
+
+    uint64_t bits = (uint64_t)length * 8;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        block[63 - i] = (uint8_t)(bits >> (i * 8));
+    }
+
+    sha1_block(state, block);
+
+    for (uint8_t i = 0; i < 5; i++) {
+        digest[i * 4] = (uint8_t)(state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)state[i];
+    }
+}
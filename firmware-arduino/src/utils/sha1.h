@@ -0,0 +1,12 @@
+#ifndef FIRMWARE_ARDUINO_SHA1_H
+#define FIRMWARE_ARDUINO_SHA1_H
+
+#include <cstdint>
+#include <cstddef>
+
+#define SHA1_DIGEST_SIZE 20
+
+// One-shot SHA-1, for the WebSocket handshake. Not for anything that needs to be secure.
+void sha1(const uint8_t *data, size_t length, uint8_t digest[SHA1_DIGEST_SIZE]);
+
+#endif //FIRMWARE_ARDUINO_SHA1_H
@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""
+Decoder for the binary telemetry frames published on <prefix>/<identifier>/tele, the shot stream batches
+published on <prefix>/<identifier>/shot while brewing, and the black box served on http://<device>/blackbox.
+
+The layouts mirror TelemetryFrame, ShotStreamHeader and ShotSample in src/telemetry_protocol.h. Telemetry frames are
+enabled by sending {"cmd": "set_telemetry_interval", "int_value": <ms>} to the command topic. Shot batches are always
+published while brewing.
+
+The black box layout mirrors BlackBoxHeader and BlackBoxEntry in src/BlackBox.h. It holds the last control cycles
+before the most recent watchdog reset.
+
+Usage:
+    mosquitto_sub -h <broker> -t 'lcc/+/tele' -t 'lcc/+/shot' -F %x | python3 telemetry_decode.py
+    curl -s http://<device>/blackbox | xxd -p | tr -d '\n' | python3 telemetry_decode.py
+"""
+
+import json
+import struct
+import sys
+
+SCHEMA_ID = 0x4C43
+SCHEMA_VERSION = 1
+
+FRAME = struct.Struct("<HBBIIhhhhhhhhBBbb")
+
+SHOT_SCHEMA_ID = 0x4C53
+SHOT_SCHEMA_VERSION = 1
+
+SHOT_HEADER = struct.Struct("<HBBHHH")
+SHOT_SAMPLE = struct.Struct("<IhhhhhB")
+
+BLACK_BOX_SCHEMA_ID = 0x4C42
+BLACK_BOX_SCHEMA_VERSION = 1
+
+BLACK_BOX_HEADER = struct.Struct("<HBBHH")
+BLACK_BOX_ENTRY = struct.Struct("<III18s5shhBBBI")
+
+STATES = [
+    "Undetermined",
+    "Heatup",
+    "Temperatures normalizing",
+    "Warm",
+    "Sleeping",
+    "Bailed",
+    "First run",
+]
+
+BAIL_REASONS = [
+    "None",
+    "CB unresponsive",
+    "CB packet invalid",
+    "LCC packet invalid",
+    "SSR queue empty",
+]
+
+FLAGS = [
+    "brew_ssr_on",
+    "service_ssr_on",
+    "eco_mode",
+    "brewing",
+    "filling_service_boiler",
+    "water_tank_low",
+    "brew_hysteresis_mode",
+    "watchdog_reboot",
+]
+
+SHOT_FLAGS = [
+    "brew_ssr_on",
+    "service_ssr_on",
+    "brewing",
+    "brew_hysteresis_mode",
+]
+
+
+INTERNAL_STATES = [
+    "Undetermined",
+    "Heatup stage 1",
+    "Heatup stage 2",
+    "Running",
+    "Sleeping",
+    "Soft bailed",
+    "Hard bailed",
+]
+
+BLACK_BOX_FLAGS = [
+    "control_board_responded",
+    "brew_ssr_on",
+    "service_ssr_on",
+    "safe_packet_sent",
+    "status_queue_full",
+]
+
+
+def lookup(names, index):
+    return names[index] if index < len(names) else "Unknown (%d)" % index
+
+
+def decode(payload):
+    if len(payload) < FRAME.size:
+        raise ValueError("Frame too short: %d bytes" % len(payload))
+
+    (schema_id, version, flags, sequence, timestamp_ms,
+     brew_temp, brew_set_point, service_temp, service_set_point,
+     brew_p, brew_i, brew_d, brew_integral,
+     state, bail_reason, rssi, rp2040_temp) = FRAME.unpack_from(payload)
+
+    if schema_id != SCHEMA_ID:
+        raise ValueError("Unknown schema ID 0x%04x" % schema_id)
+    if version != SCHEMA_VERSION:
+        raise ValueError("Unsupported schema version %d" % version)
+
+    frame = {
+        "seq": sequence,
+        "timestamp_ms": timestamp_ms,
+        "brew_temperature": brew_temp / 100.0,
+        "brew_set_point": brew_set_point / 100.0,
+        "service_temperature": service_temp / 100.0,
+        "service_set_point": service_set_point / 100.0,
+        "brew_pid": {
+            "p": brew_p / 1000.0,
+            "i": brew_i / 1000.0,
+            "d": brew_d / 1000.0,
+            "integral": brew_integral / 1000.0,
+        },
+        "state": lookup(STATES, state),
+        "bail_reason": lookup(BAIL_REASONS, bail_reason),
+        "rssi": rssi,
+        "rp2040_temperature": rp2040_temp,
+    }
+
+    for bit, name in enumerate(FLAGS):
+        frame[name] = bool(flags & (1 << bit))
+
+    return frame
+
+
+def decode_shot(payload):
+    if len(payload) < SHOT_HEADER.size:
+        raise ValueError("Batch too short: %d bytes" % len(payload))
+
+    _, version, sample_count, shot_id, batch_sequence, dropped = SHOT_HEADER.unpack_from(payload)
+
+    if version != SHOT_SCHEMA_VERSION:
+        raise ValueError("Unsupported shot schema version %d" % version)
+    if len(payload) < SHOT_HEADER.size + sample_count * SHOT_SAMPLE.size:
+        raise ValueError("Batch truncated: %d bytes for %d samples" % (len(payload), sample_count))
+
+    samples = []
+    for n in range(sample_count):
+        (timestamp_ms, brew_temp, brew_set_point, brew_p, brew_i, brew_d,
+         flags) = SHOT_SAMPLE.unpack_from(payload, SHOT_HEADER.size + n * SHOT_SAMPLE.size)
+
+        sample = {
+            "timestamp_ms": timestamp_ms,
+            "brew_temperature": brew_temp / 100.0,
+            "brew_set_point": brew_set_point / 100.0,
+            "brew_pid": {
+                "p": brew_p / 1000.0,
+                "i": brew_i / 1000.0,
+                "d": brew_d / 1000.0,
+            },
+        }
+
+        for bit, name in enumerate(SHOT_FLAGS):
+            sample[name] = bool(flags & (1 << bit))
+
+        samples.append(sample)
+
+    return {
+        "shot": shot_id,
+        "batch": batch_sequence,
+        "dropped_samples": dropped,
+        "samples": samples,
+    }
+
+
+def decode_black_box(payload):
+    if len(payload) < BLACK_BOX_HEADER.size:
+        raise ValueError("Black box too short: %d bytes" % len(payload))
+
+    _, version, entry_size, entry_count, _ = BLACK_BOX_HEADER.unpack_from(payload)
+
+    if version != BLACK_BOX_SCHEMA_VERSION or entry_size != BLACK_BOX_ENTRY.size:
+        raise ValueError("Unsupported black box schema version %d" % version)
+    if len(payload) < BLACK_BOX_HEADER.size + entry_count * BLACK_BOX_ENTRY.size:
+        raise ValueError("Black box truncated: %d bytes for %d entries" % (len(payload), entry_count))
+
+    entries = []
+    for n in range(entry_count):
+        (sequence, cycle_start_us, cycle_end_us, control_board_packet, lcc_packet,
+         brew_temp, service_temp, internal_state, bail_reason, flags,
+         _) = BLACK_BOX_ENTRY.unpack_from(payload, BLACK_BOX_HEADER.size + n * BLACK_BOX_ENTRY.size)
+
+        entry = {
+            "seq": sequence,
+            "cycle_start_us": cycle_start_us,
+            "cycle_us": (cycle_end_us - cycle_start_us) & 0xFFFFFFFF,
+            "control_board_packet": control_board_packet.hex(),
+            "lcc_packet": lcc_packet.hex(),
+            "brew_temperature": brew_temp / 10.0,
+            "service_temperature": service_temp / 10.0,
+            "state": lookup(INTERNAL_STATES, internal_state),
+            "bail_reason": lookup(BAIL_REASONS, bail_reason),
+        }
+
+        for bit, name in enumerate(BLACK_BOX_FLAGS):
+            entry[name] = bool(flags & (1 << bit))
+
+        entries.append(entry)
+
+    return {"black_box": entries}
+
+
+def decode_any(payload):
+    if len(payload) >= 2:
+        (schema_id,) = struct.unpack_from("<H", payload)
+        if schema_id == SHOT_SCHEMA_ID:
+            return decode_shot(payload)
+        if schema_id == BLACK_BOX_SCHEMA_ID:
+            return decode_black_box(payload)
+
+    return decode(payload)
+
+
+def main():
+    for line in sys.stdin:
+        line = line.strip()
+        if not line:
+            continue
+        try:
+            print(json.dumps(decode_any(bytes.fromhex(line))))
+        except ValueError as e:
+            print("Skipping frame: %s" % e, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,125 @@
+// Built into the spec, so that a watchdog reset can be simulated by clearing what a chip boot clears, and keeping the
+// ring in uninitialized RAM as it is
+#include "BlackBox.cpp"
+#include "BDDTest.h"
+
+// What a watchdog reset leaves behind: the ring as it was, and core 0 not recording yet
+void watchdogReset() {
+    recording = false;
+}
+
+void recordCycles(uint32_t cycles) {
+    for (uint32_t i = 0; i < cycles; i++) {
+        BlackBoxEntry entry{};
+        entry.cycleStartUs = i * 100000;
+        entry.cycleEndUs = entry.cycleStartUs + 2500;
+        entry.brewTemperature = (int16_t)(900 + i);
+        black_box_record(entry);
+    }
+}
+
+const BlackBoxEntry* recoveredEntries(const uint8_t* data) {
+    return (const BlackBoxEntry*)(data + sizeof(BlackBoxHeader));
+}
+
+int test_black_box_power_on() {
+    IT("recovers nothing after power on");
+    const uint8_t* data = nullptr;
+
+    // The magic doesn't match whatever the RAM came up with
+    IS_EQUAL(black_box_recover(&data), 0);
+
+    END_IT
+}
+
+int test_black_box_not_while_recording() {
+    IT("recovers nothing once core 0 has begun recording");
+    const uint8_t* data = nullptr;
+
+    black_box_begin();
+    recordCycles(10);
+    IS_EQUAL(black_box_recover(&data), 0);
+
+    END_IT
+}
+
+int test_black_box_oldest_first() {
+    IT("recovers the last cycles before the reset, oldest first, once the ring has wrapped");
+    const uint8_t* data = nullptr;
+
+    black_box_begin();
+    recordCycles(BLACK_BOX_ENTRIES + 23);
+    watchdogReset();
+
+    IS_EQUAL(black_box_recover(&data), sizeof(BlackBoxHeader) + BLACK_BOX_ENTRIES * sizeof(BlackBoxEntry));
+
+    const BlackBoxHeader* header = (const BlackBoxHeader*)data;
+    IS_EQUAL(header->schemaId, BLACK_BOX_SCHEMA_ID);
+    IS_EQUAL(header->schemaVersion, BLACK_BOX_SCHEMA_VERSION);
+    IS_EQUAL(header->entrySize, sizeof(BlackBoxEntry));
+    IS_EQUAL(header->entryCount, BLACK_BOX_ENTRIES);
+
+    const BlackBoxEntry* entries = recoveredEntries(data);
+    IS_EQUAL(entries[0].sequence, 24);
+    IS_EQUAL(entries[0].brewTemperature, 923);
+    IS_EQUAL(entries[BLACK_BOX_ENTRIES - 1].sequence, BLACK_BOX_ENTRIES + 23);
+
+    for (uint16_t i = 1; i < BLACK_BOX_ENTRIES; i++) {
+        IS_EQUAL(entries[i].sequence, entries[i - 1].sequence + 1);
+    }
+
+    END_IT
+}
+
+int test_black_box_torn_entries() {
+    IT("leaves out entries torn by the reset, and keeps the rest in order");
+    const uint8_t* data = nullptr;
+
+    black_box_begin();
+    recordCycles(10);
+
+    // The reset hit while the last entry was being copied in. One before it was corrupted in RAM.
+    blackBoxRing.entries[10].brewTemperature++;
+    blackBoxRing.entries[4].flags ^= BLACK_BOX_FLAG_BREW_SSR_ON;
+    watchdogReset();
+
+    IS_EQUAL(black_box_recover(&data), sizeof(BlackBoxHeader) + 8 * sizeof(BlackBoxEntry));
+
+    const uint32_t expected[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+    const BlackBoxEntry* entries = recoveredEntries(data);
+    for (uint16_t i = 0; i < 8; i++) {
+        IS_EQUAL(entries[i].sequence, expected[i]);
+    }
+
+    END_IT
+}
+
+int test_black_box_recovered_once() {
+    IT("recovers a black box only once, even across another reset");
+    const uint8_t* data = nullptr;
+
+    black_box_begin();
+    recordCycles(5);
+    watchdogReset();
+
+    IS_EQUAL(black_box_recover(&data), sizeof(BlackBoxHeader) + 5 * sizeof(BlackBoxEntry));
+    IS_EQUAL(black_box_recover(&data), 0);
+
+    // Core 1 hung again before core 0 began recording
+    watchdogReset();
+    IS_EQUAL(black_box_recover(&data), 0);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Black box");
+    test_black_box_power_on();
+    test_black_box_not_while_recording();
+    test_black_box_oldest_first();
+    test_black_box_torn_entries();
+    test_black_box_recovered_once();
+
+    FINISH
+}
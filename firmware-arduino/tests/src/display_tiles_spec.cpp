@@ -0,0 +1,130 @@
+#include "DisplayTiles.h"
+#include "BDDTest.h"
+#include <cstring>
+#include <vector>
+
+struct Area {
+    uint8_t tileX;
+    uint8_t tileY;
+    uint8_t tilesWide;
+    uint8_t tilesHigh;
+
+    bool operator==(const Area &other) const {
+        return tileX == other.tileX && tileY == other.tileY && tilesWide == other.tilesWide && tilesHigh == other.tilesHigh;
+    }
+};
+
+struct Panel {
+    std::vector<Area> areas;
+
+    DisplayAreaSender sender() {
+        return [this](uint8_t tileX, uint8_t tileY, uint8_t tilesWide, uint8_t tilesHigh) {
+            areas.push_back(Area{tileX, tileY, tilesWide, tilesHigh});
+        };
+    }
+};
+
+// Sets a pixel column in a tile, like drawing into U8g2's buffer does
+void drawInTile(uint8_t* frame, uint8_t page, uint8_t tile, uint8_t column = 0) {
+    frame[(page * UI_DISPLAY_TILES_PER_PAGE + tile) * 8 + column] ^= 0x01;
+}
+
+int test_display_tiles_first_frame_whole() {
+    IT("sends the first frame whole");
+    uint8_t frame[UI_FRAME_BUFFER_SIZE]{};
+    DisplayTiles tiles;
+    Panel panel;
+
+    IS_FALSE(tiles.knowsPanel());
+    IS_EQUAL(tiles.send(frame, panel.sender()), UI_FRAME_BUFFER_SIZE);
+    IS_EQUAL(panel.areas.size(), 1);
+    IS_TRUE(panel.areas[0] == (Area{0, 0, UI_DISPLAY_TILES_PER_PAGE, UI_DISPLAY_PAGES}));
+    IS_TRUE(tiles.knowsPanel());
+
+    // Nothing changed, so nothing goes out
+    IS_EQUAL(tiles.send(frame, panel.sender()), 0);
+    IS_EQUAL(panel.areas.size(), 1);
+
+    END_IT
+}
+
+int test_display_tiles_changed_span() {
+    IT("sends the span of tiles that changed, per page");
+    uint8_t frame[UI_FRAME_BUFFER_SIZE]{};
+    DisplayTiles tiles;
+    Panel panel;
+    tiles.send(frame, panel.sender());
+    panel.areas.clear();
+
+    // One tile in page 1, and two tiles far apart in page 5, which are sent along with the ones in between
+    drawInTile(frame, 1, 7, 3);
+    drawInTile(frame, 5, 2);
+    drawInTile(frame, 5, 12, 7);
+
+    IS_EQUAL(tiles.send(frame, panel.sender()), 8 + 11 * 8);
+    IS_EQUAL(panel.areas.size(), 2);
+    IS_TRUE(panel.areas[0] == (Area{7, 1, 1, 1}));
+    IS_TRUE(panel.areas[1] == (Area{2, 5, 11, 1}));
+
+    // The first and last tiles of the frame
+    panel.areas.clear();
+    drawInTile(frame, 0, 0);
+    drawInTile(frame, UI_DISPLAY_PAGES - 1, UI_DISPLAY_TILES_PER_PAGE - 1);
+
+    IS_EQUAL(tiles.send(frame, panel.sender()), 16);
+    IS_EQUAL(panel.areas.size(), 2);
+    IS_TRUE(panel.areas[0] == (Area{0, 0, 1, 1}));
+    IS_TRUE(panel.areas[1] == (Area{UI_DISPLAY_TILES_PER_PAGE - 1, UI_DISPLAY_PAGES - 1, 1, 1}));
+
+    END_IT
+}
+
+int test_display_tiles_compares_with_sent() {
+    IT("compares with what was sent, not with the frame before");
+    uint8_t frame[UI_FRAME_BUFFER_SIZE]{};
+    DisplayTiles tiles;
+    Panel panel;
+    tiles.send(frame, panel.sender());
+
+    // Drawn and drawn back, so the panel already shows it
+    drawInTile(frame, 3, 4);
+    IS_EQUAL(tiles.send(frame, panel.sender()), 8);
+    drawInTile(frame, 3, 4);
+    IS_EQUAL(tiles.send(frame, panel.sender()), 8);
+    IS_EQUAL(tiles.send(frame, panel.sender()), 0);
+
+    END_IT
+}
+
+int test_display_tiles_invalidate() {
+    IT("sends the whole frame again once invalidated");
+    uint8_t frame[UI_FRAME_BUFFER_SIZE]{};
+    DisplayTiles tiles;
+    Panel panel;
+    tiles.send(frame, panel.sender());
+    panel.areas.clear();
+
+    // Something drew straight to the panel, which the frame knows nothing about
+    tiles.invalidate();
+    IS_FALSE(tiles.knowsPanel());
+
+    IS_EQUAL(tiles.send(frame, panel.sender()), UI_FRAME_BUFFER_SIZE);
+    IS_EQUAL(panel.areas.size(), 1);
+    IS_TRUE(panel.areas[0] == (Area{0, 0, UI_DISPLAY_TILES_PER_PAGE, UI_DISPLAY_PAGES}));
+
+    drawInTile(frame, 6, 9);
+    IS_EQUAL(tiles.send(frame, panel.sender()), 8);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Display tiles");
+    test_display_tiles_first_frame_whole();
+    test_display_tiles_changed_span();
+    test_display_tiles_compares_with_sent();
+    test_display_tiles_invalidate();
+
+    FINISH
+}
@@ -0,0 +1,391 @@
+#include "EventQueue.h"
+#include "PubSubClient.h"
+#include "ShimClient.h"
+#include "MemoryFileStore.h"
+#include "BDDTest.h"
+#include "trace.h"
+
+#define TOPIC "lcc/event"
+
+byte server[] = { 172, 16, 0, 2 };
+
+void callback(char*, byte*, unsigned int) {
+}
+
+void connect(ShimClient &shimClient, PubSubClient &client, EventQueue &queue) {
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+    client.connect((char*)"client_test1");
+    queue.onConnected();
+}
+
+void expectEvent(ShimClient &shimClient, uint16_t msgId, const char* payload) {
+    byte packet[128];
+    size_t topicLength = strlen(TOPIC);
+    size_t payloadLength = strlen(payload);
+
+    packet[0] = 0x32;
+    packet[1] = 2 + topicLength + 2 + payloadLength;
+    packet[2] = 0;
+    packet[3] = topicLength;
+    memcpy(packet + 4, TOPIC, topicLength);
+    packet[4 + topicLength] = msgId >> 8;
+    packet[5 + topicLength] = msgId & 0xFF;
+    memcpy(packet + 6 + topicLength, payload, payloadLength);
+
+    shimClient.expect(packet, 6 + topicLength + payloadLength);
+}
+
+void acknowledge(ShimClient &shimClient, PubSubClient &client, uint16_t msgId) {
+    byte puback[] = { 0x40, 0x02, (byte)(msgId >> 8), (byte)(msgId & 0xFF) };
+    shimClient.respond(puback,4);
+    client.loop();
+}
+
+int test_event_queue_puback_gated() {
+    IT("only removes an event once the broker has acknowledged it");
+    ShimClient shimClient;
+    PubSubClient client(server, 1883, callback, shimClient);
+    MemoryFileStore store;
+    EventQueue queue(&store);
+
+    IS_TRUE(queue.enqueue("{\"e\":\"a\"}"));
+    IS_TRUE(queue.enqueue("{\"e\":\"b\"}"));
+    connect(shimClient, client, queue);
+
+    expectEvent(shimClient, 2, "{\"e\":\"a\"}");
+    host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+    queue.loop(client, TOPIC);
+    IS_EQUAL(queue.size(), 2);
+
+    // Nothing else goes out while the first event is in flight
+    host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS * 4);
+    uint16_t received = shimClient.received();
+    queue.loop(client, TOPIC);
+    IS_EQUAL(shimClient.received(), received);
+
+    acknowledge(shimClient, client, 2);
+    queue.loop(client, TOPIC);
+    IS_EQUAL(queue.size(), 1);
+
+    expectEvent(shimClient, 3, "{\"e\":\"b\"}");
+    host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+    queue.loop(client, TOPIC);
+    acknowledge(shimClient, client, 3);
+    queue.loop(client, TOPIC);
+    IS_EQUAL(queue.size(), 0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_event_queue_resend_after_timeout() {
+    IT("resends an event that isn't acknowledged in time");
+    ShimClient shimClient;
+    PubSubClient client(server, 1883, callback, shimClient);
+    MemoryFileStore store;
+    EventQueue queue(&store);
+
+    queue.enqueue("{\"e\":\"a\"}");
+    connect(shimClient, client, queue);
+
+    expectEvent(shimClient, 2, "{\"e\":\"a\"}");
+    host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+    queue.loop(client, TOPIC);
+
+    uint16_t received = shimClient.received();
+    host_time_advance_ms(EVENT_PUBACK_TIMEOUT_MS);
+    queue.loop(client, TOPIC);
+    IS_EQUAL(shimClient.received(), received);
+
+    expectEvent(shimClient, 3, "{\"e\":\"a\"}");
+    host_time_advance_ms(1);
+    queue.loop(client, TOPIC);
+    IS_EQUAL(queue.size(), 1);
+
+    // A late acknowledgement of the first attempt doesn't count for the second
+    acknowledge(shimClient, client, 2);
+    queue.loop(client, TOPIC);
+    IS_EQUAL(queue.size(), 1);
+
+    acknowledge(shimClient, client, 3);
+    queue.loop(client, TOPIC);
+    IS_EQUAL(queue.size(), 0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_event_queue_resend_after_reconnect() {
+    IT("resends the event in flight after a reconnect");
+    ShimClient shimClient;
+    PubSubClient client(server, 1883, callback, shimClient);
+    MemoryFileStore store;
+    EventQueue queue(&store);
+
+    queue.enqueue("{\"e\":\"a\"}");
+    connect(shimClient, client, queue);
+
+    expectEvent(shimClient, 2, "{\"e\":\"a\"}");
+    host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+    queue.loop(client, TOPIC);
+
+    shimClient.setConnected(false);
+    queue.loop(client, TOPIC);
+    IS_EQUAL(queue.size(), 1);
+
+    byte connectPacket[] = {0x10,0x18,0x0,0x4,0x4d,0x51,0x54,0x54,0x4,0x2,0x0,0xf,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    shimClient.expect(connectPacket,26);
+    connect(shimClient, client, queue);
+
+    // Not before the drain interval after the reconnect
+    uint16_t received = shimClient.received();
+    queue.loop(client, TOPIC);
+    IS_EQUAL(shimClient.received(), received);
+
+    expectEvent(shimClient, 2, "{\"e\":\"a\"}");
+    host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+    queue.loop(client, TOPIC);
+    acknowledge(shimClient, client, 2);
+    queue.loop(client, TOPIC);
+    IS_EQUAL(queue.size(), 0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_event_queue_drain_rate() {
+    IT("sends events no faster than the drain interval");
+    ShimClient shimClient;
+    PubSubClient client(server, 1883, callback, shimClient);
+    MemoryFileStore store;
+    EventQueue queue(&store);
+
+    char payload[16];
+
+    for (uint8_t i = 0; i < 5; i++) {
+        snprintf(payload, sizeof(payload), "{\"n\":%u}", i);
+        queue.enqueue(payload);
+    }
+
+    connect(shimClient, client, queue);
+
+    // Acknowledgements come straight back, so the drain interval is all that holds events back
+    uint32_t elapsedMs = 0;
+    uint16_t msgId = 2;
+
+    while (queue.size() > 0 && elapsedMs < 10000) {
+        uint16_t received = shimClient.received();
+        queue.loop(client, TOPIC);
+
+        if (shimClient.received() != received) {
+            acknowledge(shimClient, client, msgId++);
+            queue.loop(client, TOPIC);
+        }
+
+        host_time_advance_ms(10);
+        elapsedMs += 10;
+    }
+
+    IS_EQUAL(queue.size(), 0);
+    IS_EQUAL(msgId, 7);
+    // The first waits out the interval after connecting, then one per interval
+    IS_TRUE(elapsedMs >= 5 * EVENT_DRAIN_INTERVAL_MS);
+    IS_TRUE(elapsedMs <= 5 * EVENT_DRAIN_INTERVAL_MS + 5 * 10);
+
+    END_IT
+}
+
+int test_event_queue_spill_ordering() {
+    IT("spills to flash once the ram queue is full, and keeps the order");
+    ShimClient shimClient;
+    PubSubClient client(server, 1883, callback, shimClient);
+    MemoryFileStore store;
+    EventQueue queue(&store);
+
+    char payload[16];
+    uint8_t total = EVENT_QUEUE_CAPACITY + 3;
+
+    for (uint8_t i = 0; i < total; i++) {
+        snprintf(payload, sizeof(payload), "{\"n\":%u}", i);
+        IS_TRUE(queue.enqueue(payload));
+    }
+
+    IS_EQUAL(queue.size(), total);
+    IS_EQUAL(store.size(EVENT_SPILL_FILENAME), 3 * sizeof(QueuedEvent));
+
+    connect(shimClient, client, queue);
+
+    for (uint8_t i = 0; i < total; i++) {
+        snprintf(payload, sizeof(payload), "{\"n\":%u}", i);
+        expectEvent(shimClient, 2 + i, payload);
+
+        host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+        queue.loop(client, TOPIC);
+        acknowledge(shimClient, client, 2 + i);
+        queue.loop(client, TOPIC);
+    }
+
+    IS_EQUAL(queue.size(), 0);
+    IS_FALSE(store.exists(EVENT_SPILL_FILENAME));
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_event_queue_flash_writes() {
+    IT("only writes to flash to spill, and once to remove the spill file after the last acknowledgement");
+    MemoryFileStore store;
+    EventQueue queue(&store);
+
+    for (uint8_t i = 0; i < EVENT_QUEUE_CAPACITY; i++) {
+        queue.enqueue("{}");
+    }
+
+    IS_EQUAL(queue.getFlashWrites(), 0);
+    IS_EQUAL(store.writes, 0);
+
+    queue.enqueue("{}");
+    queue.enqueue("{}");
+    IS_EQUAL(queue.getFlashWrites(), 2);
+    IS_EQUAL(store.writes, 2);
+
+    ShimClient shimClient;
+    PubSubClient client(server, 1883, callback, shimClient);
+    connect(shimClient, client, queue);
+
+    for (uint16_t msgId = 2; msgId < 2 + EVENT_QUEUE_CAPACITY + 1; msgId++) {
+        host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+        queue.loop(client, TOPIC);
+        acknowledge(shimClient, client, msgId);
+        queue.loop(client, TOPIC);
+    }
+
+    // Both spilled events were read back, but one is still waiting for its acknowledgement
+    IS_EQUAL(queue.size(), 1);
+    IS_TRUE(store.exists(EVENT_SPILL_FILENAME));
+    IS_EQUAL(store.writes, 2);
+
+    host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+    queue.loop(client, TOPIC);
+    IS_TRUE(store.exists(EVENT_SPILL_FILENAME));
+    acknowledge(shimClient, client, 2 + EVENT_QUEUE_CAPACITY + 1);
+    queue.loop(client, TOPIC);
+
+    IS_EQUAL(queue.size(), 0);
+    IS_FALSE(store.exists(EVENT_SPILL_FILENAME));
+    IS_EQUAL(queue.getFlashWrites(), 3);
+    IS_EQUAL(store.writes, 3);
+
+    END_IT
+}
+
+int test_event_queue_recovers_spill() {
+    IT("picks up events spilled before a reboot");
+    MemoryFileStore store;
+
+    {
+        EventQueue queue(&store);
+
+        for (uint8_t i = 0; i < EVENT_QUEUE_CAPACITY + 2; i++) {
+            queue.enqueue("{}");
+        }
+    }
+
+    EventQueue queue(&store);
+    queue.init();
+    IS_EQUAL(queue.size(), 2);
+
+    END_IT
+}
+
+int test_event_queue_reboot_before_puback() {
+    IT("keeps spilled events that were read back, but not acknowledged, across a reboot");
+    MemoryFileStore store;
+    char payload[16];
+
+    {
+        ShimClient shimClient;
+        PubSubClient client(server, 1883, callback, shimClient);
+        EventQueue queue(&store);
+        queue.init();
+
+        for (uint8_t i = 0; i < EVENT_QUEUE_CAPACITY + 2; i++) {
+            snprintf(payload, sizeof(payload), "{\"n\":%u}", i);
+            queue.enqueue(payload);
+        }
+
+        connect(shimClient, client, queue);
+
+        for (uint16_t msgId = 2; msgId < 2 + EVENT_QUEUE_CAPACITY; msgId++) {
+            host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+            queue.loop(client, TOPIC);
+            acknowledge(shimClient, client, msgId);
+            queue.loop(client, TOPIC);
+        }
+
+        // The spilled events are read back and the first is sent, then the power goes before the PUBACK
+        host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+        queue.loop(client, TOPIC);
+        IS_EQUAL(queue.size(), 2);
+    }
+
+    ShimClient shimClient;
+    PubSubClient client(server, 1883, callback, shimClient);
+    EventQueue queue(&store);
+    queue.init();
+    IS_EQUAL(queue.size(), 2);
+
+    connect(shimClient, client, queue);
+
+    for (uint8_t i = EVENT_QUEUE_CAPACITY; i < EVENT_QUEUE_CAPACITY + 2; i++) {
+        snprintf(payload, sizeof(payload), "{\"n\":%u}", i);
+        expectEvent(shimClient, 2 + i - EVENT_QUEUE_CAPACITY, payload);
+
+        host_time_advance_ms(EVENT_DRAIN_INTERVAL_MS);
+        queue.loop(client, TOPIC);
+        acknowledge(shimClient, client, 2 + i - EVENT_QUEUE_CAPACITY);
+        queue.loop(client, TOPIC);
+    }
+
+    IS_EQUAL(queue.size(), 0);
+    IS_FALSE(store.exists(EVENT_SPILL_FILENAME));
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_event_queue_spill_limit() {
+    IT("drops events once the spill file is full");
+    MemoryFileStore store;
+    EventQueue queue(&store);
+
+    for (uint16_t i = 0; i < EVENT_QUEUE_CAPACITY + EVENT_SPILL_MAX_EVENTS; i++) {
+        IS_TRUE(queue.enqueue("{}"));
+    }
+
+    IS_FALSE(queue.enqueue("{}"));
+    IS_EQUAL(queue.getDroppedEvents(), 1);
+    IS_EQUAL(queue.size(), EVENT_QUEUE_CAPACITY + EVENT_SPILL_MAX_EVENTS);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Event queue");
+    test_event_queue_puback_gated();
+    test_event_queue_resend_after_timeout();
+    test_event_queue_resend_after_reconnect();
+    test_event_queue_drain_rate();
+    test_event_queue_spill_ordering();
+    test_event_queue_flash_writes();
+    test_event_queue_recovers_spill();
+    test_event_queue_reboot_before_puback();
+    test_event_queue_spill_limit();
+
+    FINISH
+}
@@ -0,0 +1,144 @@
+#include "FaultLog.h"
+#include "MemoryFileStore.h"
+#include "BDDTest.h"
+#include <cstring>
+
+bool readRecord(MemoryFileStore &store, uint32_t sequence, FaultRecord &record) {
+    size_t offset = (sequence % FAULT_LOG_SLOTS) * sizeof(FaultRecord);
+    return store.read(FAULT_LOG_FILENAME, offset, (uint8_t*)&record, sizeof(record)) == sizeof(record) &&
+           record.sequence == sequence;
+}
+
+void addCycle(FaultLog &log, float brewTemperature, SystemControllerBailReason bailReason = BAIL_REASON_NONE) {
+    SystemControllerStatusMessage message{};
+    message.timestamp = get_absolute_time();
+    message.brewTemperature = brewTemperature;
+    message.bailReason = bailReason;
+    log.addStatusMessage(message);
+    host_time_advance_ms(100);
+}
+
+// Writes out everything that's pending, like core 1's loop does
+void flush(FaultLog &log) {
+    for (int i = 0; i < FAULT_LOG_PENDING; i++) {
+        log.loop();
+    }
+}
+
+// The power on every spec starts from, which clears what earlier specs left in the snapshot ring
+void powerOn(MemoryFileStore &store) {
+    FaultLog log(&store);
+    log.init(false, false);
+    flush(log);
+}
+
+int test_fault_log_power_on() {
+    IT("records a power on without any cycles");
+    MemoryFileStore store;
+    FaultLog log(&store);
+    log.init(false, false);
+    flush(log);
+
+    FaultRecord record;
+    IS_TRUE(readRecord(store, 1, record));
+    IS_EQUAL(record.type, FAULT_EVENT_POWER_ON);
+    IS_EQUAL(record.snapshotCount, 0);
+
+    END_IT
+}
+
+int test_fault_log_watchdog_reset() {
+    IT("records the cycles leading up to a watchdog reset, once");
+    MemoryFileStore store;
+    powerOn(store);
+
+    FaultLog beforeReset(&store);
+    beforeReset.init(false, false);
+    addCycle(beforeReset, 90.f);
+    addCycle(beforeReset, 91.f);
+    addCycle(beforeReset, 92.f);
+
+    FaultLog afterReset(&store);
+    afterReset.init(true, false);
+    afterReset.record(FAULT_EVENT_WIFI_MODULE_RESET);
+    flush(afterReset);
+
+    // The boot record before the reset was never written, so the log carries on from the power on
+    FaultRecord record;
+    IS_TRUE(readRecord(store, 2, record));
+    IS_EQUAL(record.type, FAULT_EVENT_WATCHDOG_RESET);
+    IS_EQUAL(record.snapshotCount, 3);
+    IS_EQUAL(record.snapshots[0].brewTemperature, 900);
+    IS_EQUAL(record.snapshots[2].brewTemperature, 920);
+
+    IS_TRUE(readRecord(store, 3, record));
+    IS_EQUAL(record.snapshotCount, 0);
+
+    END_IT
+}
+
+int test_fault_log_core1_relaunch() {
+    IT("records a core 1 relaunch with the cycles before it, instead of a boot");
+    MemoryFileStore store;
+    powerOn(store);
+
+    FaultLog log(&store);
+    log.init(false, false);
+    flush(log);
+    addCycle(log, 95.f);
+    addCycle(log, 96.f);
+
+    // setup1() runs again on the same objects, and the watchdog flag is whatever the last chip boot left
+    log.init(true, true);
+    flush(log);
+
+    FaultRecord record;
+    IS_TRUE(readRecord(store, 3, record));
+    IS_EQUAL(record.type, FAULT_EVENT_CORE1_RESET);
+    IS_EQUAL(record.snapshotCount, 2);
+    IS_EQUAL(record.snapshots[1].brewTemperature, 960);
+    IS_FALSE(readRecord(store, 4, record));
+    IS_EQUAL(log.getRecordedFaults(), 3);
+
+    // Core 0 never stopped, so the ring carries on
+    addCycle(log, 97.f);
+    log.record(FAULT_EVENT_WIFI_MODULE_RESET);
+    flush(log);
+    IS_TRUE(readRecord(store, 4, record));
+    IS_EQUAL(record.snapshotCount, 3);
+
+    END_IT
+}
+
+int test_fault_log_bail() {
+    IT("records a bail once, when the reason changes");
+    MemoryFileStore store;
+    powerOn(store);
+
+    FaultLog log(&store);
+    log.init(false, false);
+    addCycle(log, 100.f);
+    addCycle(log, 101.f, BAIL_REASON_CB_UNRESPONSIVE);
+    addCycle(log, 101.f, BAIL_REASON_CB_UNRESPONSIVE);
+    flush(log);
+
+    FaultRecord record;
+    IS_TRUE(readRecord(store, 3, record));
+    IS_EQUAL(record.type, FAULT_EVENT_BAIL);
+    IS_EQUAL(record.bailReason, BAIL_REASON_CB_UNRESPONSIVE);
+    IS_EQUAL(record.snapshotCount, 2);
+    IS_FALSE(readRecord(store, 4, record));
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Fault log");
+    test_fault_log_power_on();
+    test_fault_log_watchdog_reset();
+    test_fault_log_core1_relaunch();
+    test_fault_log_bail();
+
+    FINISH
+}
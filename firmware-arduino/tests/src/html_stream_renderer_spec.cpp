@@ -0,0 +1,149 @@
+#include "HtmlStreamRenderer.h"
+#include "BDDTest.h"
+#include "trace.h"
+#include <string>
+#include <vector>
+
+struct Capture {
+    std::string output;
+    std::vector<size_t> chunks;
+
+    HtmlSink sink() {
+        return [this](const char* data, size_t length) {
+            output.append(data, length);
+            chunks.push_back(length);
+        };
+    }
+};
+
+std::string render(const char* fragment, const HtmlField* fields, size_t fieldCount) {
+    Capture capture;
+    HtmlStreamRenderer renderer(capture.sink(), fields, fieldCount);
+    renderer.render(fragment);
+    renderer.flush();
+    return capture.output;
+}
+
+int test_html_substitutes_fields() {
+    IT("substitutes placeholders with their fields");
+    const HtmlField fields[] = {
+        {"ssid", "home", false},
+        {"pw", "secret", false},
+    };
+
+    IS_TRUE(render("<p>[[ssid]]/[[pw]]</p>", fields, 2) == "<p>home/secret</p>");
+
+    END_IT
+}
+
+int test_html_nested_fragments() {
+    IT("renders fragment fields, with placeholders of their own");
+    const HtmlField fields[] = {
+        {"input_id", "<input value='[[id]]' id='id'>", true},
+        {"id", "my-ssid", false},
+    };
+
+    IS_TRUE(render("<div>[[input_id]]</div>", fields, 2) == "<div><input value='my-ssid' id='id'></div>");
+
+    END_IT
+}
+
+int test_html_fragment_depth() {
+    IT("stops expanding fragments that keep including themselves");
+    const HtmlField fields[] = {
+        {"loop", "<[[loop]]>", true},
+    };
+
+    // The fragment is expanded twice, after which it's treated as a plain value and escaped
+    IS_TRUE(render("[[loop]]", fields, 1) == "<<&lt;[[loop]]&gt;>>");
+
+    END_IT
+}
+
+int test_html_escapes_values() {
+    IT("escapes values, including both kinds of quotes");
+    const HtmlField fields[] = {
+        {"pw", "a&b<c>d'e\"f", false},
+    };
+
+    IS_TRUE(render("value='[[pw]]'", fields, 1) == "value='a&amp;b&lt;c&gt;d&#39;e&quot;f'");
+
+    END_IT
+}
+
+int test_html_unknown_placeholder() {
+    IT("writes placeholders without a field as is");
+    const HtmlField fields[] = {
+        {"id", "x", false},
+        {"idx", "y", false},
+    };
+
+    IS_TRUE(render("[[i]] [[ids]] [[id]]", fields, 2) == "[[i]] [[ids]] x");
+
+    END_IT
+}
+
+int test_html_unterminated_placeholder() {
+    IT("writes an unterminated placeholder as is");
+    const HtmlField fields[] = {
+        {"id", "x", false},
+    };
+
+    IS_TRUE(render("[[id]] and [[id", fields, 1) == "x and [[id");
+    IS_TRUE(render("[[", fields, 1) == "[[");
+    IS_TRUE(render("a]]", fields, 1) == "a]]");
+
+    END_IT
+}
+
+int test_html_chunking() {
+    IT("hands output to the sink in full chunks, across the chunk boundary");
+    std::string value(HTML_CHUNK_SIZE + 10, 'v');
+    const HtmlField fields[] = {
+        {"long", value.c_str(), false},
+        {"amp", "&", false},
+    };
+
+    // The entity straddles the first chunk boundary
+    std::string fragment(HTML_CHUNK_SIZE - 2, 'a');
+    fragment += "[[amp]][[long]]";
+
+    Capture capture;
+    HtmlStreamRenderer renderer(capture.sink(), fields, 2);
+    renderer.render(fragment.c_str());
+
+    // Only full chunks go out until the flush
+    IS_EQUAL(capture.chunks.size(), 2);
+    IS_EQUAL(capture.chunks[0], HTML_CHUNK_SIZE);
+    IS_TRUE(capture.output.substr(HTML_CHUNK_SIZE - 2, 2) == "&a");
+
+    renderer.flush();
+
+    std::string expected(HTML_CHUNK_SIZE - 2, 'a');
+    expected += "&amp;" + value;
+
+    IS_TRUE(capture.output == expected);
+    IS_EQUAL(capture.chunks.size(), 3);
+    IS_EQUAL(capture.chunks[1], HTML_CHUNK_SIZE);
+    IS_EQUAL(capture.chunks[2], expected.size() - 2 * HTML_CHUNK_SIZE);
+
+    // Nothing left to flush
+    renderer.flush();
+    IS_EQUAL(capture.chunks.size(), 3);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("HTML stream renderer");
+    test_html_substitutes_fields();
+    test_html_nested_fragments();
+    test_html_fragment_depth();
+    test_html_escapes_values();
+    test_html_unknown_placeholder();
+    test_html_unterminated_placeholder();
+    test_html_chunking();
+
+    FINISH
+}
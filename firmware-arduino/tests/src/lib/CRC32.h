@@ -0,0 +1,27 @@
+#ifndef crc32_h
+#define crc32_h
+
+#include <cstddef>
+#include <cstdint>
+
+// The standard reflected CRC-32 the CRC32 library computes, bit by bit
+class CRC32 {
+public:
+    template<typename Type>
+    static uint32_t calculate(const Type* data, size_t count) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        uint32_t crc = 0xFFFFFFFF;
+
+        for (size_t i = 0; i < count * sizeof(Type); i++) {
+            crc ^= bytes[i];
+
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+            }
+        }
+
+        return ~crc;
+    }
+};
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef firmware_tests_fs_h
+#define firmware_tests_fs_h
+
+// Like the core's, which is where most of the firmware gets Arduino.h from
+#include <Arduino.h>
+
+// FileIO is never built on the host, only its declaration is seen, so the file system needs no more than a name
+class FS;
+
+#endif
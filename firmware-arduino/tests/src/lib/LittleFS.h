@@ -0,0 +1,6 @@
+#ifndef firmware_tests_littlefs_h
+#define firmware_tests_littlefs_h
+
+#include <FS.h>
+
+#endif
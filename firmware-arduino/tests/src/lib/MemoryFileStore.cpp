@@ -0,0 +1,89 @@
+#include "MemoryFileStore.h"
+#include <cstring>
+
+bool MemoryFileStore::append(const char *filename, const uint8_t *data, size_t length) {
+    if (failWrites) {
+        return false;
+    }
+
+    writes++;
+    std::vector<uint8_t> &file = files[filename];
+    file.insert(file.end(), data, data + length);
+    return true;
+}
+
+bool MemoryFileStore::write(const char *filename, const uint8_t *data, size_t length) {
+    if (failWrites) {
+        return false;
+    }
+
+    writes++;
+    files[filename].assign(data, data + length);
+    return true;
+}
+
+bool MemoryFileStore::writeAt(const char *filename, size_t offset, const uint8_t *data, size_t length) {
+    if (failWrites) {
+        return false;
+    }
+
+    writes++;
+    std::vector<uint8_t> &file = files[filename];
+
+    if (file.size() < offset + length) {
+        file.resize(offset + length);
+    }
+
+    memcpy(file.data() + offset, data, length);
+    return true;
+}
+
+size_t MemoryFileStore::read(const char *filename, size_t offset, uint8_t *buffer, size_t length) {
+    auto file = files.find(filename);
+    reads++;
+
+    if (file == files.end() || offset >= file->second.size()) {
+        return 0;
+    }
+
+    size_t available = file->second.size() - offset;
+    size_t count = length < available ? length : available;
+    memcpy(buffer, file->second.data() + offset, count);
+    bytesRead += count;
+    return count;
+}
+
+size_t MemoryFileStore::size(const char *filename) {
+    auto file = files.find(filename);
+    return file == files.end() ? 0 : file->second.size();
+}
+
+bool MemoryFileStore::remove(const char *filename) {
+    if (failWrites) {
+        return false;
+    }
+
+    writes++;
+    return files.erase(filename) > 0;
+}
+
+bool MemoryFileStore::rename(const char *from, const char *to) {
+    if (failWrites) {
+        return false;
+    }
+
+    auto file = files.find(from);
+
+    if (file == files.end()) {
+        return false;
+    }
+
+    writes++;
+    files[to] = file->second;
+    files.erase(from);
+    return true;
+}
+
+bool MemoryFileStore::exists(const char *filename) const {
+    return files.count(filename) > 0;
+}
@@ -0,0 +1,30 @@
+#ifndef memoryfilestore_h
+#define memoryfilestore_h
+
+#include "FileStore.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Files in a map. Every call that changes a file counts as a flash write, and every read as a flash read.
+class MemoryFileStore : public FileStore {
+public:
+    std::map<std::string, std::vector<uint8_t>> files;
+    uint32_t writes = 0;
+    uint32_t reads = 0;
+    uint32_t bytesRead = 0;
+    // Makes every call that changes a file fail, like a full or worn out flash
+    bool failWrites = false;
+
+    bool append(const char * filename, const uint8_t * data, size_t length) override;
+    bool write(const char * filename, const uint8_t * data, size_t length) override;
+    bool writeAt(const char * filename, size_t offset, const uint8_t * data, size_t length) override;
+    size_t read(const char * filename, size_t offset, uint8_t * buffer, size_t length) override;
+    size_t size(const char * filename) override;
+    bool remove(const char * filename) override;
+    bool rename(const char * from, const char * to) override;
+
+    bool exists(const char * filename) const;
+};
+
+#endif
@@ -0,0 +1,5 @@
+#include "MemoryFree.h"
+
+int freeMemory() {
+    return 100000;
+}
@@ -0,0 +1,6 @@
+#ifndef firmware_tests_wifinina_pinout_generic_h
+#define firmware_tests_wifinina_pinout_generic_h
+
+// Pins only matter to the module, which isn't there
+
+#endif
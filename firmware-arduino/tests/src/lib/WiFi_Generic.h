@@ -0,0 +1,22 @@
+#ifndef firmware_tests_wifi_generic_h
+#define firmware_tests_wifi_generic_h
+
+#include <stdint.h>
+
+// The link states the module reports, with WiFiNINA's values
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_NO_MODULE = WL_NO_SHIELD,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL,
+    WL_SCAN_COMPLETED,
+    WL_CONNECTED,
+    WL_CONNECT_FAILED,
+    WL_CONNECTION_LOST,
+    WL_DISCONNECTED,
+    WL_AP_LISTENING,
+    WL_AP_CONNECTED,
+    WL_AP_FAILED,
+} wl_status_t;
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef firmware_tests_pico_time_h
+#define firmware_tests_pico_time_h
+
+#include <stdint.h>
+
+// A clock that only moves when a test moves it. It starts at one second, so that "now" is never nil_time.
+typedef uint64_t absolute_time_t;
+
+static const absolute_time_t nil_time = 0;
+static const absolute_time_t at_the_end_of_time = INT64_MAX;
+
+absolute_time_t get_absolute_time();
+uint32_t time_us_32();
+uint64_t time_us_64();
+
+void host_time_set_us(uint64_t us);
+void host_time_advance_us(uint64_t us);
+void host_time_advance_ms(uint32_t ms);
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+static inline bool is_nil_time(absolute_time_t t) { return t == nil_time; }
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + (uint64_t)ms * 1000; }
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return delayed_by_us(get_absolute_time(), us); }
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return delayed_by_ms(get_absolute_time(), ms); }
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) { return (int64_t)(to - from); }
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef firmware_tests_pico_util_queue_h
+#define firmware_tests_pico_util_queue_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+// A plain ring, as there's only the one thread on the host. Blocking calls on an empty or full queue abort.
+typedef struct {
+    uint8_t *data;
+    uint elementSize;
+    uint count;
+    uint head;
+    uint level;
+} queue_t;
+
+void queue_init_with_spinlock(queue_t *q, uint element_size, uint element_count, uint spinlock_num);
+void queue_free(queue_t *q);
+uint queue_get_level_unsafe(queue_t *q);
+uint queue_get_level(queue_t *q);
+bool queue_is_empty(queue_t *q);
+bool queue_is_full(queue_t *q);
+bool queue_try_add(queue_t *q, const void *data);
+bool queue_try_remove(queue_t *q, void *data);
+bool queue_try_peek(queue_t *q, void *data);
+void queue_add_blocking(queue_t *q, const void *data);
+void queue_remove_blocking(queue_t *q, void *data);
+void queue_peek_blocking(queue_t *q, void *data);
+
+#endif
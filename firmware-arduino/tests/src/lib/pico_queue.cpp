@@ -0,0 +1,80 @@
+#include "pico/util/queue.h"
+#include <cstdlib>
+#include <cstring>
+
+void queue_init_with_spinlock(queue_t *q, uint element_size, uint element_count, uint) {
+    q->data = (uint8_t*)calloc(element_count, element_size);
+    q->elementSize = element_size;
+    q->count = element_count;
+    q->head = 0;
+    q->level = 0;
+}
+
+void queue_free(queue_t *q) {
+    free(q->data);
+    q->data = nullptr;
+}
+
+uint queue_get_level_unsafe(queue_t *q) {
+    return q->level;
+}
+
+uint queue_get_level(queue_t *q) {
+    return q->level;
+}
+
+bool queue_is_empty(queue_t *q) {
+    return q->level == 0;
+}
+
+bool queue_is_full(queue_t *q) {
+    return q->level == q->count;
+}
+
+bool queue_try_add(queue_t *q, const void *data) {
+    if (queue_is_full(q)) {
+        return false;
+    }
+
+    memcpy(q->data + ((q->head + q->level) % q->count) * q->elementSize, data, q->elementSize);
+    q->level++;
+    return true;
+}
+
+bool queue_try_peek(queue_t *q, void *data) {
+    if (queue_is_empty(q)) {
+        return false;
+    }
+
+    memcpy(data, q->data + q->head * q->elementSize, q->elementSize);
+    return true;
+}
+
+bool queue_try_remove(queue_t *q, void *data) {
+    if (!queue_try_peek(q, data)) {
+        return false;
+    }
+
+    q->head = (q->head + 1) % q->count;
+    q->level--;
+    return true;
+}
+
+// Nothing else would ever add or remove, so waiting would hang the spec
+void queue_add_blocking(queue_t *q, const void *data) {
+    if (!queue_try_add(q, data)) {
+        abort();
+    }
+}
+
+void queue_remove_blocking(queue_t *q, void *data) {
+    if (!queue_try_remove(q, data)) {
+        abort();
+    }
+}
+
+void queue_peek_blocking(queue_t *q, void *data) {
+    if (!queue_try_peek(q, data)) {
+        abort();
+    }
+}
@@ -0,0 +1,27 @@
+#include "pico/time.h"
+
+static uint64_t now = 1000000;
+
+absolute_time_t get_absolute_time() {
+    return now;
+}
+
+uint32_t time_us_32() {
+    return (uint32_t)now;
+}
+
+uint64_t time_us_64() {
+    return now;
+}
+
+void host_time_set_us(uint64_t us) {
+    now = us;
+}
+
+void host_time_advance_us(uint64_t us) {
+    now += us;
+}
+
+void host_time_advance_ms(uint32_t ms) {
+    now += (uint64_t)ms * 1000;
+}
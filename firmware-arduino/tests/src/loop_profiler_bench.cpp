@@ -0,0 +1,60 @@
+#include <chrono>
+
+static uint32_t steadyClockUs() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Timed against a real clock, so the overhead includes reading it, like time_us_32() on the RP2040
+#define LOOP_PROFILER_CLOCK_US() steadyClockUs()
+
+#include "SystemController/LoopProfiler.h"
+#include <cstdio>
+
+// What profiling adds to a control cycle, with every stage timed the way SystemController::loop() does
+#define CYCLES 600000
+
+static void timeCycle(LoopProfiler &profiler) {
+    profiler.begin(PROFILE_STAGE_CYCLE);
+
+    for (uint8_t stage = PROFILE_STAGE_VALIDATION; stage < PROFILE_STAGE_COUNT; stage++) {
+        profiler.begin((ProfileStage)stage);
+        profiler.end((ProfileStage)stage);
+    }
+
+    // Validation is timed again after receiving
+    profiler.begin(PROFILE_STAGE_VALIDATION);
+    profiler.end(PROFILE_STAGE_VALIDATION);
+    profiler.end(PROFILE_STAGE_CYCLE);
+}
+
+int main() {
+    LoopProfiler profiler;
+    LoopProfileReport report{};
+    uint32_t reports = 0;
+    std::chrono::steady_clock::duration reporting{};
+
+    auto start = std::chrono::steady_clock::now();
+    for (int cycle = 0; cycle < CYCLES; cycle++) {
+        timeCycle(profiler);
+
+        if (profiler.endCycle()) {
+            auto reportStart = std::chrono::steady_clock::now();
+            profiler.report(report);
+            reporting += std::chrono::steady_clock::now() - reportStart;
+            reports++;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start - reporting;
+
+    char rendered[512];
+    size_t renderedLength = LoopProfiler::render(report, rendered, sizeof(rendered));
+
+    printf("per cycle:  %6.0f ns, %u stages timed\n",
+           std::chrono::duration<double, std::nano>(elapsed).count() / CYCLES, PROFILE_STAGE_COUNT + 1);
+    printf("per report: %6.0f ns, every %u cycles\n",
+           std::chrono::duration<double, std::nano>(reporting).count() / reports, LOOP_PROFILER_REPORT_CYCLES);
+    printf("rendered:   %6zu B on /profile\n", renderedLength);
+    printf("footprint:  %6zu B profiler, %zu B report\n", sizeof(LoopProfiler), sizeof(LoopProfileReport));
+    return 0;
+}
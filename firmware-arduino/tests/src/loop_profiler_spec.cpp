@@ -0,0 +1,129 @@
+#include "SystemController/LoopProfiler.h"
+#include "BDDTest.h"
+#include <cstring>
+
+int test_loop_profiler_exact_stats() {
+    IT("keeps min, mean and max exact, and the p99 within a bucket");
+    ProfileStageStats stats;
+
+    for (uint32_t us = 1; us <= 100; us++) {
+        stats.add(us);
+    }
+
+    IS_EQUAL(stats.getSamples(), 100);
+    IS_EQUAL(stats.getMin(), 1);
+    IS_EQUAL(stats.getMean(), 50);
+    IS_EQUAL(stats.getMax(), 100);
+    IS_TRUE(stats.getPercentile(99) >= 99);
+    IS_TRUE(stats.getPercentile(99) <= 100);
+    IS_TRUE(stats.getPercentile(50) >= 50);
+    IS_TRUE(stats.getPercentile(50) <= 50 * 5 / 4);
+
+    END_IT
+}
+
+int test_loop_profiler_outliers() {
+    IT("puts a rare outlier in the max, but not the p99");
+    ProfileStageStats stats;
+
+    for (int i = 0; i < 999; i++) {
+        stats.add(200);
+    }
+    stats.add(250000);
+
+    IS_EQUAL(stats.getMax(), 250000);
+    IS_TRUE(stats.getPercentile(99) >= 200);
+    IS_TRUE(stats.getPercentile(99) < 250);
+
+    stats.reset();
+    IS_EQUAL(stats.getSamples(), 0);
+    IS_EQUAL(stats.getMin(), 0);
+    IS_EQUAL(stats.getPercentile(99), 0);
+
+    END_IT
+}
+
+int test_loop_profiler_stage_summed() {
+    IT("adds a stage timed twice in a cycle up into one sample");
+    LoopProfiler profiler;
+
+    profiler.begin(PROFILE_STAGE_VALIDATION);
+    host_time_advance_us(30);
+    profiler.end(PROFILE_STAGE_VALIDATION);
+    profiler.begin(PROFILE_STAGE_UART_READ);
+    host_time_advance_us(5000);
+    profiler.end(PROFILE_STAGE_UART_READ);
+    profiler.begin(PROFILE_STAGE_VALIDATION);
+    host_time_advance_us(12);
+    profiler.end(PROFILE_STAGE_VALIDATION);
+    IS_FALSE(profiler.endCycle());
+
+    IS_EQUAL(profiler.getStats(PROFILE_STAGE_VALIDATION).getSamples(), 1);
+    IS_EQUAL(profiler.getStats(PROFILE_STAGE_VALIDATION).getMax(), 42);
+    IS_EQUAL(profiler.getStats(PROFILE_STAGE_UART_READ).getMax(), 5000);
+    // Stages that weren't timed get no sample at all
+    IS_EQUAL(profiler.getStats(PROFILE_STAGE_PARSE).getSamples(), 0);
+
+    END_IT
+}
+
+int test_loop_profiler_report() {
+    IT("reports once a minute's worth of cycles, and starts over");
+    LoopProfiler profiler;
+    bool due = false;
+
+    for (uint32_t cycle = 0; cycle < LOOP_PROFILER_REPORT_CYCLES; cycle++) {
+        IS_FALSE(due);
+        profiler.add(PROFILE_STAGE_CYCLE, 1000 + cycle % 10);
+        due = profiler.endCycle();
+    }
+
+    IS_TRUE(due);
+
+    LoopProfileReport report{};
+    profiler.report(report);
+    IS_EQUAL(report.cycles, LOOP_PROFILER_REPORT_CYCLES);
+    IS_EQUAL(report.stages[PROFILE_STAGE_CYCLE].min, 1000);
+    IS_EQUAL(report.stages[PROFILE_STAGE_CYCLE].mean, 1004);
+    IS_EQUAL(report.stages[PROFILE_STAGE_CYCLE].max, 1009);
+    IS_EQUAL(report.stages[PROFILE_STAGE_PARSE].max, 0);
+    IS_EQUAL(profiler.getStats(PROFILE_STAGE_CYCLE).getSamples(), 0);
+
+    profiler.add(PROFILE_STAGE_CYCLE, 1000);
+    IS_FALSE(profiler.endCycle());
+
+    END_IT
+}
+
+int test_loop_profiler_render() {
+    IT("renders a report as JSON, or nothing if it doesn't fit");
+    LoopProfileReport report{};
+    char buffer[512];
+
+    IS_EQUAL(LoopProfiler::render(report, buffer, sizeof(buffer)), strlen("{\"n\":0,\"s\":{}}"));
+    IS_TRUE(strcmp(buffer, "{\"n\":0,\"s\":{}}") == 0);
+
+    report.cycles = 600;
+    report.stages[PROFILE_STAGE_CYCLE] = LoopProfileStageReport{5100, 5230, 6143, 7012};
+    size_t length = LoopProfiler::render(report, buffer, sizeof(buffer));
+    IS_EQUAL(length, strlen(buffer));
+    IS_TRUE(strncmp(buffer, "{\"n\":600,\"s\":{\"cycle\":[5100,5230,6143,7012],\"validation\":[0,0,0,0],", 67) == 0);
+    IS_TRUE(strstr(buffer, "\"black_box\":[0,0,0,0]}}") != nullptr);
+
+    IS_EQUAL(LoopProfiler::render(report, buffer, length), 0);
+    IS_EQUAL(LoopProfiler::render(report, buffer, length + 1), length);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Loop profiler");
+    test_loop_profiler_exact_stats();
+    test_loop_profiler_outliers();
+    test_loop_profiler_stage_summed();
+    test_loop_profiler_report();
+    test_loop_profiler_render();
+
+    FINISH
+}
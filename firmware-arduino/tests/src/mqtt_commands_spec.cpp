@@ -0,0 +1,86 @@
+#include "mqtt_commands.h"
+#include "BDDTest.h"
+
+// The ranges the command table in NetworkController.cpp uses
+const MqttCommand brewTemperatureTarget{fnv1a_hash("set_brew_temp_target"), "set_brew_temp_target", COMMAND_ARGUMENT_FLOAT, 0, 100, nullptr};
+const MqttCommand ecoMode{fnv1a_hash("set_eco_mode"), "set_eco_mode", COMMAND_ARGUMENT_BOOL, 0, 0, nullptr};
+const MqttCommand autoSleepMin{fnv1a_hash("set_auto_sleep_min"), "set_auto_sleep_min", COMMAND_ARGUMENT_INT, 0, AUTO_SLEEP_MAX_MIN, nullptr};
+const MqttCommand brewPidParameters{fnv1a_hash("set_brew_pid_params"), "set_brew_pid_params", COMMAND_ARGUMENT_PID, 0, 1000, nullptr};
+
+bool parse(const char* json, const MqttCommand &definition, CommandArgument &argument) {
+    StaticJsonDocument<COMMAND_DOCUMENT_SIZE> document;
+
+    if (deserializeJson(document, json)) {
+        return false;
+    }
+
+    return parse_command_argument(document.as<JsonObjectConst>(), definition, argument);
+}
+
+int test_mqtt_commands_float() {
+    IT("accepts a number within the range as a float argument");
+    CommandArgument argument;
+
+    IS_TRUE(parse("{\"float_value\": 93.5}", brewTemperatureTarget, argument));
+    IS_EQUAL(argument.floatValue, 93.5f);
+    IS_TRUE(parse("{\"float_value\": 100}", brewTemperatureTarget, argument));
+    IS_EQUAL(argument.floatValue, 100.f);
+
+    IS_FALSE(parse("{\"float_value\": 100.5}", brewTemperatureTarget, argument));
+    IS_FALSE(parse("{\"float_value\": -1}", brewTemperatureTarget, argument));
+    IS_FALSE(parse("{\"float_value\": \"93.5\"}", brewTemperatureTarget, argument));
+    IS_FALSE(parse("{\"bool_value\": true}", brewTemperatureTarget, argument));
+    // Doesn't fit in a float
+    IS_FALSE(parse("{\"float_value\": 1e39}", brewTemperatureTarget, argument));
+
+    END_IT
+}
+
+int test_mqtt_commands_bool_and_int() {
+    IT("only takes a JSON bool as a bool, and a whole number in range as an int");
+    CommandArgument argument;
+
+    IS_TRUE(parse("{\"bool_value\": true}", ecoMode, argument));
+    IS_TRUE(argument.boolValue);
+    IS_FALSE(parse("{\"bool_value\": 1}", ecoMode, argument));
+    IS_FALSE(parse("{\"bool_value\": \"true\"}", ecoMode, argument));
+
+    IS_TRUE(parse("{\"int_value\": 45}", autoSleepMin, argument));
+    IS_EQUAL(argument.intValue, 45);
+    IS_FALSE(parse("{\"int_value\": 45.5}", autoSleepMin, argument));
+    IS_FALSE(parse("{\"int_value\": -1}", autoSleepMin, argument));
+    IS_FALSE(parse("{\"int_value\": 301}", autoSleepMin, argument));
+    IS_FALSE(parse("{\"int_value\": 4294967341}", autoSleepMin, argument));
+
+    END_IT
+}
+
+int test_mqtt_commands_pid() {
+    IT("takes PID parameters with gains in range and the windup limits in order");
+    CommandArgument argument;
+
+    IS_TRUE(parse("{\"kp\": 0.8, \"ki\": 0.04, \"kd\": 12, \"windup_low\": -7, \"windup_high\": 7}", brewPidParameters, argument));
+    IS_EQUAL(argument.pidValue.Kp, 0.8f);
+    IS_EQUAL(argument.pidValue.Kd, 12.f);
+    IS_EQUAL(argument.pidValue.windupLow, -7.f);
+    IS_EQUAL(argument.pidValue.windupHigh, 7.f);
+    IS_TRUE(parse("{\"kp\": 0.8, \"ki\": 0.04, \"kd\": 12, \"windup_low\": 0, \"windup_high\": 0}", brewPidParameters, argument));
+
+    IS_FALSE(parse("{\"kp\": 0.8, \"ki\": 0.04, \"kd\": 12, \"windup_low\": 7, \"windup_high\": -7}", brewPidParameters, argument));
+    IS_FALSE(parse("{\"kp\": 1001, \"ki\": 0.04, \"kd\": 12, \"windup_low\": -7, \"windup_high\": 7}", brewPidParameters, argument));
+    IS_FALSE(parse("{\"kp\": 0.8, \"ki\": -0.04, \"kd\": 12, \"windup_low\": -7, \"windup_high\": 7}", brewPidParameters, argument));
+    IS_FALSE(parse("{\"kp\": 0.8, \"ki\": 0.04, \"kd\": 12, \"windup_low\": -7}", brewPidParameters, argument));
+    IS_FALSE(parse("{\"kp\": 0.8, \"ki\": 0.04, \"kd\": \"12\", \"windup_low\": -7, \"windup_high\": 7}", brewPidParameters, argument));
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("MQTT commands");
+    test_mqtt_commands_float();
+    test_mqtt_commands_bool_and_int();
+    test_mqtt_commands_pid();
+
+    FINISH
+}
@@ -0,0 +1,113 @@
+#include "PubSubClient.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// What receiving a command costs with the classic callback, which needs the topic moved to NUL-terminate it, and with
+// the message view NetworkController uses. Bytes moved are counted by PubSubClient itself.
+
+#define COMMAND_TOPIC "lcc/LCC-A1B2C3/cmd"
+#define COMMAND_PAYLOAD "{\"cmd\":\"set_brew_temp_target\",\"float_value\":93.5}"
+#define ITERATIONS 1000000
+
+// Hands out the same packet every time it's rearmed, as the shim's response buffer only grows
+class ReplayClient : public Client {
+public:
+    void setPacket(const uint8_t *packet, size_t length) {
+        memcpy(this->packet, packet, length);
+        this->length = length;
+        rearm();
+    }
+
+    void rearm() { position = 0; }
+
+    int connect(IPAddress, uint16_t) override { return 1; }
+    int connect(const char *, uint16_t) override { return 1; }
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+    int available() override { return (int)(length - position); }
+    int read() override { return position < length ? packet[position++] : -1; }
+
+    int read(uint8_t *buf, size_t size) override {
+        size_t count = size < length - position ? size : length - position;
+        memcpy(buf, packet + position, count);
+        position += count;
+        return (int)count;
+    }
+
+    int peek() override { return position < length ? packet[position] : -1; }
+    void flush() override {}
+    void stop() override {}
+    uint8_t connected() override { return 1; }
+    operator bool() override { return true; }
+private:
+    uint8_t packet[256]{};
+    size_t length = 0;
+    size_t position = 0;
+};
+
+static size_t commandPublish(uint8_t *packet) {
+    size_t topicLength = strlen(COMMAND_TOPIC);
+    size_t payloadLength = strlen(COMMAND_PAYLOAD);
+    size_t length = 0;
+
+    // MQTT 5, QoS 0, no properties
+    packet[length++] = 0x30;
+    packet[length++] = 2 + topicLength + 1 + payloadLength;
+    packet[length++] = 0;
+    packet[length++] = topicLength;
+    memcpy(packet + length, COMMAND_TOPIC, topicLength);
+    length += topicLength;
+    packet[length++] = 0;
+    memcpy(packet + length, COMMAND_PAYLOAD, payloadLength);
+    return length + payloadLength;
+}
+
+static uint32_t messages = 0;
+
+static void callback(char*, uint8_t*, unsigned int) {
+    messages++;
+}
+
+static void messageCallback(const MqttMessage&) {
+    messages++;
+}
+
+static void bench(const char* name, bool messageView) {
+    ReplayClient replayClient;
+    PubSubClient client(replayClient);
+
+    // Topic alias maximum of 10
+    uint8_t connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x0A };
+    replayClient.setPacket(connack, sizeof(connack));
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.connect("smart-lcc");
+
+    if (messageView) {
+        client.setMessageCallback(messageCallback);
+    } else {
+        client.setCallback(callback);
+    }
+
+    uint8_t packet[256];
+    size_t length = commandPublish(packet);
+    replayClient.setPacket(packet, length);
+    messages = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        replayClient.rearm();
+        client.loop();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    printf("%-18s %3zu B packet, %5.1f B moved, %6.0f ns per message\n", name, length,
+           (double)client.getReceiveBytesMoved() / messages,
+           std::chrono::duration<double, std::nano>(elapsed).count() / messages);
+}
+
+int main() {
+    bench("setCallback", false);
+    bench("setMessageCallback", true);
+    return 0;
+}
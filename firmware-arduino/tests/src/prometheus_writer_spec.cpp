@@ -0,0 +1,117 @@
+#include "PrometheusWriter.h"
+#include "BDDTest.h"
+#include <cstring>
+
+int test_prometheus_writes_samples() {
+    IT("writes each sample after its type");
+    char buffer[256];
+    PrometheusWriter writer(buffer, sizeof(buffer));
+
+    writer.gauge("lcc_brew_temperature_celsius", 93.5f);
+    writer.gauge("lcc_state", (int32_t)-2);
+    writer.counter("lcc_bails_total", (uint32_t)7);
+
+    const char* expected = "# TYPE lcc_brew_temperature_celsius gauge\nlcc_brew_temperature_celsius 93.500\n"
+                           "# TYPE lcc_state gauge\nlcc_state -2\n"
+                           "# TYPE lcc_bails_total counter\nlcc_bails_total 7\n";
+    IS_EQUAL(writer.length(), strlen(expected));
+    IS_TRUE(strncmp(buffer, expected, writer.length()) == 0);
+
+    END_IT
+}
+
+int test_prometheus_labelled_family_typed_once() {
+    IT("writes a labelled family's type once, before its first sample");
+    char buffer[512];
+    PrometheusWriter writer(buffer, sizeof(buffer));
+
+    writer.gauge("lcc_task_cpu_ratio", "task", "control", 0.25f);
+    writer.gauge("lcc_task_cpu_ratio", "task", "display", 0.5f);
+    writer.counter("lcc_task_deadlines_missed_total", "task", "control", (uint32_t)0);
+    writer.counter("lcc_task_deadlines_missed_total", "task", "display", (uint32_t)3);
+
+    const char* expected = "# TYPE lcc_task_cpu_ratio gauge\n"
+                           "lcc_task_cpu_ratio{task=\"control\"} 0.250\n"
+                           "lcc_task_cpu_ratio{task=\"display\"} 0.500\n"
+                           "# TYPE lcc_task_deadlines_missed_total counter\n"
+                           "lcc_task_deadlines_missed_total{task=\"control\"} 0\n"
+                           "lcc_task_deadlines_missed_total{task=\"display\"} 3\n";
+    IS_EQUAL(writer.length(), strlen(expected));
+    IS_TRUE(strncmp(buffer, expected, writer.length()) == 0);
+
+    END_IT
+}
+
+int test_prometheus_family_typed_again_after_another() {
+    IT("types a family again if another came in between");
+    char buffer[256];
+    PrometheusWriter writer(buffer, sizeof(buffer));
+
+    writer.gauge("lcc_task_cpu_ratio", "task", "control", 0.25f);
+    writer.counter("lcc_bails_total", (uint32_t)1);
+    writer.gauge("lcc_task_cpu_ratio", "task", "display", 0.5f);
+
+    buffer[writer.length()] = '\0';
+    const char* first = strstr(buffer, "# TYPE lcc_task_cpu_ratio gauge\n");
+    IS_TRUE(first != nullptr);
+    IS_TRUE(strstr(first + 1, "# TYPE lcc_task_cpu_ratio gauge\n") != nullptr);
+
+    END_IT
+}
+
+int test_prometheus_overflow() {
+    IT("reports an overflow, and writes nothing after it");
+    const char* sample = "# TYPE lcc_state gauge\nlcc_state 1\n";
+    char buffer[64];
+    memset(buffer, 'x', sizeof(buffer));
+
+    // Exactly the sample doesn't fit, as vsnprintf needs room for the terminator
+    PrometheusWriter exact(buffer, strlen(sample));
+    exact.gauge("lcc_state", (int32_t)1);
+    IS_EQUAL(exact.length(), 0);
+
+    PrometheusWriter fits(buffer, strlen(sample) + 1);
+    fits.gauge("lcc_state", (int32_t)1);
+    IS_EQUAL(fits.length(), strlen(sample));
+
+    // A short sample after one that didn't fit is dropped as well, so the output is never missing one in the middle
+    PrometheusWriter writer(buffer, strlen(sample) + 8);
+    writer.gauge("lcc_state", (int32_t)1);
+    IS_EQUAL(writer.length(), strlen(sample));
+    writer.gauge("lcc_brew_temperature_celsius", 93.5f);
+    IS_EQUAL(writer.length(), 0);
+    writer.counter("a", (uint32_t)1);
+    IS_EQUAL(writer.length(), 0);
+    IS_TRUE(strncmp(buffer, sample, strlen(sample)) == 0);
+
+    END_IT
+}
+
+int test_prometheus_overflow_in_family() {
+    IT("stays overflowed when a labelled family runs out of room");
+    char buffer[96];
+    PrometheusWriter writer(buffer, sizeof(buffer));
+
+    writer.gauge("lcc_task_cpu_ratio", "task", "control", 0.25f);
+    size_t length = writer.length();
+    IS_TRUE(length > 0);
+
+    writer.gauge("lcc_task_cpu_ratio", "task", "display", 0.5f);
+    IS_EQUAL(writer.length(), 0);
+    writer.gauge("lcc_task_cpu_ratio", "task", "x", 0.f);
+    IS_EQUAL(writer.length(), 0);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Prometheus writer");
+    test_prometheus_writes_samples();
+    test_prometheus_labelled_family_typed_once();
+    test_prometheus_family_typed_again_after_another();
+    test_prometheus_overflow();
+    test_prometheus_overflow_in_family();
+
+    FINISH
+}
@@ -0,0 +1,158 @@
+#include "PublishScheduler.h"
+#include "BDDTest.h"
+
+PicoQueue<SystemControllerCommand> commandQueue(16);
+SystemSettings settings(&commandQueue, nullptr);
+
+SystemControllerStatusMessage idleMessage() {
+    SystemControllerStatusMessage message{};
+    message.timestamp = get_absolute_time();
+    message.state = SYSTEM_CONTROLLER_STATE_WARM;
+    message.brewTemperature = 93.f;
+    message.serviceTemperature = 121.f;
+    message.brewSetPoint = 93.f;
+    message.serviceSetPoint = 121.f;
+    return message;
+}
+
+SystemControllerStatusMessage brewingMessage() {
+    SystemControllerStatusMessage message = idleMessage();
+    message.currentlyBrewing = true;
+    return message;
+}
+
+int test_publish_scheduler_heartbeat() {
+    IT("publishes everything once, then on a heartbeat while nothing changes");
+    SystemStatus status(&settings);
+    status.updateStatusMessage(idleMessage());
+    PublishScheduler scheduler;
+
+    IS_TRUE(scheduler.isStateDue(&status));
+    IS_TRUE(scheduler.isConfigDue(&status, &settings));
+    IS_TRUE(scheduler.isInfoDue());
+    scheduler.statePublished(&status);
+    scheduler.configPublished(&status, &settings);
+    scheduler.infoPublished();
+
+    host_time_advance_ms(STATE_HEARTBEAT_MS - 1);
+    IS_FALSE(scheduler.isStateDue(&status));
+    host_time_advance_ms(1);
+    IS_TRUE(scheduler.isStateDue(&status));
+    scheduler.statePublished(&status);
+
+    host_time_advance_ms(CONFIG_HEARTBEAT_MS - STATE_HEARTBEAT_MS - 1);
+    IS_FALSE(scheduler.isConfigDue(&status, &settings));
+    host_time_advance_ms(1);
+    IS_TRUE(scheduler.isConfigDue(&status, &settings));
+
+    IS_FALSE(scheduler.isInfoDue());
+    host_time_advance_ms(INFO_HEARTBEAT_MS - CONFIG_HEARTBEAT_MS);
+    IS_TRUE(scheduler.isInfoDue());
+    scheduler.infoPublished();
+
+    // A reconnect starts over
+    scheduler.reset();
+    IS_TRUE(scheduler.isStateDue(&status));
+    IS_TRUE(scheduler.isInfoDue());
+
+    END_IT
+}
+
+int test_publish_scheduler_deadband() {
+    IT("holds back temperatures inside the deadband, and rate limits the rest");
+    SystemStatus status(&settings);
+    status.updateStatusMessage(idleMessage());
+    PublishScheduler scheduler;
+    scheduler.statePublished(&status);
+
+    SystemControllerStatusMessage message = idleMessage();
+    message.brewTemperature += TEMPERATURE_DEADBAND / 2;
+    status.updateStatusMessage(message);
+    host_time_advance_ms(STATE_MIN_INTERVAL_IDLE_MS);
+    IS_FALSE(scheduler.isStateDue(&status));
+
+    // Drifting slowly doesn't hide it, as it's compared to what was published
+    message.brewTemperature += TEMPERATURE_DEADBAND;
+    status.updateStatusMessage(message);
+    IS_TRUE(scheduler.isStateDue(&status));
+    scheduler.statePublished(&status);
+
+    message.serviceTemperature -= TEMPERATURE_DEADBAND * 2;
+    status.updateStatusMessage(message);
+    host_time_advance_ms(STATE_MIN_INTERVAL_IDLE_MS - 1);
+    IS_FALSE(scheduler.isStateDue(&status));
+    host_time_advance_ms(1);
+    IS_TRUE(scheduler.isStateDue(&status));
+
+    END_IT
+}
+
+int test_publish_scheduler_brewing() {
+    IT("publishes events right away, and state at up to 10 Hz while brewing");
+    SystemStatus status(&settings);
+    status.updateStatusMessage(idleMessage());
+    PublishScheduler scheduler;
+    scheduler.statePublished(&status);
+
+    SystemControllerStatusMessage message = brewingMessage();
+    status.updateStatusMessage(message);
+    IS_TRUE(scheduler.isStateDue(&status));
+    scheduler.statePublished(&status);
+
+    message.brewTemperature -= TEMPERATURE_DEADBAND * 2;
+    status.updateStatusMessage(message);
+    host_time_advance_ms(STATE_MIN_INTERVAL_BREWING_MS - 1);
+    IS_FALSE(scheduler.isStateDue(&status));
+    host_time_advance_ms(1);
+    IS_TRUE(scheduler.isStateDue(&status));
+    scheduler.statePublished(&status);
+
+    // The end of the brew isn't rate limited
+    host_time_advance_ms(10);
+    status.updateStatusMessage(idleMessage());
+    IS_TRUE(scheduler.isStateDue(&status));
+    scheduler.statePublished(&status);
+
+    message = idleMessage();
+    message.waterTankLow = true;
+    status.updateStatusMessage(message);
+    IS_TRUE(scheduler.isStateDue(&status));
+
+    END_IT
+}
+
+int test_publish_scheduler_config_change() {
+    IT("publishes config when the system controller or the settings change it");
+    SystemStatus status(&settings);
+    status.updateStatusMessage(idleMessage());
+    PublishScheduler scheduler;
+    scheduler.configPublished(&status, &settings);
+    IS_FALSE(scheduler.isConfigDue(&status, &settings));
+
+    SystemControllerStatusMessage message = idleMessage();
+    message.ecoMode = true;
+    status.updateStatusMessage(message);
+    IS_TRUE(scheduler.isConfigDue(&status, &settings));
+    scheduler.configPublished(&status, &settings);
+
+    // A temperature isn't config
+    message.brewTemperature += 5.f;
+    status.updateStatusMessage(message);
+    IS_FALSE(scheduler.isConfigDue(&status, &settings));
+
+    settings.setAutoSleepMin(settings.getAutoSleepMin() + 5);
+    IS_TRUE(scheduler.isConfigDue(&status, &settings));
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Publish scheduler");
+    test_publish_scheduler_heartbeat();
+    test_publish_scheduler_deadband();
+    test_publish_scheduler_brewing();
+    test_publish_scheduler_config_change();
+
+    FINISH
+}
@@ -0,0 +1,245 @@
+#include "SettingsJournal.h"
+#include "MemoryFileStore.h"
+#include "BDDTest.h"
+#include <CRC32.h>
+#include <cmath>
+#include <cstring>
+
+#define LEGACY_FILENAME "/fs/settings.dat"
+#define JOURNAL_FILENAME "/fs/settings.jnl"
+#define COMPACTION_FILENAME "/fs/settings.jnl.tmp"
+
+SettingStruct customSettings() {
+    SettingStruct settings{};
+    settings.brewTemperatureOffset = -8.5f;
+    settings.ecoMode = true;
+    settings.brewTemperatureTarget = 93.f;
+    settings.serviceTemperatureTarget = 125.f;
+    settings.autoSleepMin = 45;
+    settings.brewPidParameters.Kp = 1.1f;
+    return settings;
+}
+
+bool settingsEqual(const SettingStruct &a, const SettingStruct &b) {
+    return a.brewTemperatureOffset == b.brewTemperatureOffset &&
+           a.sleepMode == b.sleepMode &&
+           a.ecoMode == b.ecoMode &&
+           a.brewTemperatureTarget == b.brewTemperatureTarget &&
+           a.serviceTemperatureTarget == b.serviceTemperatureTarget &&
+           a.autoSleepMin == b.autoSleepMin &&
+           a.brewPidParameters == b.brewPidParameters &&
+           a.servicePidParameters == b.servicePidParameters;
+}
+
+// The layout FileIO::saveSystemSettings wrote: version, struct, CRC32 of the struct
+void writeLegacy(MemoryFileStore &store, const SettingStruct &settings) {
+    uint8_t buffer[sizeof(uint8_t) + sizeof(SettingStruct) + sizeof(uint32_t)];
+    uint32_t checksum = CRC32::calculate((const uint8_t*)&settings, sizeof(settings));
+
+    buffer[0] = SETTINGS_LEGACY_FILE_VERSION;
+    memcpy(buffer + 1, &settings, sizeof(settings));
+    memcpy(buffer + 1 + sizeof(settings), &checksum, sizeof(checksum));
+    store.write(LEGACY_FILENAME, buffer, sizeof(buffer));
+}
+
+// A record as the journal writes it, for journals this firmware no longer writes
+void appendRecord(MemoryFileStore &store, uint32_t sequence, SettingKey key, const void* value, uint8_t length) {
+    uint8_t buffer[64];
+    SettingsJournalRecordHeader header{sequence, key, length};
+
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), value, length);
+    uint32_t checksum = CRC32::calculate(buffer, sizeof(header) + length);
+    memcpy(buffer + sizeof(header) + length, &checksum, sizeof(checksum));
+    store.append(JOURNAL_FILENAME, buffer, sizeof(header) + length + sizeof(checksum));
+}
+
+int test_settings_journal_imports_legacy() {
+    IT("moves a version 5 settings.dat into the journal");
+    MemoryFileStore store;
+    writeLegacy(store, customSettings());
+
+    SettingStruct settings{};
+    SettingsJournal journal(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_FALSE(journal.replay(settings));
+    IS_TRUE(journal.importLegacy(LEGACY_FILENAME, settings));
+    IS_TRUE(settingsEqual(settings, customSettings()));
+    IS_FALSE(store.exists(LEGACY_FILENAME));
+
+    SettingStruct replayed{};
+    SettingsJournal rebooted(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(rebooted.replay(replayed));
+    IS_TRUE(settingsEqual(replayed, customSettings()));
+    IS_EQUAL(rebooted.getRejectedRecords(), 0);
+
+    END_IT
+}
+
+int test_settings_journal_legacy_fields_checked() {
+    IT("holds the fields of a settings.dat to what replay accepts");
+    MemoryFileStore store;
+    SettingStruct legacy = customSettings();
+    legacy.brewTemperatureOffset = NAN;
+    legacy.autoSleepMin = AUTO_SLEEP_MAX_MIN + 1;
+    writeLegacy(store, legacy);
+
+    SettingStruct settings{};
+    SettingsJournal journal(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(journal.importLegacy(LEGACY_FILENAME, settings));
+    IS_EQUAL(journal.getRejectedRecords(), 2);
+    IS_EQUAL(settings.brewTemperatureOffset, SettingStruct{}.brewTemperatureOffset);
+    IS_EQUAL(settings.autoSleepMin, SettingStruct{}.autoSleepMin);
+    IS_EQUAL(settings.brewTemperatureTarget, customSettings().brewTemperatureTarget);
+
+    END_IT
+}
+
+int test_settings_journal_legacy_kept_on_failure() {
+    IT("keeps settings.dat until the journal holds its settings");
+    MemoryFileStore store;
+    writeLegacy(store, customSettings());
+    store.failWrites = true;
+
+    SettingStruct settings{};
+    SettingsJournal journal(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(journal.importLegacy(LEGACY_FILENAME, settings));
+    IS_TRUE(settingsEqual(settings, customSettings()));
+    IS_TRUE(store.exists(LEGACY_FILENAME));
+
+    END_IT
+}
+
+int test_settings_journal_legacy_rejected() {
+    IT("ignores a settings.dat with another version or a bad checksum");
+    MemoryFileStore store;
+    writeLegacy(store, customSettings());
+    store.files[LEGACY_FILENAME][0] = SETTINGS_LEGACY_FILE_VERSION - 1;
+
+    SettingStruct settings{};
+    SettingsJournal journal(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_FALSE(journal.importLegacy(LEGACY_FILENAME, settings));
+
+    writeLegacy(store, customSettings());
+    store.files[LEGACY_FILENAME][5] ^= 0xFF;
+    IS_FALSE(journal.importLegacy(LEGACY_FILENAME, settings));
+    IS_TRUE(settingsEqual(settings, SettingStruct{}));
+
+    END_IT
+}
+
+int test_settings_journal_without_schema_record() {
+    IT("replays a journal written before the schema record");
+    MemoryFileStore store;
+    float target = 91.5f;
+    bool ecoMode = true;
+    uint16_t autoSleepMin = 30;
+    appendRecord(store, 1, SETTING_KEY_BREW_TEMPERATURE_TARGET, &target, sizeof(target));
+    appendRecord(store, 2, SETTING_KEY_ECO_MODE, &ecoMode, sizeof(ecoMode));
+    appendRecord(store, 3, SETTING_KEY_AUTO_SLEEP_MIN, &autoSleepMin, sizeof(autoSleepMin));
+    uint32_t writes = store.writes;
+
+    SettingStruct settings{};
+    SettingsJournal journal(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(journal.replay(settings));
+    IS_EQUAL(journal.getReplayedRecords(), 3);
+    IS_EQUAL(settings.brewTemperatureTarget, target);
+    IS_TRUE(settings.ecoMode);
+    IS_EQUAL(settings.autoSleepMin, autoSleepMin);
+    IS_EQUAL(settings.serviceTemperatureTarget, SettingStruct{}.serviceTemperatureTarget);
+
+    // Already the first journal schema, so there's nothing to migrate
+    IS_EQUAL(store.writes, writes);
+
+    // New records carry on from the last sequence number
+    SettingStruct changed = settings;
+    changed.sleepMode = true;
+    IS_TRUE(journal.commit(settings, changed));
+
+    SettingStruct replayed{};
+    SettingsJournal rebooted(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(rebooted.replay(replayed));
+    IS_TRUE(settingsEqual(replayed, changed));
+
+    END_IT
+}
+
+int test_settings_journal_current() {
+    IT("replays a current journal of a snapshot and changes");
+    MemoryFileStore store;
+    SettingStruct settings{};
+    SettingsJournal journal(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(journal.compact(settings));
+
+    SettingStruct changed = customSettings();
+    IS_TRUE(journal.commit(settings, changed));
+    size_t journalSize = store.size(JOURNAL_FILENAME);
+    uint32_t writes = store.writes;
+
+    SettingStruct replayed{};
+    SettingsJournal rebooted(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(rebooted.replay(replayed));
+    IS_TRUE(settingsEqual(replayed, changed));
+    IS_EQUAL(rebooted.getRejectedRecords(), 0);
+    IS_EQUAL(store.size(JOURNAL_FILENAME), journalSize);
+    IS_EQUAL(store.writes, writes);
+
+    END_IT
+}
+
+int test_settings_journal_auto_sleep_cap() {
+    IT("rejects an auto-sleep record above the command's cap");
+    MemoryFileStore store;
+    uint16_t atCap = AUTO_SLEEP_MAX_MIN;
+    uint16_t overCap = AUTO_SLEEP_MAX_MIN + 1;
+    appendRecord(store, 1, SETTING_KEY_AUTO_SLEEP_MIN, &atCap, sizeof(atCap));
+    appendRecord(store, 2, SETTING_KEY_AUTO_SLEEP_MIN, &overCap, sizeof(overCap));
+
+    SettingStruct settings{};
+    SettingsJournal journal(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(journal.replay(settings));
+    IS_EQUAL(journal.getRejectedRecords(), 1);
+    IS_EQUAL(settings.autoSleepMin, AUTO_SLEEP_MAX_MIN);
+
+    END_IT
+}
+
+int test_settings_journal_torn_record() {
+    IT("stops at a torn record and compacts the damage away");
+    MemoryFileStore store;
+    SettingStruct settings{};
+    SettingsJournal journal(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(journal.compact(settings));
+
+    SettingStruct first = settings;
+    first.ecoMode = true;
+    IS_TRUE(journal.commit(settings, first));
+    SettingStruct second = first;
+    second.brewTemperatureTarget = 96.f;
+    IS_TRUE(journal.commit(first, second));
+
+    // Power was cut in the middle of the last record
+    store.files[JOURNAL_FILENAME].resize(store.size(JOURNAL_FILENAME) - 3);
+
+    SettingStruct replayed{};
+    SettingsJournal rebooted(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    IS_TRUE(rebooted.replay(replayed));
+    IS_TRUE(settingsEqual(replayed, first));
+    IS_EQUAL(rebooted.getCompactions(), 1);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Settings journal");
+    test_settings_journal_imports_legacy();
+    test_settings_journal_legacy_fields_checked();
+    test_settings_journal_legacy_kept_on_failure();
+    test_settings_journal_legacy_rejected();
+    test_settings_journal_without_schema_record();
+    test_settings_journal_current();
+    test_settings_journal_auto_sleep_cap();
+    test_settings_journal_torn_record();
+
+    FINISH
+}
@@ -0,0 +1,91 @@
+#include "SettingsJournal.h"
+#include "MemoryFileStore.h"
+#include <CRC32.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// What reading the settings costs at boot, for the single struct settings.dat and the journal that replaced it. Host
+// time only shows the CPU side, the flash side is the number of reads and bytes read.
+
+#define LEGACY_FILENAME "/fs/settings.dat"
+#define JOURNAL_FILENAME "/fs/settings.jnl"
+#define COMPACTION_FILENAME "/fs/settings.jnl.tmp"
+#define ITERATIONS 100000
+
+// The layout FileIO::saveSystemSettings used: version, struct, CRC32 of the struct
+static void writeLegacy(MemoryFileStore &store, const SettingStruct &settings) {
+    uint8_t buffer[sizeof(uint8_t) + sizeof(SettingStruct) + sizeof(uint32_t)];
+    uint32_t checksum = CRC32::calculate((const uint8_t*)&settings, sizeof(settings));
+
+    buffer[0] = SETTINGS_LEGACY_FILE_VERSION;
+    memcpy(buffer + 1, &settings, sizeof(settings));
+    memcpy(buffer + 1 + sizeof(settings), &checksum, sizeof(checksum));
+    store.write(LEGACY_FILENAME, buffer, sizeof(buffer));
+}
+
+static bool readLegacy(MemoryFileStore &store, SettingStruct &settings) {
+    uint8_t buffer[sizeof(uint8_t) + sizeof(SettingStruct) + sizeof(uint32_t)];
+
+    if (store.read(LEGACY_FILENAME, 0, buffer, sizeof(buffer)) != sizeof(buffer) || buffer[0] != SETTINGS_LEGACY_FILE_VERSION) {
+        return false;
+    }
+
+    uint32_t checksum;
+    memcpy(&settings, buffer + 1, sizeof(settings));
+    memcpy(&checksum, buffer + 1 + sizeof(settings), sizeof(checksum));
+    return CRC32::calculate((const uint8_t*)&settings, sizeof(settings)) == checksum;
+}
+
+static void report(const char* name, MemoryFileStore &store, size_t fileSize, std::chrono::steady_clock::duration elapsed) {
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+
+    printf("%-22s %4zu B on flash, %u reads, %4u B read, %7.0f ns\n", name, fileSize,
+           store.reads / ITERATIONS, store.bytesRead / ITERATIONS, ns);
+}
+
+static void benchLegacy() {
+    MemoryFileStore store;
+    writeLegacy(store, SettingStruct{});
+    store.reads = store.bytesRead = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        SettingStruct settings{};
+        readLegacy(store, settings);
+    }
+
+    report("settings.dat", store, store.size(LEGACY_FILENAME), std::chrono::steady_clock::now() - start);
+}
+
+// A journal right after compaction, and one that's about to be compacted, which is as long as replay gets
+static void benchJournal(const char* name, size_t appendUntil) {
+    MemoryFileStore store;
+    SettingStruct settings{};
+    SettingsJournal writer(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+    writer.compact(settings);
+
+    while (store.size(JOURNAL_FILENAME) + 14 <= appendUntil) {
+        SettingStruct previous = settings;
+        settings.brewTemperatureTarget += 0.5f;
+        writer.commit(previous, settings);
+    }
+
+    store.reads = store.bytesRead = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        SettingStruct replayed{};
+        SettingsJournal journal(&store, JOURNAL_FILENAME, COMPACTION_FILENAME);
+        journal.replay(replayed);
+    }
+
+    report(name, store, store.size(JOURNAL_FILENAME), std::chrono::steady_clock::now() - start);
+}
+
+int main() {
+    benchLegacy();
+    benchJournal("journal, compacted", 0);
+    benchJournal("journal, before compact", SETTINGS_JOURNAL_COMPACT_BYTES);
+    return 0;
+}
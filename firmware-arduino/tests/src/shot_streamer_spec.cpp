@@ -0,0 +1,134 @@
+#include "ShotStreamer.h"
+#include "BDDTest.h"
+#include <cstring>
+
+// A control cycle, 100 ms apart like the real control loop
+void addCycle(ShotStreamer &streamer, bool brewing) {
+    SystemControllerStatusMessage message{};
+    message.timestamp = get_absolute_time();
+    message.brewTemperature = 93.f;
+    message.currentlyBrewing = brewing;
+    streamer.addStatusMessage(message, 0.f);
+    host_time_advance_ms(100);
+}
+
+ShotStreamHeader takeBatch(ShotStreamer &streamer) {
+    uint8_t buffer[SHOT_STREAM_MAX_BATCH_SIZE];
+    ShotStreamHeader header;
+
+    streamer.writeBatch(buffer);
+    memcpy(&header, buffer, sizeof(header));
+    return header;
+}
+
+int test_shot_streamer_batches() {
+    IT("hands out a batch every second while brewing");
+    ShotStreamer streamer;
+
+    addCycle(streamer, false);
+    IS_FALSE(streamer.isBatchReady());
+
+    for (int i = 0; i < SHOT_STREAM_BATCH_SAMPLES - 1; i++) {
+        addCycle(streamer, true);
+    }
+    IS_FALSE(streamer.isBatchReady());
+
+    addCycle(streamer, true);
+    IS_TRUE(streamer.isBatchReady());
+    IS_EQUAL(streamer.getBatchSize(), sizeof(ShotStreamHeader) + SHOT_STREAM_BATCH_SAMPLES * sizeof(ShotSample));
+
+    ShotStreamHeader header = takeBatch(streamer);
+    IS_EQUAL(header.schemaId, SHOT_STREAM_SCHEMA_ID);
+    IS_EQUAL(header.sampleCount, SHOT_STREAM_BATCH_SAMPLES);
+    IS_EQUAL(header.shotId, 1);
+    IS_EQUAL(header.batchSequence, 0);
+    IS_EQUAL(header.droppedSamples, 0);
+    IS_FALSE(streamer.isBatchReady());
+
+    for (int i = 0; i < SHOT_STREAM_BATCH_SAMPLES; i++) {
+        addCycle(streamer, true);
+    }
+    IS_EQUAL(takeBatch(streamer).batchSequence, 1);
+
+    END_IT
+}
+
+int test_shot_streamer_tail() {
+    IT("keeps streaming for the tail after the brew, then flushes what's left");
+    ShotStreamer streamer;
+    uint32_t samples = 0;
+
+    for (int i = 0; i < 5; i++) {
+        addCycle(streamer, true);
+    }
+
+    // Taken as soon as it's ready, like the network loop does
+    for (int i = 0; i < SHOT_STREAM_TAIL_MS / 100 + 5; i++) {
+        addCycle(streamer, false);
+
+        if (streamer.isBatchReady()) {
+            samples += takeBatch(streamer).sampleCount;
+        }
+    }
+
+    // One sample when the brew ends, and one per cycle until the tail is over
+    IS_EQUAL(samples, 5 + 1 + SHOT_STREAM_TAIL_MS / 100);
+    IS_FALSE(streamer.isBatchReady());
+
+    // The next brew is a new shot
+    addCycle(streamer, true);
+    addCycle(streamer, false);
+    host_time_advance_ms(SHOT_STREAM_TAIL_MS);
+    addCycle(streamer, false);
+    IS_TRUE(streamer.isBatchReady());
+
+    ShotStreamHeader header = takeBatch(streamer);
+    IS_EQUAL(header.shotId, 2);
+    IS_EQUAL(header.batchSequence, 0);
+    IS_EQUAL(header.sampleCount, 2);
+
+    END_IT
+}
+
+int test_shot_streamer_drops() {
+    IT("counts the samples dropped while the network falls behind");
+    ShotStreamer streamer;
+
+    for (int i = 0; i < SHOT_STREAM_MAX_SAMPLES + 5; i++) {
+        addCycle(streamer, true);
+    }
+
+    ShotStreamHeader header = takeBatch(streamer);
+    IS_EQUAL(header.sampleCount, SHOT_STREAM_MAX_SAMPLES);
+    IS_EQUAL(header.droppedSamples, 5);
+
+    // A batch that couldn't be published is counted in the next one
+    for (int i = 0; i < SHOT_STREAM_BATCH_SAMPLES; i++) {
+        addCycle(streamer, true);
+    }
+    streamer.dropBatch();
+
+    for (int i = 0; i < SHOT_STREAM_BATCH_SAMPLES; i++) {
+        addCycle(streamer, true);
+    }
+    header = takeBatch(streamer);
+    IS_EQUAL(header.batchSequence, 2);
+    IS_EQUAL(header.droppedSamples, SHOT_STREAM_BATCH_SAMPLES);
+
+    for (int i = 0; i < SHOT_STREAM_BATCH_SAMPLES; i++) {
+        addCycle(streamer, true);
+    }
+    IS_EQUAL(takeBatch(streamer).droppedSamples, 0);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Shot streamer");
+    test_shot_streamer_batches();
+    test_shot_streamer_tail();
+    test_shot_streamer_drops();
+
+    FINISH
+}
@@ -0,0 +1,156 @@
+#include "TaskScheduler.h"
+#include "BDDTest.h"
+
+// Tasks take as long as they're told to, on the host clock
+static uint32_t controlRunUs = 0;
+
+void runControl() {
+    host_time_advance_us(controlRunUs);
+}
+
+void runIdle() {
+}
+
+int test_task_scheduler_period() {
+    IT("runs a task once per period, and one without a period on every pass");
+    ScheduledTask tasks[] = {
+        ScheduledTask("idle", runIdle),
+        ScheduledTask("control", runControl, 100),
+    };
+    TaskScheduler scheduler(tasks, 2);
+    controlRunUs = 0;
+
+    // A periodic task is due on the first pass
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getRuns(), 1);
+    IS_EQUAL(tasks[1].getRuns(), 1);
+
+    host_time_advance_ms(50);
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getRuns(), 2);
+    IS_EQUAL(tasks[1].getRuns(), 1);
+
+    host_time_advance_ms(50);
+    scheduler.loop();
+    IS_EQUAL(tasks[1].getRuns(), 2);
+
+    // Running a little late doesn't move the schedule
+    host_time_advance_ms(130);
+    scheduler.loop();
+    IS_EQUAL(tasks[1].getRuns(), 3);
+    host_time_advance_ms(69);
+    scheduler.loop();
+    IS_EQUAL(tasks[1].getRuns(), 3);
+    host_time_advance_ms(1);
+    scheduler.loop();
+    IS_EQUAL(tasks[1].getRuns(), 4);
+
+    END_IT
+}
+
+int test_task_scheduler_falls_behind() {
+    IT("starts a task over once it falls more than a period behind, rather than catching up");
+    ScheduledTask tasks[] = {
+        ScheduledTask("control", runControl, 100),
+    };
+    TaskScheduler scheduler(tasks, 1);
+    controlRunUs = 0;
+
+    scheduler.loop();
+    host_time_advance_ms(350);
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getRuns(), 2);
+
+    // Not run back to back for the periods it missed
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getRuns(), 2);
+
+    // A full period after the late run
+    host_time_advance_ms(99);
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getRuns(), 2);
+    host_time_advance_ms(1);
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getRuns(), 3);
+
+    END_IT
+}
+
+int test_task_scheduler_missed_deadlines() {
+    IT("counts runs that start more than the deadline after they were due");
+    ScheduledTask tasks[] = {
+        ScheduledTask("control", runControl, 100, 20),
+        ScheduledTask("display", runIdle, 100, 20),
+        ScheduledTask("no_deadline", runIdle, 100),
+    };
+    TaskScheduler scheduler(tasks, 3);
+    controlRunUs = 0;
+
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getMissedDeadlines(), 0);
+
+    host_time_advance_ms(120);
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getMissedDeadlines(), 0);
+
+    host_time_advance_ms(101);
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getMissedDeadlines(), 1);
+    IS_EQUAL(tasks[1].getMissedDeadlines(), 1);
+
+    // A task that runs long makes the ones after it late
+    controlRunUs = 30000;
+    host_time_advance_ms(79);
+    scheduler.loop();
+    IS_EQUAL(tasks[0].getMissedDeadlines(), 1);
+    IS_EQUAL(tasks[1].getMissedDeadlines(), 2);
+    IS_EQUAL(tasks[1].getRuns(), 4);
+
+    // Without a deadline, nothing is ever missed
+    IS_EQUAL(tasks[2].getMissedDeadlines(), 0);
+    IS_EQUAL(tasks[2].getRuns(), 4);
+
+    END_IT
+}
+
+int test_task_scheduler_cpu_share() {
+    IT("measures each task's share of the CPU over the window");
+    ScheduledTask tasks[] = {
+        ScheduledTask("idle", runIdle),
+        ScheduledTask("control", runControl, 10),
+    };
+    TaskScheduler scheduler(tasks, 2);
+    controlRunUs = 2000;
+
+    // A pass every millisecond, with the control task busy for 2 ms out of every 10
+    absolute_time_t windowEnd = delayed_by_ms(get_absolute_time(), TASK_SCHEDULER_WINDOW_MS);
+
+    while (absolute_time_diff_us(get_absolute_time(), windowEnd) > 1000) {
+        scheduler.loop();
+        host_time_advance_ms(1);
+    }
+
+    IS_EQUAL(tasks[1].getCpuShare(), 0.f);
+
+    scheduler.loop();
+    host_time_advance_ms(1);
+    scheduler.loop();
+
+    IS_TRUE(tasks[1].getCpuShare() > 0.199f);
+    IS_TRUE(tasks[1].getCpuShare() < 0.201f);
+    IS_EQUAL(tasks[1].getMaxRunUs(), 2000);
+    IS_EQUAL(tasks[0].getCpuShare(), 0.f);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Task scheduler");
+    test_task_scheduler_period();
+    test_task_scheduler_falls_behind();
+    test_task_scheduler_missed_deadlines();
+    test_task_scheduler_cpu_share();
+
+    FINISH
+}
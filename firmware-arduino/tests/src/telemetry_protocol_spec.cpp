@@ -0,0 +1,78 @@
+#include "telemetry_protocol.h"
+#include "BDDTest.h"
+#include <cmath>
+
+SystemControllerStatusMessage statusMessage() {
+    SystemControllerStatusMessage message{};
+    message.timestamp = get_absolute_time();
+    message.brewTemperature = 93.456f;
+    message.brewSetPoint = 94.f;
+    message.serviceTemperature = 121.5f;
+    message.serviceSetPoint = 122.f;
+    message.brewPidParameters.p = 1.2345f;
+    message.brewPidParameters.i = -0.5f;
+    message.currentlyBrewing = true;
+    return message;
+}
+
+int test_telemetry_frame_scaling() {
+    IT("scales temperatures to centidegrees and PID terms to thousandths");
+    TelemetryFrame frame = create_telemetry_frame(statusMessage(), -2.f, 41.6f, 7, -60, false);
+
+    IS_EQUAL(frame.schemaId, TELEMETRY_SCHEMA_ID);
+    IS_EQUAL(frame.sequence, 7);
+    IS_EQUAL(frame.brewTemperature, 9146);
+    IS_EQUAL(frame.brewSetPoint, 9200);
+    IS_EQUAL(frame.serviceTemperature, 12150);
+    IS_EQUAL(frame.brewP, 1235);
+    IS_EQUAL(frame.brewI, -500);
+    IS_EQUAL(frame.rp2040Temperature, 42);
+    IS_EQUAL(frame.rssi, -60);
+    IS_EQUAL(frame.flags, TELEMETRY_FLAG_BREWING);
+
+    END_IT
+}
+
+int test_telemetry_frame_clamped() {
+    IT("clamps values that don't fit in an int16");
+    SystemControllerStatusMessage message = statusMessage();
+    message.brewPidParameters.integral = 100.f;
+    message.brewPidParameters.d = -100.f;
+
+    TelemetryFrame frame = create_telemetry_frame(message, 0.f, 40.f, 1, 0, false);
+    IS_EQUAL(frame.brewIntegral, INT16_MAX);
+    IS_EQUAL(frame.brewD, INT16_MIN);
+
+    END_IT
+}
+
+int test_telemetry_frame_not_finite() {
+    IT("sends INT16_MIN for values without a reading yet");
+    SystemControllerStatusMessage message = statusMessage();
+    message.brewTemperature = NAN;
+    message.serviceTemperature = INFINITY;
+    message.brewPidParameters.p = -INFINITY;
+
+    TelemetryFrame frame = create_telemetry_frame(message, NAN, NAN, 1, 0, false);
+    IS_EQUAL(frame.brewTemperature, INT16_MIN);
+    IS_EQUAL(frame.brewSetPoint, INT16_MIN);
+    IS_EQUAL(frame.serviceTemperature, INT16_MIN);
+    IS_EQUAL(frame.brewP, INT16_MIN);
+    IS_EQUAL(frame.serviceSetPoint, 12200);
+
+    ShotSample sample = create_shot_sample(message, 0.f);
+    IS_EQUAL(sample.brewTemperature, INT16_MIN);
+    IS_EQUAL(sample.brewSetPoint, 9400);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Telemetry protocol");
+    test_telemetry_frame_scaling();
+    test_telemetry_frame_clamped();
+    test_telemetry_frame_not_finite();
+
+    FINISH
+}
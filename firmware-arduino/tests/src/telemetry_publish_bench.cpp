@@ -0,0 +1,144 @@
+#include "telemetry_protocol.h"
+#include "PubSubClient.h"
+#include "ShimClient.h"
+#include <chrono>
+#include <cstdio>
+
+// What a state publish costs against a telemetry frame, both the way NetworkController publishes them over MQTT 5.
+// Bytes are what goes on the air, MQTT header and properties included. Host time only shows the CPU side.
+//
+// ArduinoJson isn't available on the host, so the state document is written with snprintf, with the keys and values
+// createStateDocument() fills in. ArduinoJson formats floats a little differently, which can move the size by a few
+// bytes.
+
+#define STATE_TOPIC "lcc/e6614103e7234c2a/state"
+#define TELEMETRY_TOPIC "lcc/e6614103e7234c2a/tele"
+#define MESSAGE_EXPIRY_S 60
+#define ITERATIONS 100000
+
+static SystemControllerStatusMessage statusMessage() {
+    SystemControllerStatusMessage message{};
+    message.timestamp = get_absolute_time();
+    message.lastSleepModeExitAt = get_absolute_time();
+    message.state = SYSTEM_CONTROLLER_STATE_WARM;
+    message.brewTemperature = 93.47f;
+    message.brewSetPoint = 94.f;
+    message.serviceTemperature = 121.83f;
+    message.serviceSetPoint = 122.f;
+    message.brewPidParameters = PidRuntimeParameters{true, 1.2734f, 0.0412f, -0.3317f, 4.1206f};
+    message.servicePidParameters = PidRuntimeParameters{true, 0.8121f, 0.0093f, -0.1125f, 2.5013f};
+    return message;
+}
+
+static size_t createStateDocument(const SystemControllerStatusMessage &message, char* buffer, size_t size) {
+    const PidRuntimeParameters &brew = message.brewPidParameters;
+    const PidRuntimeParameters &service = message.servicePidParameters;
+
+    return snprintf(buffer, size,
+                    "{\"s\":\"Warm\",\"i\":{\"rx\":true,\"tx\":true,\"b\":false,\"wr\":false,\"br\":\"None\"},"
+                    "\"bp\":{\"p\":%.9g,\"i\":%.9g,\"d\":%.9g,\"in\":%.9g,\"hm\":%s},"
+                    "\"sp\":{\"p\":%.9g,\"i\":%.9g,\"d\":%.9g,\"in\":%.9g,\"hm\":%s},"
+                    "\"r\":%d,\"bt\":%.9g,\"st\":%.9g,\"wt\":false,\"tsb\":%.9g,\"lsea\":%.9g,\"asi\":%.9g,\"ls\":%.9g,\"rt\":%.9g}",
+                    brew.p, brew.i, brew.d, brew.integral, brew.hysteresisMode ? "true" : "false",
+                    service.p, service.i, service.d, service.integral, service.hysteresisMode ? "true" : "false",
+                    -61, message.brewTemperature - 2.f, message.serviceTemperature,
+                    (double)to_us_since_boot(message.timestamp) / 60000000.f,
+                    (double)to_us_since_boot(message.lastSleepModeExitAt) / 60000000.f,
+                    42.5f, 27.3f, 38.9f);
+}
+
+// Connected over MQTT 5, with a topic alias maximum of 10
+static void connect(PubSubClient &client, ShimClient &shimClient) {
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x0A };
+    shimClient.respond(connack, sizeof(connack));
+
+    client.setBufferSize(4096);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.connect("smart-lcc");
+}
+
+// Like NetworkController::publishMqttStat() and publishJson(): serialized straight into the packet buffer, no alias
+static bool publishState(PubSubClient &client, const SystemControllerStatusMessage &message) {
+    size_t capacity;
+
+    client.setMessageExpiry(MESSAGE_EXPIRY_S);
+    uint8_t* payload = client.beginPublishInPlace(STATE_TOPIC, &capacity);
+    size_t length = createStateDocument(message, (char*)payload, capacity);
+    bool published = client.endPublishInPlace(length, false);
+    client.setMessageExpiry(0);
+
+    return published;
+}
+
+// Like NetworkController::publishMqttTelemetry()
+static bool publishTelemetry(PubSubClient &client, const SystemControllerStatusMessage &message, uint32_t sequence) {
+    TelemetryFrame frame = create_telemetry_frame(message, -2.f, 38.9f, sequence, -61, false);
+
+    client.setMessageExpiry(MESSAGE_EXPIRY_S);
+    client.setTopicAliasing(true);
+    bool published = client.publish(TELEMETRY_TOPIC, (const uint8_t *)&frame, sizeof(frame), false);
+    client.setTopicAliasing(false);
+    client.setMessageExpiry(0);
+
+    return published;
+}
+
+static void report(const char* name, size_t payload, uint16_t firstBytes, uint16_t bytes, std::chrono::steady_clock::duration elapsed) {
+    double us = std::chrono::duration<double, std::micro>(elapsed).count() / ITERATIONS;
+
+    printf("%-10s %4zu B payload, %4u B on the air (%u B first), %6.3f us per publish\n", name, payload, bytes, firstBytes, us);
+}
+
+static void benchState() {
+    ShimClient shimClient;
+    PubSubClient client(shimClient);
+    SystemControllerStatusMessage message = statusMessage();
+    char document[1024];
+
+    connect(client, shimClient);
+
+    uint16_t received = shimClient.received();
+    publishState(client, message);
+    uint16_t firstBytes = shimClient.received() - received;
+
+    received = shimClient.received();
+    publishState(client, message);
+    uint16_t bytes = shimClient.received() - received;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        publishState(client, message);
+    }
+
+    report("state", createStateDocument(message, document, sizeof(document)), firstBytes, bytes, std::chrono::steady_clock::now() - start);
+}
+
+static void benchTelemetry() {
+    ShimClient shimClient;
+    PubSubClient client(shimClient);
+    SystemControllerStatusMessage message = statusMessage();
+
+    connect(client, shimClient);
+
+    // The first frame establishes the alias, every one after that only carries the alias
+    uint16_t received = shimClient.received();
+    publishTelemetry(client, message, 0);
+    uint16_t firstBytes = shimClient.received() - received;
+
+    received = shimClient.received();
+    publishTelemetry(client, message, 1);
+    uint16_t bytes = shimClient.received() - received;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        publishTelemetry(client, message, i + 2);
+    }
+
+    report("telemetry", sizeof(TelemetryFrame), firstBytes, bytes, std::chrono::steady_clock::now() - start);
+}
+
+int main() {
+    benchState();
+    benchTelemetry();
+    return 0;
+}
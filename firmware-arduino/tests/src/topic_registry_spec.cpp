@@ -0,0 +1,52 @@
+#include "TopicRegistry.h"
+#include "BDDTest.h"
+#include <cstring>
+
+int test_topic_registry_build() {
+    IT("formats every topic into the arena, or fails if they don't fit");
+    TopicRegistry topics;
+    IS_FALSE(topics.isBuilt());
+    IS_TRUE(topics.build("lcc", "LCC-A1B2C3"));
+    IS_TRUE(topics.isBuilt());
+    IS_TRUE(strcmp(topics.get(TOPIC_ID_STATE), "lcc/LCC-A1B2C3/state") == 0);
+    IS_TRUE(strcmp(topics.get(TOPIC_ID_DISCOVERY_WILDCARD), "homeassistant/+/lcc/+/config") == 0);
+
+    char prefix[TOPIC_ARENA_SIZE / 4];
+    memset(prefix, 'p', sizeof(prefix) - 1);
+    prefix[sizeof(prefix) - 1] = '\0';
+    IS_FALSE(topics.build(prefix, "LCC-A1B2C3"));
+    IS_FALSE(topics.isBuilt());
+
+    END_IT
+}
+
+int test_topic_registry_lookup() {
+    IT("looks topics up by length, without a NUL at the end");
+    TopicRegistry topics;
+    topics.build("lcc", "LCC-A1B2C3");
+
+    // Like the receive buffer, where the topic is followed by the payload
+    const char received[] = {'l', 'c', 'c', '/', 'L', 'C', 'C', '-', 'A', '1', 'B', '2', 'C', '3', '/', 'c', 'm', 'd',
+                             '{', '"', 'x', '"', '}'};
+    size_t topicLength = strlen("lcc/LCC-A1B2C3/cmd");
+
+    IS_TRUE(topics.lookup(received, topicLength) == TOPIC_ID_COMMAND);
+    IS_FALSE(topics.lookup(received, topicLength - 1).has_value());
+    IS_FALSE(topics.lookup(received, topicLength + 1).has_value());
+    IS_FALSE(topics.lookup(received, 0).has_value());
+
+    const char* state = "lcc/LCC-A1B2C3/state";
+    IS_TRUE(topics.lookup(state, strlen(state)) == TOPIC_ID_STATE);
+    IS_FALSE(topics.lookup("lcc/LCC-A1B2C4/state", strlen(state)).has_value());
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Topic registry");
+    test_topic_registry_build();
+    test_topic_registry_lookup();
+
+    FINISH
+}
@@ -0,0 +1,98 @@
+#include "utils/sha1.h"
+#include "utils/base64.h"
+#include "BDDTest.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+std::string hex(const uint8_t* data, size_t length) {
+    std::string out;
+    char digit[3];
+
+    for (size_t i = 0; i < length; i++) {
+        snprintf(digit, sizeof(digit), "%02x", data[i]);
+        out += digit;
+    }
+
+    return out;
+}
+
+std::string sha1Hex(const std::string &data) {
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    sha1((const uint8_t*)data.data(), data.size(), digest);
+    return hex(digest, sizeof(digest));
+}
+
+std::string base64(const char* data) {
+    char out[64];
+    size_t length = base64_encode((const uint8_t*)data, strlen(data), out, sizeof(out));
+    return std::string(out, length);
+}
+
+int test_sha1_vectors() {
+    IT("hashes the FIPS 180 test vectors, across block boundaries");
+
+    IS_TRUE(sha1Hex("") == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    IS_TRUE(sha1Hex("abc") == "a9993e364706816aba3e25717850c26c9cd0d89d");
+    // 56 bytes, so the length no longer fits the first block
+    IS_TRUE(sha1Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") == "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+    IS_TRUE(sha1Hex(std::string(1000000, 'a')) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
+    END_IT
+}
+
+int test_base64_padding() {
+    IT("encodes with the standard alphabet and padding");
+
+    IS_TRUE(base64("") == "");
+    IS_TRUE(base64("f") == "Zg==");
+    IS_TRUE(base64("fo") == "Zm8=");
+    IS_TRUE(base64("foo") == "Zm9v");
+    IS_TRUE(base64("foob") == "Zm9vYg==");
+    IS_TRUE(base64("fooba") == "Zm9vYmE=");
+    IS_TRUE(base64("foobar") == "Zm9vYmFy");
+
+    const uint8_t high[] = { 0xFB, 0xFF, 0xBF };
+    char out[8];
+    IS_EQUAL(base64_encode(high, sizeof(high), out, sizeof(out)), 4);
+    IS_TRUE(strcmp(out, "+/+/") == 0);
+
+    END_IT
+}
+
+int test_base64_output_too_small() {
+    IT("encodes nothing if the output and its terminator don't fit");
+    char out[8];
+
+    IS_EQUAL(base64_encode((const uint8_t*)"foo", 3, out, 4), 0);
+    IS_EQUAL(base64_encode((const uint8_t*)"foo", 3, out, 5), 4);
+    IS_TRUE(strcmp(out, "Zm9v") == 0);
+
+    END_IT
+}
+
+int test_websocket_accept_key() {
+    IT("derives the accept key of RFC 6455's sample handshake");
+    // The same steps as TelemetryWebSocketServer::completeHandshake()
+    const char keyAndGuid[] = "dGhlIHNhbXBsZSBub25jZQ==" "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    sha1((const uint8_t*)keyAndGuid, strlen(keyAndGuid), digest);
+
+    char accept[BASE64_ENCODED_LENGTH(SHA1_DIGEST_SIZE) + 1];
+    IS_EQUAL(base64_encode(digest, sizeof(digest), accept, sizeof(accept)), 28);
+    IS_TRUE(strcmp(accept, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == 0);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("WebSocket accept key");
+    test_sha1_vectors();
+    test_base64_padding();
+    test_base64_output_too_small();
+    test_websocket_accept_key();
+
+    FINISH
+}
@@ -0,0 +1,126 @@
+#include "WifiSupervisor.h"
+#include <WiFi_Generic.h>
+#include "BDDTest.h"
+
+// Runs the supervisor through backoff and any reset up to the next attempt, and lets that attempt time out
+void failAttempt(WifiSupervisor &supervisor) {
+    while (supervisor.update(WL_IDLE_STATUS) != WIFI_ACTION_CONNECT) {
+        host_time_advance_ms(100);
+    }
+
+    host_time_advance_ms(WIFI_CONNECT_TIMEOUT_MS);
+    supervisor.update(WL_IDLE_STATUS);
+}
+
+void connect(WifiSupervisor &supervisor) {
+    while (supervisor.update(WL_IDLE_STATUS) != WIFI_ACTION_CONNECT) {
+        host_time_advance_ms(100);
+    }
+
+    supervisor.update(WL_CONNECTED);
+}
+
+int test_wifi_supervisor_backoff() {
+    IT("doubles the backoff up to the max, with up to half of it jitter");
+    WifiSupervisor supervisor;
+    uint32_t atMax[2] = {0, 0};
+
+    for (uint8_t failures = 1; failures <= 12; failures++) {
+        failAttempt(supervisor);
+        IS_EQUAL(supervisor.getState(), WIFI_LINK_BACKOFF);
+
+        uint32_t delay = failures <= 7 ? WIFI_BACKOFF_BASE_MS << (failures - 1) : WIFI_BACKOFF_MAX_MS;
+        IS_TRUE(supervisor.getBackoffMs() >= delay / 2);
+        IS_TRUE(supervisor.getBackoffMs() <= delay);
+
+        if (failures > 10) {
+            atMax[failures - 11] = supervisor.getBackoffMs();
+        }
+    }
+
+    IS_TRUE(atMax[0] != atMax[1]);
+
+    // A connection starts over from the base
+    connect(supervisor);
+    IS_TRUE(supervisor.isConnected());
+    IS_EQUAL(supervisor.getBackoffMs(), 0);
+    IS_EQUAL(supervisor.update(WL_DISCONNECTED), WIFI_ACTION_CONNECT);
+    host_time_advance_ms(WIFI_CONNECT_TIMEOUT_MS);
+    supervisor.update(WL_DISCONNECTED);
+    IS_TRUE(supervisor.getBackoffMs() <= WIFI_BACKOFF_BASE_MS);
+
+    END_IT
+}
+
+int test_wifi_supervisor_reset_cadence() {
+    IT("resets the module after every few failed attempts, however long the outage");
+    WifiSupervisor supervisor;
+
+    for (uint16_t failures = 1; failures <= 300; failures++) {
+        failAttempt(supervisor);
+    }
+
+    // The reset after the last failure is still due
+    IS_EQUAL(supervisor.getResets(), 300 / WIFI_RESET_AFTER_FAILURES - 1);
+
+    IS_EQUAL(supervisor.update(WL_IDLE_STATUS), WIFI_ACTION_NONE);
+    host_time_advance_ms(WIFI_BACKOFF_MAX_MS);
+    IS_EQUAL(supervisor.update(WL_IDLE_STATUS), WIFI_ACTION_DEINIT_MODULE);
+    IS_TRUE(supervisor.isResetting());
+    IS_EQUAL(supervisor.update(WL_IDLE_STATUS), WIFI_ACTION_NONE);
+    host_time_advance_ms(WIFI_RESET_HOLD_MS);
+    IS_EQUAL(supervisor.update(WL_IDLE_STATUS), WIFI_ACTION_INIT_MODULE);
+    IS_EQUAL(supervisor.update(WL_IDLE_STATUS), WIFI_ACTION_CONNECT);
+
+    END_IT
+}
+
+int test_wifi_supervisor_roam() {
+    IT("roams off a link that stays weak, but not more than once in a while");
+    WifiSupervisor supervisor;
+    connect(supervisor);
+
+    // A good reading, or none at all, starts the wait over
+    supervisor.reportRssi(-85);
+    host_time_advance_ms(WIFI_ROAM_WEAK_MS / 2);
+    supervisor.reportRssi(-70);
+    supervisor.reportRssi(-85);
+    host_time_advance_ms(WIFI_ROAM_WEAK_MS / 2);
+    supervisor.reportRssi(0);
+    supervisor.reportRssi(-85);
+    host_time_advance_ms(WIFI_ROAM_WEAK_MS - 1);
+    supervisor.reportRssi(-85);
+    IS_EQUAL(supervisor.update(WL_CONNECTED), WIFI_ACTION_NONE);
+
+    host_time_advance_ms(1);
+    supervisor.reportRssi(-85);
+    IS_EQUAL(supervisor.update(WL_CONNECTED), WIFI_ACTION_DISCONNECT);
+    IS_EQUAL(supervisor.getRoams(), 1);
+
+    // Reconnected right away, and not counted as a disconnect
+    IS_EQUAL(supervisor.update(WL_DISCONNECTED), WIFI_ACTION_CONNECT);
+    supervisor.update(WL_CONNECTED);
+    IS_EQUAL(supervisor.getDisconnects(), 0);
+
+    supervisor.reportRssi(-85);
+    host_time_advance_ms(WIFI_ROAM_WEAK_MS);
+    supervisor.reportRssi(-85);
+    IS_EQUAL(supervisor.update(WL_CONNECTED), WIFI_ACTION_NONE);
+
+    host_time_advance_ms(WIFI_ROAM_MIN_INTERVAL_MS - WIFI_ROAM_WEAK_MS);
+    supervisor.reportRssi(-85);
+    IS_EQUAL(supervisor.update(WL_CONNECTED), WIFI_ACTION_DISCONNECT);
+    IS_EQUAL(supervisor.getRoams(), 2);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("WiFi supervisor");
+    test_wifi_supervisor_backoff();
+    test_wifi_supervisor_reset_cadence();
+    test_wifi_supervisor_roam();
+
+    FINISH
+}